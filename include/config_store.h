@@ -0,0 +1,130 @@
+/*
+ * Persistent Configuration Store
+ * Small log-structured key/value store in the last sectors of the flash.
+ *
+ * Each sector starts with a header (magic, generation, CRC) followed by
+ * records appended one after the other (key, length, CRC-16, value). The
+ * newest value of a key is the last record for it in the active sector; a
+ * zero-length record removes the key. When the active sector is full, the
+ * next sector of the ring is erased and the current values are rewritten
+ * there compacted, with a higher generation: erases rotate over every
+ * sector of the store.
+ *
+ * Boot only reads the sector headers and scans the newest sector (one
+ * sector of memory-mapped reads at most). Changes are kept in RAM and
+ * written by config_store_task(), which the main loop calls only when a
+ * flash stall cannot hurt (see main.c); the flash operations run through
+ * flash_safe_execute(), which parks the other core and masks IRQs.
+ */
+
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//--------------------------------------------------------------------
+// Configuration
+//--------------------------------------------------------------------
+#define CONFIG_STORE_SECTORS    4           // Sectors at the end of the flash
+#define CONFIG_VALUE_MAX        16          // Largest value (bytes)
+
+//--------------------------------------------------------------------
+// Keys (never renumber: the ids are stored in flash)
+//--------------------------------------------------------------------
+typedef enum {
+    CONFIG_KEY_POLL_INTERVAL_US = 1,    // u32: Joybus poll period (default rate)
+    CONFIG_KEY_REPORT_REFRESH_MS = 2,   // u32: unchanged report keep-alive
+    CONFIG_KEY_HIGH_RATE = 3,           // u32: 1 = 1000 Hz mode (a strap pin wins)
+    CONFIG_KEY_DATA_PINS = 4,           // u8[ports]: controller data GPIOs
+    CONFIG_KEY_LED_PINS = 5,            // u8[ports]: status LED GPIOs (0 = none)
+    CONFIG_KEYS
+} config_key_t;
+
+typedef enum {
+    CONFIG_TYPE_U32,                    // One little-endian 32-bit value
+    CONFIG_TYPE_U8_LIST                 // One byte per port
+} config_type_t;
+
+//--------------------------------------------------------------------
+// Store Status
+//--------------------------------------------------------------------
+typedef struct {
+    uint32_t generation;        // Generation of the active sector (0 = empty store)
+    uint8_t  sector;            // Active sector index in the store
+    uint16_t used;              // Bytes used in the active sector
+    uint32_t writes;            // Records written since boot
+    uint32_t compactions;       // Sector rewrites since boot
+    bool     pending;           // Changes waiting for config_store_task()
+} config_store_status_t;
+
+//--------------------------------------------------------------------
+// Functions
+//--------------------------------------------------------------------
+
+/**
+ * Load the newest sector (call once at boot, before reading values)
+ */
+void config_store_init(void);
+
+/**
+ * Read a value
+ * @param key Configuration key
+ * @param value Filled with the value (at most size bytes)
+ * @param size Size of the value buffer
+ * @return Value length, 0 if the key is not set
+ */
+uint8_t config_store_get(config_key_t key, void *value, uint8_t size);
+
+/**
+ * Read a 32-bit value
+ * @param key Configuration key
+ * @param value Filled with the value if the key is set
+ * @return true if the key is set
+ */
+bool config_store_get_u32(config_key_t key, uint32_t *value);
+
+/**
+ * Change a value (RAM now, flash on the next config_store_task)
+ * @param key Configuration key
+ * @param value New value
+ * @param len Value length (0 = remove the key)
+ * @return false if the key or length is invalid
+ */
+bool config_store_set(config_key_t key, const void *value, uint8_t len);
+
+/**
+ * Write pending changes to flash (blocks for the flash operation:
+ * about 1 ms per record, tens of ms when a sector has to be erased)
+ * @return true if something was written
+ */
+bool config_store_task(void);
+
+/**
+ * Store status
+ * @param status Filled with the status
+ */
+void config_store_get_status(config_store_status_t *status);
+
+/**
+ * Key name for the console (NULL if unknown)
+ * @param key Configuration key
+ * @return Key name
+ */
+const char *config_key_name(config_key_t key);
+
+/**
+ * Key from its console name
+ * @param name Key name
+ * @return Key, or CONFIG_KEYS if unknown
+ */
+config_key_t config_key_from_name(const char *name);
+
+/**
+ * Value type of a key
+ * @param key Configuration key
+ * @return Value type
+ */
+config_type_t config_key_type(config_key_t key);
+
+#endif /* CONFIG_STORE_H */
@@ -0,0 +1,59 @@
+/*
+ * CPU Load Counter
+ * Per-core utilisation measurement (busy time / wall time over a window)
+ */
+
+#ifndef CPU_LOAD_H
+#define CPU_LOAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//--------------------------------------------------------------------
+// Configuration
+//--------------------------------------------------------------------
+#define CPU_LOAD_WINDOW_US  1000000     // Measurement window (1 second)
+
+//--------------------------------------------------------------------
+// CPU Load Counter (one per core, only touched by its own core)
+//--------------------------------------------------------------------
+typedef struct {
+    uint64_t window_start_us;       // Start of current window
+    uint64_t busy_start_us;         // Start of current busy section
+    uint64_t busy_us;               // Busy time accumulated in current window
+    bool in_busy;                   // Inside a busy section
+    volatile uint32_t load_permille; // Load of last completed window (0-1000)
+} cpu_load_t;
+
+//--------------------------------------------------------------------
+// Functions
+//--------------------------------------------------------------------
+
+/**
+ * Initialize a CPU load counter
+ * @param load Pointer to counter
+ */
+void cpu_load_init(cpu_load_t *load);
+
+/**
+ * Mark the beginning of a busy section
+ * @param load Pointer to counter
+ */
+void cpu_load_begin(cpu_load_t *load);
+
+/**
+ * Mark the end of a busy section
+ * @param load Pointer to counter
+ * @return Duration of the section in microseconds (0 if none was open)
+ */
+uint32_t cpu_load_end(cpu_load_t *load);
+
+/**
+ * Get load of the last completed window
+ * Safe to call from the other core
+ * @param load Pointer to counter
+ * @return Load in permille (0-1000)
+ */
+uint32_t cpu_load_get_permille(const cpu_load_t *load);
+
+#endif /* CPU_LOAD_H */
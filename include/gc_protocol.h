@@ -0,0 +1,84 @@
+/*
+ * GameCube Controller Protocol Constants
+ * Same Joybus line and bit timing as the N64 controller: the PIO program
+ * sends the 3-byte poll command and receives the 8-byte response as any
+ * other transfer
+ */
+
+#ifndef GC_PROTOCOL_H
+#define GC_PROTOCOL_H
+
+#include <stdint.h>
+
+//--------------------------------------------------------------------
+// GameCube Commands
+//--------------------------------------------------------------------
+#define GC_CMD_POLL         0x40    // Poll: 0x40, mode, rumble (returns 8 bytes)
+#define GC_CMD_ORIGIN       0x41    // Rest position of the analog axes (returns 10 bytes)
+
+#define GC_POLL_MODE        0x03    // Full 8-bit sticks and triggers, no analog A/B
+#define GC_POLL_RUMBLE_OFF  0x00
+
+//--------------------------------------------------------------------
+// GameCube Response Sizes
+//--------------------------------------------------------------------
+#define GC_POLL_CMD_SIZE    3
+#define GC_POLL_SIZE        8       // Buttons (2 bytes), 6 axes
+#define GC_ORIGIN_SIZE      10      // Buttons (2 bytes), 6 axes, 2 unused bytes
+#define GC_AXES             6       // Main stick, C-stick, L and R triggers
+
+//--------------------------------------------------------------------
+// INFO Response
+//--------------------------------------------------------------------
+#define GC_INFO_ID          0x0900  // Identifier bits shared by GameCube controllers
+#define GC_INFO_ID_MASK     0x0900  // (0x0900 wired, 0xE9A0 WaveBird)
+
+//--------------------------------------------------------------------
+// Byte 0 - Status and Buttons
+//--------------------------------------------------------------------
+#define GC_NEED_ORIGIN      (1 << 5)    // Controller recalibrated: read the origin again
+#define GC_MASK_START       (1 << 4)
+#define GC_MASK_Y           (1 << 3)
+#define GC_MASK_X           (1 << 2)
+#define GC_MASK_B           (1 << 1)
+#define GC_MASK_A           (1 << 0)
+#define GC_MASK_BUTTONS0    0x1F
+
+//--------------------------------------------------------------------
+// Byte 1 - Shoulder Buttons and D-Pad
+//--------------------------------------------------------------------
+#define GC_MASK_L           (1 << 6)    // L fully pressed (digital click)
+#define GC_MASK_R           (1 << 5)    // R fully pressed (digital click)
+#define GC_MASK_Z           (1 << 4)
+#define GC_MASK_DPAD        0x0F
+
+// D-Pad values (Left and Right swapped compared to the N64 controller)
+#define GC_DPAD_UP          0x08
+#define GC_DPAD_DOWN        0x04
+#define GC_DPAD_RIGHT       0x02
+#define GC_DPAD_LEFT        0x01
+
+//--------------------------------------------------------------------
+// Bytes 2-7 - Analog Axes (unsigned, ~128 at rest)
+//--------------------------------------------------------------------
+#define GC_STICK_MAX        100     // Typical deflection from the origin
+#define GC_CSTICK_THRESHOLD 48      // C-stick deflection reported as a C button
+
+//--------------------------------------------------------------------
+// GameCube Controller State Structure
+// Parsed response: axes are relative to the origin read at connection
+//--------------------------------------------------------------------
+typedef struct {
+    uint8_t buttons0;       // Start, Y, X, B, A
+    uint8_t buttons1;       // L, R, Z, D-Pad
+    int8_t  stick_x;        // Main stick X (about -100 to +100)
+    int8_t  stick_y;        // Main stick Y
+    int8_t  cstick_x;       // C-stick X
+    int8_t  cstick_y;       // C-stick Y
+    uint8_t trigger_l;      // L analog travel (0 at rest)
+    uint8_t trigger_r;      // R analog travel
+} gc_state_t;
+
+_Static_assert(sizeof(gc_state_t) == GC_POLL_SIZE, "gc_state_t must match the poll response");
+
+#endif /* GC_PROTOCOL_H */
@@ -0,0 +1,99 @@
+/*
+ * Latency Statistics
+ * Fixed-bucket latency histograms per controller port and pipeline stage,
+ * from the Joybus command to the host reading the HID report:
+ *
+ *   command start -> response complete      LATENCY_WIRE
+ *   response complete -> report built       LATENCY_CONVERT
+ *   report built -> report queued on USB    LATENCY_QUEUE
+ *   report queued -> report read by host    LATENCY_HOST
+ *   response complete -> report read        LATENCY_TOTAL
+ *
+ * Histograms accumulate until reset (they are read by the GET_FEATURE
+ * report and the UART dump without being cleared). Each stage of a port is
+ * written by a single core; readers may see a histogram mid-update.
+ */
+
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_descriptors.h"
+
+//--------------------------------------------------------------------
+// Configuration
+//--------------------------------------------------------------------
+#define LATENCY_BUCKETS     13          // 1-2-5 series, 10 us to 50 ms, then overflow
+
+typedef enum {
+    LATENCY_WIRE,
+    LATENCY_CONVERT,
+    LATENCY_QUEUE,
+    LATENCY_HOST,
+    LATENCY_TOTAL,
+    LATENCY_STAGES
+} latency_stage_t;
+
+//--------------------------------------------------------------------
+// Histogram
+//--------------------------------------------------------------------
+typedef struct {
+    uint32_t count;
+    uint64_t sum_us;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t buckets[LATENCY_BUCKETS];  // buckets[i]: value <= latency_bucket_limit_us[i]
+} latency_hist_t;
+
+// Upper limit of each bucket (last one: UINT32_MAX)
+extern const uint32_t latency_bucket_limit_us[LATENCY_BUCKETS];
+
+//--------------------------------------------------------------------
+// Functions
+//--------------------------------------------------------------------
+
+/**
+ * Clear every histogram
+ */
+void latency_stats_init(void);
+
+/**
+ * Add one latency sample
+ * @param port Controller port index
+ * @param stage Pipeline stage
+ * @param us Latency in microseconds
+ */
+void latency_stats_record(uint8_t port, latency_stage_t stage, uint32_t us);
+
+/**
+ * Copy the histogram of a port and stage (not cleared)
+ * @param port Controller port index
+ * @param stage Pipeline stage
+ * @param hist Filled with the histogram
+ */
+void latency_stats_get(uint8_t port, latency_stage_t stage, latency_hist_t *hist);
+
+/**
+ * Clear the histograms of a port
+ * @param port Controller port index
+ */
+void latency_stats_reset(uint8_t port);
+
+/**
+ * Percentile upper bound from a histogram
+ * @param hist Histogram
+ * @param permille Percentile in 1/1000 (500 = median, 990 = p99)
+ * @return Upper limit of the bucket holding the percentile, capped to
+ *         the maximum seen (0 if empty)
+ */
+uint32_t latency_hist_percentile(const latency_hist_t *hist, uint32_t permille);
+
+/**
+ * Short name of a stage (for logs)
+ * @param stage Pipeline stage
+ * @return Stage name
+ */
+const char *latency_stage_name(latency_stage_t stage);
+
+#endif /* LATENCY_STATS_H */
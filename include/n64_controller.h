@@ -1,7 +1,7 @@
 /*
  * N64 Controller Interface
  * Functions for communicating with N64 controller via PIO
- * Supports dual controllers
+ * Supports up to 8 controllers (one PIO state machine each)
  */
 
 #ifndef N64_CONTROLLER_H
@@ -11,33 +11,86 @@
 #include <stdbool.h>
 #include "hardware/pio.h"
 #include "n64_protocol.h"
+#include "n64_device.h"
 #include "usb_descriptors.h"
 
 //--------------------------------------------------------------------
 // Configuration - GPIO Pins for N64 data lines
+// One pin per port, generated from the PICO_N64_DATA_PINS CMake list
 //--------------------------------------------------------------------
-#define N64_DATA_PIN_1      18      // GPIO pin for controller 1
-#define N64_DATA_PIN_2      19      // GPIO pin for controller 2
+#ifndef N64_DATA_PIN_LIST
+#define N64_DATA_PIN_LIST   18, 19  // GPIO pins for controllers 1 and 2
+#endif
 
 // Array of pins for easy iteration
-static const uint N64_DATA_PINS[MAX_CONTROLLERS] = {
-    N64_DATA_PIN_1,
-    N64_DATA_PIN_2
-};
+static const uint N64_DATA_PINS[MAX_CONTROLLERS] = { N64_DATA_PIN_LIST };
 
 //--------------------------------------------------------------------
 // Configuration - Optional External Status LEDs
-// Set to 0 to disable, or GPIO pin number to enable
+// Generated from the PICO_N64_LED_PINS CMake list; 0 (or a missing
+// entry) disables the LED of that port
 // LEDs are active HIGH (on when controller connected)
 //--------------------------------------------------------------------
-#define N64_LED_PIN_1       16      // External LED for controller 1 (0 = disabled)
-#define N64_LED_PIN_2       17      // External LED for controller 2 (0 = disabled)
+#ifndef N64_LED_PIN_LIST
+#define N64_LED_PIN_LIST    16, 17  // External LEDs for controllers 1 and 2
+#endif
 
 // Array of LED pins for easy iteration
-static const uint N64_LED_PINS[MAX_CONTROLLERS] = {
-    N64_LED_PIN_1,
-    N64_LED_PIN_2
-};
+static const uint N64_LED_PINS[MAX_CONTROLLERS] = { N64_LED_PIN_LIST };
+
+//--------------------------------------------------------------------
+// Transfer Timing
+//--------------------------------------------------------------------
+#define N64_TIMEOUT_FIRST_US    600     // Max wait for the first response byte
+#define N64_TIMEOUT_BYTE_US     40      // Extra allowance per response byte
+#define N64_FRAME_GAP_US        10      // Idle gap after the stop bit before next command
+#define N64_TIMEOUT_CMD_BYTE_US 32      // Wire time of each command byte after the first
+
+// Responses up to this size are autopushed as a single 32-bit FIFO word
+// (0 = one FIFO word per byte for every response, for comparison builds)
+#ifndef N64_RX_WORD_MAX
+#define N64_RX_WORD_MAX         4
+#endif
+
+// Longest command (pak write: command, address, 32 data bytes) and response
+#define N64_CMD_MAX_LEN         35
+#define N64_RESPONSE_MAX_LEN    256
+
+// TX FIFO words of the longest command: header word with the first byte,
+// then 4 command bytes per word. Up to 4 words go straight into the TX FIFO,
+// longer commands are fed by a second DMA channel.
+#define N64_TX_WORDS_MAX        (1 + (N64_CMD_MAX_LEN - 1 + 3) / 4)
+#define N64_TX_FIFO_WORDS       4
+
+//--------------------------------------------------------------------
+// Asynchronous Transfer Status
+//--------------------------------------------------------------------
+typedef enum {
+    N64_XFER_IDLE,          // No transfer in progress
+    N64_XFER_BUSY,          // Command sent, response not complete yet
+    N64_XFER_DONE,          // Response complete
+    N64_XFER_ERROR,         // Timeout, short frame or controller unavailable
+    N64_XFER_ABSENT         // No start bit in the presence window (empty port)
+} n64_xfer_status_t;
+
+//--------------------------------------------------------------------
+// Device Read Step (what n64_read_start sends next)
+//--------------------------------------------------------------------
+typedef enum {
+    N64_DEVICE_STEP_IDENTIFY,   // INFO: pick the driver
+    N64_DEVICE_STEP_CALIBRATE,  // Driver's calibration command (GameCube origin)
+    N64_DEVICE_STEP_POLL        // Driver's poll command
+} n64_device_step_t;
+
+//--------------------------------------------------------------------
+// Transfer Duration Statistics (command release to end of frame)
+//--------------------------------------------------------------------
+typedef struct {
+    uint32_t count;         // Completed transfers
+    uint64_t sum_us;        // Total duration
+    uint32_t min_us;        // Shortest transfer
+    uint32_t max_us;        // Longest transfer
+} n64_xfer_stats_t;
 
 //--------------------------------------------------------------------
 // N64 Controller Handle
@@ -48,6 +101,35 @@ typedef struct {
     uint offset;            // PIO program offset
     uint pin;               // Data GPIO pin
     bool connected;         // Controller connection status
+    uint8_t info_status;    // Accessory status byte of the last INFO (N64_INFO_PAK_*)
+
+    // Device driver, picked from the INFO identifier once per connection
+    const n64_device_driver_t *driver;  // NULL until identified
+    n64_device_step_t device_step;      // Next read: identify, calibrate or poll
+    n64_device_calib_t calib;           // Calibration read after identification
+    const uint8_t *read_cmd;            // Command bytes of the next read
+    uint8_t read_cmd_len;
+    uint8_t read_len;                   // Response bytes of the next read
+
+    // Asynchronous transfer engine (DMA drains the RX FIFO)
+    int dma_chan;                       // DMA channel (-1 = none)
+    int tx_dma_chan;                    // TX DMA channel, claimed on the first long command
+    volatile n64_xfer_status_t xfer_state;  // Current transfer state
+    uint64_t xfer_start_us;             // Time the command was released
+    volatile uint64_t xfer_done_us;     // End of frame time (set by PIO IRQ)
+    uint64_t xfer_deadline_us;          // Timeout for current transfer
+    uint32_t xfer_timeout_us;           // Timeout from release (command + response)
+    uint64_t next_xfer_us;              // Earliest start of next transfer
+    bool xfer_held;                     // Prepared, waiting for release
+    uint xfer_len;                      // Expected response length
+    uint xfer_dma_count;                // DMA transfers armed (1 word or len bytes)
+    bool xfer_packed;                   // Response arrives as one FIFO word
+    uint8_t *xfer_response;             // Caller's response buffer
+    uint8_t xfer_cmd;                   // Command byte of current transfer
+    uint32_t tx_words[N64_TX_WORDS_MAX];    // Encoded command (TX DMA source)
+    uint rx_shift;                      // Current autopush threshold (bits)
+    uint32_t rx_word;                   // Packed response (DMA destination)
+    uint8_t rx_buf[N64_DEVICE_RESPONSE_MAX];    // Response buffer for device reads
 } n64_controller_t;
 
 //--------------------------------------------------------------------
@@ -63,22 +145,85 @@ typedef struct {
 bool n64_init(n64_controller_t *controller, uint pin);
 
 /**
- * Read current state from N64 controller
+ * Read current state from the device on the port (blocking)
  * @param controller Pointer to controller handle
  * @param state Pointer to state structure to fill
  * @return true if read successful, false if controller disconnected
  */
-bool n64_read(n64_controller_t *controller, n64_state_t *state);
+bool n64_read(n64_controller_t *controller, n64_device_state_t *state);
 
 /**
- * Send command to N64 controller and receive response
+ * Start a command (pak read/write, accessory probes) without waiting for
+ * the response
+ * The command is encoded before returning; the response buffer must stay
+ * valid until the transfer completes. Must be polled with
+ * n64_transfer_poll() from the core that initialized the controller.
  * @param controller Pointer to controller handle
- * @param cmd Command byte to send
- * @param response Buffer for response bytes
- * @param response_len Expected response length
- * @return true if communication successful
+ * @param cmd Command bytes (command, then its arguments)
+ * @param cmd_len Number of command bytes (1 to N64_CMD_MAX_LEN)
+ * @param response Buffer for response bytes (filled by DMA)
+ * @param response_len Expected response length (1 to N64_RESPONSE_MAX_LEN)
+ * @return true if the transfer was started
+ */
+bool n64_command_async(n64_controller_t *controller, const uint8_t *cmd, uint cmd_len,
+                       uint8_t *response, uint response_len);
+
+/**
+ * Start all prepared transfers in the same PIO cycle (per PIO block)
+ * @param controllers Array of controller handles
+ * @param count Number of controllers in the array
+ */
+void n64_transfer_release(n64_controller_t *controllers, uint count);
+
+/**
+ * Check progress of an asynchronous transfer
+ * DONE, ERROR and ABSENT are reported once, then the controller returns to IDLE.
+ * @param controller Pointer to controller handle
+ * @return Current transfer status
+ */
+n64_xfer_status_t n64_transfer_poll(n64_controller_t *controller);
+
+/**
+ * Start an asynchronous device read
+ * An unidentified port gets INFO, then the driver's calibration command if
+ * it has one; after that every read is the driver's poll command.
+ * @param controller Pointer to controller handle
+ * @return true if the transfer was started
+ */
+bool n64_read_start(n64_controller_t *controller);
+
+/**
+ * Prepare a device read for batched release
+ * The command is preloaded in the TX FIFO with the state machine stopped;
+ * n64_transfer_release() starts all prepared ports together.
+ * @param controller Pointer to controller handle
+ * @return true if the transfer was prepared
+ */
+bool n64_read_prepare(n64_controller_t *controller);
+
+/**
+ * Collect the result of an asynchronous device read
+ * Updates the connection status once the transfer has finished. The
+ * identification and calibration reads report a neutral state; an unknown
+ * device is reported ABSENT. After ERROR or ABSENT the port is identified
+ * again on its next answer.
+ * @param controller Pointer to controller handle
+ * @param state Pointer to state structure to fill on success
+ * @return N64_XFER_BUSY while pending, then DONE, ERROR or ABSENT
+ */
+n64_xfer_status_t n64_read_poll(n64_controller_t *controller, n64_device_state_t *state);
+
+/**
+ * Get transfer duration statistics for a command
+ * @param cmd N64_CMD_INFO, N64_CMD_STATUS, N64_CMD_READ or N64_CMD_WRITE
+ * @param stats Filled with the statistics
+ * @return false if the command is not tracked
+ */
+bool n64_get_xfer_stats(uint8_t cmd, n64_xfer_stats_t *stats);
+
+/**
+ * Reset transfer duration statistics
  */
-bool n64_transfer(n64_controller_t *controller, uint8_t cmd,
-                  uint8_t *response, uint response_len);
+void n64_reset_xfer_stats(void);
 
 #endif /* N64_CONTROLLER_H */
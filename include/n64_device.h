@@ -0,0 +1,112 @@
+/*
+ * Joybus Device Drivers
+ * One driver per device family answering the INFO command: its poll
+ * command and response length, an optional calibration command, and the
+ * parser turning the poll response into an n64_device_state_t. The HID
+ * mapping of each device type is in usb_gamepad.c.
+ *
+ * The driver is picked from the INFO identifier once per hot-plug (see
+ * n64_read_poll): a port is identified when it first answers and again
+ * only after it stopped answering, polls go straight through the driver
+ * the handle points to.
+ *
+ * Keep this header free of Pico SDK dependencies (shared with host tools).
+ */
+
+#ifndef N64_DEVICE_H
+#define N64_DEVICE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "n64_protocol.h"
+#include "gc_protocol.h"
+
+//--------------------------------------------------------------------
+// Device Types
+//--------------------------------------------------------------------
+typedef enum {
+    N64_DEVICE_NONE,            // Not identified (no state yet)
+    N64_DEVICE_CONTROLLER,      // N64 controller
+    N64_DEVICE_MOUSE,           // N64 mouse (stick bytes are the motion)
+    N64_DEVICE_GAMECUBE,        // GameCube controller
+    N64_DEVICE_TYPES
+} n64_device_type_t;
+
+//--------------------------------------------------------------------
+// Sizes
+//--------------------------------------------------------------------
+#define N64_DEVICE_STATE_SIZE       8       // Largest parsed state (GameCube)
+#define N64_DEVICE_RESPONSE_MAX     10      // Largest poll or calibration response
+#define N64_DEVICE_CMD_MAX          3       // Longest poll command
+
+//--------------------------------------------------------------------
+// Parsed Poll Result
+// Published as-is from the polling core to the USB core
+//--------------------------------------------------------------------
+typedef struct {
+    union {
+        n64_state_t n64;        // N64 controller and mouse: status response bytes
+        gc_state_t gc;          // GameCube controller
+        uint32_t words[N64_DEVICE_STATE_SIZE / 4];
+    };
+    uint8_t type;               // n64_device_type_t of the driver that parsed it
+} n64_device_state_t;
+
+//--------------------------------------------------------------------
+// Calibration (read once per connection)
+//--------------------------------------------------------------------
+typedef struct {
+    uint8_t origin[GC_AXES];    // Rest value of each analog axis (GameCube)
+} n64_device_calib_t;
+
+//--------------------------------------------------------------------
+// Driver
+//--------------------------------------------------------------------
+typedef struct n64_device_driver {
+    n64_device_type_t type;
+    uint16_t id;                        // INFO identifier (bytes 0-1, big-endian)
+    uint16_t id_mask;                   // Identifier bits that must match
+    bool accessory;                     // Has an accessory slot (paks, rumble)
+    uint8_t poll_cmd[N64_DEVICE_CMD_MAX];
+    uint8_t poll_cmd_len;
+    uint8_t poll_len;                   // Poll response bytes
+    uint8_t calib_cmd;                  // Calibration command (if calib_len != 0)
+    uint8_t calib_len;                  // Calibration response bytes (0 = none)
+
+    /**
+     * Store the calibration response (NULL if calib_len is 0)
+     * @param response Calibration response bytes
+     * @param calib Calibration to fill
+     */
+    void (*calibrate)(const uint8_t *response, n64_device_calib_t *calib);
+
+    /**
+     * Parse a poll response (polling core, every poll)
+     * @param response Poll response bytes
+     * @param calib Calibration read at connection
+     * @param state State to fill (type is set by the caller)
+     * @return false if the device asks to be calibrated again
+     */
+    bool (*parse)(const uint8_t *response, const n64_device_calib_t *calib,
+                  n64_device_state_t *state);
+} n64_device_driver_t;
+
+//--------------------------------------------------------------------
+// Functions
+//--------------------------------------------------------------------
+
+/**
+ * Find the driver of an INFO response
+ * @param info INFO response (N64_INFO_SIZE bytes)
+ * @return Driver, or NULL for an unsupported device
+ */
+const n64_device_driver_t *n64_device_identify(const uint8_t *info);
+
+/**
+ * Device type name for the console
+ * @param type Device type
+ * @return Name
+ */
+const char *n64_device_name(n64_device_type_t type);
+
+#endif /* N64_DEVICE_H */
@@ -0,0 +1,76 @@
+/*
+ * N64 Hot-Plug Scheduler
+ * Tracks connection state per port and probes empty ports with
+ * exponential back-off, so unplugged ports do not slow down live ones
+ */
+
+#ifndef N64_HOTPLUG_H
+#define N64_HOTPLUG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_descriptors.h"
+
+//--------------------------------------------------------------------
+// Configuration
+//--------------------------------------------------------------------
+#define N64_HOTPLUG_BACKOFF_MIN_MS  8       // First probe interval after a miss
+#define N64_HOTPLUG_BACKOFF_MAX_MS  250     // Probe interval ceiling
+
+//--------------------------------------------------------------------
+// Connection Events
+//--------------------------------------------------------------------
+typedef enum {
+    N64_HOTPLUG_NONE,           // No change
+    N64_HOTPLUG_CONNECTED,      // First connection since boot
+    N64_HOTPLUG_RECONNECTED,    // Connected again after a disconnect
+    N64_HOTPLUG_DISCONNECTED    // Stopped responding
+} n64_hotplug_event_t;
+
+//--------------------------------------------------------------------
+// Per-Port State
+// Written only by the core that processes poll results; the polling
+// core may read it concurrently (32-bit fields, single writer)
+//--------------------------------------------------------------------
+typedef struct {
+    volatile bool connected;            // Controller answered last poll
+    uint32_t connect_count;             // Number of connections since boot
+    uint32_t backoff_ms;                // Current probe interval (0 = no miss yet)
+    volatile uint32_t next_probe_ms;    // Next probe time while disconnected
+} n64_hotplug_port_t;
+
+typedef struct {
+    n64_hotplug_port_t ports[MAX_CONTROLLERS];
+} n64_hotplug_t;
+
+//--------------------------------------------------------------------
+// Functions
+//--------------------------------------------------------------------
+
+/**
+ * Initialize the scheduler (all ports probed immediately)
+ * @param hotplug Pointer to scheduler state
+ */
+void n64_hotplug_init(n64_hotplug_t *hotplug);
+
+/**
+ * Get the ports to poll in the cycle starting now
+ * Connected ports are always polled, empty ports only when their probe is due.
+ * @param hotplug Pointer to scheduler state
+ * @param now_ms Current time in milliseconds
+ * @return Bitmask of ports to poll
+ */
+uint32_t n64_hotplug_due_mask(const n64_hotplug_t *hotplug, uint32_t now_ms);
+
+/**
+ * Record the result of a poll and update the back-off
+ * @param hotplug Pointer to scheduler state
+ * @param port Port index
+ * @param responding true if the controller answered
+ * @param now_ms Current time in milliseconds
+ * @return Connection event caused by this result
+ */
+n64_hotplug_event_t n64_hotplug_update(n64_hotplug_t *hotplug, uint8_t port,
+                                       bool responding, uint32_t now_ms);
+
+#endif /* N64_HOTPLUG_H */
@@ -0,0 +1,214 @@
+/*
+ * N64 Controller Pak
+ * 32-byte block reads and writes on the controller's accessory slot
+ * (Joybus commands 0x02 and 0x03): address CRC-5 added to every command,
+ * data CRC-8 of every block checked, and a block job that streams a range
+ * of blocks (whole 32 KiB dump or restore) between poll cycles.
+ *
+ * Block I/O only goes through n64_command_async() and n64_transfer_poll(),
+ * so the module also runs on a host against a simulated controller that
+ * provides those two functions.
+ */
+
+#ifndef N64_PAK_H
+#define N64_PAK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "n64_controller.h"
+
+//--------------------------------------------------------------------
+// Controller Pak Layout and Commands
+//--------------------------------------------------------------------
+#define N64_PAK_SIZE                0x8000      // Controller Pak SRAM (32 KiB)
+#define N64_PAK_BLOCK_SIZE          32          // Bytes per read/write command
+#define N64_PAK_BLOCKS              (N64_PAK_SIZE / N64_PAK_BLOCK_SIZE)
+#define N64_PAK_ADDRESS_BLOCKS      (0x10000 / N64_PAK_BLOCK_SIZE)  // Whole accessory address space
+
+#define N64_PAK_READ_CMD_LEN        3           // Command, address (2 bytes)
+#define N64_PAK_WRITE_CMD_LEN       (3 + N64_PAK_BLOCK_SIZE)
+#define N64_PAK_READ_RESPONSE_LEN   (N64_PAK_BLOCK_SIZE + 1)    // Data, data CRC
+#define N64_PAK_WRITE_RESPONSE_LEN  1           // Data CRC
+
+// Wire time budget of one block, frame gap included (estimate: ~1.18 ms
+// for a read, 25 + 264 response bits at 4 us, plus settle and reply delay)
+#define N64_PAK_BLOCK_US            1250
+
+#define N64_PAK_RETRIES             3           // Attempts per block after the first
+
+//--------------------------------------------------------------------
+// Block Results
+//--------------------------------------------------------------------
+typedef enum {
+    N64_PAK_OK,                 // Data CRC matches
+    N64_PAK_BUSY,               // Transfer still on the wire
+    N64_PAK_CRC_ERROR,          // Data CRC mismatch (line noise, loose pak)
+    N64_PAK_NO_PAK,             // Inverted CRC: nothing in the accessory slot
+    N64_PAK_NO_RESPONSE         // Timeout or no controller on the port
+} n64_pak_result_t;
+
+typedef enum {
+    N64_PAK_OP_READ,
+    N64_PAK_OP_WRITE
+} n64_pak_op_t;
+
+//--------------------------------------------------------------------
+// One Block Transfer (command encoded before it is started)
+//--------------------------------------------------------------------
+typedef struct {
+    n64_pak_op_t op;
+    uint16_t address;                               // Block address (32-byte aligned)
+    uint8_t *data;                                  // Read destination or write source
+    uint8_t crc;                                    // Expected data CRC (writes)
+    uint8_t cmd[N64_PAK_WRITE_CMD_LEN];
+    uint8_t response[N64_PAK_READ_RESPONSE_LEN];
+} n64_pak_block_t;
+
+//--------------------------------------------------------------------
+// Block Job (range of blocks between a pak and a RAM buffer)
+// Run by the polling core; the other core may read the progress fields
+//--------------------------------------------------------------------
+typedef enum {
+    N64_PAK_JOB_IDLE,
+    N64_PAK_JOB_RUNNING,
+    N64_PAK_JOB_DONE,
+    N64_PAK_JOB_FAILED
+} n64_pak_job_state_t;
+
+typedef struct {
+    volatile n64_pak_job_state_t state;
+    n64_pak_op_t op;
+    uint port;                      // Controller port index
+    uint8_t *data;                  // Buffer of the blocks, first block at offset 0
+    uint16_t first_block;           // First block of the job
+    uint16_t next_block;            // Next block to encode
+    uint16_t end_block;             // One past the last block
+    uint16_t count;                 // Blocks in the job
+    volatile uint16_t done;         // Blocks transferred and verified
+    uint8_t attempts;               // Retries of the block on the wire
+    uint32_t retries;               // Retries over the whole job
+    n64_pak_result_t result;        // Last failure
+    uint64_t start_us;              // First block started
+    uint64_t end_us;                // Last block verified
+    uint64_t wire_us;               // Sum of block transfer times
+
+    // Ping-pong blocks: one on the wire, the next one already encoded
+    n64_pak_block_t blocks[2];
+    uint8_t wire;                   // Index of the block on the wire
+    bool in_flight;                 // blocks[wire] is on the wire
+    bool start_pending;             // blocks[wire] is waiting to be started
+    bool prepared;                  // blocks[wire ^ 1] is encoded
+} n64_pak_job_t;
+
+//--------------------------------------------------------------------
+// Functions - Protocol
+//--------------------------------------------------------------------
+
+/**
+ * Add the address CRC-5 to a block address
+ * @param address Pak address (the low 5 bits are ignored)
+ * @return 32-byte aligned address with its CRC in bits 4-0
+ */
+uint16_t n64_pak_address_crc(uint16_t address);
+
+/**
+ * Data CRC-8 of one block, as returned by the controller
+ * @param data N64_PAK_BLOCK_SIZE bytes
+ * @return CRC (poly 0x85)
+ */
+uint8_t n64_pak_data_crc(const uint8_t *data);
+
+/**
+ * Encode a block command
+ * @param block Filled with the command (and the expected CRC for a write)
+ * @param op Read or write
+ * @param address Block address
+ * @param data Read destination or write source (N64_PAK_BLOCK_SIZE bytes)
+ */
+void n64_pak_block_encode(n64_pak_block_t *block, n64_pak_op_t op,
+                          uint16_t address, uint8_t *data);
+
+//--------------------------------------------------------------------
+// Functions - Block I/O (core that polls the controller)
+//--------------------------------------------------------------------
+
+/**
+ * Start an encoded block transfer
+ * @param controller Pointer to controller handle
+ * @param block Encoded block (must stay valid until the transfer ends)
+ * @return true if the transfer was started
+ */
+bool n64_pak_block_start(n64_controller_t *controller, n64_pak_block_t *block);
+
+/**
+ * Check a block transfer; reads are copied to their destination once
+ * their CRC has been checked
+ * @param controller Pointer to controller handle
+ * @param block Block being transferred
+ * @return N64_PAK_BUSY while on the wire, then the block result
+ */
+n64_pak_result_t n64_pak_block_poll(n64_controller_t *controller, n64_pak_block_t *block);
+
+/**
+ * Read one block (blocking)
+ * @param controller Pointer to controller handle
+ * @param address Block address
+ * @param data Filled with N64_PAK_BLOCK_SIZE bytes
+ * @return Block result
+ */
+n64_pak_result_t n64_pak_read(n64_controller_t *controller, uint16_t address, uint8_t *data);
+
+/**
+ * Write one block (blocking)
+ * @param controller Pointer to controller handle
+ * @param address Block address
+ * @param data N64_PAK_BLOCK_SIZE bytes
+ * @return Block result
+ */
+n64_pak_result_t n64_pak_write(n64_controller_t *controller, uint16_t address,
+                               const uint8_t *data);
+
+//--------------------------------------------------------------------
+// Functions - Block Job
+//--------------------------------------------------------------------
+
+/**
+ * Set up a job (started by the next n64_pak_job_task call)
+ * @param job Pointer to job state
+ * @param op Read (pak -> buffer) or write (buffer -> pak)
+ * @param port Controller port index
+ * @param data count * N64_PAK_BLOCK_SIZE bytes, first block at offset 0
+ * @param first_block First block index (address / N64_PAK_BLOCK_SIZE, up to
+ *                    0xFFE0 for the accessory registers above the pak)
+ * @param count Number of blocks
+ */
+void n64_pak_job_start(n64_pak_job_t *job, n64_pak_op_t op, uint port,
+                       uint8_t *data, uint first_block, uint count);
+
+/**
+ * Advance a job: collect the block on the wire and start the next one
+ * if it fits before until_us (call often from the polling core; pass the
+ * current time or 0 to only collect, e.g. while a poll cycle is running)
+ * @param job Pointer to job state
+ * @param controllers Controller array (indexed by port)
+ * @param until_us Latest end of a new block transfer (time_us_64)
+ * @return true while a block is on the wire
+ */
+bool n64_pak_job_task(n64_pak_job_t *job, n64_controller_t *controllers, uint64_t until_us);
+
+/**
+ * Ports whose state machine is busy with a pak block (leave them out of
+ * the poll cycle)
+ * @param job Pointer to job state
+ * @return Port bitmask
+ */
+uint32_t n64_pak_job_busy_mask(const n64_pak_job_t *job);
+
+/**
+ * Result name for the console
+ * @param result Block result
+ * @return Name
+ */
+const char *n64_pak_result_name(n64_pak_result_t result);
+
+#endif /* N64_PAK_H */
@@ -0,0 +1,230 @@
+/*
+ * N64 Controller Pak Block Cache
+ * Write-back RAM cache between the USB mass-storage sectors and the pak
+ * blocks, so the host's sector accesses do not each turn into 16 Joybus
+ * round trips.
+ *
+ * One cache line holds one 512-byte sector (16 pak blocks) of one port.
+ * Reads of a missing line are answered "busy" while the whole line is read
+ * from the pak; writes only mark the blocks whose content changed, and a
+ * dirty line is written back block run by block run once the host has
+ * stopped writing for N64_PAK_CACHE_FLUSH_MS (or at once on eject and
+ * SYNCHRONIZE CACHE).
+ *
+ * Pak identity: the ID block (address 0x0020) is read every
+ * N64_PAK_CACHE_PROBE_MS and right before each write-back. A pak that is
+ * gone or was swapped drops the port's lines: cached writes are never
+ * flushed into another pak, the blocks lost are counted instead.
+ *
+ * Runs on core0 only (USB callbacks and main loop); the block transfers are
+ * handed to the polling core one at a time through n64_pak_cache_next_io()
+ * and n64_pak_cache_io_done().
+ */
+
+#ifndef N64_PAK_CACHE_H
+#define N64_PAK_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "n64_pak.h"
+#include "usb_descriptors.h"
+
+//--------------------------------------------------------------------
+// Configuration
+//--------------------------------------------------------------------
+#define N64_PAK_CACHE_LINE_SIZE     512     // One mass-storage sector
+#define N64_PAK_CACHE_LINE_BLOCKS   (N64_PAK_CACHE_LINE_SIZE / N64_PAK_BLOCK_SIZE)
+#define N64_PAK_CACHE_PAK_LINES     (N64_PAK_SIZE / N64_PAK_CACHE_LINE_SIZE)
+#ifndef N64_PAK_CACHE_LINES
+#define N64_PAK_CACHE_LINES         16      // Lines shared by every port (8 KiB)
+#endif
+#define N64_PAK_CACHE_FLUSH_MS      100     // Write-back delay after the last write
+#define N64_PAK_CACHE_PROBE_MS      1000    // Pak presence / identity check period
+#define N64_PAK_ID_ADDRESS          0x0020  // ID block (serial, checked for swaps)
+
+_Static_assert(N64_PAK_CACHE_LINE_BLOCKS <= 16, "dirty masks are 16 bits");
+
+//--------------------------------------------------------------------
+// Results
+//--------------------------------------------------------------------
+typedef enum {
+    N64_PAK_CACHE_OK,
+    N64_PAK_CACHE_BUSY,         // Line being read or written back, retry later
+    N64_PAK_CACHE_NO_MEDIUM     // No pak known on this port
+} n64_pak_cache_result_t;
+
+//--------------------------------------------------------------------
+// Cache Line
+//--------------------------------------------------------------------
+typedef enum {
+    N64_PAK_LINE_FREE,
+    N64_PAK_LINE_FILL_PENDING,  // Waiting for its read
+    N64_PAK_LINE_FILLING,       // Being read by the polling core
+    N64_PAK_LINE_VALID
+} n64_pak_line_state_t;
+
+typedef struct {
+    uint8_t data[N64_PAK_CACHE_LINE_SIZE];
+    n64_pak_line_state_t state;
+    uint8_t port;
+    uint8_t line;               // Sector index in the pak
+    uint16_t dirty;             // Blocks changed since the last write-back
+    uint16_t writing;           // Blocks being written back (line locked)
+    bool fresh;                 // Filled for a read miss not served yet
+    uint32_t last_use;          // LRU stamp
+} n64_pak_cache_line_t;
+
+//--------------------------------------------------------------------
+// Port Medium State
+//--------------------------------------------------------------------
+typedef struct {
+    bool present;               // Pak answered the last check
+    bool verified;              // Identity checked since the last write
+    bool flush;                 // Write back now (eject, SYNCHRONIZE CACHE)
+    bool reset;                 // Drop every line (pak rewritten behind the cache)
+    uint8_t id[N64_PAK_BLOCK_SIZE];     // ID block of the pak
+    uint16_t medium;            // Incremented on every new pak (insert, swap)
+    uint64_t checked_us;        // Last presence check
+    uint64_t last_write_us;     // Last host write
+} n64_pak_cache_port_t;
+
+//--------------------------------------------------------------------
+// Statistics
+//--------------------------------------------------------------------
+typedef struct {
+    uint32_t hits;              // Sector accesses served from a line
+    uint32_t misses;            // Sector accesses that allocated a line
+    uint32_t fills;             // Lines read from a pak
+    uint32_t evictions;         // Clean lines reused for another sector
+    uint32_t written;           // Blocks written back
+    uint32_t unchanged;         // Blocks rewritten by the host with the same data
+    uint32_t probes;            // ID block checks
+    uint32_t lost;              // Dirty blocks dropped (pak removed or swapped)
+    uint32_t errors;            // Block transfers that failed
+} n64_pak_cache_stats_t;
+
+//--------------------------------------------------------------------
+// Block Transfer Request (handed to the polling core)
+//--------------------------------------------------------------------
+typedef enum {
+    N64_PAK_IO_FILL,
+    N64_PAK_IO_WRITE_BACK,
+    N64_PAK_IO_PROBE
+} n64_pak_io_kind_t;
+
+typedef struct {
+    n64_pak_io_kind_t kind;
+    n64_pak_op_t op;
+    uint8_t port;
+    uint16_t first_block;
+    uint16_t count;
+    uint8_t *data;              // count * N64_PAK_BLOCK_SIZE bytes
+    int8_t line;                // Cache line (fill, write-back)
+} n64_pak_io_t;
+
+//--------------------------------------------------------------------
+// Cache
+//--------------------------------------------------------------------
+typedef struct {
+    n64_pak_cache_line_t lines[N64_PAK_CACHE_LINES];
+    n64_pak_cache_port_t ports[MAX_CONTROLLERS];
+    n64_pak_cache_stats_t stats;
+    n64_pak_io_t io;            // Transfer in flight
+    bool io_busy;
+    bool starved;               // A sector waits for a clean line
+    uint32_t use_clock;
+    uint8_t id_block[N64_PAK_BLOCK_SIZE];
+} n64_pak_cache_t;
+
+//--------------------------------------------------------------------
+// Functions - Sector Access (USB mass storage)
+//--------------------------------------------------------------------
+
+/**
+ * Initialize the cache (every port without a pak until checked)
+ * @param cache Pointer to cache
+ */
+void n64_pak_cache_init(n64_pak_cache_t *cache);
+
+/**
+ * Read one sector
+ * @param cache Pointer to cache
+ * @param port Controller port index
+ * @param line Sector index in the pak (0 to N64_PAK_CACHE_PAK_LINES - 1)
+ * @param buffer Filled with N64_PAK_CACHE_LINE_SIZE bytes on N64_PAK_CACHE_OK
+ * @return N64_PAK_CACHE_BUSY while the line is read from the pak
+ */
+n64_pak_cache_result_t n64_pak_cache_read(n64_pak_cache_t *cache, uint port, uint line,
+                                          uint8_t *buffer);
+
+/**
+ * Write one sector (written back to the pak later)
+ * @param cache Pointer to cache
+ * @param port Controller port index
+ * @param line Sector index in the pak
+ * @param buffer N64_PAK_CACHE_LINE_SIZE bytes
+ * @return N64_PAK_CACHE_BUSY while the line is locked or no line is free
+ */
+n64_pak_cache_result_t n64_pak_cache_write(n64_pak_cache_t *cache, uint port, uint line,
+                                           const uint8_t *buffer);
+
+/**
+ * Pak state of a port
+ * @param cache Pointer to cache
+ * @param port Controller port index
+ * @param medium Set to the pak counter (changes when the pak is replaced)
+ * @return true if a pak answered the last check
+ */
+bool n64_pak_cache_present(const n64_pak_cache_t *cache, uint port, uint16_t *medium);
+
+/**
+ * Write back the dirty lines of a port without waiting for the delay
+ * @param cache Pointer to cache
+ * @param port Controller port index
+ */
+void n64_pak_cache_flush(n64_pak_cache_t *cache, uint port);
+
+/**
+ * Blocks of a port waiting for their write-back
+ * @param cache Pointer to cache
+ * @param port Controller port index
+ * @return Dirty block count
+ */
+uint n64_pak_cache_dirty_blocks(const n64_pak_cache_t *cache, uint port);
+
+/**
+ * Forget the lines of a port (its pak was rewritten outside the cache)
+ * @param cache Pointer to cache
+ * @param port Controller port index
+ */
+void n64_pak_cache_invalidate(n64_pak_cache_t *cache, uint port);
+
+//--------------------------------------------------------------------
+// Functions - Block Transfers (core0 main loop)
+//--------------------------------------------------------------------
+
+/**
+ * Next transfer to run: line reads first (the host is waiting), then
+ * presence checks, then write-backs that are due
+ * @param cache Pointer to cache
+ * @param connected Ports with a controller (the others lose their pak)
+ * @param io Filled with the transfer
+ * @return true if a transfer was returned (call n64_pak_cache_io_done after it)
+ */
+bool n64_pak_cache_next_io(n64_pak_cache_t *cache, uint32_t connected, n64_pak_io_t *io);
+
+/**
+ * Result of the transfer returned by n64_pak_cache_next_io
+ * @param cache Pointer to cache
+ * @param result N64_PAK_OK, or the failure of the block job
+ */
+void n64_pak_cache_io_done(n64_pak_cache_t *cache, n64_pak_result_t result);
+
+/**
+ * Statistics since boot
+ * @param cache Pointer to cache
+ * @param stats Filled with the counters
+ */
+void n64_pak_cache_get_stats(const n64_pak_cache_t *cache, n64_pak_cache_stats_t *stats);
+
+#endif /* N64_PAK_CACHE_H */
@@ -0,0 +1,82 @@
+/*
+ * N64 Poll Cycle
+ * Drives one device read per controller port per poll cycle (the poll
+ * command of the port's driver), either port after port (sequential) or
+ * all ports at once (batched)
+ */
+
+#ifndef N64_POLLER_H
+#define N64_POLLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "n64_controller.h"
+
+//--------------------------------------------------------------------
+// Per-port timing (sample offset from the start of the poll cycle)
+//--------------------------------------------------------------------
+typedef struct {
+    uint32_t samples;           // Successful reads
+    uint64_t offset_sum_us;     // Sum of (response complete - cycle start)
+    uint32_t offset_max_us;     // Worst offset seen
+} n64_port_timing_t;
+
+//--------------------------------------------------------------------
+// Poller State
+//--------------------------------------------------------------------
+typedef struct {
+    n64_controller_t *controllers;  // Controller array (MAX_CONTROLLERS)
+    bool batched;                   // Start all ports together
+    uint32_t cycle_mask;            // Ports selected for the current cycle
+    uint32_t pending;               // Ports with a transfer in flight
+    uint next_port;                 // Sequential mode: next port to start
+    uint32_t cycle_start_us;        // Start of the current cycle
+    n64_port_timing_t timing[MAX_CONTROLLERS];
+} n64_poller_t;
+
+//--------------------------------------------------------------------
+// Functions
+//--------------------------------------------------------------------
+
+/**
+ * Initialize the poller
+ * @param poller Pointer to poller state
+ * @param controllers Array of MAX_CONTROLLERS controller handles
+ * @param batched true to release all ports in the same PIO cycle
+ */
+void n64_poller_init(n64_poller_t *poller, n64_controller_t *controllers,
+                     bool batched);
+
+/**
+ * Start a new poll cycle
+ * @param poller Pointer to poller state
+ * @param port_mask Bitmask of ports to poll in this cycle
+ */
+void n64_poller_start_cycle(n64_poller_t *poller, uint32_t port_mask);
+
+/**
+ * Check whether the current cycle still has transfers in flight
+ * @param poller Pointer to poller state
+ * @return true while at least one port is pending
+ */
+bool n64_poller_busy(const n64_poller_t *poller);
+
+/**
+ * Collect one finished port (non-blocking)
+ * Call repeatedly until it returns -1.
+ * @param poller Pointer to poller state
+ * @param state Filled with the parsed device state when responding
+ * @param responding Filled with true if the controller answered
+ * @param sample_us Filled with the response completion time (time_us_32)
+ * @return Port index, or -1 if no port finished yet
+ */
+int n64_poller_collect(n64_poller_t *poller, n64_device_state_t *state,
+                       bool *responding, uint32_t *sample_us);
+
+/**
+ * Reset per-port timing statistics
+ * @param poller Pointer to poller state
+ */
+void n64_poller_reset_timing(n64_poller_t *poller);
+
+#endif /* N64_POLLER_H */
@@ -20,6 +20,18 @@
 // N64 Controller Response Size
 //--------------------------------------------------------------------
 #define N64_STATUS_SIZE     4       // 4 bytes response for status command
+#define N64_INFO_SIZE       3       // Device id (2 bytes), accessory status
+
+//--------------------------------------------------------------------
+// INFO Response
+//--------------------------------------------------------------------
+#define N64_INFO_ID_CONTROLLER  0x05    // First id byte of a standard controller
+#define N64_INFO_ID_MOUSE       0x02    // First id byte of the N64 mouse
+
+// Byte 2 - Accessory slot status
+#define N64_INFO_PAK_PRESENT    0x01    // Something is plugged in the accessory slot
+#define N64_INFO_PAK_REMOVED    0x02    // Slot emptied since the last INFO
+#define N64_INFO_ADDRESS_ERROR  0x04    // Address CRC of the last pak command was wrong
 
 //--------------------------------------------------------------------
 // Byte 0 - Buttons (bits 7-4) and D-Pad (bits 3-0)
@@ -68,4 +80,7 @@ typedef struct {
     int8_t  stick_y;        // Analog stick Y (-80 to +80)
 } n64_state_t;
 
+// Same byte order as the status response: copied as-is from the RX buffer
+_Static_assert(sizeof(n64_state_t) == N64_STATUS_SIZE, "n64_state_t must match the status response");
+
 #endif /* N64_PROTOCOL_H */
@@ -0,0 +1,167 @@
+/*
+ * N64 Rumble Pak
+ * Host rumble commands (HID output reports, core0) turned into Rumble Pak
+ * motor writes (block 0xC000, polling core).
+ *
+ * Each port has a one-entry command mailbox: the host only cares about the
+ * latest state, so a command that arrives before the previous one was
+ * applied replaces it (counted as coalesced) instead of queueing a motor
+ * write that would already be stale. Neither core ever waits on the other.
+ *
+ * The motor is on or off; the strength is a duty cycle over
+ * N64_RUMBLE_PWM_MS, so a write is only sent when the wanted motor state
+ * changes. Writes go through the same block I/O as the Controller Pak and
+ * follow the same rule: started between poll cycles, only if they end
+ * before the next deadline.
+ *
+ * The accessory is identified on the first command after the controller
+ * is connected, with the sequence games use: 0xFE written at 0x8000 must
+ * not read back (a Controller Pak would echo it), then 0x80 written there
+ * must. A port without a Rumble Pak ignores commands, and is checked
+ * again every N64_RUMBLE_RETRY_MS while the host keeps asking for rumble.
+ */
+
+#ifndef N64_RUMBLE_H
+#define N64_RUMBLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "n64_pak.h"
+#include "usb_descriptors.h"
+
+//--------------------------------------------------------------------
+// Rumble Pak Layout and Timing
+//--------------------------------------------------------------------
+#define N64_RUMBLE_ID_ADDRESS       0x8000  // Accessory init / identification block
+#define N64_RUMBLE_PROBE            0xFE    // Written first: read back only by a Controller Pak
+#define N64_RUMBLE_ID               0x80    // Written next: read back by a Rumble Pak
+#define N64_RUMBLE_MOTOR_ADDRESS    0xC000  // Motor block: 0x01 = on, 0x00 = off
+#define N64_RUMBLE_PWM_MS           100     // Strength duty cycle period
+#define N64_RUMBLE_MIN_PHASE_MS     10      // Shortest on or off phase of the duty cycle
+#define N64_RUMBLE_RETRY_MS         1000    // Identification retry on a port without one
+#define N64_RUMBLE_DURATION_UNIT_MS 10      // Unit of the command duration
+
+//--------------------------------------------------------------------
+// Port State (polling core)
+//--------------------------------------------------------------------
+typedef enum {
+    N64_RUMBLE_UNKNOWN,         // Not identified since the controller connected
+    N64_RUMBLE_PROBE_WRITE,     // Identification: 0xFE written at 0x8000
+    N64_RUMBLE_PROBE_READ,      // Identification: 0x8000 read back (not 0xFE)
+    N64_RUMBLE_ID_WRITE,        // Identification: 0x80 written at 0x8000
+    N64_RUMBLE_ID_READ,         // Identification: 0x8000 read back (0x80)
+    N64_RUMBLE_ABSENT,          // No Rumble Pak (retried while commands come in)
+    N64_RUMBLE_READY            // Rumble Pak identified
+} n64_rumble_state_t;
+
+typedef struct {
+    uint32_t commands;          // Host commands received (core0)
+    uint32_t coalesced;         // Commands replaced before being applied
+    uint32_t unchanged;         // Commands applied without a motor write
+    uint32_t ignored;           // Commands for a port without a Rumble Pak
+    uint32_t writes;            // Motor writes (on or off)
+    uint32_t errors;            // Motor or identification blocks that failed
+    uint32_t latency_count;     // Commands timed from host to motor
+    uint32_t latency_min_us;
+    uint32_t latency_max_us;
+    uint64_t latency_sum_us;
+} n64_rumble_stats_t;
+
+typedef struct {
+    // Mailbox: written by core0, read by the polling core
+    volatile uint32_t command;      // Strength | duration << 8 | sequence << 16
+    volatile uint32_t command_us;   // Arrival of the command (time_us_32)
+
+    // Polling core
+    n64_rumble_state_t state;
+    uint16_t sequence;              // Last command applied
+    uint8_t strength;               // 0 = off, 255 = always on
+    bool motor;                     // Motor state last written
+    bool in_flight;                 // Block is on the wire
+    bool timing;                    // Next motor write ends a host command
+    uint8_t attempts;               // Retries of the block on the wire
+    uint32_t timing_start_us;       // Arrival of the command being timed
+    uint64_t phase_us;              // Duty cycle origin (command applied)
+    uint64_t stop_us;               // Command duration end (0 = none)
+    uint64_t retry_us;              // Next identification while absent
+    bool skipped;                   // Missed its last poll for a block
+    n64_pak_block_t block;
+    uint8_t data[N64_PAK_BLOCK_SIZE];
+    n64_rumble_stats_t stats;
+} n64_rumble_port_t;
+
+typedef struct {
+    n64_rumble_port_t ports[MAX_CONTROLLERS];
+} n64_rumble_t;
+
+//--------------------------------------------------------------------
+// Functions - Host Commands (core0)
+//--------------------------------------------------------------------
+
+/**
+ * Initialize every port (motor off, accessory not identified)
+ * @param rumble Pointer to rumble state
+ */
+void n64_rumble_init(n64_rumble_t *rumble);
+
+/**
+ * Post a host command (replaces a command not applied yet, never blocks)
+ * @param rumble Pointer to rumble state
+ * @param port Controller port index
+ * @param strength 0 = off, 1-254 = duty cycle, 255 = always on
+ * @param duration Stop after this many N64_RUMBLE_DURATION_UNIT_MS (0 = until
+ *                 the next command)
+ */
+void n64_rumble_command(n64_rumble_t *rumble, uint port, uint8_t strength, uint8_t duration);
+
+//--------------------------------------------------------------------
+// Functions - Motor Writes (polling core)
+//--------------------------------------------------------------------
+
+/**
+ * Apply the commands and run the motor writes: collect the blocks on the
+ * wire, start the ones due if they end before until_us (0 = only collect,
+ * e.g. while a poll cycle is running)
+ * @param rumble Pointer to rumble state
+ * @param controllers Controller array (indexed by port)
+ * @param connected Ports with a controller (the others are forgotten)
+ * @param until_us Latest end of a new block transfer (time_us_64)
+ * @param period_us Poll period: when shorter than a block, a block may
+ *                  take the place of the port's next poll (not twice in a row)
+ * @return true while a block is on the wire
+ */
+bool n64_rumble_task(n64_rumble_t *rumble, n64_controller_t *controllers, uint32_t connected,
+                     uint64_t until_us, uint32_t period_us);
+
+/**
+ * Leave the ports with a rumble block on the wire out of the poll cycle
+ * @param rumble Pointer to rumble state
+ * @param due Ports due for a poll
+ * @return Ports to poll
+ */
+uint32_t n64_rumble_filter_due(n64_rumble_t *rumble, uint32_t due);
+
+/**
+ * Accessory state of a port
+ * @param rumble Pointer to rumble state
+ * @param port Controller port index
+ * @return Port state
+ */
+n64_rumble_state_t n64_rumble_state(const n64_rumble_t *rumble, uint port);
+
+/**
+ * Statistics since boot
+ * @param rumble Pointer to rumble state
+ * @param port Controller port index
+ * @param stats Filled with the counters
+ */
+void n64_rumble_get_stats(const n64_rumble_t *rumble, uint port, n64_rumble_stats_t *stats);
+
+/**
+ * State name for the console
+ * @param state Port state
+ * @return Name
+ */
+const char *n64_rumble_state_name(n64_rumble_state_t state);
+
+#endif /* N64_RUMBLE_H */
@@ -0,0 +1,234 @@
+/*
+ * N64 Transfer Pak
+ * Game Boy cartridge ROM and SRAM dump through a Transfer Pak, run by the
+ * polling core between poll cycles.
+ *
+ * Transfer Pak registers, in the accessory address space:
+ *   0x8000  power (0x84 = on, 0xFE = off), reads back 0x84 when powered
+ *   0xA000  bank: maps Game Boy addresses bank * 0x4000 ... + 0x3FFF
+ *   0xB000  cartridge access (0x01 = on), read: status (N64_TPAK_STATUS_*)
+ *   0xC000  window on the selected 16 KiB of the Game Boy address space
+ * Game Boy cartridge registers (MBC bank numbers, SRAM enable) are written
+ * through the window like any other address.
+ *
+ * The dump checks the accessory slot with an INFO command, powers the
+ * Transfer Pak, reads the cartridge header, then walks the ROM (or SRAM)
+ * banks. Data is read as block jobs of N64_TPAK_CHUNK_SIZE bytes into two
+ * chunk buffers: the polling core fills one while core0 sends the other to
+ * the host, and waits (counted as a stall) if both are still full.
+ *
+ * Supported mappers: none (32 KiB), MBC1, MBC2, MBC3, MBC5. MBC1 cannot
+ * map banks 0x20, 0x40 and 0x60 in the upper area (they read as the next
+ * bank): those are read at 0x0000 in MBC1 banking mode 1.
+ */
+
+#ifndef N64_TPAK_H
+#define N64_TPAK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "n64_pak.h"
+
+//--------------------------------------------------------------------
+// Transfer Pak Registers
+//--------------------------------------------------------------------
+#define N64_TPAK_POWER_ADDRESS      0x8000
+#define N64_TPAK_BANK_ADDRESS       0xA000
+#define N64_TPAK_STATUS_ADDRESS     0xB000
+#define N64_TPAK_WINDOW_ADDRESS     0xC000
+#define N64_TPAK_WINDOW_SIZE        0x4000
+
+#define N64_TPAK_POWER_ON           0x84    // Also the power register read back
+#define N64_TPAK_POWER_OFF          0xFE
+#define N64_TPAK_ACCESS_ON          0x01
+
+// Status register bits
+#define N64_TPAK_STATUS_ACCESS      0x01    // Cartridge access enabled
+#define N64_TPAK_STATUS_WAS_RESET   0x04
+#define N64_TPAK_STATUS_RESETTING   0x08
+#define N64_TPAK_STATUS_REMOVED     0x40    // No cartridge (or pulled out)
+#define N64_TPAK_STATUS_POWERED     0x80
+
+//--------------------------------------------------------------------
+// Game Boy Cartridge Header (0x0100 - 0x014F)
+//--------------------------------------------------------------------
+#define GB_HEADER_ADDRESS           0x0100
+#define GB_HEADER_SIZE              0x0060  // Three blocks, 0x0100 - 0x015F
+#define GB_TITLE                    0x0134
+#define GB_TITLE_SIZE               16
+#define GB_CART_TYPE                0x0147
+#define GB_ROM_SIZE                 0x0148  // 32 KiB << code
+#define GB_RAM_SIZE                 0x0149
+#define GB_HEADER_CHECKSUM          0x014D  // Over 0x0134 - 0x014C
+#define GB_ROM_BANK_SIZE            0x4000
+#define GB_RAM_BANK_SIZE            0x2000
+#define GB_RAM_ADDRESS              0xA000
+
+//--------------------------------------------------------------------
+// Configuration
+//--------------------------------------------------------------------
+#define N64_TPAK_CHUNK_SIZE         512     // Bytes per read job and per USB hand-off
+#define N64_TPAK_CHUNK_BLOCKS       (N64_TPAK_CHUNK_SIZE / N64_PAK_BLOCK_SIZE)
+#define N64_TPAK_MAX_WRITES         8       // Register writes before a read
+
+//--------------------------------------------------------------------
+// Dump Target and Result
+//--------------------------------------------------------------------
+typedef enum {
+    N64_TPAK_HEADER,            // Identify the cartridge only
+    N64_TPAK_ROM,
+    N64_TPAK_SRAM
+} n64_tpak_target_t;
+
+typedef enum {
+    N64_TPAK_IDLE,
+    N64_TPAK_RUNNING,
+    N64_TPAK_DONE,
+    N64_TPAK_FAILED
+} n64_tpak_state_t;
+
+typedef enum {
+    N64_TPAK_OK,
+    N64_TPAK_NO_CONTROLLER,     // INFO unanswered
+    N64_TPAK_NO_ACCESSORY,      // INFO: accessory slot empty
+    N64_TPAK_NOT_TPAK,          // Power register did not read back 0x84
+    N64_TPAK_NO_CARTRIDGE,      // Status: not powered or cartridge removed
+    N64_TPAK_UNSUPPORTED,       // Mapper or size not handled
+    N64_TPAK_NO_SRAM,           // SRAM dump of a cartridge without SRAM
+    N64_TPAK_IO_ERROR,          // Block failed after its retries
+    N64_TPAK_ABORTED
+} n64_tpak_error_t;
+
+typedef enum {
+    GB_MBC_NONE,
+    GB_MBC1,
+    GB_MBC2,
+    GB_MBC3,
+    GB_MBC5
+} gb_mbc_t;
+
+typedef struct {
+    uint8_t header[GB_HEADER_SIZE];     // Game Boy 0x0100 - 0x015F
+    char title[GB_TITLE_SIZE + 1];
+    uint8_t type;                       // Cartridge type byte
+    gb_mbc_t mbc;
+    uint32_t rom_size;
+    uint32_t ram_size;
+    bool checksum_ok;                   // Header checksum matches
+} n64_tpak_cart_t;
+
+//--------------------------------------------------------------------
+// Dump State
+// Started by core0, run by the polling core; the chunk flags and the
+// state are the only fields the other core reads while it runs
+//--------------------------------------------------------------------
+typedef struct {
+    uint16_t address;
+    uint8_t value;
+} n64_tpak_write_t;
+
+typedef struct n64_tpak {
+    volatile n64_tpak_state_t state;
+    volatile bool abort;                // Set by core0: stop at the next block
+    volatile bool cart_ready;           // cart and total are valid
+    n64_tpak_target_t target;
+    n64_tpak_error_t error;
+    uint port;
+    n64_tpak_cart_t cart;
+    uint32_t total;                     // Bytes the dump produces
+
+    // Step: register writes, then one read (polling core)
+    uint8_t phase;
+    uint16_t bank;                      // ROM or SRAM bank of the step
+    n64_tpak_write_t writes[N64_TPAK_MAX_WRITES];
+    uint8_t write_count;
+    uint8_t write_next;
+    uint16_t read_address;              // Next block to read
+    uint16_t read_blocks;               // Blocks left to read in the step
+    bool read_chunks;                   // Reads go to the chunk buffers
+    bool job_active;
+    bool job_chunk;                     // Job fills chunks[fill]
+    bool info_in_flight;
+    n64_pak_job_t job;
+    uint8_t block[N64_PAK_BLOCK_SIZE];  // Register write source, register reads
+    uint8_t info[N64_INFO_SIZE];
+
+    // Chunk buffers: filled by the polling core, sent by core0
+    uint8_t chunks[2][N64_TPAK_CHUNK_SIZE];
+    volatile bool full[2];
+    uint8_t fill;                       // Next chunk to fill (polling core)
+    uint8_t drain;                      // Next chunk to send (core0)
+    uint16_t chunk_len[2];
+    bool stalled;                       // Waiting for core0 to free chunks[fill]
+
+    // Statistics
+    volatile uint32_t produced;         // Bytes read into the chunks
+    uint32_t stalls;                    // Chunk reads that waited for a free buffer
+    uint32_t retries;
+    uint64_t start_us;                  // First data block started
+    uint64_t end_us;                    // Dump finished
+    uint64_t wire_us;                   // Sum of data block transfer times
+} n64_tpak_t;
+
+//--------------------------------------------------------------------
+// Functions - Control (core0)
+//--------------------------------------------------------------------
+
+/**
+ * Start a dump (picked up by the next n64_tpak_task call)
+ * @param tpak Pointer to dump state (must not be running)
+ * @param port Controller port index
+ * @param target Header only, ROM or SRAM
+ */
+void n64_tpak_start(n64_tpak_t *tpak, uint port, n64_tpak_target_t target);
+
+/**
+ * Ask a running dump to stop (ends as N64_TPAK_FAILED / N64_TPAK_ABORTED)
+ * @param tpak Pointer to dump state
+ */
+void n64_tpak_abort(n64_tpak_t *tpak);
+
+/**
+ * Next chunk to send
+ * @param tpak Pointer to dump state
+ * @param len Set to the chunk length
+ * @return Chunk data, or NULL if the next chunk is not read yet
+ */
+const uint8_t *n64_tpak_chunk(n64_tpak_t *tpak, uint *len);
+
+/**
+ * Give the chunk returned by n64_tpak_chunk back to the polling core
+ * @param tpak Pointer to dump state
+ */
+void n64_tpak_chunk_done(n64_tpak_t *tpak);
+
+/**
+ * Error name for the console
+ * @param error Dump result
+ * @return Name
+ */
+const char *n64_tpak_error_name(n64_tpak_error_t error);
+
+//--------------------------------------------------------------------
+// Functions - Transfers (polling core)
+//--------------------------------------------------------------------
+
+/**
+ * Advance the dump: collect the transfer on the wire and start the next
+ * one if it ends before until_us (0 = only collect)
+ * @param tpak Pointer to dump state
+ * @param controllers Controller array (indexed by port)
+ * @param until_us Latest end of a new block transfer (time_us_64)
+ * @return true while a transfer is on the wire
+ */
+bool n64_tpak_task(n64_tpak_t *tpak, n64_controller_t *controllers, uint64_t until_us);
+
+/**
+ * Ports whose state machine is busy with the dump (leave them out of the
+ * poll cycle)
+ * @param tpak Pointer to dump state
+ * @return Port bitmask
+ */
+uint32_t n64_tpak_busy_mask(const n64_tpak_t *tpak);
+
+#endif /* N64_TPAK_H */
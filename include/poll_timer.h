@@ -0,0 +1,76 @@
+/*
+ * Poll Timer
+ * Microsecond-resolution periodic deadline driven by an RP2040 hardware
+ * alarm, with jitter statistics (actual start - ideal deadline)
+ */
+
+#ifndef POLL_TIMER_H
+#define POLL_TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//--------------------------------------------------------------------
+// Jitter Statistics
+//--------------------------------------------------------------------
+typedef struct {
+    uint32_t count;             // Deadlines consumed
+    uint32_t missed;            // Whole periods skipped (loop too slow)
+    int32_t min_dev_us;         // Smallest deviation from the deadline
+    int32_t max_dev_us;         // Largest deviation from the deadline
+    int64_t sum_dev_us;         // Sum of deviations (for the mean)
+} poll_timer_stats_t;
+
+//--------------------------------------------------------------------
+// Poll Timer
+// Alarm IRQ runs on the core that called poll_timer_init()
+//--------------------------------------------------------------------
+typedef struct {
+    int alarm_num;                      // Hardware alarm (0-3)
+    uint32_t period_us;                 // Poll period
+    uint64_t deadline_us;               // Ideal time of the pending deadline
+    volatile bool due;                  // Set by the alarm IRQ
+    poll_timer_stats_t stats;           // Jitter statistics
+} poll_timer_t;
+
+//--------------------------------------------------------------------
+// Functions
+//--------------------------------------------------------------------
+
+/**
+ * Claim a hardware alarm and start the periodic deadline
+ * @param timer Pointer to timer state
+ * @param period_us Poll period in microseconds
+ * @return true if a hardware alarm was available
+ */
+bool poll_timer_init(poll_timer_t *timer, uint32_t period_us);
+
+/**
+ * Replace the pending deadline with an explicit one
+ * Periodic deadlines resume from it (one period later) unless rescheduled.
+ * @param timer Pointer to timer state
+ * @param deadline_us Absolute deadline (time_us_64)
+ */
+void poll_timer_schedule(poll_timer_t *timer, uint64_t deadline_us);
+
+/**
+ * Consume a due deadline, record its jitter and arm the next one
+ * @param timer Pointer to timer state
+ * @return true if a deadline was due (start the poll now)
+ */
+bool poll_timer_take(poll_timer_t *timer);
+
+/**
+ * Copy the jitter statistics
+ * @param timer Pointer to timer state
+ * @param stats Filled with the statistics since the last reset
+ */
+void poll_timer_get_stats(const poll_timer_t *timer, poll_timer_stats_t *stats);
+
+/**
+ * Reset the jitter statistics (core that takes the deadlines)
+ * @param timer Pointer to timer state
+ */
+void poll_timer_reset_stats(poll_timer_t *timer);
+
+#endif /* POLL_TIMER_H */
@@ -0,0 +1,119 @@
+/*
+ * Section Profiler
+ * Scoped cycle-count probes around the hot functions, accumulated into a
+ * static table (calls, total, min, max) and dumped on request.
+ *
+ * On the RP2040 the probes read the SysTick counter of the running core
+ * (clk_sys cycles, 24 bits: sections up to ~130 ms). The same header and
+ * profiler.c also build on a desktop host (PICO_ON_DEVICE unset), where the
+ * tick source is the TSC on x86 and CLOCK_MONOTONIC elsewhere, so probe
+ * tables from the board and from host benchmarks have the same format.
+ * Both report ticks and nanoseconds.
+ *
+ * Compiled out unless N64_PROFILE: PROFILE_SCOPE() then expands to nothing.
+ * Updates are not atomic: a probe hit from two contexts at once (core and
+ * IRQ) may lose a sample, which only affects the statistics.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef N64_PROFILE
+#define N64_PROFILE         0
+#endif
+
+//--------------------------------------------------------------------
+// Probes
+//--------------------------------------------------------------------
+typedef enum {
+    PROF_N64_START,             // begin_transfer (encode, queue, release)
+    PROF_N64_READ_POLL,         // n64_read_poll (collect + device parser)
+    PROF_N64_XFER_POLL,         // n64_transfer_poll (deadline, unpack, stats)
+    PROF_N64_UNPACK,            // unpack_response (RX word -> response bytes)
+    PROF_N64_RESET_SM,          // reset_state_machine
+    PROF_N64_PARSE,             // accept_response (device driver parser)
+    PROF_USB_CONVERT,           // device_to_usb_report
+    PROF_USB_SEND,              // usb_gamepad_send_report
+    PROF_TUD_TASK,              // tud_task
+    PROF_PROBES
+} profiler_probe_t;
+
+typedef struct {
+    uint32_t calls;
+    uint64_t total;             // Ticks, probe overhead removed
+    uint32_t min;
+    uint32_t max;
+} profiler_stats_t;
+
+//--------------------------------------------------------------------
+// Functions
+//--------------------------------------------------------------------
+
+/**
+ * Start the tick source of core0, measure the probe overhead and clear
+ * the table (once, at boot)
+ */
+void profiler_init(void);
+
+/**
+ * Start the tick source of the calling core (device: SysTick is per core;
+ * call it on every other core that runs probes, the table is left as is)
+ */
+void profiler_init_core(void);
+
+/**
+ * Current tick count (device: SysTick, counts down)
+ * @return Raw tick counter
+ */
+uint32_t profiler_ticks(void);
+
+/**
+ * Add one sample to a probe
+ * @param probe Probe id
+ * @param start Tick count when the section started
+ */
+void profiler_record(profiler_probe_t probe, uint32_t start);
+
+/**
+ * Copy the statistics of a probe
+ * @param probe Probe id
+ * @param stats Filled with the statistics
+ */
+void profiler_get(profiler_probe_t probe, profiler_stats_t *stats);
+
+/**
+ * Clear every probe
+ */
+void profiler_reset(void);
+
+/**
+ * Print the probe table (stdout / debug UART)
+ */
+void profiler_dump(void);
+
+//--------------------------------------------------------------------
+// Scoped Probe
+// Samples from the declaration to the end of the enclosing block,
+// early returns included (GCC/Clang cleanup attribute)
+//--------------------------------------------------------------------
+typedef struct {
+    profiler_probe_t probe;
+    uint32_t start;
+} profiler_scope_t;
+
+static inline void profiler_scope_end(profiler_scope_t *scope) {
+    profiler_record(scope->probe, scope->start);
+}
+
+#if N64_PROFILE
+#define PROFILE_SCOPE(probe) \
+    profiler_scope_t _profile_scope __attribute__((cleanup(profiler_scope_end))) = \
+        { (probe), profiler_ticks() }
+#else
+#define PROFILE_SCOPE(probe) ((void)0)
+#endif
+
+#endif /* PROFILER_H */
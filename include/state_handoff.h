@@ -0,0 +1,63 @@
+/*
+ * Controller State Handoff
+ * Lock-free single-producer/single-consumer snapshot (seqlock)
+ * Used to pass parsed device states from core1 (polling) to core0 (USB)
+ */
+
+#ifndef STATE_HANDOFF_H
+#define STATE_HANDOFF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "n64_device.h"
+
+//--------------------------------------------------------------------
+// Snapshot Slot (one per controller port)
+// Sequence is odd while the producer is writing, even when stable
+//--------------------------------------------------------------------
+typedef struct {
+    volatile uint32_t seq;          // Sequence counter (even = stable)
+    volatile n64_device_state_t state;  // Last device state parsed
+    volatile bool responding;       // Controller answered the last poll
+    volatile uint32_t sample_us;    // Response completion time (time_us_32)
+    volatile uint16_t capture_seq;  // Poll result number from the polling core
+} state_handoff_t;
+
+//--------------------------------------------------------------------
+// Functions
+//--------------------------------------------------------------------
+
+/**
+ * Initialize a handoff slot (no snapshot published yet)
+ * @param handoff Pointer to handoff slot
+ */
+void state_handoff_init(state_handoff_t *handoff);
+
+/**
+ * Publish a new snapshot (producer side, never blocks)
+ * @param handoff Pointer to handoff slot
+ * @param state Controller state to publish
+ * @param responding true if the controller answered the poll
+ * @param sample_us Time the response completed (time_us_32)
+ * @param capture_seq Poll result number (+1 per result on any port)
+ */
+void state_handoff_publish(state_handoff_t *handoff, const n64_device_state_t *state,
+                           bool responding, uint32_t sample_us, uint16_t capture_seq);
+
+/**
+ * Read the latest consistent snapshot (consumer side, never blocks)
+ * @param handoff Pointer to handoff slot
+ * @param state Filled with the published controller state
+ * @param responding Filled with the published connection status
+ * @param sample_us Filled with the published response completion time
+ * @param capture_seq Filled with the published poll result number (a jump
+ *                    of more than one across ports = results overwritten)
+ * @param seq Filled with the snapshot sequence number (0 = nothing published)
+ * @return true if a consistent snapshot was read, false if the producer
+ *         kept writing during every attempt (retry on next loop)
+ */
+bool state_handoff_read(const state_handoff_t *handoff, n64_device_state_t *state,
+                        bool *responding, uint32_t *sample_us, uint16_t *capture_seq,
+                        uint32_t *seq);
+
+#endif /* STATE_HANDOFF_H */
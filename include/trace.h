@@ -0,0 +1,158 @@
+/*
+ * Binary Event Trace
+ * Fixed-size binary records (event, port, timestamp, two arguments) written
+ * into a ring buffer from either core or from an IRQ, instead of formatting
+ * text on the hot path. The records are drained to the debug UART by core0
+ * when it has nothing else to do, without ever waiting for the UART, and
+ * turned back into text on the host by tools/n64_trace_decode.py.
+ *
+ * One ring per core: each ring has a single producer (its core, with IRQs
+ * masked for the few cycles of the write) and a single consumer (core0
+ * drain), so no lock is shared between the cores. A full ring drops the new
+ * record and counts it; the drain reports the loss as a TRACE_EV_DROPPED
+ * record.
+ *
+ * The decoder reads the event names and argument labels from the enum
+ * below: keep one event per line, with its arguments in the comment.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/sync.h"
+#include "hardware/structs/timer.h"
+#include "pico/platform.h"
+
+// Tracing compiled in (0 = trace_event() is empty)
+#ifndef N64_TRACE
+#define N64_TRACE           1
+#endif
+
+// Per-poll events (cycle start, port collected): high rate, off by default
+#ifndef N64_TRACE_POLL
+#define N64_TRACE_POLL      0
+#endif
+
+//--------------------------------------------------------------------
+// Configuration
+//--------------------------------------------------------------------
+#define TRACE_RING_SIZE     128         // Records per core (power of two)
+#define TRACE_CORES         2
+
+//--------------------------------------------------------------------
+// Events
+//--------------------------------------------------------------------
+typedef enum {
+    TRACE_EV_NONE = 0,
+    TRACE_EV_DROPPED,           // Records lost, ring full (arg1 = count)
+    TRACE_EV_CONNECT,           // Controller connected (arg0 = data GPIO)
+    TRACE_EV_RECONNECT,         // Controller reconnected (arg0 = data GPIO, arg1 = connect count)
+    TRACE_EV_DISCONNECT,        // Controller disconnected (arg0 = data GPIO)
+    TRACE_EV_REPORT_PENDING,    // Endpoint busy, report kept for retry (arg1 = sample time)
+    TRACE_EV_CYCLE_START,       // Poll cycle started (arg1 = port mask)
+    TRACE_EV_PORT_DONE,         // Port response collected (arg0 = responding, arg1 = wire us)
+    TRACE_EV_CONFIG_SAVED,      // Configuration written to flash (arg0 = sector, arg1 = generation)
+    TRACE_EV_PAK_RETRY,         // Controller Pak block retried (arg0 = address, arg1 = result)
+    TRACE_EV_RUMBLE,            // Rumble Pak motor written for a host command (arg0 = on, arg1 = host to motor us)
+    TRACE_EV_COUNT
+} trace_event_t;
+
+//--------------------------------------------------------------------
+// Record (12 bytes, little-endian, same layout on the wire)
+//--------------------------------------------------------------------
+#define TRACE_PORT_CORE1    0x80        // Set in port: written by core1
+#define TRACE_PORT_NONE     0x7F        // Event not tied to a port
+
+typedef struct {
+    uint32_t timestamp_us;      // time_us_32 at the event (wraps)
+    uint8_t  event;             // trace_event_t
+    uint8_t  port;              // Port index | TRACE_PORT_CORE1
+    uint16_t arg0;
+    uint32_t arg1;
+} trace_record_t;
+
+_Static_assert(sizeof(trace_record_t) == 12, "trace record layout is shared with the decoder");
+
+//--------------------------------------------------------------------
+// Ring (one per core)
+//--------------------------------------------------------------------
+typedef struct {
+    trace_record_t records[TRACE_RING_SIZE];
+    volatile uint32_t head;     // Next record to write (producer core)
+    volatile uint32_t tail;     // Next record to drain (core0)
+    volatile uint32_t dropped;  // Records lost since boot (producer core)
+} trace_ring_t;
+
+extern trace_ring_t g_trace_rings[TRACE_CORES];
+
+//--------------------------------------------------------------------
+// Functions
+//--------------------------------------------------------------------
+
+/**
+ * Log one event (any core, any context, never blocks)
+ * Inlined: a few loads and stores with IRQs masked on this core only
+ * @param event Event id
+ * @param port Controller port index (TRACE_PORT_NONE if not port related)
+ * @param arg0 First argument
+ * @param arg1 Second argument
+ */
+static inline void trace_event(trace_event_t event, uint8_t port, uint16_t arg0, uint32_t arg1) {
+#if N64_TRACE
+    uint32_t core = get_core_num();
+    trace_ring_t *ring = &g_trace_rings[core];
+
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t head = ring->head;
+    if (head - ring->tail >= TRACE_RING_SIZE) {
+        ring->dropped++;
+    } else {
+        trace_record_t *record = &ring->records[head & (TRACE_RING_SIZE - 1)];
+        record->timestamp_us = timer_hw->timerawl;
+        record->event = (uint8_t)event;
+        record->port = core ? (port | TRACE_PORT_CORE1) : port;
+        record->arg0 = arg0;
+        record->arg1 = arg1;
+
+        // Record complete before the drain can see it
+        __dmb();
+        ring->head = head + 1;
+    }
+    restore_interrupts(irq);
+#else
+    (void)event;
+    (void)port;
+    (void)arg0;
+    (void)arg1;
+#endif
+}
+
+// Per-poll events, compiled out unless N64_TRACE_POLL
+#if N64_TRACE_POLL
+#define trace_poll_event(event, port, arg0, arg1) trace_event(event, port, arg0, arg1)
+#else
+#define trace_poll_event(event, port, arg0, arg1) ((void)0)
+#endif
+
+/**
+ * Clear both rings
+ */
+void trace_init(void);
+
+/**
+ * Send pending records to the debug UART (core0, main loop idle path)
+ * Writes only while the UART TX FIFO has room; a record cut short is
+ * resumed on the next call. Records are sent oldest first across cores.
+ * @return true if records (or part of one) are still waiting
+ */
+bool trace_drain(void);
+
+/**
+ * Finish the record being sent, waiting for the UART if needed
+ * (call before printing text so lines are not interleaved)
+ */
+void trace_drain_sync(void);
+
+#endif /* TRACE_H */
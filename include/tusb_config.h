@@ -60,11 +60,26 @@ extern "C" {
 #endif
 
 //------------- CLASS -------------//
-// Enable HID class (2 instances = 2 separate gamepad interfaces)
-#define CFG_TUD_HID 2
-
-// HID buffer size - must be large enough for our report
-#define CFG_TUD_HID_EP_BUFSIZE 16
+// Enable HID class (one instance per controller port = separate gamepad
+// interfaces, or a single instance in Report ID mode, plus the raw stream)
+#include "usb_descriptors.h"
+#define CFG_TUD_HID USB_HID_TOTAL
+
+// HID buffer size - also bounds GET/SET_REPORT control transfers: large
+// enough for the latency feature report and the raw stream packets
+// (endpoint wMaxPacketSize is set per interface in usb_descriptors.c)
+#define CFG_TUD_HID_EP_BUFSIZE 64
+
+// Mass storage (Controller Pak drive): one sector per buffer, so every
+// write callback gets a whole sector
+#define CFG_TUD_MSC N64_MSC
+#define CFG_TUD_MSC_EP_BUFSIZE 512
+
+// Vendor bulk interface (Transfer Pak dumps): the TX FIFO holds a whole
+// chunk, so a chunk buffer is handed back as soon as it is copied
+#define CFG_TUD_VENDOR N64_TPAK
+#define CFG_TUD_VENDOR_RX_BUFSIZE 64
+#define CFG_TUD_VENDOR_TX_BUFSIZE 512
 
 #ifdef __cplusplus
 }
@@ -1,6 +1,15 @@
 /*
  * USB Descriptors for N64-USB Gamepad
  * Dual gamepad support - USB composite device
+ *
+ * Two layouts (build option PICO_N64_HID_REPORT_ID):
+ *   default   - one HID interface and IN endpoint per controller port
+ *   Report ID - one HID interface and IN endpoint shared by every port,
+ *               one gamepad collection per player selected by Report ID
+ * PICO_N64_RAW_STREAM adds a vendor-defined HID interface after the
+ * gamepads for the raw Joybus stream, PICO_N64_MSC a mass-storage
+ * interface after the HID ones for the Controller Pak drive, and
+ * PICO_N64_TPAK a vendor bulk interface last for Transfer Pak dumps.
  */
 
 #ifndef USB_DESCRIPTORS_H
@@ -11,7 +20,45 @@
 //--------------------------------------------------------------------
 // Configuration
 //--------------------------------------------------------------------
-#define MAX_CONTROLLERS     2           // Maximum number of controllers
+// Port count comes from the build (length of the PICO_N64_DATA_PINS list)
+#ifndef N64_NUM_PORTS
+#define N64_NUM_PORTS       2
+#endif
+#define MAX_CONTROLLERS     N64_NUM_PORTS   // Number of controller ports (1-8)
+#define USB_HID_POLL_INTERVAL_MS 8      // HID IN endpoint bInterval (frames)
+#define USB_HID_POLL_INTERVAL_FAST_MS 1 // bInterval of the 1000 Hz mode
+
+// Single shared interface with one Report ID per player
+#ifndef N64_HID_REPORT_ID
+#define N64_HID_REPORT_ID   0
+#endif
+
+// Vendor HID interface streaming raw controller states
+#ifndef N64_RAW_STREAM
+#define N64_RAW_STREAM      0
+#endif
+#define USB_STREAM_POLL_INTERVAL_MS 1   // Raw stream IN endpoint bInterval
+#define USB_GAMEPAD_EP_SIZE 16          // Gamepad IN endpoint wMaxPacketSize
+#define USB_STREAM_EP_SIZE  64          // Raw stream IN endpoint wMaxPacketSize
+#define USB_LATENCY_FEATURE_SIZE 63     // Latency feature report payload (bytes)
+
+// Rumble output report on every gamepad
+#ifndef N64_RUMBLE
+#define N64_RUMBLE          1
+#endif
+#define USB_RUMBLE_REPORT_SIZE 2        // Rumble output report payload (bytes)
+
+// Mass-storage interface exposing the Controller Paks
+#ifndef N64_MSC
+#define N64_MSC             0
+#endif
+#define USB_MSC_EP_SIZE     64          // Bulk endpoints wMaxPacketSize (full speed)
+
+// Vendor bulk interface streaming Transfer Pak cartridge dumps
+#ifndef N64_TPAK
+#define N64_TPAK            0
+#endif
+#define USB_TPAK_EP_SIZE    64          // Bulk endpoints wMaxPacketSize (full speed)
 
 //--------------------------------------------------------------------
 // USB IDs
@@ -27,12 +74,57 @@
 #define STRID_MANUFACTURER  1
 #define STRID_PRODUCT       2
 #define STRID_SERIAL        3
+#define STRID_INTERFACE     4           // "N64 Gamepad P1", then one per port
+#define STRID_STREAM        (STRID_INTERFACE + USB_HID_INSTANCES)   // After the gamepads
+#define STRID_MSC           (STRID_STREAM + N64_RAW_STREAM)         // After the raw stream
+#define STRID_TPAK          (STRID_MSC + N64_MSC)                   // After the pak drive
+
+//--------------------------------------------------------------------
+// Interface Numbers (one HID interface and IN endpoint per HID instance)
+//--------------------------------------------------------------------
+#if N64_HID_REPORT_ID
+#define USB_HID_INSTANCES   1                   // Shared by every port
+#else
+#define USB_HID_INSTANCES   MAX_CONTROLLERS     // One per port
+#endif
+#define USB_STREAM_INSTANCE USB_HID_INSTANCES   // HID instance of the raw stream
+#define USB_HID_TOTAL       (USB_HID_INSTANCES + N64_RAW_STREAM)
+#define ITF_NUM_HID(itf)    (itf)
+#define ITF_NUM_MSC         USB_HID_TOTAL               // After the HID interfaces
+#define ITF_NUM_TPAK        (USB_HID_TOTAL + N64_MSC)   // Last
+#define ITF_NUM_TOTAL       (USB_HID_TOTAL + N64_MSC + N64_TPAK)
+#define EPNUM_HID(itf)      (0x81 + (itf))
+#define EPNUM_MSC_OUT       (0x01 + ITF_NUM_MSC)
+#define EPNUM_MSC_IN        (0x81 + ITF_NUM_MSC)
+#define EPNUM_TPAK_OUT      (0x01 + ITF_NUM_TPAK)
+#define EPNUM_TPAK_IN       (0x81 + ITF_NUM_TPAK)
+#define HID_REPORT_ID(port) ((port) + 1)        // Report ID mode: player 1 = ID 1
 
 //--------------------------------------------------------------------
-// Interface Numbers (one HID interface per gamepad)
+// Functions
 //--------------------------------------------------------------------
-#define ITF_NUM_HID1        0
-#define ITF_NUM_HID2        1
-#define ITF_NUM_TOTAL       2
+
+/**
+ * Set the polling interval of every HID IN endpoint
+ * Must be called before tusb_init() (the host reads it at enumeration).
+ * In Report ID mode the shared endpoint is polled MAX_CONTROLLERS times
+ * faster (at least every frame) so each player keeps the same report rate.
+ * @param interval_ms Report period per player in frames (1-255)
+ */
+void usb_descriptors_set_poll_interval(uint8_t interval_ms);
+
+/**
+ * Get the polling interval advertised to the host
+ * @return bInterval of the HID IN endpoint(s) in frames
+ */
+uint8_t usb_descriptors_get_poll_interval(void);
+
+/**
+ * Get the report period of each player
+ * Equal to bInterval with one endpoint per port; in Report ID mode the
+ * players take turns on the shared endpoint, MAX_CONTROLLERS times bInterval.
+ * @return Interval between two host reads of a player's report in frames
+ */
+uint8_t usb_descriptors_get_report_interval(void);
 
 #endif /* USB_DESCRIPTORS_H */
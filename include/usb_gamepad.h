@@ -1,7 +1,10 @@
 /*
  * USB HID Gamepad Interface
- * Converts N64 controller state to USB HID gamepad report
+ * Converts device states (N64 controller, N64 mouse, GameCube controller)
+ * to USB HID gamepad reports
  * Supports dual controllers via separate HID interfaces
+ * Reports are only queued when they change (plus a periodic refresh);
+ * reports refused by a busy endpoint are kept and retried.
  */
 
 #ifndef USB_GAMEPAD_H
@@ -9,12 +12,14 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include "n64_protocol.h"
+#include "n64_device.h"
 #include "usb_descriptors.h"
+#include "latency_stats.h"
 
 //--------------------------------------------------------------------
 // USB HID Gamepad Report Structure
-// No Report ID - each gamepad has its own HID interface
+// No Report ID in the default layout (each gamepad has its own HID
+// interface); TinyUSB prepends the Report ID in Report ID mode
 //--------------------------------------------------------------------
 typedef struct __attribute__((packed)) {
     uint16_t buttons;       // 16 buttons (bits 0-15)
@@ -23,6 +28,47 @@ typedef struct __attribute__((packed)) {
     uint8_t  ly;            // Left stick Y (0-255, 128=center)
 } usb_gamepad_report_t;
 
+//--------------------------------------------------------------------
+// Latency Feature Report (GET_FEATURE on a gamepad, same Report ID)
+// Percentiles are bucket upper limits (see latency_stats.h), all values
+// saturate at 65535 us. SET_FEATURE clears the port's histograms.
+//--------------------------------------------------------------------
+#define USB_LATENCY_FEATURE_VERSION 1
+
+typedef struct __attribute__((packed)) {
+    uint32_t count;         // Samples since the last reset
+    uint16_t p50_us;
+    uint16_t p90_us;
+    uint16_t p99_us;
+    uint16_t max_us;
+} usb_latency_stage_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t version;        // USB_LATENCY_FEATURE_VERSION
+    uint8_t port;           // Controller port (0 = P1)
+    uint8_t stages;         // LATENCY_STAGES
+    usb_latency_stage_t stage[LATENCY_STAGES];  // latency_stage_t order
+} usb_latency_feature_t;
+
+_Static_assert(sizeof(usb_latency_feature_t) == USB_LATENCY_FEATURE_SIZE,
+               "feature report size must match the report descriptor");
+
+//--------------------------------------------------------------------
+// Rumble Output Report (SET_REPORT Output on a gamepad, same Report ID)
+// Sent over the control endpoint: the gamepad interfaces have no OUT
+// endpoint. Unmount and suspend stop every motor.
+//--------------------------------------------------------------------
+typedef struct __attribute__((packed)) {
+    uint8_t strength;       // 0 = off, 1-254 = duty cycle, 255 = full
+    uint8_t duration;       // Stop after this many 10 ms (0 = until the next report)
+} usb_rumble_report_t;
+
+_Static_assert(sizeof(usb_rumble_report_t) == USB_RUMBLE_REPORT_SIZE,
+               "output report size must match the report descriptor");
+
+// Rumble report handler (USB task context, must not block)
+typedef void (*usb_rumble_cb_t)(uint8_t port, const usb_rumble_report_t *report);
+
 //--------------------------------------------------------------------
 // Button Bit Positions in USB Report
 //--------------------------------------------------------------------
@@ -36,6 +82,13 @@ typedef struct __attribute__((packed)) {
 #define USB_BTN_C_LEFT      (1 << 7)    // Button 8 - N64 C-Left
 #define USB_BTN_C_RIGHT     (1 << 8)    // Button 9 - N64 C-Right
 #define USB_BTN_START       (1 << 9)    // Button 10 - N64 Start
+#define USB_BTN_X           (1 << 10)   // Button 11 - GameCube X
+#define USB_BTN_Y           (1 << 11)   // Button 12 - GameCube Y
+
+// GameCube buttons without an N64 twin reuse the closest N64 position:
+// A, B, Z, L, R and Start as on the N64, the C-stick as the C buttons
+// (past GC_CSTICK_THRESHOLD), the main stick and D-Pad as on the N64.
+// An N64 mouse reports A and B, and its motion on the stick.
 
 //--------------------------------------------------------------------
 // Hat Switch Values (D-Pad directions)
@@ -56,18 +109,50 @@ typedef struct __attribute__((packed)) {
 #define JOYSTICK_CENTER     128         // USB center value (8-bit)
 #define JOYSTICK_MIN        0           // USB minimum value
 #define JOYSTICK_MAX        255         // USB maximum value
+#define USB_MOUSE_GAIN      4           // N64 mouse motion per poll -> stick units
+
+//--------------------------------------------------------------------
+// Report Transmission
+//--------------------------------------------------------------------
+typedef enum {
+    USB_REPORT_SENT,            // Queued on the endpoint
+    USB_REPORT_SUPPRESSED,      // Same as the last report sent, refresh not due
+    USB_REPORT_PENDING          // Endpoint busy: kept for usb_gamepad_flush()
+} usb_report_result_t;
+
+typedef struct {
+    uint32_t sent;              // Reports queued on the endpoint
+    uint32_t suppressed;        // Unchanged reports not queued
+    uint32_t coalesced;         // Pending reports replaced by a newer one
+} usb_report_stats_t;
 
 //--------------------------------------------------------------------
 // Functions
 //--------------------------------------------------------------------
 
 /**
- * Convert N64 controller state to USB HID gamepad report
+ * Build the button and axis lookup tables used by the device mappings
+ * and reset the per-instance report caches
+ * Must be called once before the first conversion.
+ * @param refresh_ms Resend an unchanged report after this long
+ *                   (0 = no deduplication, every report is sent)
+ */
+void usb_gamepad_init(uint32_t refresh_ms);
+
+/**
+ * Convert N64 controller state to USB HID gamepad report (table-driven)
  * @param n64 Pointer to N64 controller state
  * @param usb Pointer to USB report structure to fill
  */
 void n64_to_usb_report(const n64_state_t *n64, usb_gamepad_report_t *usb);
 
+/**
+ * Convert a parsed device state with the HID mapping of its device type
+ * @param state Pointer to device state (neutral report if type is NONE)
+ * @param usb Pointer to USB report structure to fill
+ */
+void device_to_usb_report(const n64_device_state_t *state, usb_gamepad_report_t *usb);
+
 /**
  * Initialize a neutral (centered, no buttons) report
  * @param usb Pointer to USB report structure to fill
@@ -88,12 +173,46 @@ uint8_t scale_n64_axis(int8_t n64_value);
  */
 uint8_t map_dpad_to_hat(uint8_t dpad);
 
+/**
+ * Submit a report for a HID instance (change-driven transmission)
+ * Unchanged reports are suppressed until the refresh interval elapses;
+ * if the endpoint is busy the report replaces any pending one.
+ * @param instance HID instance index (controller port)
+ * @param report Pointer to the new report
+ * @param now_ms Current time (ms since boot)
+ * @return What was done with the report
+ */
+usb_report_result_t usb_gamepad_submit_report(uint8_t instance,
+                                              const usb_gamepad_report_t *report,
+                                              uint32_t now_ms);
+
+/**
+ * Retry the pending reports whose endpoint became ready
+ * @param now_ms Current time (ms since boot)
+ * @return Bit mask of the HID instances that queued their pending report
+ */
+uint32_t usb_gamepad_flush(uint32_t now_ms);
+
+/**
+ * Copy and reset the transmission counters of a HID instance
+ * @param instance HID instance index (controller port)
+ * @param stats Filled with the counters since the last call
+ */
+void usb_gamepad_get_report_stats(uint8_t instance, usb_report_stats_t *stats);
+
 /**
  * Send USB HID gamepad report on a specific HID instance
- * @param instance HID instance index (0 = P1, 1 = P2)
+ * In Report ID mode every port goes through instance 0 with its Report ID.
+ * @param instance Controller port (0 = P1, 1 = P2)
  * @param report Pointer to report to send
  * @return true if report sent successfully
  */
 bool usb_gamepad_send_report(uint8_t instance, const usb_gamepad_report_t *report);
 
+/**
+ * Set the handler of the rumble output reports
+ * @param cb Called with the port and the report (NULL = reports ignored)
+ */
+void usb_gamepad_set_rumble_cb(usb_rumble_cb_t cb);
+
 #endif /* USB_GAMEPAD_H */
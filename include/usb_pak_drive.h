@@ -0,0 +1,46 @@
+/*
+ * Controller Pak USB Drive
+ * USB mass-storage interface with one logical unit per controller port.
+ * Each inserted pak shows up as a tiny FAT12 volume holding a single file,
+ * PAK<n>.MPK: the raw 32 KiB pak image, in the .mpk layout emulators use.
+ *
+ * The boot sector, FAT and root directory are generated on the fly; the
+ * file's clusters are contiguous and map one to one onto the pak, one
+ * 512-byte sector per cache line. Host writes to the file land in the pak
+ * through the block cache; writes to the FAT or directory are ignored (the
+ * volume layout is fixed), so a same-size .mpk copied over the file
+ * replaces the pak content.
+ *
+ * A pak removed, swapped or ejected is reported as a medium change, and
+ * the volume serial number follows the pak so the host drops its caches.
+ */
+
+#ifndef USB_PAK_DRIVE_H
+#define USB_PAK_DRIVE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "n64_pak_cache.h"
+
+//--------------------------------------------------------------------
+// Volume Layout (512-byte sectors, one sector per cluster)
+//--------------------------------------------------------------------
+#define PAK_DRIVE_SECTOR_SIZE       N64_PAK_CACHE_LINE_SIZE
+#define PAK_DRIVE_BOOT_SECTOR       0
+#define PAK_DRIVE_FAT_SECTOR        1
+#define PAK_DRIVE_ROOT_SECTOR       2
+#define PAK_DRIVE_DATA_SECTOR       3       // First sector of the file (cluster 2)
+#define PAK_DRIVE_ROOT_ENTRIES      16      // One root directory sector
+#define PAK_DRIVE_SECTORS           (PAK_DRIVE_DATA_SECTOR + N64_PAK_CACHE_PAK_LINES)
+
+//--------------------------------------------------------------------
+// Functions
+//--------------------------------------------------------------------
+
+/**
+ * Attach the drive to the pak cache (before tusb_init)
+ * @param cache Cache the sectors are read from and written to
+ */
+void usb_pak_drive_init(n64_pak_cache_t *cache);
+
+#endif /* USB_PAK_DRIVE_H */
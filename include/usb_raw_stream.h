@@ -0,0 +1,87 @@
+/*
+ * Raw Joybus Stream
+ * Vendor-defined HID interface streaming every controller poll result as
+ * read on the wire (raw n64_state_t bytes, device timestamp, sequence
+ * number), bypassing the gamepad report conversion. GameCube controllers
+ * send the first 4 bytes of their parsed state (buttons, main stick
+ * relative to its origin); the device type is in the frame flags. Meant for emulators,
+ * replay and input analysis tools (see tools/n64_stream_reader.c).
+ *
+ * The wire format below is shared with the host tool: keep this header
+ * free of Pico SDK dependencies. All fields are little-endian.
+ */
+
+#ifndef USB_RAW_STREAM_H
+#define USB_RAW_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "n64_device.h"
+
+//--------------------------------------------------------------------
+// Wire Format (one 64-byte input report, no Report ID)
+//--------------------------------------------------------------------
+#define RAW_STREAM_REPORT_SIZE      64
+#define RAW_STREAM_MAGIC            0x4E    // 'N'
+#define RAW_STREAM_FRAMES_PER_REPORT 5
+
+#define RAW_FRAME_RESPONDING        0x01    // Controller answered the poll
+#define RAW_FRAME_DEVICE_SHIFT      1       // Bits 1-2: n64_device_type_t
+#define RAW_FRAME_DEVICE_MASK       0x06
+
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp_us;      // Response complete time (device clock, wraps)
+    uint16_t seq;               // +1 per poll result, any port (gap = frames lost)
+    uint8_t  port;              // Controller port (0 = P1)
+    uint8_t  flags;             // RAW_FRAME_*
+    n64_state_t state;          // Status response bytes, unmodified (N64 devices)
+} raw_stream_frame_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t  magic;             // RAW_STREAM_MAGIC
+    uint8_t  count;             // Valid frames in this report
+    uint16_t reserved;
+    raw_stream_frame_t frames[RAW_STREAM_FRAMES_PER_REPORT];
+} raw_stream_report_t;
+
+_Static_assert(sizeof(raw_stream_report_t) == RAW_STREAM_REPORT_SIZE,
+               "raw stream report must fill one full-speed packet");
+
+//--------------------------------------------------------------------
+// Device Statistics
+//--------------------------------------------------------------------
+typedef struct {
+    uint32_t frames;            // Frames sent to the host
+    uint32_t reports;           // Reports (USB transfers) sent
+    uint32_t dropped;           // Frames lost because the queue was full
+} usb_raw_stream_stats_t;
+
+//--------------------------------------------------------------------
+// Functions
+//--------------------------------------------------------------------
+
+/**
+ * Queue one controller poll result for the stream
+ * @param port Controller port index
+ * @param state Device state as parsed (N64 devices: raw status bytes)
+ * @param responding true if the controller answered
+ * @param sample_us Response completion time (time_us_32)
+ * @param seq Poll result number, assigned where the result was collected:
+ *            results overwritten before reaching the stream leave a gap
+ */
+void usb_raw_stream_push(uint8_t port, const n64_device_state_t *state, bool responding,
+                         uint32_t sample_us, uint16_t seq);
+
+/**
+ * Send queued frames when the stream endpoint is free (call after tud_task)
+ * @return true if a report was queued on the endpoint
+ */
+bool usb_raw_stream_task(void);
+
+/**
+ * Copy and reset the stream statistics
+ * @param stats Filled with the counters since the last call
+ */
+void usb_raw_stream_get_stats(usb_raw_stream_stats_t *stats);
+
+#endif /* USB_RAW_STREAM_H */
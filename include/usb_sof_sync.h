@@ -0,0 +1,132 @@
+/*
+ * USB SOF Synchronisation
+ * Tracks the USB frame phase (Start Of Frame) and the frame in which the
+ * host reads each HID endpoint, so the controller poll can be scheduled to
+ * finish just before the host IN token ("just-in-time" polling).
+ * Also measures the input age seen by the host (sample -> report read)
+ * and feeds the host and total stages of the latency histograms.
+ */
+
+#ifndef USB_SOF_SYNC_H
+#define USB_SOF_SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_descriptors.h"
+
+//--------------------------------------------------------------------
+// Configuration
+//--------------------------------------------------------------------
+#define SOF_SYNC_FRAME_US           1000    // Full-speed frame period
+#define SOF_SYNC_PHASE_WINDOW       32      // SOFs per frame phase estimate
+#define SOF_SYNC_SLOT_WINDOW        16      // Host reads per read slot estimate
+#define SOF_SYNC_SLOT_BIAS_US       100     // Tolerated early error of the phase
+#define SOF_SYNC_TIMEOUT_US         4000    // No SOF for this long = unlocked
+#define SOF_SYNC_GUARD_US           150     // Margin before the host IN token
+#define SOF_SYNC_LEAD_INIT_US       1000    // Lead time before the first measure
+
+//--------------------------------------------------------------------
+// Host read age (sample complete -> report read by the host)
+//--------------------------------------------------------------------
+typedef struct {
+    uint32_t count;             // Reports read by the host
+    uint64_t sum_us;            // Sum of ages
+    uint32_t max_us;            // Worst age seen
+} usb_sof_age_t;
+
+//--------------------------------------------------------------------
+// Per-endpoint host read tracking
+//--------------------------------------------------------------------
+typedef struct {
+    volatile int8_t slot;           // Read frame modulo interval (-1 = unknown)
+    uint8_t window_count;           // Reads in the current estimate window
+    uint32_t window_min;            // Earliest biased read offset in the window
+    volatile uint32_t queued_sample_us; // Sample time of the report in flight
+    volatile uint32_t queued_us;    // Time the report in flight was queued
+    volatile bool queued;           // A report is waiting for the host
+    usb_sof_age_t age;              // Host read age statistics
+} usb_sof_endpoint_t;
+
+//--------------------------------------------------------------------
+// SOF Sync State
+// Written by the USB core only; the polling core reads single words
+//--------------------------------------------------------------------
+typedef struct {
+    uint8_t interval_frames;        // Host read period of each player
+    bool sof_enabled;               // SOF callback requested from TinyUSB
+
+    // Frame phase: SOF time estimate from the earliest callback in a window
+    bool phase_valid;
+    uint32_t sof_us;                // Estimated time of the last SOF
+    uint32_t last_frame;            // Last 11-bit frame number seen
+    int32_t window_min_err;         // Earliest (callback - estimate) in window
+    uint32_t window_count;          // SOFs in the current window
+    volatile uint32_t last_sof_us;  // Callback time of the last SOF
+    volatile uint32_t cycle_anchor_us;  // SOF time of a frame = 0 mod interval
+
+    // Lead time: poll start -> report queued, plus guard
+    volatile uint32_t ready_us;     // Smoothed poll-to-queue duration
+    volatile uint32_t lead_us;      // ready_us + SOF_SYNC_GUARD_US
+
+    usb_sof_endpoint_t endpoints[MAX_CONTROLLERS];
+} usb_sof_sync_t;
+
+//--------------------------------------------------------------------
+// Functions
+//--------------------------------------------------------------------
+
+/**
+ * Initialize SOF tracking (call after tusb_init)
+ * @param sync Pointer to sync state
+ * @param interval_frames Host read period of each player (frames, see
+ *                        usb_descriptors_get_report_interval)
+ * @param track_sof true to enable the SOF callback (just-in-time mode);
+ *                  false only measures the host read age
+ */
+void usb_sof_sync_init(usb_sof_sync_t *sync, uint8_t interval_frames, bool track_sof);
+
+/**
+ * Record a report queued on an endpoint (for the host read age)
+ * @param sync Pointer to sync state
+ * @param instance HID instance (controller port)
+ * @param sample_us Response completion time of the queued state (time_us_32)
+ */
+void usb_sof_sync_report_queued(usb_sof_sync_t *sync, uint8_t instance,
+                                uint32_t sample_us);
+
+/**
+ * Feed one poll-start to report-queued duration into the lead time
+ * Rises quickly and decays slowly so the slowest port sets the lead.
+ * @param sync Pointer to sync state
+ * @param duration_us Time from poll cycle start to report queued
+ */
+void usb_sof_sync_record_ready(usb_sof_sync_t *sync, uint32_t duration_us);
+
+/**
+ * Compute the start time of the next just-in-time poll
+ * Safe to call from the polling core.
+ * @param sync Pointer to sync state
+ * @param instance_mask Endpoints to serve (bit per HID instance)
+ * @param after_us Earliest acceptable start time (time_us_32)
+ * @param start_us Filled with the poll start time (time_us_32)
+ * @return false if the frame phase or the host read slots are unknown
+ */
+bool usb_sof_sync_next_poll(const usb_sof_sync_t *sync, uint32_t instance_mask,
+                            uint32_t after_us, uint32_t *start_us);
+
+/**
+ * Check whether the SOF phase is currently tracked
+ * @param sync Pointer to sync state
+ * @return true if SOFs are arriving and the phase is estimated
+ */
+bool usb_sof_sync_locked(const usb_sof_sync_t *sync);
+
+/**
+ * Copy and reset the host read age statistics of an endpoint
+ * @param sync Pointer to sync state
+ * @param instance HID instance (controller port)
+ * @param age Filled with the statistics since the last call
+ */
+void usb_sof_sync_get_age(usb_sof_sync_t *sync, uint8_t instance, usb_sof_age_t *age);
+
+#endif /* USB_SOF_SYNC_H */
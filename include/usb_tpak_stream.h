@@ -0,0 +1,107 @@
+/*
+ * Transfer Pak Dump Stream
+ * Vendor bulk interface streaming Game Boy cartridge dumps (see
+ * tools/n64_tpak_dump.c). The host sends one request, the adapter answers
+ * with a response header, exactly `length` bytes of data, then a trailer
+ * with the result and the throughput measured on the device.
+ *
+ * Data goes out as the polling core reads it: each chunk is copied to the
+ * endpoint FIFO while the next one is being read from the cartridge. A
+ * dump that fails part way is padded with zeros up to `length`; the
+ * trailer status and byte count tell the host what is valid.
+ *
+ * The wire format below is shared with the host tool: keep this header
+ * free of Pico SDK dependencies. All fields are little-endian.
+ */
+
+#ifndef USB_TPAK_STREAM_H
+#define USB_TPAK_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//--------------------------------------------------------------------
+// Wire Format
+//--------------------------------------------------------------------
+#define TPAK_STREAM_VERSION         1
+#define TPAK_REQUEST_MAGIC          "TP"
+#define TPAK_RESPONSE_MAGIC         "TD"
+#define TPAK_TRAILER_MAGIC          "TE"
+
+// Request commands (same values as n64_tpak_target_t)
+#define TPAK_CMD_HEADER             0       // Identify only (length 0)
+#define TPAK_CMD_ROM                1
+#define TPAK_CMD_SRAM               2
+
+// Status: n64_tpak_error_t value (0 = ok), or one of these
+#define TPAK_STATUS_BUSY            0xFE    // A dump is already running
+#define TPAK_STATUS_BAD_REQUEST     0xFF
+
+// Game Boy header bytes carried in the response (0x0134 - 0x014F)
+#define TPAK_GB_HEADER_START        0x0134
+#define TPAK_GB_HEADER_LEN          0x1C
+
+typedef struct __attribute__((packed)) {
+    char     magic[2];          // TPAK_REQUEST_MAGIC
+    uint8_t  version;           // TPAK_STREAM_VERSION
+    uint8_t  command;           // TPAK_CMD_*
+    uint8_t  port;              // Controller port (0 = P1)
+    uint8_t  reserved[3];
+} tpak_request_t;
+
+typedef struct __attribute__((packed)) {
+    char     magic[2];          // TPAK_RESPONSE_MAGIC
+    uint8_t  version;
+    uint8_t  status;            // Identification result (length is 0 if not ok)
+    uint8_t  port;
+    uint8_t  command;
+    uint8_t  checksum_ok;       // Header checksum verified by the adapter
+    uint8_t  reserved0;
+    uint32_t length;            // Data bytes that follow
+    uint32_t rom_size;
+    uint32_t ram_size;
+    uint8_t  gb_header[TPAK_GB_HEADER_LEN];     // Title ... global checksum
+    uint8_t  reserved1[16];
+} tpak_response_t;
+
+typedef struct __attribute__((packed)) {
+    char     magic[2];          // TPAK_TRAILER_MAGIC
+    uint8_t  version;
+    uint8_t  status;            // Dump result
+    uint32_t bytes;             // Valid data bytes (the rest is padding)
+    uint32_t retries;           // Block retries over the dump
+    uint32_t stalls;            // Reads that waited for USB to free a buffer
+    uint32_t elapsed_us;        // First data block to last one
+    uint32_t wire_us;           // Joybus time of the data blocks
+    uint32_t bytes_per_s;       // Sustained rate (bytes / elapsed)
+    uint8_t  reserved[36];
+} tpak_trailer_t;
+
+_Static_assert(sizeof(tpak_request_t) == 8, "Transfer Pak request must be 8 bytes");
+_Static_assert(sizeof(tpak_response_t) == 64, "Transfer Pak response must fill one packet");
+_Static_assert(sizeof(tpak_trailer_t) == 64, "Transfer Pak trailer must fill one packet");
+
+//--------------------------------------------------------------------
+// Functions (core0)
+//--------------------------------------------------------------------
+struct n64_tpak;
+
+/**
+ * Attach the stream to the dump state it starts and drains
+ * @param tpak Dump state run by the polling core
+ */
+void usb_tpak_stream_init(struct n64_tpak *tpak);
+
+/**
+ * Take requests and move dump data to the endpoint (call after tud_task)
+ * @return true while a dump is being streamed
+ */
+bool usb_tpak_stream_task(void);
+
+/**
+ * Whether the stream owns the dump state (a console dump must wait)
+ * @return true from the request to the trailer
+ */
+bool usb_tpak_stream_active(void);
+
+#endif /* USB_TPAK_STREAM_H */
@@ -2,25 +2,127 @@
  * N64-USB Dual Gamepad Adapter
  * Main Application for Raspberry Pi Pico
  *
- * Converts up to 2 N64 controllers to USB HID gamepads
- * Dynamically detects 0, 1, or 2 connected controllers
+ * Converts up to 8 N64 controllers to USB HID gamepads
+ * (port count and pins from the PICO_N64_DATA_PINS build list)
+ * Dynamically detects which ports have a controller connected
+ *
+ * Build modes:
+ *   default             - single core: USB, LEDs and polling share core0
+ *   PICO_N64_DUAL_CORE  - core1 polls the controllers and publishes states
+ *                         through lock-free snapshots, core0 only runs USB
+ *   PICO_N64_SOF_SYNC   - polls are timed from the USB SOF so reports are
+ *                         queued just before the host reads the endpoints
+ *   PICO_N64_HIGH_RATE  - 1000 Hz reports (bInterval=1) and Joybus polling;
+ *                         can also be selected at boot with a GPIO strap
+ *   PICO_N64_HID_REPORT_ID - one HID interface for every port, one Report ID
+ *                         per player (instead of one interface per port)
+ *   PICO_N64_RAW_STREAM - extra vendor HID interface streaming the raw
+ *                         controller states with timestamps
+ *   PICO_N64_TRACE      - binary event trace drained to the UART when idle
+ *                         (decoded by tools/n64_trace_decode.py)
+ *   PICO_N64_PROFILE    - cycle-count probes around the hot functions,
+ *                         table dumped by the 'p' console command
+ *   PICO_N64_PAK        - Controller Pak dump/restore from the UART console,
+ *                         blocks transferred between poll cycles
+ *   PICO_N64_MSC        - USB mass-storage drive, one FAT volume per pak,
+ *                         behind a write-back block cache
+ *   PICO_N64_RUMBLE     - HID output report driving the Rumble Pak motors,
+ *                         written between poll cycles
+ *   PICO_N64_TPAK       - Transfer Pak cartridge dumps streamed on a vendor
+ *                         bulk interface (tools/n64_tpak_dump.c)
+ *
+ * Poll period, report refresh, 1000 Hz mode and pins can be overridden at
+ * run time from the UART console ("cfg"), saved in flash, applied at boot.
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
 #include "tusb.h"
 
 #include "n64_controller.h"
+#include "n64_poller.h"
+#include "n64_hotplug.h"
+#include "n64_pak.h"
+#include "n64_pak_cache.h"
+#include "n64_rumble.h"
+#include "n64_tpak.h"
 #include "n64_protocol.h"
 #include "usb_gamepad.h"
 #include "usb_descriptors.h"
+#include "usb_sof_sync.h"
+#include "usb_raw_stream.h"
+#include "usb_pak_drive.h"
+#include "usb_tpak_stream.h"
+#include "cpu_load.h"
+#include "poll_timer.h"
+#include "latency_stats.h"
+#include "trace.h"
+#include "profiler.h"
+#include "config_store.h"
+
+#if PICO_N64_DUAL_CORE
+#include "pico/multicore.h"
+#include "pico/flash.h"
+#include "state_handoff.h"
+#endif
 
 //--------------------------------------------------------------------
 // Configuration
 //--------------------------------------------------------------------
 #define LED_PIN             PICO_DEFAULT_LED_PIN    // Built-in LED (GP25)
-#define POLL_INTERVAL_MS    8                        // ~125Hz polling rate
+#ifndef POLL_INTERVAL_US
+#define POLL_INTERVAL_US    8000                     // ~125Hz polling rate
+#endif
+#define POLL_INTERVAL_FAST_US 1000                   // 1000Hz mode polling rate
+#ifndef N64_REPORT_REFRESH_MS
+#define N64_REPORT_REFRESH_MS 100                    // Unchanged report keep-alive (0 = every poll)
+#endif
+
+// Batched polling: all ports released in the same PIO cycle
+#ifndef N64_BATCHED_POLL
+#define N64_BATCHED_POLL    1
+#endif
+
+// 1000 Hz mode: bInterval=1 and Joybus polling every millisecond
+#ifndef N64_HIGH_RATE
+#define N64_HIGH_RATE       0
+#endif
+
+// Optional boot strap: this pin tied to GND selects the 1000 Hz mode
+// (-1 = no strap, N64_HIGH_RATE decides)
+#ifndef N64_RATE_SELECT_PIN
+#define N64_RATE_SELECT_PIN -1
+#endif
+
+// Just-in-time polling: poll deadline follows the host reads (USB SOF)
+#ifndef N64_SOF_SYNC
+#define N64_SOF_SYNC        0
+#endif
+
+// Raw stream capacity: one report of RAW_STREAM_FRAMES_PER_REPORT frames per
+// stream bInterval. Faster polling than that drops frames (sequence gaps).
+#define RAW_STREAM_MAX_FRAMES_PER_S (RAW_STREAM_FRAMES_PER_REPORT * 1000 / USB_STREAM_POLL_INTERVAL_MS)
+#if N64_RAW_STREAM && N64_HIGH_RATE && MAX_CONTROLLERS * 1000 > RAW_STREAM_MAX_FRAMES_PER_S
+#error "N64_RAW_STREAM carries 5000 frames/s: at most 5 ports with N64_HIGH_RATE"
+#endif
+
+// Controller Pak console commands (32 KiB RAM image)
+#ifndef N64_PAK
+#define N64_PAK             1
+#endif
+
+// Controller Pak USB drive (block transfers go through the pak job)
+#if N64_MSC && !N64_PAK
+#error "N64_MSC needs N64_PAK"
+#endif
+
+// Transfer Pak dumps (blocks go through the Controller Pak block I/O)
+#if N64_TPAK && !N64_PAK
+#error "N64_TPAK needs N64_PAK"
+#endif
 
 //--------------------------------------------------------------------
 // LED Status Patterns
@@ -29,33 +131,130 @@ typedef enum {
     LED_OFF,                // USB not connected
     LED_BLINK_SLOW,         // No controllers connected
     LED_BLINK_MEDIUM,       // 1 controller connected
-    LED_ON                  // 2 controllers connected (or error if fast)
+    LED_ON                  // 2+ controllers connected (or error if fast)
 } led_status_t;
 
 //--------------------------------------------------------------------
 // Global Variables
 //--------------------------------------------------------------------
 static n64_controller_t g_controllers[MAX_CONTROLLERS];
-static n64_state_t g_states[MAX_CONTROLLERS];
+static n64_device_state_t g_states[MAX_CONTROLLERS];
 static usb_gamepad_report_t g_reports[MAX_CONTROLLERS];
 static led_status_t g_led_status = LED_OFF;
 static uint32_t g_last_led_toggle = 0;
 static bool g_led_state = false;
 static bool g_pio_init_ok = false;
+static bool g_high_rate = false;
+
+// Runtime configuration: build defaults, overridden by the flash store
+static uint g_data_pins[MAX_CONTROLLERS];
+static uint g_led_pins[MAX_CONTROLLERS];
+static uint32_t g_poll_interval_us = POLL_INTERVAL_US;
+static uint32_t g_report_refresh_ms = N64_REPORT_REFRESH_MS;
+
+// UART console input line
+static char g_console_line[64];
+static uint g_console_len = 0;
 
 // External LED states
-static bool g_ext_leds_enabled[MAX_CONTROLLERS] = {false, false};
+static bool g_ext_leds_enabled[MAX_CONTROLLERS];
+
+// Connection tracking and empty-port probe back-off
+// (updated by core0 only; the polling core reads the due mask)
+static n64_hotplug_t g_hotplug;
 
-// Connection tracking for debug logs
-static bool g_was_connected[MAX_CONTROLLERS] = {false, false};
-static uint32_t g_connect_count[MAX_CONTROLLERS] = {0, 0};
+// Poll cycle driver and its deadline (both run on the polling core)
+static n64_poller_t g_poller;
+static poll_timer_t g_poll_timer;
+
+// USB frame phase, host read slots and host read age (updated by core0)
+static usb_sof_sync_t g_sof_sync;
+
+// Input age: report queued time - response complete time, per port
+typedef struct {
+    uint32_t count;
+    uint64_t sum_us;
+    uint32_t max_us;
+} input_age_t;
+static input_age_t g_input_age[MAX_CONTROLLERS];
+
+// Sample and build times of the report waiting for a busy endpoint, per port
+static uint32_t g_pending_sample_us[MAX_CONTROLLERS];
+static uint32_t g_pending_built_us[MAX_CONTROLLERS];
+
+// CPU time spent by the polling core on each poll cycle
+// (cycle start + collect, conversion and USB queue / snapshot publish)
+typedef struct {
+    uint32_t cycle_us;      // Accumulated for the cycle in progress
+    uint32_t count;
+    uint64_t sum_us;
+    uint32_t max_us;
+} poll_cost_t;
+static poll_cost_t g_poll_cost;
+
+// 'stats' (core0) asks the polling core to clear the counters it writes:
+// poll cost, deadline jitter, poll timing and Joybus transfer durations
+static volatile bool g_stats_reset;
+
+// CPU utilisation (one counter per core)
+static cpu_load_t g_core0_load;
+static uint32_t g_last_stats = 0;                  // Last 'stats' command (ms since boot)
+
+// Poll result number, +1 per result on any port (polling core); the raw
+// stream sequence, so results lost on the way to core0 leave a gap
+static uint16_t g_capture_seq;
+
+#if N64_PAK
+// Controller Pak job, run by the polling core, and its RAM image
+static n64_pak_job_t g_pak_job;
+static uint8_t g_pak_image[N64_PAK_SIZE];
+static bool g_pak_skipped;          // Pak port missed its last poll (polling core)
+static bool g_pak_reported = true;  // Job result printed (core0)
+
+// Job request (console or USB drive), handed to the polling core
+typedef struct {
+    volatile bool pending;
+    n64_pak_op_t op;
+    uint port;
+    uint first_block;
+    uint count;
+    uint8_t *data;
+} pak_request_t;
+static pak_request_t g_pak_request;
+#endif
+
+#if N64_MSC
+// USB drive block cache (core0) and its transfer on the pak job
+static n64_pak_cache_t g_pak_cache;
+static bool g_pak_cache_io;
+#endif
+
+#if N64_RUMBLE
+// Host rumble commands (core0) and motor writes (polling core)
+static n64_rumble_t g_rumble;
+#endif
+
+#if N64_TPAK
+// Transfer Pak dump: started by core0 (console, USB stream), run by the
+// polling core
+static n64_tpak_t g_tpak;
+static bool g_tpak_skipped;         // Dump port missed its last poll (polling core)
+static uint64_t g_tpak_reported_us; // End of the last dump printed (core0)
+#endif
+
+#if PICO_N64_DUAL_CORE
+// Core1 -> core0 controller state snapshots
+static cpu_load_t g_core1_load;
+static state_handoff_t g_handoff[MAX_CONTROLLERS];
+static uint32_t g_last_seq[MAX_CONTROLLERS];
+#endif
 
 //--------------------------------------------------------------------
 // External LED Management (optional per-controller LEDs)
 //--------------------------------------------------------------------
 static void init_external_leds(void) {
     for (int i = 0; i < MAX_CONTROLLERS; i++) {
-        uint pin = N64_LED_PINS[i];
+        uint pin = g_led_pins[i];
         if (pin != 0) {
             gpio_init(pin);
             gpio_set_dir(pin, GPIO_OUT);
@@ -70,7 +269,7 @@ static void update_external_leds(void) {
     for (int i = 0; i < MAX_CONTROLLERS; i++) {
         if (g_ext_leds_enabled[i]) {
             // LED ON when controller is connected, OFF otherwise
-            gpio_put(N64_LED_PINS[i], g_controllers[i].connected);
+            gpio_put(g_led_pins[i], g_controllers[i].connected);
         }
     }
 }
@@ -105,7 +304,7 @@ static void update_led(void) {
             break;
 
         case LED_ON:
-            // 2 controllers - solid on
+            // 2+ controllers - solid on
             gpio_put(LED_PIN, true);
             break;
     }
@@ -124,6 +323,33 @@ static uint8_t count_connected(void) {
     return count;
 }
 
+#if N64_MSC || N64_RUMBLE
+// Ports with a controller, as seen by hot-plug detection, whose device has
+// an accessory slot (no pak traffic to a mouse or a GameCube controller)
+static uint32_t accessory_ports(void) {
+    uint32_t ports = 0;
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        const n64_device_driver_t *driver = g_controllers[i].driver;
+        if (g_hotplug.ports[i].connected && driver != NULL && driver->accessory) {
+            ports |= 1u << i;
+        }
+    }
+    return ports;
+}
+#endif
+
+#if N64_PAK
+// Known device without an accessory slot on the port (console refusal)
+static bool no_accessory_slot(const char *tag, uint port) {
+    const n64_device_driver_t *driver = g_controllers[port].driver;
+    if (driver == NULL || driver->accessory) {
+        return false;
+    }
+    printf("[%s] P%u: %s has no accessory slot\n", tag, port + 1, n64_device_name(driver->type));
+    return true;
+}
+#endif
+
 //--------------------------------------------------------------------
 // Update LED based on connection status
 //--------------------------------------------------------------------
@@ -153,43 +379,1202 @@ static void update_led_status(void) {
     }
 }
 
+//--------------------------------------------------------------------
+// Report rate selection (before USB enumeration)
+//--------------------------------------------------------------------
+static bool select_high_rate(void) {
+#if N64_RATE_SELECT_PIN >= 0
+    // Strap to GND = 1000 Hz, left floating (pull-up) = default rate
+    gpio_init(N64_RATE_SELECT_PIN);
+    gpio_set_dir(N64_RATE_SELECT_PIN, GPIO_IN);
+    gpio_pull_up(N64_RATE_SELECT_PIN);
+    sleep_us(100);  // Let the pull-up settle
+    return !gpio_get(N64_RATE_SELECT_PIN);
+#else
+    uint32_t high_rate;
+    if (config_store_get_u32(CONFIG_KEY_HIGH_RATE, &high_rate)) {
+        return high_rate != 0;
+    }
+    return N64_HIGH_RATE;
+#endif
+}
+
+//--------------------------------------------------------------------
+// Runtime configuration (build defaults, then the flash store)
+//--------------------------------------------------------------------
+static bool pins_valid(const uint8_t *data, const uint8_t *led) {
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        if (data[i] >= NUM_BANK0_GPIOS || data[i] == LED_PIN) {
+            return false;
+        }
+        if (led[i] != 0 && (led[i] >= NUM_BANK0_GPIOS || led[i] == LED_PIN)) {
+            return false;
+        }
+        for (int j = 0; j < MAX_CONTROLLERS; j++) {
+            if ((j != i && data[j] == data[i]) || (led[j] != 0 && led[j] == data[i])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static uint32_t load_config(void) {
+    uint32_t start_us = time_us_32();
+    config_store_init();
+
+    uint8_t data[MAX_CONTROLLERS];
+    uint8_t led[MAX_CONTROLLERS];
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        data[i] = (uint8_t)N64_DATA_PINS[i];
+        led[i] = (uint8_t)N64_LED_PINS[i];
+    }
+    config_store_get(CONFIG_KEY_DATA_PINS, data, sizeof(data));
+    config_store_get(CONFIG_KEY_LED_PINS, led, sizeof(led));
+    if (!pins_valid(data, led)) {
+        // Keep the build pins rather than drive a wrong GPIO
+        for (int i = 0; i < MAX_CONTROLLERS; i++) {
+            data[i] = (uint8_t)N64_DATA_PINS[i];
+            led[i] = (uint8_t)N64_LED_PINS[i];
+        }
+    }
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        g_data_pins[i] = data[i];
+        g_led_pins[i] = led[i];
+    }
+
+    uint32_t value;
+    if (config_store_get_u32(CONFIG_KEY_POLL_INTERVAL_US, &value) &&
+        value >= POLL_INTERVAL_FAST_US && value <= 100000) {
+        g_poll_interval_us = value;
+    }
+    if (config_store_get_u32(CONFIG_KEY_REPORT_REFRESH_MS, &value) && value <= 10000) {
+        g_report_refresh_ms = value;
+    }
+
+    return time_us_32() - start_us;
+}
+
+//--------------------------------------------------------------------
+// USB Task (counted as busy only when TinyUSB has events queued)
+//--------------------------------------------------------------------
+static void run_usb_task(void) {
+    bool pending = tud_task_event_ready();
+
+    if (pending) {
+        cpu_load_begin(&g_core0_load);
+    }
+    {
+        PROFILE_SCOPE(PROF_TUD_TASK);
+        tud_task();
+    }
+    if (pending) {
+        cpu_load_end(&g_core0_load);
+    }
+}
+
+//--------------------------------------------------------------------
+// Statistics ('stats' console command)
+// Counters cover the time since the previous 'stats' (or boot) and are
+// cleared by it; the CPU load is the last one-second window. Counters the
+// polling core writes are cleared by that core (apply_stats_reset())
+//--------------------------------------------------------------------
+static void report_stats(void) {
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    uint32_t elapsed_ms = now - g_last_stats;
+    g_last_stats = now;
+    if (elapsed_ms == 0) {
+        elapsed_ms = 1;
+    }
+    printf("[STATS] Over the last %lu ms\n", elapsed_ms);
+
+    uint32_t core0 = cpu_load_get_permille(&g_core0_load);
+#if PICO_N64_DUAL_CORE
+    uint32_t core1 = cpu_load_get_permille(&g_core1_load);
+    printf("[STATS] CPU load: core0 %lu.%lu%%, core1 %lu.%lu%%\n",
+           core0 / 10, core0 % 10, core1 / 10, core1 % 10);
+#else
+    printf("[STATS] CPU load: core0 %lu.%lu%%\n", core0 / 10, core0 % 10);
+#endif
+
+    // Polling core CPU time per cycle
+    if (g_poll_cost.count > 0) {
+        printf("[STATS] Poll cost: avg %lu max %lu us per cycle (%lu cycles)\n",
+               (uint32_t)(g_poll_cost.sum_us / g_poll_cost.count),
+               g_poll_cost.max_us, g_poll_cost.count);
+    }
+
+    // Poll deadline jitter (actual cycle start - ideal deadline)
+    poll_timer_stats_t jitter;
+    poll_timer_get_stats(&g_poll_timer, &jitter);
+    if (jitter.count > 0) {
+        printf("[STATS] Poll timer: period %lu us, jitter min %ld avg %ld max %ld us, %lu missed\n",
+               g_poll_timer.period_us, jitter.min_dev_us,
+               (int32_t)(jitter.sum_dev_us / jitter.count), jitter.max_dev_us,
+               jitter.missed);
+    }
+
+#if N64_SOF_SYNC
+    printf("[STATS] SOF sync: %s, lead %lu us, host read slots",
+           usb_sof_sync_locked(&g_sof_sync) ? "locked" : "unlocked", g_sof_sync.lead_us);
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        printf(" P%d %d", i + 1, g_sof_sync.endpoints[i].slot);
+    }
+    printf("\n");
+#endif
+
+    // Input age when the host reads the report (completion callback time)
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        usb_sof_age_t host_age;
+        usb_sof_sync_get_age(&g_sof_sync, i, &host_age);
+        if (host_age.count == 0) {
+            continue;
+        }
+        printf("[STATS] P%d host read: age avg %lu max %lu us (%lu reports)\n",
+               i + 1, (uint32_t)(host_age.sum_us / host_age.count),
+               host_age.max_us, host_age.count);
+    }
+
+    // Per-port sample offset within the cycle and input age at USB queue time
+    // (statistics only: in dual-core mode core1 may update them concurrently)
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        const n64_port_timing_t *timing = &g_poller.timing[i];
+        input_age_t *age = &g_input_age[i];
+        if (timing->samples == 0 || age->count == 0) {
+            continue;
+        }
+        printf("[STATS] P%d (%s, %s): offset avg %lu max %lu us, age avg %lu max %lu us\n",
+               i + 1, n64_device_name((n64_device_type_t)g_states[i].type),
+               g_poller.batched ? "batched" : "sequential",
+               (uint32_t)(timing->offset_sum_us / timing->samples), timing->offset_max_us,
+               (uint32_t)(age->sum_us / age->count), age->max_us);
+        age->count = 0;
+        age->sum_us = 0;
+        age->max_us = 0;
+    }
+
+    // Reports queued vs. unchanged vs. replaced while the endpoint was busy
+    uint32_t transfers = 0;
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        usb_report_stats_t reports;
+        usb_gamepad_get_report_stats(i, &reports);
+        transfers += reports.sent;
+        if (reports.sent == 0 && reports.suppressed == 0 && reports.coalesced == 0) {
+            continue;
+        }
+        printf("[STATS] P%d reports: %lu sent, %lu suppressed (unchanged), %lu coalesced (endpoint busy)\n",
+               i + 1, reports.sent, reports.suppressed, reports.coalesced);
+    }
+    // One interrupt IN transfer per report, whatever the layout
+    printf("[STATS] USB: %lu transfers/s on %d endpoint%s\n",
+           transfers * 1000 / elapsed_ms, USB_HID_INSTANCES,
+           USB_HID_INSTANCES > 1 ? "s" : "");
+
+#if N64_RAW_STREAM
+    usb_raw_stream_stats_t stream;
+    usb_raw_stream_get_stats(&stream);
+    printf("[STATS] Raw stream: %lu frames/s in %lu reports/s, %lu dropped (queue full)\n",
+           stream.frames * 1000 / elapsed_ms, stream.reports * 1000 / elapsed_ms,
+           stream.dropped);
+#endif
+#if N64_MSC
+    // Controller Pak drive cache (cumulative)
+    n64_pak_cache_stats_t cache;
+    n64_pak_cache_get_stats(&g_pak_cache, &cache);
+    uint32_t lookups = cache.hits + cache.misses;
+    if (lookups > 0) {
+        printf("[STATS] Pak cache: %lu hits, %lu misses (%lu%% hits), %lu line reads, "
+               "%lu evictions, %lu blocks written, %lu unchanged, %lu lost, %lu errors\n",
+               cache.hits, cache.misses, cache.hits * 100 / lookups, cache.fills,
+               cache.evictions, cache.written, cache.unchanged, cache.lost, cache.errors);
+    }
+#endif
+#if N64_RUMBLE
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        n64_rumble_stats_t rumble;
+        n64_rumble_get_stats(&g_rumble, i, &rumble);
+        if (rumble.commands == 0) {
+            continue;
+        }
+        printf("[STATS] P%d rumble (%s): %lu commands, %lu coalesced, %lu unchanged, "
+               "%lu ignored, %lu motor writes, %lu errors\n",
+               i + 1, n64_rumble_state_name(n64_rumble_state(&g_rumble, i)), rumble.commands,
+               rumble.coalesced, rumble.unchanged, rumble.ignored, rumble.writes, rumble.errors);
+        if (rumble.latency_count > 0) {
+            printf("[STATS] P%d rumble host->motor: min %lu avg %lu max %lu us (%lu commands)\n",
+                   i + 1, rumble.latency_min_us,
+                   (uint32_t)(rumble.latency_sum_us / rumble.latency_count),
+                   rumble.latency_max_us, rumble.latency_count);
+        }
+    }
+#endif
+
+    // Joybus transfer durations (command release to end of frame)
+    static const struct { uint8_t cmd; const char *name; } tracked[] = {
+        {N64_CMD_INFO, "INFO"},
+        {N64_CMD_STATUS, "STATUS"},
+        {N64_CMD_READ, "PAK READ"},
+        {N64_CMD_WRITE, "PAK WRITE"},
+    };
+    for (uint i = 0; i < count_of(tracked); i++) {
+        n64_xfer_stats_t xfer;
+        if (!n64_get_xfer_stats(tracked[i].cmd, &xfer) || xfer.count == 0) {
+            continue;
+        }
+        printf("[STATS] Joybus %s: avg %lu min %lu max %lu us (%lu transfers)\n",
+               tracked[i].name, (uint32_t)(xfer.sum_us / xfer.count),
+               xfer.min_us, xfer.max_us, xfer.count);
+    }
+
+    // Printed: cleared by the polling core before its next cycle
+    g_stats_reset = true;
+}
+
+//--------------------------------------------------------------------
+// Latency histograms ('lat' console command)
+// Cumulative until cleared by SET_FEATURE; percentiles are bucket upper
+// limits. Printed on request only: the lines take several milliseconds of
+// UART time per port
+//--------------------------------------------------------------------
+static void report_latency(void) {
+    printf("[LAT] Bucket limits (us):");
+    for (int b = 0; b < LATENCY_BUCKETS - 1; b++) {
+        printf(" %lu", latency_bucket_limit_us[b]);
+    }
+    printf(" inf\n");
+
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        for (int stage = 0; stage < LATENCY_STAGES; stage++) {
+            latency_hist_t hist;
+            latency_stats_get(i, (latency_stage_t)stage, &hist);
+            if (hist.count == 0) {
+                continue;
+            }
+            printf("[LAT] P%d %-7s n=%lu min %lu p50<=%lu p90<=%lu p99<=%lu max %lu us |",
+                   i + 1, latency_stage_name((latency_stage_t)stage), hist.count,
+                   hist.min_us, latency_hist_percentile(&hist, 500),
+                   latency_hist_percentile(&hist, 900), latency_hist_percentile(&hist, 990),
+                   hist.max_us);
+            for (int b = 0; b < LATENCY_BUCKETS; b++) {
+                printf(" %lu", hist.buckets[b]);
+            }
+            printf("\n");
+        }
+    }
+}
+
+//--------------------------------------------------------------------
+// UART console
+//   cfg                       - show the configuration store
+//   cfg set <key> <v> [v...]  - change a value (one value per port for pins)
+//   cfg unset <key>           - back to the build default
+//   pak                       - Controller Pak job status
+//   pak dump <port>           - read the whole pak into the RAM image
+//   pak restore <port>        - write the RAM image back to the pak
+//   pak read <port> <addr>    - read and print one 32-byte block
+//   stats                     - counters since the last 'stats'
+//   lat                       - latency histograms
+//   p / P                     - profiler table (P also clears it)
+// Configuration changes are saved when no controller is connected,
+// applied at reboot
+//--------------------------------------------------------------------
+static void print_config(void) {
+    config_store_status_t status;
+    config_store_get_status(&status);
+    printf("[CFG] generation %lu, sector %u, %u bytes used, %lu records written, "
+           "%lu compactions%s\n",
+           status.generation, status.sector, status.used, status.writes,
+           status.compactions, status.pending ? ", changes pending" : "");
+
+    for (int key = 1; key < CONFIG_KEYS; key++) {
+        const char *name = config_key_name((config_key_t)key);
+        if (name == NULL) {
+            continue;
+        }
+        uint8_t value[CONFIG_VALUE_MAX];
+        uint8_t len = config_store_get((config_key_t)key, value, sizeof(value));
+        printf("[CFG] %-10s", name);
+        if (len == 0) {
+            printf(" (build default)\n");
+            continue;
+        }
+        if (config_key_type((config_key_t)key) == CONFIG_TYPE_U32) {
+            uint32_t v;
+            memcpy(&v, value, sizeof(v));
+            printf(" %lu\n", v);
+        } else {
+            for (int i = 0; i < len; i++) {
+                printf(" %u", value[i]);
+            }
+            printf("\n");
+        }
+    }
+}
+
+static void run_config_command(char *args) {
+    char *op = strtok(args, " ");
+    if (op == NULL) {
+        print_config();
+        return;
+    }
+
+    char *name = strtok(NULL, " ");
+    config_key_t key = (name != NULL) ? config_key_from_name(name) : CONFIG_KEYS;
+    if (key == CONFIG_KEYS) {
+        printf("[CFG] Unknown key\n");
+        return;
+    }
+
+    bool ok;
+    if (strcmp(op, "unset") == 0) {
+        ok = config_store_set(key, NULL, 0);
+    } else if (strcmp(op, "set") == 0) {
+        uint8_t value[CONFIG_VALUE_MAX];
+        uint8_t len = 0;
+        char *arg;
+        while ((arg = strtok(NULL, " ")) != NULL && len < CONFIG_VALUE_MAX) {
+            uint32_t v = strtoul(arg, NULL, 0);
+            if (config_key_type(key) == CONFIG_TYPE_U32) {
+                memcpy(value, &v, sizeof(v));
+                len = sizeof(v);
+                break;
+            }
+            value[len++] = (uint8_t)v;
+        }
+        // No value: only 'unset' removes a key
+        ok = (len > 0) && config_store_set(key, value, len);
+    } else {
+        ok = false;
+    }
+
+    printf(ok ? "[CFG] %s updated, saved when no controller is connected, applied at reboot\n"
+              : "[CFG] Invalid command or value for %s\n", name);
+}
+
+#if N64_PAK
+static void print_pak_status(void) {
+    n64_pak_job_state_t state = g_pak_job.state;
+    static const char *const names[] = {"idle", "running", "done", "failed"};
+
+    printf("[PAK] Job %s", names[state]);
+    if (state != N64_PAK_JOB_IDLE) {
+        printf(": P%u %s, %u/%u blocks", g_pak_job.port + 1,
+               g_pak_job.op == N64_PAK_OP_READ ? "read" : "write",
+               g_pak_job.done, g_pak_job.count);
+    }
+    printf("\n");
+
+#if N64_MSC
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        uint16_t medium;
+        bool present = n64_pak_cache_present(&g_pak_cache, i, &medium);
+        printf("[PAK] P%d drive: %s, %u blocks to write back\n", i + 1,
+               present ? "pak present" : "no pak", n64_pak_cache_dirty_blocks(&g_pak_cache, i));
+    }
+#endif
+}
+
+static void run_pak_command(char *args) {
+    char *op = strtok(args, " ");
+    if (op == NULL) {
+        print_pak_status();
+        return;
+    }
+
+    char *port_arg = strtok(NULL, " ");
+    uint port = (port_arg != NULL) ? strtoul(port_arg, NULL, 0) : 0;
+    if (port < 1 || port > MAX_CONTROLLERS) {
+        printf("[PAK] Port must be 1 to %d\n", MAX_CONTROLLERS);
+        return;
+    }
+    if (g_pak_request.pending || g_pak_job.state == N64_PAK_JOB_RUNNING) {
+        printf("[PAK] A job is already running\n");
+        return;
+    }
+    if (no_accessory_slot("PAK", port - 1)) {
+        return;
+    }
+
+    n64_pak_op_t pak_op = N64_PAK_OP_READ;
+    uint first_block = 0;
+    uint count = N64_PAK_BLOCKS;
+    if (strcmp(op, "restore") == 0) {
+        pak_op = N64_PAK_OP_WRITE;
+    } else if (strcmp(op, "read") == 0) {
+        char *addr_arg = strtok(NULL, " ");
+        uint32_t address = (addr_arg != NULL) ? strtoul(addr_arg, NULL, 0) : N64_PAK_SIZE;
+        if (address >= N64_PAK_SIZE) {
+            printf("[PAK] Address must be below 0x%04X\n", N64_PAK_SIZE);
+            return;
+        }
+        first_block = address / N64_PAK_BLOCK_SIZE;
+        count = 1;
+    } else if (strcmp(op, "dump") != 0) {
+        printf("[PAK] Commands: pak, pak dump <port>, pak restore <port>, pak read <port> <addr>\n");
+        return;
+    }
+
+    g_pak_request.op = pak_op;
+    g_pak_request.port = port - 1;
+    g_pak_request.first_block = first_block;
+    g_pak_request.count = count;
+    g_pak_request.data = g_pak_image + first_block * N64_PAK_BLOCK_SIZE;
+    g_pak_reported = false;
+    __dmb();
+    g_pak_request.pending = true;
+    printf("[PAK] P%u: %s of %u block%s queued\n", port,
+           pak_op == N64_PAK_OP_READ ? "read" : "write", count, count > 1 ? "s" : "");
+}
+
+// Job result, printed once by core0 (throughput over the whole job and
+// the wire time of a block, i.e. the Joybus limit without polling)
+static void report_pak_job(void) {
+    n64_pak_job_state_t state = g_pak_job.state;
+    if (g_pak_reported || g_pak_request.pending ||
+        (state != N64_PAK_JOB_DONE && state != N64_PAK_JOB_FAILED)) {
+        return;
+    }
+    g_pak_reported = true;
+    trace_drain_sync();
+
+    const n64_pak_job_t *job = &g_pak_job;
+    const char *op = (job->op == N64_PAK_OP_READ) ? "read" : "write";
+#if N64_MSC
+    // The pak changed behind the USB drive's cache
+    if (job->op == N64_PAK_OP_WRITE) {
+        n64_pak_cache_invalidate(&g_pak_cache, job->port);
+    }
+#endif
+    if (state == N64_PAK_JOB_FAILED) {
+        printf("[PAK] P%u %s failed after %u/%u blocks: %s (%lu retries)\n",
+               job->port + 1, op, job->done, job->count,
+               n64_pak_result_name(job->result), job->retries);
+        return;
+    }
+
+    uint32_t elapsed_us = (uint32_t)(job->end_us - job->start_us);
+    uint32_t bytes = (uint32_t)job->done * N64_PAK_BLOCK_SIZE;
+    uint32_t block_us = job->done ? (uint32_t)(job->wire_us / job->done) : 0;
+    printf("[PAK] P%u %s done: %u blocks (%lu bytes) in %lu us, %lu B/s, %lu retries\n",
+           job->port + 1, op, job->done, bytes, elapsed_us,
+           elapsed_us ? (uint32_t)((uint64_t)bytes * 1000000 / elapsed_us) : 0, job->retries);
+    if (block_us != 0) {
+        printf("[PAK] Wire: %lu us per block (%lu B/s back to back), link busy %lu%%\n",
+               block_us, N64_PAK_BLOCK_SIZE * 1000000 / block_us,
+               elapsed_us ? (uint32_t)(job->wire_us * 100 / elapsed_us) : 0);
+    }
+
+    // Single block: show it
+    if (job->count == 1 && job->op == N64_PAK_OP_READ) {
+        uint address = (job->end_block - 1) * N64_PAK_BLOCK_SIZE;
+        for (uint i = 0; i < N64_PAK_BLOCK_SIZE; i++) {
+            if (i % 16 == 0) {
+                printf("[PAK] %04X:", address + i);
+            }
+            printf(" %02X", g_pak_image[address + i]);
+            if (i % 16 == 15) {
+                printf("\n");
+            }
+        }
+    }
+}
+#endif
+
+#if N64_MSC
+//--------------------------------------------------------------------
+// USB drive block transfers (core0)
+// The cache's transfers share the pak job with the console, one at a time,
+// and only once a console job has been started and reported
+//--------------------------------------------------------------------
+static void run_pak_cache(void) {
+    if (g_pak_request.pending || g_pak_job.state == N64_PAK_JOB_RUNNING) {
+        return;
+    }
+    if (g_pak_cache_io) {
+        g_pak_cache_io = false;
+        n64_pak_cache_io_done(&g_pak_cache, g_pak_job.result);
+    }
+    if (!g_pak_reported) {
+        return;
+    }
+
+    n64_pak_io_t io;
+    if (!n64_pak_cache_next_io(&g_pak_cache, accessory_ports(), &io)) {
+        return;
+    }
+    g_pak_request.op = io.op;
+    g_pak_request.port = io.port;
+    g_pak_request.first_block = io.first_block;
+    g_pak_request.count = io.count;
+    g_pak_request.data = io.data;
+    g_pak_cache_io = true;
+    __dmb();
+    g_pak_request.pending = true;
+}
+#endif
+
+#if N64_TPAK
+//--------------------------------------------------------------------
+// Transfer Pak (core0)
+// "tpak <port>" identifies the cartridge; ROM and SRAM dumps are asked for
+// by the host tool on the USB stream. Results of both are printed here.
+//--------------------------------------------------------------------
+static void run_tpak_command(char *args) {
+    char *port_arg = strtok(args, " ");
+    uint port = (port_arg != NULL) ? strtoul(port_arg, NULL, 0) : 0;
+    if (port < 1 || port > MAX_CONTROLLERS) {
+        printf("[TPAK] Commands: tpak <port> (cartridge header, dumps with tools/n64_tpak_dump)\n");
+        return;
+    }
+    if (usb_tpak_stream_active() || g_tpak.state == N64_TPAK_RUNNING) {
+        printf("[TPAK] A dump is already running\n");
+        return;
+    }
+    if (no_accessory_slot("TPAK", port - 1)) {
+        return;
+    }
+    n64_tpak_start(&g_tpak, port - 1, N64_TPAK_HEADER);
+    printf("[TPAK] P%u: reading the cartridge header\n", port);
+}
+
+// Dump result, printed once (sustained rate from the first data block on)
+static void report_tpak(void) {
+    static const char *const targets[] = {"header", "ROM", "SRAM"};
+    const n64_tpak_t *t = &g_tpak;
+    n64_tpak_state_t state = t->state;
+    if ((state != N64_TPAK_DONE && state != N64_TPAK_FAILED) || t->end_us == g_tpak_reported_us) {
+        return;
+    }
+    g_tpak_reported_us = t->end_us;
+    trace_drain_sync();
+
+    if (t->cart_ready) {
+        const n64_tpak_cart_t *cart = &t->cart;
+        printf("[TPAK] P%u cartridge \"%s\": type 0x%02X, ROM %lu KiB, SRAM %lu bytes, "
+               "header checksum %s\n", t->port + 1, cart->title, cart->type,
+               cart->rom_size / 1024, cart->ram_size, cart->checksum_ok ? "ok" : "BAD");
+    }
+    if (state == N64_TPAK_FAILED) {
+        printf("[TPAK] P%u %s failed after %lu bytes: %s (%lu retries)\n", t->port + 1,
+               targets[t->target], t->produced, n64_tpak_error_name(t->error), t->retries);
+        return;
+    }
+    if (t->target == N64_TPAK_HEADER) {
+        return;
+    }
+
+    uint32_t elapsed_us = (uint32_t)(t->end_us - t->start_us);
+    uint32_t rate = elapsed_us ? (uint32_t)((uint64_t)t->produced * 1000000 / elapsed_us) : 0;
+    printf("[TPAK] P%u %s dump done: %lu bytes in %lu us, %lu.%lu KB/s sustained, "
+           "%lu retries, %lu reads waited for USB\n", t->port + 1, targets[t->target],
+           t->produced, elapsed_us, rate / 1000, rate % 1000 / 100, t->retries, t->stalls);
+    if (elapsed_us != 0) {
+        printf("[TPAK] Joybus busy %lu%% of the dump\n", (uint32_t)(t->wire_us * 100 / elapsed_us));
+    }
+}
+#endif
+
+static void run_console_command(char *line) {
+    if (strncmp(line, "cfg", 3) == 0 && (line[3] == '\0' || line[3] == ' ')) {
+        run_config_command(line + 3);
+#if N64_PAK
+    } else if (strncmp(line, "pak", 3) == 0 && (line[3] == '\0' || line[3] == ' ')) {
+        run_pak_command(line + 3);
+#endif
+#if N64_TPAK
+    } else if (strncmp(line, "tpak", 4) == 0 && (line[4] == '\0' || line[4] == ' ')) {
+        run_tpak_command(line + 4);
+#endif
+    } else if (strcmp(line, "stats") == 0) {
+        report_stats();
+    } else if (strcmp(line, "lat") == 0) {
+        report_latency();
+#if N64_PROFILE
+    } else if (strcmp(line, "p") == 0 || strcmp(line, "P") == 0) {
+        profiler_dump();
+        if (line[0] == 'P') {
+            profiler_reset();
+        }
+#endif
+    } else {
+        printf("Commands: cfg, cfg set <key> <value...>, cfg unset <key>, stats, lat%s%s%s\n",
+               N64_PAK ? ", pak, pak dump|restore <port>, pak read <port> <addr>" : "",
+               N64_TPAK ? ", tpak <port>" : "", N64_PROFILE ? ", p, P" : "");
+    }
+}
+
+static void poll_console(void) {
+#if N64_PAK
+    report_pak_job();
+#endif
+#if N64_TPAK
+    report_tpak();
+#endif
+
+    int c;
+    while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
+        if (c == '\r' || c == '\n') {
+            if (g_console_len > 0) {
+                g_console_line[g_console_len] = '\0';
+                g_console_len = 0;
+                trace_drain_sync();
+                run_console_command(g_console_line);
+            }
+        } else if (g_console_len < sizeof(g_console_line) - 1) {
+            g_console_line[g_console_len++] = (char)c;
+        }
+    }
+}
+
+//--------------------------------------------------------------------
+// Deferred configuration write (core0)
+// Flash writes stall both cores (other core parked, XIP off): only done
+// while no controller is connected, so no player input is delayed
+//--------------------------------------------------------------------
+static void save_config(void) {
+    if (count_connected() != 0) {
+        return;
+    }
+    if (config_store_task()) {
+        config_store_status_t status;
+        config_store_get_status(&status);
+        trace_event(TRACE_EV_CONFIG_SAVED, TRACE_PORT_NONE, status.sector, status.generation);
+    }
+}
+
+//--------------------------------------------------------------------
+// Report queued on the endpoint: host read age and input age tracking
+//--------------------------------------------------------------------
+static void record_report_queued(int i, uint32_t sample_us, uint32_t queued_us) {
+    usb_sof_sync_report_queued(&g_sof_sync, i, sample_us);
+
+    uint32_t age_us = queued_us - sample_us;
+    g_input_age[i].count++;
+    g_input_age[i].sum_us += age_us;
+    if (age_us > g_input_age[i].max_us) {
+        g_input_age[i].max_us = age_us;
+    }
+}
+
+//--------------------------------------------------------------------
+// Retry reports refused by a busy endpoint (after tud_task)
+// and feed the raw stream endpoint
+//--------------------------------------------------------------------
+static void flush_pending_reports(void) {
+#if N64_RAW_STREAM
+    usb_raw_stream_task();
+#endif
+
+    uint32_t flushed = usb_gamepad_flush(to_ms_since_boot(get_absolute_time()));
+    if (flushed == 0) {
+        return;
+    }
+
+    uint32_t now = time_us_32();
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        if (flushed & (1u << i)) {
+            latency_stats_record(i, LATENCY_QUEUE, now - g_pending_built_us[i]);
+            record_report_queued(i, g_pending_sample_us[i], now);
+        }
+    }
+}
+
+//--------------------------------------------------------------------
+// Handle one controller poll result (connection tracking + USB report)
+//--------------------------------------------------------------------
+static void process_port(int i, bool responding, uint32_t sample_us, uint16_t capture_seq) {
+#if N64_RAW_STREAM
+    // Raw bytes as read, before any conversion (empty state if no answer)
+    static const n64_device_state_t no_state = {0};
+    usb_raw_stream_push(i, responding ? &g_states[i] : &no_state, responding, sample_us,
+                        capture_seq);
+#else
+    (void)capture_seq;
+#endif
+
+    // Detect connection state changes
+    uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+    switch (n64_hotplug_update(&g_hotplug, i, responding, now_ms)) {
+        case N64_HOTPLUG_CONNECTED:
+            trace_event(TRACE_EV_CONNECT, i, g_data_pins[i], 0);
+            break;
+
+        case N64_HOTPLUG_RECONNECTED:
+            trace_event(TRACE_EV_RECONNECT, i, g_data_pins[i],
+                        g_hotplug.ports[i].connect_count);
+            break;
+
+        case N64_HOTPLUG_DISCONNECTED:
+            trace_event(TRACE_EV_DISCONNECT, i, g_data_pins[i], 0);
+            // Send one final neutral report so the host sees all buttons released
+            // (kept and retried if the endpoint is busy)
+            usb_gamepad_init_neutral(&g_reports[i]);
+            if (usb_gamepad_submit_report(i, &g_reports[i], now_ms) == USB_REPORT_PENDING) {
+                g_pending_sample_us[i] = sample_us;
+                g_pending_built_us[i] = time_us_32();
+                trace_event(TRACE_EV_REPORT_PENDING, i, 0, sample_us);
+            }
+            break;
+
+        case N64_HOTPLUG_NONE:
+            break;
+    }
+
+    if (responding) {
+        // HID mapping of the device type the driver's parser reported
+        device_to_usb_report(&g_states[i], &g_reports[i]);
+        uint32_t built_us = time_us_32();
+        latency_stats_record(i, LATENCY_CONVERT, built_us - sample_us);
+
+        switch (usb_gamepad_submit_report(i, &g_reports[i], now_ms)) {
+            case USB_REPORT_SENT: {
+                uint32_t queued_us = time_us_32();
+                latency_stats_record(i, LATENCY_QUEUE, queued_us - built_us);
+                record_report_queued(i, sample_us, queued_us);
+                usb_sof_sync_record_ready(&g_sof_sync, queued_us - g_poller.cycle_start_us);
+                break;
+            }
+
+            case USB_REPORT_PENDING:
+                g_pending_sample_us[i] = sample_us;
+                g_pending_built_us[i] = built_us;
+                trace_event(TRACE_EV_REPORT_PENDING, i, 0, sample_us);
+                break;
+
+            case USB_REPORT_SUPPRESSED:
+                break;
+        }
+    }
+}
+
+//--------------------------------------------------------------------
+// Joybus transfer latency of a collected port (polling core)
+//--------------------------------------------------------------------
+static void record_wire_latency(int port, bool responding, uint32_t sample_us) {
+    uint32_t wire_us = 0;
+    if (responding) {
+        uint32_t start_us = (uint32_t)g_controllers[port].xfer_start_us;
+        wire_us = sample_us - start_us;
+        latency_stats_record(port, LATENCY_WIRE, wire_us);
+    }
+    trace_poll_event(TRACE_EV_PORT_DONE, port, responding, wire_us);
+}
+
+//--------------------------------------------------------------------
+// Controller port initialization
+// Runs on the core that will poll the controllers (DMA IRQ affinity)
+//--------------------------------------------------------------------
+static void init_controllers(void) {
+    printf("Initializing %d controller ports (%s polling)...\n", MAX_CONTROLLERS,
+           N64_BATCHED_POLL ? "batched" : "sequential");
+
+    g_pio_init_ok = true;
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        printf("  Controller %d on GP%d: ", i + 1, g_data_pins[i]);
+
+        if (n64_init(&g_controllers[i], g_data_pins[i])) {
+            const n64_device_driver_t *driver = g_controllers[i].driver;
+            printf("OK (%s)\n", driver ? n64_device_name(driver->type) : "empty");
+        } else {
+            printf("FAILED (PIO unavailable)\n");
+            g_pio_init_ok = false;
+        }
+    }
+
+    if (!g_pio_init_ok) {
+        printf("ERROR: Not all controllers could be initialized\n");
+    }
+
+    n64_poller_init(&g_poller, g_controllers, N64_BATCHED_POLL);
+
+    // Poll deadline alarm (IRQ on this core)
+    uint32_t interval_us = g_high_rate ? POLL_INTERVAL_FAST_US : g_poll_interval_us;
+    if (!poll_timer_init(&g_poll_timer, interval_us)) {
+        printf("ERROR: No hardware alarm available for the poll timer\n");
+    }
+}
+
+//--------------------------------------------------------------------
+// Statistics reset posted by 'stats' (polling core, between cycles)
+//--------------------------------------------------------------------
+static void apply_stats_reset(void) {
+    if (!g_stats_reset) {
+        return;
+    }
+    g_poll_cost.count = 0;
+    g_poll_cost.sum_us = 0;
+    g_poll_cost.max_us = 0;
+    poll_timer_reset_stats(&g_poll_timer);
+    n64_poller_reset_timing(&g_poller);
+    n64_reset_xfer_stats();
+    __dmb();
+    g_stats_reset = false;
+}
+
+//--------------------------------------------------------------------
+// Poll cycle CPU cost (polling core)
+//--------------------------------------------------------------------
+static void poll_cost_close_cycle(void) {
+    uint32_t cost = g_poll_cost.cycle_us;
+    g_poll_cost.cycle_us = 0;
+    g_poll_cost.count++;
+    g_poll_cost.sum_us += cost;
+    if (cost > g_poll_cost.max_us) {
+        g_poll_cost.max_us = cost;
+    }
+}
+
+//--------------------------------------------------------------------
+// Just-in-time scheduling (SOF sync mode, runs on the polling core)
+// Moves the next deadline so the reports of the connected ports are queued
+// right before the host reads them; free-running period while unlocked
+//--------------------------------------------------------------------
+static void schedule_next_poll(void) {
+#if N64_SOF_SYNC
+    uint32_t connected = 0;
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        if (g_hotplug.ports[i].connected) {
+            connected |= 1u << i;
+        }
+    }
+
+    // Half a frame ahead so the read being served now is not picked again
+    uint32_t now = time_us_32();
+    uint32_t start_us;
+    if (usb_sof_sync_next_poll(&g_sof_sync, connected,
+                               now + SOF_SYNC_FRAME_US / 2, &start_us)) {
+        poll_timer_schedule(&g_poll_timer, time_us_64() + (start_us - now));
+    }
+#endif
+}
+
+//--------------------------------------------------------------------
+// Controller Pak job (polling core)
+// A block starts only between poll cycles and only if it ends before the
+// next deadline, so status polls are never delayed. When the period is
+// shorter than a block (1000 Hz), a block may take the place of the pak
+// port's next poll instead: that port is then polled every other cycle
+// during the job, the other ports are not affected.
+//--------------------------------------------------------------------
+static bool run_pak_job(void) {
+#if N64_PAK
+    if (g_pak_request.pending && g_pak_job.state != N64_PAK_JOB_RUNNING) {
+        n64_pak_job_start(&g_pak_job, g_pak_request.op, g_pak_request.port, g_pak_request.data,
+                          g_pak_request.first_block, g_pak_request.count);
+        g_pak_skipped = false;
+        __dmb();
+        g_pak_request.pending = false;
+    }
+
+    uint64_t until_us = 0;     // Collect only while a cycle is in flight
+    if (!n64_poller_busy(&g_poller)) {
+        until_us = g_poll_timer.deadline_us;
+        if (g_poll_timer.period_us < N64_PAK_BLOCK_US && !g_pak_skipped) {
+            until_us += g_poll_timer.period_us;
+        }
+    }
+    return n64_pak_job_task(&g_pak_job, g_controllers, until_us);
+#else
+    return false;
+#endif
+}
+
+// Transfer Pak dump (polling core), same slot rule as the pak job
+static bool run_tpak(void) {
+#if N64_TPAK
+    uint64_t until_us = 0;
+    if (!n64_poller_busy(&g_poller)) {
+        until_us = g_poll_timer.deadline_us;
+        if (g_poll_timer.period_us < N64_PAK_BLOCK_US && !g_tpak_skipped) {
+            until_us += g_poll_timer.period_us;
+        }
+    }
+    return n64_tpak_task(&g_tpak, g_controllers, until_us);
+#else
+    return false;
+#endif
+}
+
+#if N64_RUMBLE
+// Rumble output report (core0, USB task): posted, applied by the polling core
+static void on_rumble_report(uint8_t port, const usb_rumble_report_t *report) {
+    n64_rumble_command(&g_rumble, port, report->strength, report->duration);
+}
+#endif
+
+// Rumble Pak motor writes (polling core), same slot rule as the pak job;
+// a port being dumped is left alone (its identification writes 0x8000)
+static bool run_rumble(void) {
+#if N64_RUMBLE
+    uint32_t ports = accessory_ports();
+#if N64_TPAK
+    if (g_tpak.state == N64_TPAK_RUNNING) {
+        ports &= ~(1u << g_tpak.port);
+    }
+#endif
+    uint64_t until_us = n64_poller_busy(&g_poller) ? 0 : g_poll_timer.deadline_us;
+    return n64_rumble_task(&g_rumble, g_controllers, ports, until_us,
+                           g_poll_timer.period_us);
+#else
+    return false;
+#endif
+}
+
+// Leave a port with a pak, Transfer Pak or rumble block on the wire out of the cycle
+static uint32_t pak_filter_due(uint32_t due) {
+#if N64_PAK
+    uint32_t busy = n64_pak_job_busy_mask(&g_pak_job);
+    if (busy != 0) {
+        g_pak_skipped = (due & busy) != 0;
+    } else if (g_pak_job.state == N64_PAK_JOB_RUNNING) {
+        g_pak_skipped = false;
+    }
+    due &= ~busy;
+#endif
+#if N64_TPAK
+    uint32_t tpak_busy = n64_tpak_busy_mask(&g_tpak);
+    if (tpak_busy != 0) {
+        g_tpak_skipped = (due & tpak_busy) != 0;
+    } else if (g_tpak.state == N64_TPAK_RUNNING) {
+        g_tpak_skipped = false;
+    }
+    due &= ~tpak_busy;
+#endif
+#if N64_RUMBLE
+    due = n64_rumble_filter_due(&g_rumble, due);
+#endif
+    return due;
+}
+
+#if PICO_N64_DUAL_CORE
+//--------------------------------------------------------------------
+// Core1: controller init + Joybus polling loop
+// Owns the PIO state machines; never touches TinyUSB
+//--------------------------------------------------------------------
+static void core1_main(void) {
+#if N64_PROFILE
+    // SysTick is per core: start the one the polling probes read (core0
+    // has cleared the table and measured the probe overhead)
+    profiler_init_core();
+#endif
+    // Let core0 park this core while it writes the configuration flash
+    flash_safe_execute_core_init();
+    init_controllers();
+
+    // Signal core0 that the ports are ready
+    multicore_fifo_push_blocking(1);
+
+    while (true) {
+        // Controller Pak, Transfer Pak and Rumble Pak blocks fill the gaps between poll cycles
+        bool pak_busy = run_pak_job();
+        pak_busy |= run_tpak();
+        pak_busy |= run_rumble();
+
+        apply_stats_reset();
+
+        // Sleep until the poll deadline alarm fires (or the pak block ends)
+        if (!poll_timer_take(&g_poll_timer)) {
+            if (!pak_busy) {
+                __wfe();
+            }
+            continue;
+        }
+        schedule_next_poll();
+
+        // Live ports every cycle, empty ports only when their probe is due
+        uint32_t now = to_ms_since_boot(get_absolute_time());
+        uint32_t due = pak_filter_due(n64_hotplug_due_mask(&g_hotplug, now));
+        if (due == 0) {
+            continue;
+        }
+
+        trace_poll_event(TRACE_EV_CYCLE_START, TRACE_PORT_NONE, 0, due);
+        cpu_load_begin(&g_core1_load);
+        n64_poller_start_cycle(&g_poller, due);
+        g_poll_cost.cycle_us += cpu_load_end(&g_core1_load);
+
+        // Publish each port as soon as its response is complete
+        while (n64_poller_busy(&g_poller)) {
+            n64_device_state_t state = {0};
+            bool responding;
+            uint32_t sample_us;
+            int port = n64_poller_collect(&g_poller, &state, &responding, &sample_us);
+            if (port >= 0) {
+                cpu_load_begin(&g_core1_load);
+                record_wire_latency(port, responding, sample_us);
+                state_handoff_publish(&g_handoff[port], &state, responding, sample_us,
+                                      g_capture_seq++);
+                g_poll_cost.cycle_us += cpu_load_end(&g_core1_load);
+            }
+        }
+        poll_cost_close_cycle();
+    }
+}
+
+//--------------------------------------------------------------------
+// Core0: consume new snapshots published by core1
+//--------------------------------------------------------------------
+static void consume_snapshots(void) {
+    bool updated = false;
+
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        n64_device_state_t state;
+        bool responding;
+        uint32_t sample_us;
+        uint16_t capture_seq;
+        uint32_t seq;
+
+        if (!state_handoff_read(&g_handoff[i], &state, &responding, &sample_us, &capture_seq,
+                                &seq) ||
+            seq == g_last_seq[i]) {
+            continue;  // Nothing new (or writer busy, retry next loop)
+        }
+
+        if (!updated) {
+            cpu_load_begin(&g_core0_load);
+            updated = true;
+        }
+
+        g_last_seq[i] = seq;
+        g_states[i] = state;
+        process_port(i, responding, sample_us, capture_seq);
+    }
+
+    if (updated) {
+        update_led_status();
+        update_external_leds();
+        cpu_load_end(&g_core0_load);
+    }
+}
+#else
+//--------------------------------------------------------------------
+// Poll cycle results (single-core mode)
+// USB keeps being serviced while responses are on the wire.
+//--------------------------------------------------------------------
+static void collect_poll_results(void) {
+    n64_device_state_t state;
+    bool responding;
+    uint32_t sample_us;
+    int port;
+
+    while ((port = n64_poller_collect(&g_poller, &state, &responding, &sample_us)) >= 0) {
+        cpu_load_begin(&g_core0_load);
+        record_wire_latency(port, responding, sample_us);
+
+        if (responding) {
+            g_states[port] = state;
+        }
+        process_port(port, responding, sample_us, g_capture_seq++);
+
+        bool cycle_done = !n64_poller_busy(&g_poller);
+        if (cycle_done) {
+            // Update LED status based on connected controllers
+            update_led_status();
+            update_external_leds();
+        }
+
+        g_poll_cost.cycle_us += cpu_load_end(&g_core0_load);
+        if (cycle_done) {
+            poll_cost_close_cycle();
+        }
+    }
+}
+#endif
+
 //--------------------------------------------------------------------
 // Main Application
 //--------------------------------------------------------------------
 int main(void) {
-    // Initialize standard I/O (UART for debug)
+    // Initialize standard I/O (UART for debug) and the event trace
     stdio_init_all();
+    trace_init();
+#if N64_PROFILE
+    profiler_init();
+#endif
+
+    // Saved configuration (pins, rates), before anything uses it
+    uint32_t config_us = load_config();
 
     // Initialize LED
     gpio_init(LED_PIN);
     gpio_set_dir(LED_PIN, GPIO_OUT);
     gpio_put(LED_PIN, false);
 
+    // Report rate (descriptor is patched before the host enumerates it)
+    g_high_rate = select_high_rate();
+    usb_descriptors_set_poll_interval(g_high_rate ? USB_HID_POLL_INTERVAL_FAST_MS
+                                                  : USB_HID_POLL_INTERVAL_MS);
+
+#if N64_MSC
+    // Controller Pak drive, answered from the cache once USB runs
+    n64_pak_cache_init(&g_pak_cache);
+    usb_pak_drive_init(&g_pak_cache);
+#endif
+#if N64_TPAK
+    // Transfer Pak dumps requested on the vendor interface
+    usb_tpak_stream_init(&g_tpak);
+#endif
+
     // Initialize TinyUSB
     tusb_init();
 
-    // Initialize N64 controllers
     printf("N64-USB Dual Gamepad Adapter\n");
-    printf("Initializing %d controller ports...\n", MAX_CONTROLLERS);
+    printf("Report rate: %d Hz (bInterval %d ms)\n",
+           1000 / usb_descriptors_get_report_interval(), usb_descriptors_get_poll_interval());
+#if N64_HID_REPORT_ID
+    printf("USB layout: 1 HID interface, Report IDs 1-%d\n", MAX_CONTROLLERS);
+#else
+    printf("USB layout: %d HID interfaces\n", MAX_CONTROLLERS);
+#endif
+#if N64_MSC
+    printf("USB drive: %d Controller Pak units, %d cache lines\n", MAX_CONTROLLERS,
+           N64_PAK_CACHE_LINES);
+#endif
+#if N64_TPAK
+    printf("USB Transfer Pak stream: vendor interface %d\n", ITF_NUM_TPAK);
+#endif
+#if N64_RAW_STREAM
+    // Poll results past the stream capacity are dropped (sequence gaps)
+    uint32_t stream_fps = MAX_CONTROLLERS *
+                          (1000000 / (g_high_rate ? POLL_INTERVAL_FAST_US : g_poll_interval_us));
+    printf("USB raw stream: %lu frames/s of %d max%s\n", stream_fps, RAW_STREAM_MAX_FRAMES_PER_S,
+           stream_fps > RAW_STREAM_MAX_FRAMES_PER_S ? " (over capacity: frames dropped)" : "");
+#endif
+    printf("Config: loaded in %lu us (\"cfg\" on the console to change it)\n", config_us);
 
-    g_pio_init_ok = true;
-    for (int i = 0; i < MAX_CONTROLLERS; i++) {
-        printf("  Controller %d on GP%d: ", i + 1, N64_DATA_PINS[i]);
-
-        if (n64_init(&g_controllers[i], N64_DATA_PINS[i])) {
-            printf("OK\n");
-        } else {
-            printf("FAILED (PIO unavailable)\n");
-            g_pio_init_ok = false;
-        }
+    // Host read tracking (SOF phase only in just-in-time mode)
+    usb_sof_sync_init(&g_sof_sync, usb_descriptors_get_report_interval(), N64_SOF_SYNC);
 
-        // Initialize neutral reports
+    // Report conversion tables and caches, then neutral reports
+    usb_gamepad_init(g_report_refresh_ms);
+#if N64_RUMBLE
+    n64_rumble_init(&g_rumble);
+    usb_gamepad_set_rumble_cb(on_rumble_report);
+#endif
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
         usb_gamepad_init_neutral(&g_reports[i]);
     }
 
-    if (!g_pio_init_ok) {
-        printf("ERROR: Not all controllers could be initialized\n");
+    cpu_load_init(&g_core0_load);
+    n64_hotplug_init(&g_hotplug);
+
+    // Latency histograms, printed by the 'lat' console command
+    latency_stats_init();
+
+#if PICO_N64_DUAL_CORE
+    // Hand the controllers over to core1 and wait for their init
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        state_handoff_init(&g_handoff[i]);
+        g_last_seq[i] = 0;
     }
+    cpu_load_init(&g_core1_load);
+    printf("Dual-core mode: polling on core1\n");
+    multicore_launch_core1(core1_main);
+    multicore_fifo_pop_blocking();
+#else
+    // Initialize N64 controllers
+    init_controllers();
+#endif
 
     // Initialize optional external LEDs
     printf("Initializing external LEDs...\n");
@@ -198,60 +1583,102 @@ int main(void) {
     printf("Waiting for controllers...\n");
     g_led_status = LED_BLINK_SLOW;
 
-    // Main loop
-    uint32_t last_poll = 0;
-
+#if PICO_N64_DUAL_CORE
+    // Main loop (core0: USB only)
     while (true) {
-        // Process USB tasks
-        tud_task();
+        // Process USB tasks, then move Transfer Pak dump data to its endpoint
+        run_usb_task();
+#if N64_TPAK
+        usb_tpak_stream_task();
+#endif
 
         // Update LED
         update_led();
-
-        // Poll controllers at fixed interval
-        uint32_t now = to_ms_since_boot(get_absolute_time());
-        if (now - last_poll < POLL_INTERVAL_MS) {
-            continue;
-        }
-        last_poll = now;
+        poll_console();
+#if N64_MSC
+        run_pak_cache();
+#endif
 
         // Check USB connection status
-        if (!tud_mounted()) {
+        if (tud_mounted()) {
+            flush_pending_reports();
+            consume_snapshots();
+        } else {
             g_led_status = LED_OFF;
+        }
+
+        // USB idle: save configuration changes, send trace records while
+        // the UART has room, then sleep until the next USB IRQ or snapshot from core1
+        if (!tud_task_event_ready()) {
+            save_config();
+            trace_drain();
+            __wfe();
+        }
+    }
+#else
+    // Main loop
+    while (true) {
+        // Process USB tasks, then retry reports refused by a busy endpoint
+        run_usb_task();
+        if (tud_mounted()) {
+            flush_pending_reports();
+        }
+#if N64_TPAK
+        usb_tpak_stream_task();
+#endif
+
+        // Update LED
+        update_led();
+        poll_console();
+#if N64_MSC
+        run_pak_cache();
+#endif
+
+        // Controller Pak, Transfer Pak and Rumble Pak blocks fill the gaps between poll cycles
+        bool pak_busy = run_pak_job();
+        pak_busy |= run_tpak();
+        pak_busy |= run_rumble();
+
+        // Collect finished transfers (sequential mode chains the next port)
+        // Responses are short and timeouts are polled: don't sleep meanwhile
+        if (n64_poller_busy(&g_poller)) {
+            collect_poll_results();
             continue;
         }
 
-        // Read and send reports only for connected controllers
-        for (int i = 0; i < MAX_CONTROLLERS; i++) {
-            bool responding = n64_read(&g_controllers[i], &g_states[i]);
-
-            // Detect connection state changes
-            if (responding && !g_was_connected[i]) {
-                g_connect_count[i]++;
-                if (g_connect_count[i] == 1) {
-                    printf("[P%d] Connected (GP%d)\n", i + 1, N64_DATA_PINS[i]);
-                } else {
-                    printf("[P%d] Reconnected (GP%d) - #%lu\n",
-                           i + 1, N64_DATA_PINS[i], g_connect_count[i]);
-                }
-            } else if (!responding && g_was_connected[i]) {
-                printf("[P%d] Disconnected (GP%d)\n", i + 1, N64_DATA_PINS[i]);
-                // Send one final neutral report so the host sees all buttons released
-                usb_gamepad_init_neutral(&g_reports[i]);
-                usb_gamepad_send_report(i, &g_reports[i]);
+        // Poll controllers when the deadline alarm has fired
+        apply_stats_reset();
+        if (poll_timer_take(&g_poll_timer)) {
+            schedule_next_poll();
+
+            if (!tud_mounted()) {
+                // Check USB connection status
+                g_led_status = LED_OFF;
+                continue;
             }
-            g_was_connected[i] = responding;
 
-            if (responding) {
-                n64_to_usb_report(&g_states[i], &g_reports[i]);
-                usb_gamepad_send_report(i, &g_reports[i]);
+            // Live ports every cycle, empty ports only when their probe is due
+            uint32_t now = to_ms_since_boot(get_absolute_time());
+            uint32_t due = pak_filter_due(n64_hotplug_due_mask(&g_hotplug, now));
+            if (due != 0) {
+                trace_poll_event(TRACE_EV_CYCLE_START, TRACE_PORT_NONE, 0, due);
+                cpu_load_begin(&g_core0_load);
+                n64_poller_start_cycle(&g_poller, due);
+                g_poll_cost.cycle_us += cpu_load_end(&g_core0_load);
             }
+            continue;
         }
 
-        // Update LED status based on connected controllers
-        update_led_status();
-        update_external_leds();
+        // Nothing to do: save configuration changes, send trace records
+        // while the UART has room, then sleep until the next IRQ (USB, poll
+        // alarm); pak block timeouts are polled, so stay awake during one
+        if (!tud_task_event_ready() && !pak_busy) {
+            save_config();
+            trace_drain();
+            __wfe();
+        }
     }
+#endif
 
     return 0;
 }
@@ -1,48 +1,118 @@
 /*
  * N64 Controller Implementation
  * Handles communication with N64 controller via PIO
+ *
+ * Transfers are asynchronous: the command is queued in the TX FIFO, a DMA
+ * channel drains the RX FIFO into the response buffer and the PIO program
+ * raises an IRQ on the controller's stop bit to mark the end of frame.
+ *
+ * FIFO traffic is word-packed: the response length, the command length and
+ * the first command byte go out as one TX word, further command bytes 4 per
+ * word (a status poll is a single word; the 35-byte pak write needs 10 and
+ * is fed by a TX DMA channel claimed on first use). Responses of up to 4
+ * bytes come back as one RX word (autopush at 8 * length bits) that is
+ * byte-swapped into the response buffer. Longer responses fall back to one
+ * byte per word.
+ * Blocking calls are built on top of it. The state machine is only reset
+ * after a protocol error or timeout.
+ *
+ * Device reads go through the driver picked when the port first answers
+ * INFO (see n64_device.h): the command and response length of the next read
+ * are kept in the handle, so a poll costs no table lookup.
+ *
+ * The program is loaded at most once per PIO block and shared by all of its
+ * state machines, so up to 8 ports fit on pio0 + pio1.
  */
 
 #include "n64_controller.h"
 #include "n64_controller.pio.h"
+#include "profiler.h"
 #include "pico/stdlib.h"
 #include "hardware/pio.h"
 #include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
 #include <string.h>
 
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+static n64_controller_t *s_sm_owner[NUM_PIOS][NUM_PIO_STATE_MACHINES];
+static bool s_pio_irq_installed[NUM_PIOS] = {false, false};
+
+// Program offset in each PIO block (-1 = not loaded yet)
+static int s_program_offset[NUM_PIOS] = {-1, -1};
+
+// Transfer duration statistics for INFO, STATUS, pak READ and pak WRITE
+static n64_xfer_stats_t s_xfer_stats[N64_CMD_WRITE + 1];
+
+static const uint8_t s_info_cmd[] = {N64_CMD_INFO};
+
 //--------------------------------------------------------------------
 // Private Function Declarations
 //--------------------------------------------------------------------
-static void send_request(PIO pio, uint sm, const uint8_t *request, uint8_t length);
-static bool get_response(PIO pio, uint sm, uint8_t *response, uint8_t length);
-static void reset_state_machine(n64_controller_t *controller);
+static bool begin_transfer(n64_controller_t *controller, const uint8_t *cmd, uint cmd_len,
+                           uint8_t *response, uint response_len, bool start);
+static uint encode_command(n64_controller_t *controller, const uint8_t *cmd, uint cmd_len,
+                           uint response_len);
+static void queue_command(n64_controller_t *controller, uint words);
+static void reset_state_machine(n64_controller_t *controller, bool enable);
+static void set_rx_threshold(n64_controller_t *controller, uint bits, bool enable);
+static void unpack_response(n64_controller_t *controller);
+static void set_device_step(n64_controller_t *controller, n64_device_step_t step);
+static bool accept_response(n64_controller_t *controller, n64_device_state_t *state);
+static void abort_transfer(n64_controller_t *controller);
+static void record_duration(uint8_t cmd, uint32_t duration_us);
+static void pio_irq_handler(void);
 
 //--------------------------------------------------------------------
 // Public Functions
 //--------------------------------------------------------------------
 
 bool n64_init(n64_controller_t *controller, uint pin) {
-    // Try to add program to PIO0 first, then PIO1
+    // Fill PIO0 first, then PIO1; the program is shared inside a block
     PIO pio_instances[] = {pio0, pio1};
     PIO selected_pio = NULL;
-    uint offset = 0;
+    uint pio_index = 0;
+    int sm = -1;
+
+    controller->pio = NULL;
+    controller->dma_chan = -1;
+    controller->tx_dma_chan = -1;
+    controller->xfer_state = N64_XFER_IDLE;
+    controller->xfer_held = false;
+
+    for (uint i = 0; i < NUM_PIOS; i++) {
+        if (s_program_offset[i] < 0 &&
+            !pio_can_add_program(pio_instances[i], &n64_controller_program)) {
+            continue;  // No room for the program in this block
+        }
 
-    for (int i = 0; i < 2; i++) {
-        if (pio_can_add_program(pio_instances[i], &n64_controller_program)) {
+        sm = pio_claim_unused_sm(pio_instances[i], false);
+        if (sm >= 0) {
             selected_pio = pio_instances[i];
+            pio_index = i;
             break;
         }
     }
 
     if (selected_pio == NULL) {
-        return false;  // No PIO available
+        return false;  // No PIO state machine available
     }
 
-    // Add program and claim state machine
-    offset = pio_add_program(selected_pio, &n64_controller_program);
-    int sm = pio_claim_unused_sm(selected_pio, false);
-    if (sm < 0) {
-        return false;  // No state machine available
+    // Load the program the first time this block is used
+    if (s_program_offset[pio_index] < 0) {
+        s_program_offset[pio_index] = (int)pio_add_program(selected_pio,
+                                                           &n64_controller_program);
+    }
+    uint offset = (uint)s_program_offset[pio_index];
+
+    // Claim a DMA channel to drain the RX FIFO
+    int dma_chan = dma_claim_unused_channel(false);
+    if (dma_chan < 0) {
+        pio_sm_unclaim(selected_pio, (uint)sm);
+        return false;  // No DMA channel available
     }
 
     // Store controller configuration
@@ -51,104 +121,295 @@ bool n64_init(n64_controller_t *controller, uint pin) {
     controller->offset = offset;
     controller->pin = pin;
     controller->connected = false;
+    controller->dma_chan = dma_chan;
+    controller->xfer_start_us = 0;
+    controller->xfer_done_us = 0;
+    controller->next_xfer_us = 0;
+    controller->rx_shift = 8;       // As configured by n64_controller_program_init()
+    controller->driver = NULL;
+    controller->info_status = 0;
+    set_device_step(controller, N64_DEVICE_STEP_IDENTIFY);
+
+    // Route the end-of-frame flag of this SM to the shared PIO IRQ handler
+    uint pio_irq = (pio_index == 0) ? PIO0_IRQ_0 : PIO1_IRQ_0;
+    s_sm_owner[pio_index][sm] = controller;
+    pio_interrupt_clear(selected_pio, (uint)sm);
+    pio_set_irq0_source_enabled(selected_pio,
+                                (pio_interrupt_source_t)(pis_interrupt0 + sm), true);
+    if (!s_pio_irq_installed[pio_index]) {
+        irq_add_shared_handler(pio_irq, pio_irq_handler,
+                               PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(pio_irq, true);
+        s_pio_irq_installed[pio_index] = true;
+    }
 
     // Initialize PIO state machine
     pio_sm_config c = n64_controller_program_get_default_config(offset);
     n64_controller_program_init(selected_pio, controller->sm, offset, pin, &c);
 
-    // Test connection by sending info command
-    uint8_t response[3];
-    if (n64_transfer(controller, N64_CMD_INFO, response, 3)) {
-        // Check if response indicates N64 controller (0x05 for standard controller)
-        controller->connected = (response[0] == 0x05);
-    }
+    // Test connection: identifies the device (connected only if it has a driver)
+    n64_device_state_t state;
+    n64_read(controller, &state);
 
     return true;
 }
 
-bool n64_read(n64_controller_t *controller, n64_state_t *state) {
-    uint8_t response[N64_STATUS_SIZE];
-
-    if (!n64_transfer(controller, N64_CMD_STATUS, response, N64_STATUS_SIZE)) {
-        controller->connected = false;
+bool n64_read(n64_controller_t *controller, n64_device_state_t *state) {
+    if (!n64_read_start(controller)) {
+        n64_read_poll(controller, state);
         return false;
     }
 
-    controller->connected = true;
+    n64_xfer_status_t status;
+    do {
+        status = n64_read_poll(controller, state);
+    } while (status == N64_XFER_BUSY);
 
-    // Parse response into state structure
-    state->buttons0 = response[0];
-    state->buttons1 = response[1];
-    state->stick_x = (int8_t)response[2];
-    state->stick_y = (int8_t)response[3];
+    return status == N64_XFER_DONE;
+}
 
-    return true;
+bool n64_read_start(n64_controller_t *controller) {
+    return begin_transfer(controller, controller->read_cmd, controller->read_cmd_len,
+                          controller->rx_buf, controller->read_len, true);
 }
 
-bool n64_transfer(n64_controller_t *controller, uint8_t cmd,
-                  uint8_t *response, uint response_len) {
-    PIO pio = controller->pio;
-    uint sm = controller->sm;
+bool n64_read_prepare(n64_controller_t *controller) {
+    return begin_transfer(controller, controller->read_cmd, controller->read_cmd_len,
+                          controller->rx_buf, controller->read_len, false);
+}
 
-    // Reset state machine to ensure clean state
-    reset_state_machine(controller);
+n64_xfer_status_t n64_read_poll(n64_controller_t *controller, n64_device_state_t *state) {
+    PROFILE_SCOPE(PROF_N64_READ_POLL);
+    n64_xfer_status_t status = n64_transfer_poll(controller);
 
-    // Send response length (minus 1, as expected by PIO program)
-    // The PIO program expects the count in the upper 8 bits
-    pio_sm_put_blocking(pio, sm, ((response_len - 1) & 0x1F) << 24);
+    if (status == N64_XFER_ERROR || status == N64_XFER_ABSENT) {
+        // Identify again on the next answer: another device may be plugged in
+        controller->connected = false;
+        controller->driver = NULL;
+        set_device_step(controller, N64_DEVICE_STEP_IDENTIFY);
+    } else if (status == N64_XFER_DONE && !accept_response(controller, state)) {
+        status = N64_XFER_ABSENT;
+    }
 
-    // Send command byte
-    uint8_t request[] = {cmd};
-    send_request(pio, sm, request, 1);
+    return status;
+}
 
-    // Get response
-    if (!get_response(pio, sm, response, response_len)) {
-        // Reset state machine on failure to recover from stuck state
-        reset_state_machine(controller);
-        return false;
+bool n64_command_async(n64_controller_t *controller, const uint8_t *cmd, uint cmd_len,
+                       uint8_t *response, uint response_len) {
+    return begin_transfer(controller, cmd, cmd_len, response, response_len, true);
+}
+
+void n64_transfer_release(n64_controller_t *controllers, uint count) {
+    PIO pio_instances[] = {pio0, pio1};
+    uint32_t sm_mask[2] = {0, 0};
+
+    for (uint i = 0; i < count; i++) {
+        if (!controllers[i].xfer_held) {
+            continue;
+        }
+        uint pio_index = (controllers[i].pio == pio0) ? 0 : 1;
+        sm_mask[pio_index] |= 1u << controllers[i].sm;
+    }
+
+    // Start every held state machine of a PIO block on the same cycle
+    for (int i = 0; i < 2; i++) {
+        if (sm_mask[i] != 0) {
+            pio_enable_sm_mask_in_sync(pio_instances[i], sm_mask[i]);
+        }
+    }
+
+    uint64_t now = time_us_64();
+    for (uint i = 0; i < count; i++) {
+        n64_controller_t *controller = &controllers[i];
+        if (!controller->xfer_held) {
+            continue;
+        }
+        controller->xfer_start_us = now;
+        controller->xfer_deadline_us = now + controller->xfer_timeout_us;
+        controller->xfer_held = false;
+    }
+}
+
+n64_xfer_status_t n64_transfer_poll(n64_controller_t *controller) {
+    PROFILE_SCOPE(PROF_N64_XFER_POLL);
+    n64_xfer_status_t status = controller->xfer_state;
+
+    if (status == N64_XFER_BUSY && time_us_64() > controller->xfer_deadline_us) {
+        // Re-check with IRQs masked: the frame may end right now
+        uint32_t irq_status = save_and_disable_interrupts();
+        if (controller->xfer_state == N64_XFER_BUSY) {
+            abort_transfer(controller);
+            controller->xfer_state = N64_XFER_ERROR;
+        }
+        restore_interrupts(irq_status);
+        status = controller->xfer_state;
+    }
+
+    if (status == N64_XFER_DONE) {
+        if (controller->xfer_packed) {
+            unpack_response(controller);
+        }
+
+        // Line is idle after the stop bit: only a short gap is needed
+        controller->next_xfer_us = controller->xfer_done_us + N64_FRAME_GAP_US;
+        record_duration(controller->xfer_cmd,
+                        (uint32_t)(controller->xfer_done_us - controller->xfer_start_us));
+        controller->xfer_state = N64_XFER_IDLE;
+    } else if (status == N64_XFER_ERROR || status == N64_XFER_ABSENT) {
+        controller->xfer_state = N64_XFER_IDLE;
     }
 
-    // Wait for communication to complete
-    // 4us per byte plus settling time
-    busy_wait_us(4 * (1 + response_len) + 450);
+    return status;
+}
 
+bool n64_get_xfer_stats(uint8_t cmd, n64_xfer_stats_t *stats) {
+    if (cmd > N64_CMD_WRITE) {
+        return false;
+    }
+    *stats = s_xfer_stats[cmd];
     return true;
 }
 
+void n64_reset_xfer_stats(void) {
+    memset(s_xfer_stats, 0, sizeof(s_xfer_stats));
+}
+
 //--------------------------------------------------------------------
 // Private Functions
 //--------------------------------------------------------------------
 
-static void send_request(PIO pio, uint sm, const uint8_t *request, uint8_t length) {
-    for (uint8_t i = 0; i < length; i++) {
-        // PIO expects data in upper 8 bits of 32-bit word
-        pio_sm_put_blocking(pio, sm, ((uint32_t)request[i]) << 24);
+static bool begin_transfer(n64_controller_t *controller, const uint8_t *cmd, uint cmd_len,
+                           uint8_t *response, uint response_len, bool start) {
+    PROFILE_SCOPE(PROF_N64_START);
+
+    if (controller->xfer_state == N64_XFER_BUSY) {
+        return false;  // Previous transfer still running
     }
-}
 
-static bool get_response(PIO pio, uint sm, uint8_t *response, uint8_t length) {
-    for (uint8_t i = 0; i < length; i++) {
-        // Wait for response with timeout
-        absolute_time_t timeout = make_timeout_time_us(600);
-        bool timed_out = false;
+    if (controller->pio == NULL || controller->dma_chan < 0 ||
+        cmd_len == 0 || cmd_len > N64_CMD_MAX_LEN ||
+        response_len == 0 || response_len > N64_RESPONSE_MAX_LEN) {
+        controller->xfer_state = N64_XFER_ERROR;
+        return false;
+    }
 
-        while (pio_sm_is_rx_fifo_empty(pio, sm) && !timed_out) {
-            timed_out = time_reached(timeout);
-        }
+    PIO pio = controller->pio;
+    uint sm = controller->sm;
+    uint chan = (uint)controller->dma_chan;
 
-        if (timed_out) {
-            return false;  // Controller not responding
+    // Encode while the previous frame gap runs out
+    uint words = encode_command(controller, cmd, cmd_len, response_len);
+
+    // Long commands need the TX DMA channel: claim it once
+    if (words > N64_TX_FIFO_WORDS && controller->tx_dma_chan < 0) {
+        controller->tx_dma_chan = dma_claim_unused_channel(false);
+        if (controller->tx_dma_chan < 0) {
+            controller->xfer_state = N64_XFER_ERROR;
+            return false;
         }
+    }
 
-        // Read response byte (lower 8 bits of 32-bit word)
-        uint32_t data = pio_sm_get(pio, sm);
-        response[i] = (uint8_t)(data & 0xFF);
+    // Respect the inter-frame gap after the previous transfer
+    uint64_t now = time_us_64();
+    if (now < controller->next_xfer_us) {
+        busy_wait_us_32((uint32_t)(controller->next_xfer_us - now));
     }
 
+    // A healthy state machine is stalled on its first PULL: no reset needed.
+    // Batched transfers hold it stopped until n64_transfer_release().
+    if (!start) {
+        pio_sm_set_enabled(pio, sm, false);
+    }
+    pio_interrupt_clear(pio, sm);
+
+    // Short responses: autopush the whole response as one word
+    bool packed = response_len <= N64_RX_WORD_MAX;
+    uint rx_bits = packed ? 8 * response_len : 8;
+    if (rx_bits != controller->rx_shift) {
+        set_rx_threshold(controller, rx_bits, start);
+    }
+
+    // Arm DMA: one word, or one byte per RX FIFO entry (data in the low byte)
+    dma_channel_config dc = dma_channel_get_default_config(chan);
+    channel_config_set_transfer_data_size(&dc, packed ? DMA_SIZE_32 : DMA_SIZE_8);
+    channel_config_set_read_increment(&dc, false);
+    channel_config_set_write_increment(&dc, !packed);
+    channel_config_set_dreq(&dc, pio_get_dreq(pio, sm, false));
+
+    controller->xfer_len = response_len;
+    controller->xfer_dma_count = packed ? 1 : response_len;
+    controller->xfer_packed = packed;
+    controller->xfer_response = response;
+    controller->xfer_cmd = cmd[0];
+    controller->xfer_held = !start;
+    controller->xfer_state = N64_XFER_BUSY;
+    if (packed) {
+        dma_channel_configure(chan, &dc, &controller->rx_word,
+                              (io_rw_32 *)&pio->rxf[sm], 1, true);
+    } else {
+        dma_channel_configure(chan, &dc, response, (io_rw_8 *)&pio->rxf[sm],
+                              response_len, true);
+    }
+
+    queue_command(controller, words);
+
+    // Held transfers get their start time and deadline when released
+    controller->xfer_timeout_us = N64_TIMEOUT_FIRST_US + N64_TIMEOUT_BYTE_US * response_len +
+                                  N64_TIMEOUT_CMD_BYTE_US * (cmd_len - 1);
+    controller->xfer_start_us = time_us_64();
+    controller->xfer_deadline_us = start ? controller->xfer_start_us + controller->xfer_timeout_us
+                                         : UINT64_MAX;
     return true;
 }
 
-static void reset_state_machine(n64_controller_t *controller) {
+static uint encode_command(n64_controller_t *controller, const uint8_t *cmd, uint cmd_len,
+                           uint response_len) {
+    uint32_t *words = controller->tx_words;
+
+    // Header word: response length - 1 (bits 31-24), command bits - 1
+    // (bits 23-8), first command byte (bits 7-0). Bits go out inverted:
+    // the PIO writes them straight to the pin direction (1 = drive low).
+    words[0] = ((uint32_t)(response_len - 1) << 24) | ((8 * cmd_len - 1) << 8) |
+               (uint8_t)~cmd[0];
+
+    // Remaining bytes MSB first, 4 per word; the PIO drops the unused tail
+    uint count = 1;
+    for (uint i = 1; i < cmd_len; i += 4) {
+        uint32_t word = 0;
+        for (uint j = 0; j < 4; j++) {
+            uint8_t byte = (i + j < cmd_len) ? (uint8_t)~cmd[i + j] : 0;
+            word = (word << 8) | byte;
+        }
+        words[count++] = word;
+    }
+    return count;
+}
+
+static void queue_command(n64_controller_t *controller, uint words) {
+    PIO pio = controller->pio;
+    uint sm = controller->sm;
+
+    // Fits in the TX FIFO (status poll, pak read): never blocks
+    if (words <= N64_TX_FIFO_WORDS) {
+        for (uint i = 0; i < words; i++) {
+            pio_sm_put(pio, sm, controller->tx_words[i]);
+        }
+        return;
+    }
+
+    // Pak write: DMA keeps the FIFO topped up while the bits go out
+    uint chan = (uint)controller->tx_dma_chan;
+    dma_channel_config dc = dma_channel_get_default_config(chan);
+    channel_config_set_transfer_data_size(&dc, DMA_SIZE_32);
+    channel_config_set_read_increment(&dc, true);
+    channel_config_set_write_increment(&dc, false);
+    channel_config_set_dreq(&dc, pio_get_dreq(pio, sm, true));
+    dma_channel_configure(chan, &dc, &pio->txf[sm], controller->tx_words, words, true);
+}
+
+static void reset_state_machine(n64_controller_t *controller, bool enable) {
+    PROFILE_SCOPE(PROF_N64_RESET_SM);
+
     PIO pio = controller->pio;
     uint sm = controller->sm;
     uint offset = controller->offset;
@@ -164,5 +425,158 @@ static void reset_state_machine(n64_controller_t *controller) {
     pio_sm_exec(pio, sm, pio_encode_jmp(offset));
 
     // Re-enable state machine
-    pio_sm_set_enabled(pio, sm, true);
+    if (enable) {
+        pio_sm_set_enabled(pio, sm, true);
+    }
+}
+
+static void set_rx_threshold(n64_controller_t *controller, uint bits, bool enable) {
+    PIO pio = controller->pio;
+    uint sm = controller->sm;
+
+    // PUSH_THRESH field: 0 encodes 32 bits
+    hw_write_masked(&pio->sm[sm].shiftctrl,
+                    (bits & 0x1Fu) << PIO_SM0_SHIFTCTRL_PUSH_THRESH_LSB,
+                    PIO_SM0_SHIFTCTRL_PUSH_THRESH_BITS);
+    controller->rx_shift = bits;
+
+    // Restart so the ISR shift counter starts from zero with the new threshold
+    reset_state_machine(controller, enable);
+}
+
+static void unpack_response(n64_controller_t *controller) {
+    PROFILE_SCOPE(PROF_N64_UNPACK);
+
+    // First byte received sits in the top bits of the (8 * len)-bit word:
+    // left-align it, then byte-swap so it lands at the lowest address
+    uint len = controller->xfer_len;
+    uint32_t word = __builtin_bswap32(controller->rx_word << (32 - 8 * len));
+    memcpy(controller->xfer_response, &word, len);
+}
+
+static void set_device_step(n64_controller_t *controller, n64_device_step_t step) {
+    const n64_device_driver_t *driver = controller->driver;
+
+    controller->device_step = step;
+    switch (step) {
+        case N64_DEVICE_STEP_IDENTIFY:
+            controller->read_cmd = s_info_cmd;
+            controller->read_cmd_len = sizeof(s_info_cmd);
+            controller->read_len = N64_INFO_SIZE;
+            break;
+
+        case N64_DEVICE_STEP_CALIBRATE:
+            controller->read_cmd = &driver->calib_cmd;
+            controller->read_cmd_len = 1;
+            controller->read_len = driver->calib_len;
+            break;
+
+        case N64_DEVICE_STEP_POLL:
+            controller->read_cmd = driver->poll_cmd;
+            controller->read_cmd_len = driver->poll_cmd_len;
+            controller->read_len = driver->poll_len;
+            break;
+    }
+}
+
+// Completed device read: parse a poll, or move on to the next step.
+// Returns false if the device is not one we have a driver for.
+static bool accept_response(n64_controller_t *controller, n64_device_state_t *state) {
+    PROFILE_SCOPE(PROF_N64_PARSE);
+
+    const n64_device_driver_t *driver = controller->driver;
+
+    switch (controller->device_step) {
+        case N64_DEVICE_STEP_POLL:
+            // Hot path: no lookup, straight to the driver's parser
+            if (!driver->parse(controller->rx_buf, &controller->calib, state)) {
+                set_device_step(controller, N64_DEVICE_STEP_CALIBRATE);
+            }
+            state->type = (uint8_t)driver->type;
+            controller->connected = true;
+            return true;
+
+        case N64_DEVICE_STEP_IDENTIFY:
+            driver = n64_device_identify(controller->rx_buf);
+            if (driver == NULL) {
+                controller->connected = false;
+                return false;
+            }
+            controller->driver = driver;
+            controller->info_status = controller->rx_buf[N64_INFO_SIZE - 1];
+            set_device_step(controller, driver->calib_len != 0 ? N64_DEVICE_STEP_CALIBRATE
+                                                               : N64_DEVICE_STEP_POLL);
+            break;
+
+        case N64_DEVICE_STEP_CALIBRATE:
+            driver->calibrate(controller->rx_buf, &controller->calib);
+            set_device_step(controller, N64_DEVICE_STEP_POLL);
+            break;
+    }
+
+    // Identification and calibration carry no input: report a neutral state
+    controller->connected = true;
+    memset(state, 0, sizeof(*state));
+    state->type = (uint8_t)driver->type;
+    return true;
+}
+
+static void abort_transfer(n64_controller_t *controller) {
+    dma_channel_abort((uint)controller->dma_chan);
+    if (controller->tx_dma_chan >= 0) {
+        dma_channel_abort((uint)controller->tx_dma_chan);
+    }
+
+    // Reset state machine on failure to recover from stuck state
+    controller->xfer_held = false;
+    reset_state_machine(controller, true);
+    pio_interrupt_clear(controller->pio, controller->sm);
+}
+
+static void record_duration(uint8_t cmd, uint32_t duration_us) {
+    if (cmd > N64_CMD_WRITE) {
+        return;  // Only the standard commands are tracked
+    }
+
+    n64_xfer_stats_t *stats = &s_xfer_stats[cmd];
+    if (stats->count == 0 || duration_us < stats->min_us) {
+        stats->min_us = duration_us;
+    }
+    if (duration_us > stats->max_us) {
+        stats->max_us = duration_us;
+    }
+    stats->sum_us += duration_us;
+    stats->count++;
+}
+
+static void pio_irq_handler(void) {
+    PIO pio_instances[] = {pio0, pio1};
+
+    for (uint p = 0; p < NUM_PIOS; p++) {
+        for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+            n64_controller_t *controller = s_sm_owner[p][sm];
+            if (controller == NULL || !pio_interrupt_get(pio_instances[p], sm)) {
+                continue;
+            }
+
+            pio_interrupt_clear(pio_instances[p], sm);
+            if (controller->xfer_state != N64_XFER_BUSY) {
+                continue;
+            }
+
+            controller->xfer_done_us = time_us_64();
+            uint chan = (uint)controller->dma_chan;
+            if (!dma_channel_is_busy(chan)) {
+                controller->xfer_state = N64_XFER_DONE;
+            } else if (dma_channel_hw_addr(chan)->transfer_count == controller->xfer_dma_count) {
+                // No start bit in the presence window: the SM is already idle
+                dma_channel_abort(chan);
+                controller->xfer_state = N64_XFER_ABSENT;
+            } else {
+                // Frame ended before all expected bytes arrived
+                abort_transfer(controller);
+                controller->xfer_state = N64_XFER_ERROR;
+            }
+        }
+    }
 }
@@ -0,0 +1,120 @@
+/*
+ * Joybus Device Drivers Implementation
+ * Driver table, matched in order against the INFO identifier
+ */
+
+#include "n64_device.h"
+#include <stddef.h>
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Parsers
+//--------------------------------------------------------------------
+
+// N64 controller and mouse: bytes are already in n64_state_t order
+static bool parse_n64(const uint8_t *response, const n64_device_calib_t *calib,
+                      n64_device_state_t *state) {
+    (void)calib;
+    memcpy(&state->n64, response, sizeof(state->n64));
+    return true;
+}
+
+static int8_t recenter(uint8_t value, uint8_t origin) {
+    int delta = (int)value - (int)origin;
+    if (delta > INT8_MAX) {
+        delta = INT8_MAX;
+    } else if (delta < INT8_MIN) {
+        delta = INT8_MIN;
+    }
+    return (int8_t)delta;
+}
+
+static uint8_t travel(uint8_t value, uint8_t origin) {
+    return (value > origin) ? (uint8_t)(value - origin) : 0;
+}
+
+// Origin response: buttons, then the 6 axes in poll order
+static void calibrate_gamecube(const uint8_t *response, n64_device_calib_t *calib) {
+    memcpy(calib->origin, &response[2], GC_AXES);
+}
+
+static bool parse_gamecube(const uint8_t *response, const n64_device_calib_t *calib,
+                           n64_device_state_t *state) {
+    gc_state_t *gc = &state->gc;
+    const uint8_t *origin = calib->origin;
+
+    gc->buttons0 = response[0] & GC_MASK_BUTTONS0;
+    gc->buttons1 = response[1] & (GC_MASK_L | GC_MASK_R | GC_MASK_Z | GC_MASK_DPAD);
+    gc->stick_x = recenter(response[2], origin[0]);
+    gc->stick_y = recenter(response[3], origin[1]);
+    gc->cstick_x = recenter(response[4], origin[2]);
+    gc->cstick_y = recenter(response[5], origin[3]);
+    gc->trigger_l = travel(response[6], origin[4]);
+    gc->trigger_r = travel(response[7], origin[5]);
+
+    return !(response[0] & GC_NEED_ORIGIN);
+}
+
+//--------------------------------------------------------------------
+// Driver Table
+//--------------------------------------------------------------------
+static const n64_device_driver_t s_drivers[] = {
+    {
+        .type = N64_DEVICE_CONTROLLER,
+        .id = N64_INFO_ID_CONTROLLER << 8,
+        .id_mask = 0xFF00,
+        .accessory = true,
+        .poll_cmd = {N64_CMD_STATUS},
+        .poll_cmd_len = 1,
+        .poll_len = N64_STATUS_SIZE,
+        .parse = parse_n64,
+    },
+    {
+        .type = N64_DEVICE_MOUSE,
+        .id = N64_INFO_ID_MOUSE << 8,
+        .id_mask = 0xFF00,
+        .accessory = false,
+        .poll_cmd = {N64_CMD_STATUS},
+        .poll_cmd_len = 1,
+        .poll_len = N64_STATUS_SIZE,
+        .parse = parse_n64,
+    },
+    {
+        .type = N64_DEVICE_GAMECUBE,
+        .id = GC_INFO_ID,
+        .id_mask = GC_INFO_ID_MASK,
+        .accessory = false,
+        .poll_cmd = {GC_CMD_POLL, GC_POLL_MODE, GC_POLL_RUMBLE_OFF},
+        .poll_cmd_len = GC_POLL_CMD_SIZE,
+        .poll_len = GC_POLL_SIZE,
+        .calib_cmd = GC_CMD_ORIGIN,
+        .calib_len = GC_ORIGIN_SIZE,
+        .calibrate = calibrate_gamecube,
+        .parse = parse_gamecube,
+    },
+};
+
+_Static_assert(GC_POLL_SIZE <= N64_DEVICE_STATE_SIZE && GC_ORIGIN_SIZE <= N64_DEVICE_RESPONSE_MAX,
+               "GameCube responses must fit the device buffers");
+
+//--------------------------------------------------------------------
+// Public Functions
+//--------------------------------------------------------------------
+
+const n64_device_driver_t *n64_device_identify(const uint8_t *info) {
+    uint16_t id = (uint16_t)((info[0] << 8) | info[1]);
+
+    for (size_t i = 0; i < sizeof(s_drivers) / sizeof(s_drivers[0]); i++) {
+        if ((id & s_drivers[i].id_mask) == s_drivers[i].id) {
+            return &s_drivers[i];
+        }
+    }
+    return NULL;
+}
+
+const char *n64_device_name(n64_device_type_t type) {
+    static const char *const names[N64_DEVICE_TYPES] = {
+        "none", "N64 controller", "N64 mouse", "GameCube controller"
+    };
+    return (type < N64_DEVICE_TYPES) ? names[type] : "unknown";
+}
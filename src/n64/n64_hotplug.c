@@ -0,0 +1,70 @@
+/*
+ * N64 Hot-Plug Scheduler Implementation
+ * Probe interval of an empty port: 8 -> 16 -> 32 -> ... -> 250 ms
+ */
+
+#include "n64_hotplug.h"
+
+//--------------------------------------------------------------------
+// Public Functions
+//--------------------------------------------------------------------
+
+void n64_hotplug_init(n64_hotplug_t *hotplug) {
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        n64_hotplug_port_t *port = &hotplug->ports[i];
+        port->connected = false;
+        port->connect_count = 0;
+        port->backoff_ms = 0;
+        port->next_probe_ms = 0;
+    }
+}
+
+uint32_t n64_hotplug_due_mask(const n64_hotplug_t *hotplug, uint32_t now_ms) {
+    uint32_t mask = 0;
+
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        const n64_hotplug_port_t *port = &hotplug->ports[i];
+        if (port->connected || (int32_t)(now_ms - port->next_probe_ms) >= 0) {
+            mask |= 1u << i;
+        }
+    }
+
+    return mask;
+}
+
+n64_hotplug_event_t n64_hotplug_update(n64_hotplug_t *hotplug, uint8_t port_index,
+                                       bool responding, uint32_t now_ms) {
+    n64_hotplug_port_t *port = &hotplug->ports[port_index];
+    n64_hotplug_event_t event = N64_HOTPLUG_NONE;
+
+    if (responding) {
+        if (!port->connected) {
+            port->connect_count++;
+            event = (port->connect_count == 1) ? N64_HOTPLUG_CONNECTED
+                                               : N64_HOTPLUG_RECONNECTED;
+        }
+        port->connected = true;
+        port->backoff_ms = 0;
+        return event;
+    }
+
+    if (port->connected) {
+        // Just unplugged: probe again soon in case of a glitch
+        event = N64_HOTPLUG_DISCONNECTED;
+        port->backoff_ms = N64_HOTPLUG_BACKOFF_MIN_MS;
+    } else {
+        // Still empty: first miss at the minimum, then double the interval
+        if (port->backoff_ms == 0) {
+            port->backoff_ms = N64_HOTPLUG_BACKOFF_MIN_MS;
+        } else {
+            port->backoff_ms *= 2;
+            if (port->backoff_ms > N64_HOTPLUG_BACKOFF_MAX_MS) {
+                port->backoff_ms = N64_HOTPLUG_BACKOFF_MAX_MS;
+            }
+        }
+    }
+
+    port->connected = false;
+    port->next_probe_ms = now_ms + port->backoff_ms;
+    return event;
+}
@@ -0,0 +1,329 @@
+/*
+ * N64 Controller Pak Implementation
+ *
+ * Address CRC: CRC-5 of address bits 15-5, one XOR term per set bit.
+ * Data CRC: CRC-8, polynomial 0x85, MSB first, over the 32 data bytes plus
+ * 8 zero bits (the controller's augmented form); the table below gives the
+ * same result one byte at a time. A controller with an empty accessory slot
+ * answers with the CRC inverted.
+ *
+ * Block job pipeline: the Joybus is half duplex, so one block is on the
+ * wire at a time; the command of the next block (address CRC, and the data
+ * CRC of a write) is built while the current one is being transferred, and
+ * the next block is started as soon as the previous one is collected, so
+ * consecutive blocks are only separated by the controller frame gap.
+ */
+
+#include "n64_pak.h"
+#include "trace.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+
+// Address CRC term of each address bit 5..15
+static const uint8_t s_address_crc_terms[11] = {
+    0x15, 0x1F, 0x0B, 0x16, 0x19, 0x07, 0x0E, 0x1C, 0x0D, 0x1A, 0x01
+};
+
+// CRC-8 (poly 0x85) of every byte value
+static const uint8_t s_data_crc_table[256] = {
+    0x00, 0x85, 0x8F, 0x0A, 0x9B, 0x1E, 0x14, 0x91,
+    0xB3, 0x36, 0x3C, 0xB9, 0x28, 0xAD, 0xA7, 0x22,
+    0xE3, 0x66, 0x6C, 0xE9, 0x78, 0xFD, 0xF7, 0x72,
+    0x50, 0xD5, 0xDF, 0x5A, 0xCB, 0x4E, 0x44, 0xC1,
+    0x43, 0xC6, 0xCC, 0x49, 0xD8, 0x5D, 0x57, 0xD2,
+    0xF0, 0x75, 0x7F, 0xFA, 0x6B, 0xEE, 0xE4, 0x61,
+    0xA0, 0x25, 0x2F, 0xAA, 0x3B, 0xBE, 0xB4, 0x31,
+    0x13, 0x96, 0x9C, 0x19, 0x88, 0x0D, 0x07, 0x82,
+    0x86, 0x03, 0x09, 0x8C, 0x1D, 0x98, 0x92, 0x17,
+    0x35, 0xB0, 0xBA, 0x3F, 0xAE, 0x2B, 0x21, 0xA4,
+    0x65, 0xE0, 0xEA, 0x6F, 0xFE, 0x7B, 0x71, 0xF4,
+    0xD6, 0x53, 0x59, 0xDC, 0x4D, 0xC8, 0xC2, 0x47,
+    0xC5, 0x40, 0x4A, 0xCF, 0x5E, 0xDB, 0xD1, 0x54,
+    0x76, 0xF3, 0xF9, 0x7C, 0xED, 0x68, 0x62, 0xE7,
+    0x26, 0xA3, 0xA9, 0x2C, 0xBD, 0x38, 0x32, 0xB7,
+    0x95, 0x10, 0x1A, 0x9F, 0x0E, 0x8B, 0x81, 0x04,
+    0x89, 0x0C, 0x06, 0x83, 0x12, 0x97, 0x9D, 0x18,
+    0x3A, 0xBF, 0xB5, 0x30, 0xA1, 0x24, 0x2E, 0xAB,
+    0x6A, 0xEF, 0xE5, 0x60, 0xF1, 0x74, 0x7E, 0xFB,
+    0xD9, 0x5C, 0x56, 0xD3, 0x42, 0xC7, 0xCD, 0x48,
+    0xCA, 0x4F, 0x45, 0xC0, 0x51, 0xD4, 0xDE, 0x5B,
+    0x79, 0xFC, 0xF6, 0x73, 0xE2, 0x67, 0x6D, 0xE8,
+    0x29, 0xAC, 0xA6, 0x23, 0xB2, 0x37, 0x3D, 0xB8,
+    0x9A, 0x1F, 0x15, 0x90, 0x01, 0x84, 0x8E, 0x0B,
+    0x0F, 0x8A, 0x80, 0x05, 0x94, 0x11, 0x1B, 0x9E,
+    0xBC, 0x39, 0x33, 0xB6, 0x27, 0xA2, 0xA8, 0x2D,
+    0xEC, 0x69, 0x63, 0xE6, 0x77, 0xF2, 0xF8, 0x7D,
+    0x5F, 0xDA, 0xD0, 0x55, 0xC4, 0x41, 0x4B, 0xCE,
+    0x4C, 0xC9, 0xC3, 0x46, 0xD7, 0x52, 0x58, 0xDD,
+    0xFF, 0x7A, 0x70, 0xF5, 0x64, 0xE1, 0xEB, 0x6E,
+    0xAF, 0x2A, 0x20, 0xA5, 0x34, 0xB1, 0xBB, 0x3E,
+    0x1C, 0x99, 0x93, 0x16, 0x87, 0x02, 0x08, 0x8D,
+};
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+
+// Encode the next block of the job into the spare ping-pong slot
+static void prepare_next_block(n64_pak_job_t *job) {
+    if (job->prepared || job->next_block >= job->end_block) {
+        return;
+    }
+    uint16_t address = (uint16_t)(job->next_block * N64_PAK_BLOCK_SIZE);
+    uint8_t *data = job->data + (job->next_block - job->first_block) * N64_PAK_BLOCK_SIZE;
+    n64_pak_block_encode(&job->blocks[job->wire ^ 1], job->op, address, data);
+    job->next_block++;
+    job->prepared = true;
+}
+
+static void finish_job(n64_pak_job_t *job, n64_pak_job_state_t state) {
+    job->end_us = time_us_64();
+
+    // Progress and result visible before the state (read by the other core)
+    __dmb();
+    job->state = state;
+}
+
+//--------------------------------------------------------------------
+// Public Functions - Protocol
+//--------------------------------------------------------------------
+
+uint16_t n64_pak_address_crc(uint16_t address) {
+    address &= (uint16_t)~0x1F;
+
+    uint8_t crc = 0;
+    for (uint bit = 5; bit < 16; bit++) {
+        if (address & (1u << bit)) {
+            crc ^= s_address_crc_terms[bit - 5];
+        }
+    }
+    return address | crc;
+}
+
+uint8_t n64_pak_data_crc(const uint8_t *data) {
+    uint8_t crc = 0;
+    for (uint i = 0; i < N64_PAK_BLOCK_SIZE; i++) {
+        crc = s_data_crc_table[crc ^ data[i]];
+    }
+    return crc;
+}
+
+void n64_pak_block_encode(n64_pak_block_t *block, n64_pak_op_t op,
+                          uint16_t address, uint8_t *data) {
+    uint16_t coded = n64_pak_address_crc(address);
+
+    block->op = op;
+    block->address = (uint16_t)(coded & ~0x1F);
+    block->data = data;
+    block->cmd[0] = (op == N64_PAK_OP_READ) ? N64_CMD_READ : N64_CMD_WRITE;
+    block->cmd[1] = (uint8_t)(coded >> 8);
+    block->cmd[2] = (uint8_t)coded;
+    if (op == N64_PAK_OP_WRITE) {
+        memcpy(&block->cmd[3], data, N64_PAK_BLOCK_SIZE);
+        block->crc = n64_pak_data_crc(data);
+    }
+}
+
+//--------------------------------------------------------------------
+// Public Functions - Block I/O
+//--------------------------------------------------------------------
+
+bool n64_pak_block_start(n64_controller_t *controller, n64_pak_block_t *block) {
+    if (controller->xfer_state != N64_XFER_IDLE) {
+        return false;  // Status poll (or its result) still pending
+    }
+
+    bool write = (block->op == N64_PAK_OP_WRITE);
+    if (!n64_command_async(controller, block->cmd,
+                           write ? N64_PAK_WRITE_CMD_LEN : N64_PAK_READ_CMD_LEN,
+                           block->response,
+                           write ? N64_PAK_WRITE_RESPONSE_LEN : N64_PAK_READ_RESPONSE_LEN)) {
+        n64_transfer_poll(controller);  // Consume the error state
+        return false;
+    }
+    return true;
+}
+
+n64_pak_result_t n64_pak_block_poll(n64_controller_t *controller, n64_pak_block_t *block) {
+    n64_xfer_status_t status = n64_transfer_poll(controller);
+    if (status == N64_XFER_BUSY) {
+        return N64_PAK_BUSY;
+    }
+    if (status != N64_XFER_DONE) {
+        return N64_PAK_NO_RESPONSE;
+    }
+
+    uint8_t expected;
+    uint8_t crc;
+    if (block->op == N64_PAK_OP_READ) {
+        expected = n64_pak_data_crc(block->response);
+        crc = block->response[N64_PAK_BLOCK_SIZE];
+    } else {
+        expected = block->crc;
+        crc = block->response[0];
+    }
+
+    if (crc == expected) {
+        if (block->op == N64_PAK_OP_READ) {
+            memcpy(block->data, block->response, N64_PAK_BLOCK_SIZE);
+        }
+        return N64_PAK_OK;
+    }
+    uint8_t inverted = (uint8_t)~expected;
+    return (crc == inverted) ? N64_PAK_NO_PAK : N64_PAK_CRC_ERROR;
+}
+
+n64_pak_result_t n64_pak_read(n64_controller_t *controller, uint16_t address, uint8_t *data) {
+    n64_pak_block_t block;
+    n64_pak_block_encode(&block, N64_PAK_OP_READ, address, data);
+    if (!n64_pak_block_start(controller, &block)) {
+        return N64_PAK_NO_RESPONSE;
+    }
+
+    n64_pak_result_t result;
+    do {
+        result = n64_pak_block_poll(controller, &block);
+    } while (result == N64_PAK_BUSY);
+    return result;
+}
+
+n64_pak_result_t n64_pak_write(n64_controller_t *controller, uint16_t address,
+                               const uint8_t *data) {
+    // The source is only read: copied into the command by the encoder
+    n64_pak_block_t block;
+    n64_pak_block_encode(&block, N64_PAK_OP_WRITE, address, (uint8_t *)data);
+    if (!n64_pak_block_start(controller, &block)) {
+        return N64_PAK_NO_RESPONSE;
+    }
+
+    n64_pak_result_t result;
+    do {
+        result = n64_pak_block_poll(controller, &block);
+    } while (result == N64_PAK_BUSY);
+    return result;
+}
+
+//--------------------------------------------------------------------
+// Public Functions - Block Job
+//--------------------------------------------------------------------
+
+void n64_pak_job_start(n64_pak_job_t *job, n64_pak_op_t op, uint port,
+                       uint8_t *data, uint first_block, uint count) {
+    if (first_block > N64_PAK_ADDRESS_BLOCKS) {
+        first_block = N64_PAK_ADDRESS_BLOCKS;
+    }
+    if (count > N64_PAK_ADDRESS_BLOCKS - first_block) {
+        count = N64_PAK_ADDRESS_BLOCKS - first_block;
+    }
+
+    job->op = op;
+    job->port = port;
+    job->data = data;
+    job->first_block = (uint16_t)first_block;
+    job->next_block = (uint16_t)first_block;
+    job->end_block = (uint16_t)(first_block + count);
+    job->count = (uint16_t)count;
+    job->done = 0;
+    job->attempts = 0;
+    job->retries = 0;
+    job->result = N64_PAK_OK;
+    job->start_us = 0;
+    job->end_us = 0;
+    job->wire_us = 0;
+    job->in_flight = false;
+    job->prepared = false;
+
+    if (count == 0) {
+        finish_job(job, N64_PAK_JOB_DONE);
+        return;
+    }
+
+    // First block encoded in the spare slot, then made the current one
+    job->wire = 1;
+    prepare_next_block(job);
+    job->wire = 0;
+    job->prepared = false;
+    job->start_pending = true;
+    job->state = N64_PAK_JOB_RUNNING;
+}
+
+bool n64_pak_job_task(n64_pak_job_t *job, n64_controller_t *controllers, uint64_t until_us) {
+    if (job->state != N64_PAK_JOB_RUNNING) {
+        return false;
+    }
+    n64_controller_t *controller = &controllers[job->port];
+
+    // Collect the block on the wire
+    if (job->in_flight) {
+        n64_pak_block_t *block = &job->blocks[job->wire];
+        n64_pak_result_t result = n64_pak_block_poll(controller, block);
+        if (result == N64_PAK_BUSY) {
+            return true;
+        }
+        job->in_flight = false;
+
+        if (result == N64_PAK_OK) {
+            job->wire_us += controller->xfer_done_us - controller->xfer_start_us;
+            job->attempts = 0;
+            job->done++;
+            if (job->done == job->count) {
+                finish_job(job, N64_PAK_JOB_DONE);
+                return false;
+            }
+
+            // Switch to the block encoded while this one was on the wire
+            prepare_next_block(job);
+            job->wire ^= 1;
+            job->prepared = false;
+        } else if (result == N64_PAK_NO_PAK || job->attempts >= N64_PAK_RETRIES) {
+            job->result = result;
+            finish_job(job, N64_PAK_JOB_FAILED);
+            return false;
+        } else {
+            // Same block again (its command is still encoded)
+            job->attempts++;
+            job->retries++;
+            trace_event(TRACE_EV_PAK_RETRY, (uint8_t)job->port, block->address, result);
+        }
+        job->start_pending = true;
+    }
+
+    // Start the current block if it ends before the caller's limit
+    uint64_t now = time_us_64();
+    if (job->start_pending && now + N64_PAK_BLOCK_US <= until_us) {
+        if (n64_pak_block_start(controller, &job->blocks[job->wire])) {
+            if (job->start_us == 0) {
+                job->start_us = now;
+            }
+            job->start_pending = false;
+            job->in_flight = true;
+        } else if (controller->xfer_state == N64_XFER_IDLE) {
+            // Port unusable (no TX DMA channel, PIO init failed)
+            job->result = N64_PAK_NO_RESPONSE;
+            finish_job(job, N64_PAK_JOB_FAILED);
+            return false;
+        }
+    }
+
+    // Pipeline: encode the next block while this one is on the wire
+    if (job->in_flight) {
+        prepare_next_block(job);
+    }
+    return job->in_flight;
+}
+
+uint32_t n64_pak_job_busy_mask(const n64_pak_job_t *job) {
+    return (job->state == N64_PAK_JOB_RUNNING && job->in_flight) ? 1u << job->port : 0;
+}
+
+const char *n64_pak_result_name(n64_pak_result_t result) {
+    static const char *const names[] = {
+        "ok", "busy", "data CRC error", "no pak", "no response"
+    };
+    return (result < count_of(names)) ? names[result] : "?";
+}
@@ -0,0 +1,410 @@
+/*
+ * N64 Controller Pak Block Cache Implementation
+ *
+ * Lines are replaced least recently used first, among the clean lines only:
+ * a dirty line stays until it has been written back. When every line is
+ * dirty, the write-back delay is skipped so a line frees up quickly.
+ */
+
+#include "n64_pak_cache.h"
+#include "pico/stdlib.h"
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+
+#define ALL_BLOCKS  ((uint16_t)((1u << N64_PAK_CACHE_LINE_BLOCKS) - 1))
+
+static n64_pak_cache_line_t *find_line(n64_pak_cache_t *cache, uint port, uint line) {
+    for (int i = 0; i < N64_PAK_CACHE_LINES; i++) {
+        n64_pak_cache_line_t *l = &cache->lines[i];
+        if (l->state != N64_PAK_LINE_FREE && l->port == port && l->line == line) {
+            return l;
+        }
+    }
+    return NULL;
+}
+
+static void touch_line(n64_pak_cache_t *cache, n64_pak_cache_line_t *l) {
+    l->last_use = ++cache->use_clock;
+}
+
+// Free line, else the least recently used clean one (NULL if all are dirty)
+static n64_pak_cache_line_t *alloc_line(n64_pak_cache_t *cache, uint port, uint line) {
+    n64_pak_cache_line_t *victim = NULL;
+    for (int i = 0; i < N64_PAK_CACHE_LINES; i++) {
+        n64_pak_cache_line_t *l = &cache->lines[i];
+        if (l->state == N64_PAK_LINE_FREE) {
+            victim = l;
+            break;
+        }
+        if (l->state == N64_PAK_LINE_VALID && l->dirty == 0 && l->writing == 0 &&
+            (victim == NULL || l->last_use < victim->last_use)) {
+            victim = l;
+        }
+    }
+    if (victim == NULL) {
+        cache->starved = true;
+        return NULL;
+    }
+
+    if (victim->state != N64_PAK_LINE_FREE) {
+        cache->stats.evictions++;
+    }
+    cache->starved = false;
+    victim->port = (uint8_t)port;
+    victim->line = (uint8_t)line;
+    victim->dirty = 0;
+    victim->writing = 0;
+    victim->fresh = false;
+    touch_line(cache, victim);
+    return victim;
+}
+
+// Only called while no transfer is in flight (lines are not locked)
+static void drop_lines(n64_pak_cache_t *cache, uint port) {
+    for (int i = 0; i < N64_PAK_CACHE_LINES; i++) {
+        n64_pak_cache_line_t *l = &cache->lines[i];
+        if (l->state != N64_PAK_LINE_FREE && l->port == port) {
+            cache->stats.lost += (uint32_t)__builtin_popcount(l->dirty);
+            l->state = N64_PAK_LINE_FREE;
+            l->dirty = 0;
+            l->writing = 0;
+        }
+    }
+}
+
+static void set_absent(n64_pak_cache_t *cache, uint port) {
+    n64_pak_cache_port_t *p = &cache->ports[port];
+    drop_lines(cache, port);
+    p->present = false;
+    p->verified = false;
+    p->flush = false;
+}
+
+// ID block read: same pak, new pak or first pak since the port was empty
+static void set_present(n64_pak_cache_t *cache, uint port, const uint8_t *id) {
+    n64_pak_cache_port_t *p = &cache->ports[port];
+    if (!p->present || memcmp(p->id, id, N64_PAK_BLOCK_SIZE) != 0) {
+        drop_lines(cache, port);
+        memcpy(p->id, id, N64_PAK_BLOCK_SIZE);
+        p->medium++;
+        p->flush = false;
+    }
+    p->present = true;
+    p->verified = true;
+}
+
+static bool port_has_dirty(const n64_pak_cache_t *cache, uint port) {
+    for (int i = 0; i < N64_PAK_CACHE_LINES; i++) {
+        const n64_pak_cache_line_t *l = &cache->lines[i];
+        if (l->state == N64_PAK_LINE_VALID && l->port == port && l->dirty != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool write_back_due(const n64_pak_cache_t *cache, uint port, uint64_t now) {
+    const n64_pak_cache_port_t *p = &cache->ports[port];
+    return p->flush || cache->starved ||
+           now - p->last_write_us >= (uint64_t)N64_PAK_CACHE_FLUSH_MS * 1000;
+}
+
+static void start_io(n64_pak_cache_t *cache, n64_pak_io_t *io) {
+    cache->io = *io;
+    cache->io_busy = true;
+}
+
+//--------------------------------------------------------------------
+// Public Functions - Sector Access
+//--------------------------------------------------------------------
+
+void n64_pak_cache_init(n64_pak_cache_t *cache) {
+    memset(cache, 0, sizeof(*cache));
+}
+
+n64_pak_cache_result_t n64_pak_cache_read(n64_pak_cache_t *cache, uint port, uint line,
+                                          uint8_t *buffer) {
+    if (port >= MAX_CONTROLLERS || line >= N64_PAK_CACHE_PAK_LINES ||
+        !cache->ports[port].present) {
+        return N64_PAK_CACHE_NO_MEDIUM;
+    }
+
+    n64_pak_cache_line_t *l = find_line(cache, port, line);
+    if (l != NULL) {
+        if (l->state != N64_PAK_LINE_VALID) {
+            return N64_PAK_CACHE_BUSY;
+        }
+        // The first read of a fresh line is the retry of its miss
+        if (!l->fresh) {
+            cache->stats.hits++;
+        }
+        l->fresh = false;
+        memcpy(buffer, l->data, N64_PAK_CACHE_LINE_SIZE);
+        touch_line(cache, l);
+        return N64_PAK_CACHE_OK;
+    }
+
+    l = alloc_line(cache, port, line);
+    if (l != NULL) {
+        cache->stats.misses++;
+        l->state = N64_PAK_LINE_FILL_PENDING;
+    }
+    return N64_PAK_CACHE_BUSY;
+}
+
+n64_pak_cache_result_t n64_pak_cache_write(n64_pak_cache_t *cache, uint port, uint line,
+                                           const uint8_t *buffer) {
+    if (port >= MAX_CONTROLLERS || line >= N64_PAK_CACHE_PAK_LINES ||
+        !cache->ports[port].present) {
+        return N64_PAK_CACHE_NO_MEDIUM;
+    }
+
+    n64_pak_cache_line_t *l = find_line(cache, port, line);
+    if (l != NULL && l->state == N64_PAK_LINE_VALID) {
+        // Locked while the polling core sends it
+        if (l->writing != 0) {
+            return N64_PAK_CACHE_BUSY;
+        }
+        cache->stats.hits++;
+
+        // Only the blocks that really change go back to the pak
+        for (uint b = 0; b < N64_PAK_CACHE_LINE_BLOCKS; b++) {
+            uint8_t *dst = &l->data[b * N64_PAK_BLOCK_SIZE];
+            const uint8_t *src = &buffer[b * N64_PAK_BLOCK_SIZE];
+            if (memcmp(dst, src, N64_PAK_BLOCK_SIZE) != 0) {
+                memcpy(dst, src, N64_PAK_BLOCK_SIZE);
+                l->dirty |= (uint16_t)(1u << b);
+            } else {
+                cache->stats.unchanged++;
+            }
+        }
+    } else if (l != NULL && l->state == N64_PAK_LINE_FILL_PENDING) {
+        // Whole sector overwritten: its read is no longer needed
+        memcpy(l->data, buffer, N64_PAK_CACHE_LINE_SIZE);
+        l->state = N64_PAK_LINE_VALID;
+        l->dirty = ALL_BLOCKS;
+    } else if (l != NULL) {
+        return N64_PAK_CACHE_BUSY;
+    } else {
+        l = alloc_line(cache, port, line);
+        if (l == NULL) {
+            return N64_PAK_CACHE_BUSY;
+        }
+        cache->stats.misses++;
+        memcpy(l->data, buffer, N64_PAK_CACHE_LINE_SIZE);
+        l->state = N64_PAK_LINE_VALID;
+        l->dirty = ALL_BLOCKS;
+    }
+
+    touch_line(cache, l);
+    if (l->dirty != 0) {
+        n64_pak_cache_port_t *p = &cache->ports[port];
+        p->last_write_us = time_us_64();
+        p->verified = false;
+    }
+    return N64_PAK_CACHE_OK;
+}
+
+bool n64_pak_cache_present(const n64_pak_cache_t *cache, uint port, uint16_t *medium) {
+    if (port >= MAX_CONTROLLERS) {
+        return false;
+    }
+    *medium = cache->ports[port].medium;
+    return cache->ports[port].present;
+}
+
+void n64_pak_cache_flush(n64_pak_cache_t *cache, uint port) {
+    if (port < MAX_CONTROLLERS && port_has_dirty(cache, port)) {
+        cache->ports[port].flush = true;
+    }
+}
+
+uint n64_pak_cache_dirty_blocks(const n64_pak_cache_t *cache, uint port) {
+    uint count = 0;
+    for (int i = 0; i < N64_PAK_CACHE_LINES; i++) {
+        const n64_pak_cache_line_t *l = &cache->lines[i];
+        if (l->state == N64_PAK_LINE_VALID && l->port == port) {
+            count += (uint)__builtin_popcount(l->dirty);
+        }
+    }
+    return count;
+}
+
+void n64_pak_cache_invalidate(n64_pak_cache_t *cache, uint port) {
+    if (port < MAX_CONTROLLERS) {
+        cache->ports[port].reset = true;
+    }
+}
+
+//--------------------------------------------------------------------
+// Public Functions - Block Transfers
+//--------------------------------------------------------------------
+
+bool n64_pak_cache_next_io(n64_pak_cache_t *cache, uint32_t connected, n64_pak_io_t *io) {
+    if (cache->io_busy) {
+        return false;
+    }
+    uint64_t now = time_us_64();
+
+    // Unplugged controllers and rewritten paks (no line is locked here)
+    for (uint port = 0; port < MAX_CONTROLLERS; port++) {
+        n64_pak_cache_port_t *p = &cache->ports[port];
+        if (p->reset) {
+            p->reset = false;
+            set_absent(cache, port);
+            p->checked_us = 0;
+        }
+        if (!(connected & (1u << port)) && p->present) {
+            set_absent(cache, port);
+        }
+    }
+
+    // Reads first: the host is waiting for them
+    for (int i = 0; i < N64_PAK_CACHE_LINES; i++) {
+        n64_pak_cache_line_t *l = &cache->lines[i];
+        if (l->state != N64_PAK_LINE_FILL_PENDING) {
+            continue;
+        }
+        if (!cache->ports[l->port].present) {
+            l->state = N64_PAK_LINE_FREE;
+            continue;
+        }
+        l->state = N64_PAK_LINE_FILLING;
+        *io = (n64_pak_io_t){
+            .kind = N64_PAK_IO_FILL,
+            .op = N64_PAK_OP_READ,
+            .port = l->port,
+            .first_block = (uint16_t)(l->line * N64_PAK_CACHE_LINE_BLOCKS),
+            .count = N64_PAK_CACHE_LINE_BLOCKS,
+            .data = l->data,
+            .line = (int8_t)i,
+        };
+        start_io(cache, io);
+        return true;
+    }
+
+    // Presence and identity: periodically, and before writing to a pak
+    for (uint port = 0; port < MAX_CONTROLLERS; port++) {
+        n64_pak_cache_port_t *p = &cache->ports[port];
+        if (!(connected & (1u << port))) {
+            continue;
+        }
+        bool due = p->checked_us == 0 ||
+                   now - p->checked_us >= (uint64_t)N64_PAK_CACHE_PROBE_MS * 1000;
+        if (!due && p->present && !p->verified) {
+            due = port_has_dirty(cache, port) && write_back_due(cache, port, now);
+        }
+        if (!due) {
+            continue;
+        }
+        *io = (n64_pak_io_t){
+            .kind = N64_PAK_IO_PROBE,
+            .op = N64_PAK_OP_READ,
+            .port = (uint8_t)port,
+            .first_block = N64_PAK_ID_ADDRESS / N64_PAK_BLOCK_SIZE,
+            .count = 1,
+            .data = cache->id_block,
+            .line = -1,
+        };
+        start_io(cache, io);
+        return true;
+    }
+
+    // Write-backs, one run of consecutive dirty blocks at a time
+    for (int i = 0; i < N64_PAK_CACHE_LINES; i++) {
+        n64_pak_cache_line_t *l = &cache->lines[i];
+        if (l->state != N64_PAK_LINE_VALID || l->dirty == 0) {
+            continue;
+        }
+        const n64_pak_cache_port_t *p = &cache->ports[l->port];
+        if (!p->present || !p->verified || !write_back_due(cache, l->port, now)) {
+            continue;
+        }
+
+        uint first = (uint)__builtin_ctz(l->dirty);
+        uint count = 0;
+        while (first + count < N64_PAK_CACHE_LINE_BLOCKS && (l->dirty & (1u << (first + count)))) {
+            count++;
+        }
+        l->writing = (uint16_t)(((1u << count) - 1) << first);
+        *io = (n64_pak_io_t){
+            .kind = N64_PAK_IO_WRITE_BACK,
+            .op = N64_PAK_OP_WRITE,
+            .port = l->port,
+            .first_block = (uint16_t)(l->line * N64_PAK_CACHE_LINE_BLOCKS + first),
+            .count = (uint16_t)count,
+            .data = &l->data[first * N64_PAK_BLOCK_SIZE],
+            .line = (int8_t)i,
+        };
+        start_io(cache, io);
+        return true;
+    }
+    return false;
+}
+
+void n64_pak_cache_io_done(n64_pak_cache_t *cache, n64_pak_result_t result) {
+    if (!cache->io_busy) {
+        return;
+    }
+    const n64_pak_io_t *io = &cache->io;
+    n64_pak_cache_port_t *p = &cache->ports[io->port];
+    n64_pak_cache_line_t *l = (io->line >= 0) ? &cache->lines[io->line] : NULL;
+    cache->io_busy = false;
+
+    switch (io->kind) {
+        case N64_PAK_IO_FILL:
+            if (result == N64_PAK_OK) {
+                l->state = N64_PAK_LINE_VALID;
+                l->fresh = true;
+                cache->stats.fills++;
+            } else {
+                l->state = N64_PAK_LINE_FREE;
+            }
+            break;
+
+        case N64_PAK_IO_WRITE_BACK: {
+            uint16_t mask = l->writing;
+            l->writing = 0;
+            if (result == N64_PAK_OK) {
+                l->dirty &= (uint16_t)~mask;
+                cache->stats.written += io->count;
+
+                // A rewritten ID block is the pak's new identity
+                uint id_block = N64_PAK_ID_ADDRESS / N64_PAK_BLOCK_SIZE;
+                if (io->first_block <= id_block && id_block < io->first_block + io->count) {
+                    uint offset = (id_block - l->line * N64_PAK_CACHE_LINE_BLOCKS) *
+                                  N64_PAK_BLOCK_SIZE;
+                    memcpy(p->id, &l->data[offset], N64_PAK_BLOCK_SIZE);
+                }
+                if (!port_has_dirty(cache, io->port)) {
+                    p->flush = false;
+                }
+            }
+            break;
+        }
+
+        case N64_PAK_IO_PROBE:
+            cache->stats.probes++;
+            p->checked_us = time_us_64();
+            if (result == N64_PAK_OK) {
+                set_present(cache, io->port, cache->id_block);
+            }
+            break;
+    }
+
+    // Pak gone or unreadable: its lines (and unwritten blocks) are dropped
+    if (result != N64_PAK_OK) {
+        if (result != N64_PAK_NO_PAK) {
+            cache->stats.errors++;
+        }
+        set_absent(cache, io->port);
+        p->checked_us = time_us_64();
+    }
+}
+
+void n64_pak_cache_get_stats(const n64_pak_cache_t *cache, n64_pak_cache_stats_t *stats) {
+    *stats = cache->stats;
+}
@@ -0,0 +1,110 @@
+/*
+ * N64 Poll Cycle Implementation
+ *
+ * Sequential mode: port N+1 starts when port N has finished, so the last
+ * port is sampled (N-1) frames after the first one.
+ * Batched mode: every command is preloaded in its TX FIFO and all state
+ * machines are released together, so a full cycle takes about one frame.
+ */
+
+#include "n64_poller.h"
+#include "pico/stdlib.h"
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+
+// Sequential mode: start the next selected port, if any
+static void start_next_port(n64_poller_t *poller) {
+    while (poller->next_port < MAX_CONTROLLERS) {
+        uint port = poller->next_port++;
+        if (poller->cycle_mask & (1u << port)) {
+            n64_read_start(&poller->controllers[port]);
+            poller->pending |= 1u << port;
+            return;
+        }
+    }
+}
+
+//--------------------------------------------------------------------
+// Public Functions
+//--------------------------------------------------------------------
+
+void n64_poller_init(n64_poller_t *poller, n64_controller_t *controllers,
+                     bool batched) {
+    poller->controllers = controllers;
+    poller->batched = batched;
+    poller->pending = 0;
+    poller->cycle_mask = 0;
+    poller->next_port = MAX_CONTROLLERS;
+    poller->cycle_start_us = 0;
+    n64_poller_reset_timing(poller);
+}
+
+void n64_poller_start_cycle(n64_poller_t *poller, uint32_t port_mask) {
+    poller->cycle_start_us = time_us_32();
+    poller->cycle_mask = port_mask;
+
+    if (poller->batched) {
+        // Preload every selected port, then release them together
+        for (uint i = 0; i < MAX_CONTROLLERS; i++) {
+            if (port_mask & (1u << i)) {
+                n64_read_prepare(&poller->controllers[i]);
+                poller->pending |= 1u << i;
+            }
+        }
+        n64_transfer_release(poller->controllers, MAX_CONTROLLERS);
+        poller->next_port = MAX_CONTROLLERS;
+    } else {
+        poller->next_port = 0;
+        start_next_port(poller);
+    }
+}
+
+bool n64_poller_busy(const n64_poller_t *poller) {
+    return poller->pending != 0;
+}
+
+int n64_poller_collect(n64_poller_t *poller, n64_device_state_t *state,
+                       bool *responding, uint32_t *sample_us) {
+    for (uint i = 0; i < MAX_CONTROLLERS; i++) {
+        if (!(poller->pending & (1u << i))) {
+            continue;
+        }
+
+        n64_controller_t *controller = &poller->controllers[i];
+        n64_xfer_status_t status = n64_read_poll(controller, state);
+        if (status == N64_XFER_BUSY) {
+            continue;
+        }
+
+        poller->pending &= ~(1u << i);
+        *responding = (status == N64_XFER_DONE);
+        *sample_us = *responding ? (uint32_t)controller->xfer_done_us : time_us_32();
+
+        if (*responding) {
+            n64_port_timing_t *timing = &poller->timing[i];
+            uint32_t offset = *sample_us - poller->cycle_start_us;
+            timing->samples++;
+            timing->offset_sum_us += offset;
+            if (offset > timing->offset_max_us) {
+                timing->offset_max_us = offset;
+            }
+        }
+
+        // Sequential mode: chain the next port
+        start_next_port(poller);
+
+        return (int)i;
+    }
+
+    return -1;
+}
+
+void n64_poller_reset_timing(n64_poller_t *poller) {
+    for (uint i = 0; i < MAX_CONTROLLERS; i++) {
+        poller->timing[i].samples = 0;
+        poller->timing[i].offset_sum_us = 0;
+        poller->timing[i].offset_max_us = 0;
+    }
+}
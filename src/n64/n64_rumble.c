@@ -0,0 +1,327 @@
+/*
+ * N64 Rumble Pak Implementation
+ *
+ * Mailbox: core0 stores the arrival time, then the packed command with a
+ * new sequence number in one 32-bit store. The polling core reads the
+ * command, the time, then the command again: a different value means core0
+ * posted meanwhile, and the newer command is picked up on the next call.
+ *
+ * Each port runs at most one block at a time (identification or motor),
+ * re-encoded from the port state on every attempt, so a retry always
+ * carries the latest wanted motor state.
+ */
+
+#include "n64_rumble.h"
+#include "trace.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Private Functions - Commands
+//--------------------------------------------------------------------
+
+#define COMMAND_STRENGTH(c)     ((uint8_t)(c))
+#define COMMAND_DURATION(c)     ((uint8_t)((c) >> 8))
+#define COMMAND_SEQUENCE(c)     ((uint16_t)((c) >> 16))
+
+static void forget_port(n64_rumble_port_t *p) {
+    p->state = N64_RUMBLE_UNKNOWN;
+    p->strength = 0;
+    p->motor = false;
+    p->timing = false;
+    p->attempts = 0;
+    p->stop_us = 0;
+}
+
+// Take the latest command from the mailbox, if there is a new one
+static void apply_command(n64_rumble_port_t *p, uint64_t now) {
+    uint32_t command = p->command;
+    __dmb();
+    uint32_t command_us = p->command_us;
+    __dmb();
+    if (p->command != command || COMMAND_SEQUENCE(command) == p->sequence) {
+        return;
+    }
+
+    uint16_t skipped = (uint16_t)(COMMAND_SEQUENCE(command) - p->sequence - 1);
+    p->stats.coalesced += skipped;
+    p->sequence = COMMAND_SEQUENCE(command);
+
+    p->strength = COMMAND_STRENGTH(command);
+    p->phase_us = now;
+    uint8_t duration = COMMAND_DURATION(command);
+    p->stop_us = (p->strength != 0 && duration != 0)
+               ? now + (uint64_t)duration * N64_RUMBLE_DURATION_UNIT_MS * 1000 : 0;
+
+    // Timed until the motor write that follows it
+    p->timing = true;
+    p->timing_start_us = command_us;
+}
+
+// Motor state the current command asks for at this time
+static bool motor_wanted(n64_rumble_port_t *p, uint64_t now) {
+    if (p->stop_us != 0 && now >= p->stop_us) {
+        p->strength = 0;
+        p->stop_us = 0;
+    }
+    if (p->strength == 0) {
+        return false;
+    }
+
+    // Duty cycle, phases no shorter than N64_RUMBLE_MIN_PHASE_MS
+    const uint32_t period_us = N64_RUMBLE_PWM_MS * 1000;
+    const uint32_t min_us = N64_RUMBLE_MIN_PHASE_MS * 1000;
+    uint32_t on_us = (uint32_t)p->strength * period_us / 255;
+    if (on_us < min_us) {
+        on_us = min_us;
+    }
+    if (on_us > period_us - min_us) {
+        return true;
+    }
+    return (now - p->phase_us) % period_us < on_us;
+}
+
+//--------------------------------------------------------------------
+// Private Functions - Blocks
+//--------------------------------------------------------------------
+
+// Encode the block the port needs next; false if there is nothing to send
+static bool prepare_block(n64_rumble_port_t *p, uint64_t now) {
+    bool wanted = motor_wanted(p, now);
+
+    switch (p->state) {
+        case N64_RUMBLE_ABSENT:
+            if (p->strength == 0 || now < p->retry_us) {
+                if (p->timing) {
+                    p->timing = false;
+                    p->stats.ignored++;
+                }
+                return false;
+            }
+            p->state = N64_RUMBLE_UNKNOWN;
+            // fall through
+        case N64_RUMBLE_UNKNOWN:
+            if (p->strength == 0) {
+                if (p->timing) {
+                    p->timing = false;
+                    p->stats.unchanged++;   // Never started: already off
+                }
+                return false;
+            }
+            p->state = N64_RUMBLE_PROBE_WRITE;
+            // fall through
+        case N64_RUMBLE_PROBE_WRITE:
+            memset(p->data, N64_RUMBLE_PROBE, sizeof(p->data));
+            n64_pak_block_encode(&p->block, N64_PAK_OP_WRITE, N64_RUMBLE_ID_ADDRESS, p->data);
+            return true;
+
+        case N64_RUMBLE_PROBE_READ:
+        case N64_RUMBLE_ID_READ:
+            n64_pak_block_encode(&p->block, N64_PAK_OP_READ, N64_RUMBLE_ID_ADDRESS, p->data);
+            return true;
+
+        case N64_RUMBLE_ID_WRITE:
+            memset(p->data, N64_RUMBLE_ID, sizeof(p->data));
+            n64_pak_block_encode(&p->block, N64_PAK_OP_WRITE, N64_RUMBLE_ID_ADDRESS, p->data);
+            return true;
+
+        case N64_RUMBLE_READY:
+            if (wanted == p->motor) {
+                p->attempts = 0;
+                if (p->timing) {
+                    p->timing = false;
+                    p->stats.unchanged++;
+                }
+                return false;
+            }
+            memset(p->data, wanted ? 0x01 : 0x00, sizeof(p->data));
+            n64_pak_block_encode(&p->block, N64_PAK_OP_WRITE, N64_RUMBLE_MOTOR_ADDRESS, p->data);
+            return true;
+    }
+    return false;
+}
+
+static void set_absent(n64_rumble_port_t *p, uint64_t now) {
+    p->state = N64_RUMBLE_ABSENT;
+    p->motor = false;
+    p->retry_us = now + N64_RUMBLE_RETRY_MS * 1000;
+}
+
+// Result of the block that was on the wire
+static void block_done(n64_rumble_port_t *p, uint port, n64_controller_t *controller,
+                       n64_pak_result_t result, uint64_t now) {
+    if (result != N64_PAK_OK) {
+        p->stats.errors++;
+        if (result != N64_PAK_NO_PAK && p->attempts < N64_PAK_RETRIES) {
+            p->attempts++;
+            trace_event(TRACE_EV_PAK_RETRY, (uint8_t)port, p->block.address, result);
+            return;     // Same step again
+        }
+        // Empty slot, or the pak stopped answering: identified again later
+        p->attempts = 0;
+        set_absent(p, now);
+        return;
+    }
+    p->attempts = 0;
+
+    switch (p->state) {
+        case N64_RUMBLE_PROBE_WRITE:
+            p->state = N64_RUMBLE_PROBE_READ;
+            break;
+
+        case N64_RUMBLE_PROBE_READ:
+            // Memory that keeps what was written is a Controller Pak
+            if (p->data[N64_PAK_BLOCK_SIZE - 1] == N64_RUMBLE_PROBE) {
+                set_absent(p, now);
+            } else {
+                p->state = N64_RUMBLE_ID_WRITE;
+            }
+            break;
+
+        case N64_RUMBLE_ID_WRITE:
+            p->state = N64_RUMBLE_ID_READ;
+            break;
+
+        case N64_RUMBLE_ID_READ:
+            if (p->data[N64_PAK_BLOCK_SIZE - 1] == N64_RUMBLE_ID) {
+                p->state = N64_RUMBLE_READY;
+                p->motor = false;       // Off after the init write
+            } else {
+                set_absent(p, now);
+            }
+            break;
+
+        case N64_RUMBLE_READY:
+            p->motor = (p->block.cmd[3] != 0);
+            p->stats.writes++;
+            if (p->timing) {
+                uint32_t latency_us = (uint32_t)controller->xfer_done_us - p->timing_start_us;
+                p->timing = false;
+                p->stats.latency_count++;
+                p->stats.latency_sum_us += latency_us;
+                if (latency_us < p->stats.latency_min_us) {
+                    p->stats.latency_min_us = latency_us;
+                }
+                if (latency_us > p->stats.latency_max_us) {
+                    p->stats.latency_max_us = latency_us;
+                }
+                trace_event(TRACE_EV_RUMBLE, (uint8_t)port, p->motor, latency_us);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+//--------------------------------------------------------------------
+// Public Functions - Host Commands
+//--------------------------------------------------------------------
+
+void n64_rumble_init(n64_rumble_t *rumble) {
+    memset(rumble, 0, sizeof(*rumble));
+    for (uint i = 0; i < MAX_CONTROLLERS; i++) {
+        forget_port(&rumble->ports[i]);
+        rumble->ports[i].stats.latency_min_us = UINT32_MAX;
+    }
+}
+
+void n64_rumble_command(n64_rumble_t *rumble, uint port, uint8_t strength, uint8_t duration) {
+    if (port >= MAX_CONTROLLERS) {
+        return;
+    }
+    n64_rumble_port_t *p = &rumble->ports[port];
+
+    uint16_t sequence = (uint16_t)(COMMAND_SEQUENCE(p->command) + 1);
+    p->stats.commands++;
+    p->command_us = time_us_32();
+
+    // Time visible before the command that refers to it
+    __dmb();
+    p->command = (uint32_t)strength | ((uint32_t)duration << 8) | ((uint32_t)sequence << 16);
+
+    // Wake the polling core if it sleeps until its next poll
+    __sev();
+}
+
+//--------------------------------------------------------------------
+// Public Functions - Motor Writes
+//--------------------------------------------------------------------
+
+bool n64_rumble_task(n64_rumble_t *rumble, n64_controller_t *controllers, uint32_t connected,
+                     uint64_t until_us, uint32_t period_us) {
+    bool busy = false;
+    uint64_t now = time_us_64();
+
+    for (uint i = 0; i < MAX_CONTROLLERS; i++) {
+        n64_rumble_port_t *p = &rumble->ports[i];
+        n64_controller_t *controller = &controllers[i];
+
+        // Collect the block on the wire
+        if (p->in_flight) {
+            n64_pak_result_t result = n64_pak_block_poll(controller, &p->block);
+            if (result == N64_PAK_BUSY) {
+                busy = true;
+                continue;
+            }
+            p->in_flight = false;
+            block_done(p, i, controller, result, now);
+        }
+
+        apply_command(p, now);
+        if (!(connected & (1u << i))) {
+            if (p->timing) {
+                p->stats.ignored++;
+            }
+            forget_port(p);
+            continue;
+        }
+
+        // Same slot rule as the pak job, per port
+        uint64_t limit_us = until_us;
+        if (limit_us != 0 && period_us < N64_PAK_BLOCK_US && !p->skipped) {
+            limit_us += period_us;
+        }
+        if (now + N64_PAK_BLOCK_US > limit_us || !prepare_block(p, now)) {
+            continue;
+        }
+        if (n64_pak_block_start(controller, &p->block)) {
+            p->in_flight = true;
+            busy = true;
+        }
+        // Otherwise the port is busy (pak job, poll result): next call
+    }
+    return busy;
+}
+
+uint32_t n64_rumble_filter_due(n64_rumble_t *rumble, uint32_t due) {
+    uint32_t busy = 0;
+    for (uint i = 0; i < MAX_CONTROLLERS; i++) {
+        n64_rumble_port_t *p = &rumble->ports[i];
+        uint32_t bit = 1u << i;
+        if (p->in_flight) {
+            p->skipped = (due & bit) != 0;
+            busy |= bit;
+        } else if (due & bit) {
+            p->skipped = false;
+        }
+    }
+    return due & ~busy;
+}
+
+n64_rumble_state_t n64_rumble_state(const n64_rumble_t *rumble, uint port) {
+    return rumble->ports[port].state;
+}
+
+void n64_rumble_get_stats(const n64_rumble_t *rumble, uint port, n64_rumble_stats_t *stats) {
+    *stats = rumble->ports[port].stats;
+}
+
+const char *n64_rumble_state_name(n64_rumble_state_t state) {
+    static const char *const names[] = {
+        "not identified", "identifying", "identifying", "identifying", "identifying",
+        "no Rumble Pak", "Rumble Pak"
+    };
+    return (state < count_of(names)) ? names[state] : "?";
+}
@@ -0,0 +1,479 @@
+/*
+ * N64 Transfer Pak Implementation
+ *
+ * The dump is a list of steps, each made of Transfer Pak / cartridge
+ * register writes followed by one read (a register, the header, or a bank
+ * of data). Every transfer is an n64_pak_job_t, so blocks get the same
+ * CRC checks, retries and between-cycles scheduling as the Controller Pak
+ * job; a data read is split into chunk-sized jobs, each started as soon as
+ * the previous one is collected if the other chunk buffer is free.
+ */
+
+#include "n64_tpak.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+enum {
+    PHASE_INFO,                 // INFO: controller and accessory slot
+    PHASE_POWER,                // Power on, read the power register back
+    PHASE_ACCESS,               // Cartridge access on, read the status
+    PHASE_HEADER,               // Bank 0, read 0x0100 - 0x015F
+    PHASE_DATA,                 // One ROM or SRAM bank per step
+    PHASE_POWER_OFF             // Back to the power-on state, then finish
+};
+
+// SRAM size by header code (MBC2 has 512 x 4 bits built in, code 0)
+static const uint32_t s_ram_sizes[] = {0, 0x800, 0x2000, 0x8000, 0x20000, 0x10000};
+
+//--------------------------------------------------------------------
+// Private Functions - Cartridge
+//--------------------------------------------------------------------
+
+static bool cart_mbc(uint8_t type, gb_mbc_t *mbc) {
+    if (type == 0x00 || type == 0x08 || type == 0x09) {
+        *mbc = GB_MBC_NONE;
+    } else if (type >= 0x01 && type <= 0x03) {
+        *mbc = GB_MBC1;
+    } else if (type == 0x05 || type == 0x06) {
+        *mbc = GB_MBC2;
+    } else if (type >= 0x0F && type <= 0x13) {
+        *mbc = GB_MBC3;
+    } else if (type >= 0x19 && type <= 0x1E) {
+        *mbc = GB_MBC5;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Header fields from the three header blocks; false if not supported
+static bool parse_header(n64_tpak_cart_t *cart) {
+    const uint8_t *h = cart->header - GB_HEADER_ADDRESS;   // Indexed by Game Boy address
+
+    memcpy(cart->title, &h[GB_TITLE], GB_TITLE_SIZE);
+    cart->title[GB_TITLE_SIZE] = '\0';
+    for (uint i = 0; i < GB_TITLE_SIZE; i++) {
+        if (cart->title[i] != '\0' && (cart->title[i] < 0x20 || cart->title[i] > 0x7E)) {
+            cart->title[i] = '?';
+        }
+    }
+
+    uint8_t sum = 0;
+    for (uint a = GB_TITLE; a < GB_HEADER_CHECKSUM; a++) {
+        sum = (uint8_t)(sum - h[a] - 1);
+    }
+    cart->checksum_ok = (sum == h[GB_HEADER_CHECKSUM]);
+
+    cart->type = h[GB_CART_TYPE];
+    uint8_t rom_code = h[GB_ROM_SIZE];
+    uint8_t ram_code = h[GB_RAM_SIZE];
+    if (!cart_mbc(cart->type, &cart->mbc) || rom_code > 8 || ram_code >= count_of(s_ram_sizes)) {
+        return false;
+    }
+    cart->rom_size = 0x8000u << rom_code;
+    cart->ram_size = (cart->mbc == GB_MBC2) ? 0x200 : s_ram_sizes[ram_code];
+    return true;
+}
+
+//--------------------------------------------------------------------
+// Private Functions - Steps
+//--------------------------------------------------------------------
+
+static void add_write(n64_tpak_t *tpak, uint16_t address, uint8_t value) {
+    n64_tpak_write_t *w = &tpak->writes[tpak->write_count++];
+    w->address = address;
+    w->value = value;
+}
+
+// Game Boy address in the Transfer Pak window (bank selected by the caller)
+static uint16_t window(uint16_t gb_address) {
+    return (uint16_t)(N64_TPAK_WINDOW_ADDRESS + gb_address % N64_TPAK_WINDOW_SIZE);
+}
+
+static void set_step(n64_tpak_t *tpak, uint8_t phase, uint16_t read_address, uint read_blocks,
+                     bool chunks) {
+    tpak->phase = phase;
+    tpak->write_count = 0;
+    tpak->write_next = 0;
+    tpak->read_address = read_address;
+    tpak->read_blocks = (uint16_t)read_blocks;
+    tpak->read_chunks = chunks;
+}
+
+static void finish(n64_tpak_t *tpak) {
+    tpak->end_us = time_us_64();
+
+    // Results visible before the state (read by core0)
+    __dmb();
+    tpak->state = (tpak->error == N64_TPAK_OK) ? N64_TPAK_DONE : N64_TPAK_FAILED;
+}
+
+// Cartridge access and power off; the dump ends once they are written
+static void power_off(n64_tpak_t *tpak) {
+    set_step(tpak, PHASE_POWER_OFF, 0, 0, false);
+    add_write(tpak, N64_TPAK_BANK_ADDRESS, 0);
+    add_write(tpak, window(0x0000), 0x00);          // SRAM disable
+    add_write(tpak, N64_TPAK_STATUS_ADDRESS, 0x00);
+    add_write(tpak, N64_TPAK_POWER_ADDRESS, N64_TPAK_POWER_OFF);
+}
+
+static void fail(n64_tpak_t *tpak, n64_tpak_error_t error) {
+    if (tpak->error == N64_TPAK_OK) {
+        tpak->error = error;
+    }
+    if (tpak->phase == PHASE_INFO) {
+        finish(tpak);           // Nothing powered yet
+    } else if (tpak->phase != PHASE_POWER_OFF) {
+        power_off(tpak);
+    }
+}
+
+// Writes and read of one ROM bank (16 KiB, read through window bank 1)
+static void rom_bank_step(n64_tpak_t *tpak, uint bank) {
+    gb_mbc_t mbc = tpak->cart.mbc;
+    set_step(tpak, PHASE_DATA, N64_TPAK_WINDOW_ADDRESS, GB_ROM_BANK_SIZE / N64_PAK_BLOCK_SIZE, true);
+    tpak->bank = (uint16_t)bank;
+
+    if (bank == 0 || mbc == GB_MBC_NONE) {
+        add_write(tpak, N64_TPAK_BANK_ADDRESS, (uint8_t)bank);
+        return;
+    }
+
+    // MBC1 maps banks 0x20/0x40/0x60 at 0x4000 as the next bank: in banking
+    // mode 1 the upper bits select them at 0x0000 instead (window bank 0)
+    if (mbc == GB_MBC1 && (bank & 0x1F) == 0) {
+        add_write(tpak, N64_TPAK_BANK_ADDRESS, 1);
+        add_write(tpak, window(0x4000), (uint8_t)((bank >> 5) & 0x03));
+        add_write(tpak, window(0x6000), 0x01);
+        add_write(tpak, N64_TPAK_BANK_ADDRESS, 0);
+        return;
+    }
+
+    // Bank number registers: 0x2100 suits MBC1/3/5 and MBC2 (address bit 8)
+    static const uint8_t low_masks[] = {0x00, 0x1F, 0x0F, 0x7F, 0xFF};
+    add_write(tpak, N64_TPAK_BANK_ADDRESS, 0);
+    add_write(tpak, window(0x2100), (uint8_t)(bank & low_masks[mbc]));
+    if (mbc == GB_MBC5) {
+        add_write(tpak, window(0x3000), (uint8_t)((bank >> 8) & 0x01));
+    }
+    add_write(tpak, N64_TPAK_BANK_ADDRESS, 1);
+    if (mbc == GB_MBC1) {
+        add_write(tpak, window(0x4000), (uint8_t)((bank >> 5) & 0x03));
+        add_write(tpak, window(0x6000), 0x00);      // Bank 0 back at 0x0000
+    }
+}
+
+// Writes and read of one SRAM bank (8 KiB at 0xA000, window bank 2)
+static void ram_bank_step(n64_tpak_t *tpak, uint bank) {
+    uint32_t size = tpak->cart.ram_size;
+    uint32_t bank_size = (size < GB_RAM_BANK_SIZE) ? size : GB_RAM_BANK_SIZE;
+    set_step(tpak, PHASE_DATA, window(GB_RAM_ADDRESS), bank_size / N64_PAK_BLOCK_SIZE, true);
+    tpak->bank = (uint16_t)bank;
+
+    add_write(tpak, N64_TPAK_BANK_ADDRESS, 0);
+    add_write(tpak, window(0x0000), 0x0A);              // SRAM enable
+    add_write(tpak, N64_TPAK_BANK_ADDRESS, 1);
+    if (tpak->cart.mbc == GB_MBC1 && size > GB_RAM_BANK_SIZE) {
+        add_write(tpak, window(0x6000), 0x01);          // Banking mode: SRAM banks
+    }
+    add_write(tpak, window(0x4000), (uint8_t)bank);
+    add_write(tpak, N64_TPAK_BANK_ADDRESS, 2);
+}
+
+static void data_step(n64_tpak_t *tpak, uint bank) {
+    if (tpak->target == N64_TPAK_ROM) {
+        rom_bank_step(tpak, bank);
+    } else {
+        ram_bank_step(tpak, bank);
+    }
+}
+
+// Check the step just completed and set up the next one; false once finished
+static bool next_step(n64_tpak_t *tpak) {
+    switch (tpak->phase) {
+        case PHASE_POWER:
+            if (tpak->block[N64_PAK_BLOCK_SIZE - 1] != N64_TPAK_POWER_ON) {
+                fail(tpak, N64_TPAK_NOT_TPAK);
+                break;
+            }
+            set_step(tpak, PHASE_ACCESS, N64_TPAK_STATUS_ADDRESS, 1, false);
+            add_write(tpak, N64_TPAK_STATUS_ADDRESS, N64_TPAK_ACCESS_ON);
+            break;
+
+        case PHASE_ACCESS:
+            if (tpak->block[0] & N64_TPAK_STATUS_REMOVED) {
+                fail(tpak, N64_TPAK_NO_CARTRIDGE);
+                break;
+            }
+            set_step(tpak, PHASE_HEADER, window(GB_HEADER_ADDRESS),
+                     GB_HEADER_SIZE / N64_PAK_BLOCK_SIZE, false);
+            add_write(tpak, N64_TPAK_BANK_ADDRESS, 0);
+            break;
+
+        case PHASE_HEADER:
+            if (!parse_header(&tpak->cart)) {
+                fail(tpak, N64_TPAK_UNSUPPORTED);
+                break;
+            }
+            if (tpak->target == N64_TPAK_ROM) {
+                tpak->total = tpak->cart.rom_size;
+            } else if (tpak->target == N64_TPAK_SRAM) {
+                tpak->total = tpak->cart.ram_size;
+            }
+            __dmb();
+            tpak->cart_ready = true;
+
+            if (tpak->target == N64_TPAK_HEADER) {
+                power_off(tpak);
+            } else if (tpak->total == 0) {
+                fail(tpak, N64_TPAK_NO_SRAM);
+            } else {
+                data_step(tpak, 0);
+            }
+            break;
+
+        case PHASE_DATA: {
+            uint32_t bank_size = (tpak->target == N64_TPAK_ROM) ? GB_ROM_BANK_SIZE : GB_RAM_BANK_SIZE;
+            uint next = tpak->bank + 1u;
+            if (next * bank_size < tpak->total) {
+                data_step(tpak, next);
+            } else {
+                power_off(tpak);
+            }
+            break;
+        }
+
+        case PHASE_POWER_OFF:
+        default:
+            finish(tpak);
+            return false;
+    }
+    return tpak->state == N64_TPAK_RUNNING;
+}
+
+//--------------------------------------------------------------------
+// Private Functions - Transfers
+//--------------------------------------------------------------------
+
+static void job_finished(n64_tpak_t *tpak) {
+    tpak->job_active = false;
+    tpak->retries += tpak->job.retries;
+
+    if (tpak->job.state == N64_PAK_JOB_FAILED) {
+        // Power-off writes are best effort: the next one still goes
+        if (tpak->phase != PHASE_POWER_OFF) {
+            fail(tpak, tpak->job.result == N64_PAK_NO_PAK ? N64_TPAK_NO_ACCESSORY
+                                                          : N64_TPAK_IO_ERROR);
+        }
+        return;
+    }
+
+    if (tpak->job_chunk) {
+        tpak->wire_us += tpak->job.wire_us;
+        tpak->produced += tpak->chunk_len[tpak->fill];
+
+        // Chunk complete before core0 can see it
+        __dmb();
+        tpak->full[tpak->fill] = true;
+        tpak->fill ^= 1;
+        __sev();                // Core0 may sleep until there is data to send
+    }
+}
+
+static void start_job(n64_tpak_t *tpak, n64_pak_op_t op, uint16_t address, uint8_t *data,
+                      uint count, bool chunk) {
+    n64_pak_job_start(&tpak->job, op, tpak->port, data, address / N64_PAK_BLOCK_SIZE, count);
+    tpak->job_active = true;
+    tpak->job_chunk = chunk;
+}
+
+// Set up the next transfer of the step (false: nothing can start now)
+static bool start_next(n64_tpak_t *tpak, n64_controller_t *controller, uint64_t until_us) {
+    while (tpak->state == N64_TPAK_RUNNING) {
+        if (tpak->phase == PHASE_INFO) {
+            static const uint8_t cmd = N64_CMD_INFO;
+            if (time_us_64() + N64_PAK_BLOCK_US > until_us) {
+                return false;
+            }
+            if (n64_command_async(controller, &cmd, 1, tpak->info, N64_INFO_SIZE)) {
+                tpak->info_in_flight = true;
+                return true;
+            }
+            if (controller->xfer_state == N64_XFER_IDLE) {
+                fail(tpak, N64_TPAK_NO_CONTROLLER);     // Port unusable
+            }
+            return false;
+        }
+
+        if (tpak->write_next < tpak->write_count) {
+            const n64_tpak_write_t *w = &tpak->writes[tpak->write_next++];
+            memset(tpak->block, w->value, sizeof(tpak->block));
+            start_job(tpak, N64_PAK_OP_WRITE, w->address, tpak->block, 1, false);
+            return true;
+        }
+
+        if (tpak->read_blocks > 0) {
+            uint count = tpak->read_blocks;
+            uint8_t *data = (tpak->phase == PHASE_HEADER) ? tpak->cart.header : tpak->block;
+            if (tpak->read_chunks) {
+                // Both buffers still waiting for USB: no read until one is sent
+                if (tpak->full[tpak->fill]) {
+                    if (!tpak->stalled) {
+                        tpak->stalled = true;
+                        tpak->stalls++;
+                    }
+                    return false;
+                }
+                tpak->stalled = false;
+                if (count > N64_TPAK_CHUNK_BLOCKS) {
+                    count = N64_TPAK_CHUNK_BLOCKS;
+                }
+                data = tpak->chunks[tpak->fill];
+                tpak->chunk_len[tpak->fill] = (uint16_t)(count * N64_PAK_BLOCK_SIZE);
+                if (tpak->start_us == 0) {
+                    tpak->start_us = time_us_64();
+                }
+            }
+            start_job(tpak, N64_PAK_OP_READ, tpak->read_address, data, count, tpak->read_chunks);
+            tpak->read_address += (uint16_t)(count * N64_PAK_BLOCK_SIZE);
+            tpak->read_blocks -= (uint16_t)count;
+            return true;
+        }
+
+        if (!next_step(tpak)) {
+            return false;
+        }
+    }
+    return false;
+}
+
+//--------------------------------------------------------------------
+// Public Functions - Control
+//--------------------------------------------------------------------
+
+void n64_tpak_start(n64_tpak_t *tpak, uint port, n64_tpak_target_t target) {
+    memset(&tpak->cart, 0, sizeof(tpak->cart));
+    tpak->abort = false;
+    tpak->cart_ready = false;
+    tpak->target = target;
+    tpak->error = N64_TPAK_OK;
+    tpak->port = port;
+    tpak->total = 0;
+    set_step(tpak, PHASE_INFO, 0, 0, false);
+    tpak->job_active = false;
+    tpak->info_in_flight = false;
+    tpak->full[0] = false;
+    tpak->full[1] = false;
+    tpak->fill = 0;
+    tpak->drain = 0;
+    tpak->stalled = false;
+    tpak->produced = 0;
+    tpak->stalls = 0;
+    tpak->retries = 0;
+    tpak->start_us = 0;
+    tpak->end_us = 0;
+    tpak->wire_us = 0;
+
+    // Set up before the polling core sees it running
+    __dmb();
+    tpak->state = N64_TPAK_RUNNING;
+    __sev();
+}
+
+void n64_tpak_abort(n64_tpak_t *tpak) {
+    tpak->abort = true;
+    __sev();
+}
+
+const uint8_t *n64_tpak_chunk(n64_tpak_t *tpak, uint *len) {
+    if (!tpak->full[tpak->drain]) {
+        return NULL;
+    }
+    __dmb();
+    *len = tpak->chunk_len[tpak->drain];
+    return tpak->chunks[tpak->drain];
+}
+
+void n64_tpak_chunk_done(n64_tpak_t *tpak) {
+    // Chunk read out before the polling core may refill it
+    __dmb();
+    tpak->full[tpak->drain] = false;
+    tpak->drain ^= 1;
+    __sev();
+}
+
+const char *n64_tpak_error_name(n64_tpak_error_t error) {
+    static const char *const names[] = {
+        "ok", "no controller", "accessory slot empty", "not a Transfer Pak", "no cartridge",
+        "unsupported cartridge", "no SRAM", "block I/O error", "aborted"
+    };
+    return (error < count_of(names)) ? names[error] : "?";
+}
+
+//--------------------------------------------------------------------
+// Public Functions - Transfers
+//--------------------------------------------------------------------
+
+bool n64_tpak_task(n64_tpak_t *tpak, n64_controller_t *controllers, uint64_t until_us) {
+    if (tpak->state != N64_TPAK_RUNNING) {
+        return false;
+    }
+    n64_controller_t *controller = &controllers[tpak->port];
+
+    // INFO: controller present, then the accessory slot status bit
+    if (tpak->info_in_flight) {
+        n64_xfer_status_t status = n64_transfer_poll(controller);
+        if (status == N64_XFER_BUSY) {
+            return true;
+        }
+        tpak->info_in_flight = false;
+        if (status != N64_XFER_DONE || tpak->info[0] != N64_INFO_ID_CONTROLLER) {
+            fail(tpak, N64_TPAK_NO_CONTROLLER);
+            return false;
+        }
+        controller->info_status = tpak->info[2];
+        if (!(tpak->info[2] & N64_INFO_PAK_PRESENT)) {
+            fail(tpak, N64_TPAK_NO_ACCESSORY);
+            return false;
+        }
+        set_step(tpak, PHASE_POWER, N64_TPAK_POWER_ADDRESS, 1, false);
+        add_write(tpak, N64_TPAK_POWER_ADDRESS, N64_TPAK_POWER_ON);
+    }
+
+    // Collect the job on the wire (or start its next block)
+    if (tpak->job_active) {
+        bool busy = n64_pak_job_task(&tpak->job, controllers, until_us);
+        if (tpak->job.state == N64_PAK_JOB_RUNNING) {
+            return busy;
+        }
+        job_finished(tpak);
+    }
+
+    if (tpak->abort && tpak->state == N64_TPAK_RUNNING && tpak->phase != PHASE_POWER_OFF) {
+        fail(tpak, N64_TPAK_ABORTED);
+    }
+
+    // Next transfer, started right away if it fits before until_us
+    if (!start_next(tpak, controller, until_us)) {
+        return false;
+    }
+    if (tpak->info_in_flight) {
+        return true;
+    }
+    n64_pak_job_task(&tpak->job, controllers, until_us);
+    return tpak->job.in_flight;
+}
+
+uint32_t n64_tpak_busy_mask(const n64_tpak_t *tpak) {
+    if (tpak->state != N64_TPAK_RUNNING) {
+        return 0;
+    }
+    if (tpak->info_in_flight) {
+        return 1u << tpak->port;
+    }
+    return tpak->job_active ? n64_pak_job_busy_mask(&tpak->job) : 0;
+}
@@ -0,0 +1,373 @@
+/*
+ * Persistent Configuration Store Implementation
+ * Flash is read through the XIP window; appends program the page(s) that
+ * hold the new records with every other byte left at 0xFF, which keeps the
+ * records already in those pages intact (NOR flash only clears bits).
+ */
+
+#include "config_store.h"
+#include "usb_descriptors.h"
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Flash Layout
+//--------------------------------------------------------------------
+#define STORE_OFFSET        (PICO_FLASH_SIZE_BYTES - CONFIG_STORE_SECTORS * FLASH_SECTOR_SIZE)
+#define STORE_MAGIC         0x4E364366u     // "fC6N"
+#define HEADER_SIZE         12
+#define RECORD_HEADER_SIZE  4
+#define KEY_ERASED          0xFF
+#define FLASH_OP_TIMEOUT_MS 100
+
+typedef struct {
+    uint32_t magic;
+    uint32_t generation;        // +1 per compaction, newest sector wins
+    uint16_t crc;               // CRC-16 of magic and generation
+    uint16_t reserved;
+} sector_header_t;
+
+typedef struct {
+    uint8_t  key;               // config_key_t (0xFF = end of log)
+    uint8_t  len;               // Value bytes (0 = key removed)
+    uint16_t crc;               // CRC-16 of key, len and value
+} record_header_t;
+
+_Static_assert(sizeof(sector_header_t) == HEADER_SIZE, "sector header layout");
+_Static_assert(sizeof(record_header_t) == RECORD_HEADER_SIZE, "record header layout");
+
+#define RECORD_SIZE(len)    (RECORD_HEADER_SIZE + (((len) + 3u) & ~3u))
+
+// A compacted sector (header + every key at its largest) fits in one page
+_Static_assert(HEADER_SIZE + (CONFIG_KEYS - 1) * RECORD_SIZE(CONFIG_VALUE_MAX) <= FLASH_PAGE_SIZE,
+               "compacted store must fit in one flash page");
+
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+typedef struct {
+    const char *name;
+    config_type_t type;
+} key_info_t;
+
+static const key_info_t s_keys[CONFIG_KEYS] = {
+    [CONFIG_KEY_POLL_INTERVAL_US]  = {"poll_us", CONFIG_TYPE_U32},
+    [CONFIG_KEY_REPORT_REFRESH_MS] = {"refresh_ms", CONFIG_TYPE_U32},
+    [CONFIG_KEY_HIGH_RATE]         = {"high_rate", CONFIG_TYPE_U32},
+    [CONFIG_KEY_DATA_PINS]         = {"data_pins", CONFIG_TYPE_U8_LIST},
+    [CONFIG_KEY_LED_PINS]          = {"led_pins", CONFIG_TYPE_U8_LIST},
+};
+
+// Current values (loaded at boot, changed by config_store_set)
+static uint8_t s_values[CONFIG_KEYS][CONFIG_VALUE_MAX];
+static uint8_t s_len[CONFIG_KEYS];
+static uint32_t s_dirty;                // Keys changed since the last write (bit = key)
+
+static uint32_t s_generation;           // 0 = no valid sector
+static uint8_t s_sector;
+static uint32_t s_used;                 // Next free byte in the active sector
+static uint32_t s_writes;
+static uint32_t s_compactions;
+
+// Pages being programmed (appends may straddle a page boundary)
+static uint8_t s_page_buf[2 * FLASH_PAGE_SIZE];
+
+typedef struct {
+    uint32_t offset;            // Flash offset
+    const uint8_t *data;        // NULL = erase one sector
+    uint32_t len;
+} flash_op_t;
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+
+// CRC-16/CCITT-FALSE, one nibble per step (boot scans a whole sector)
+static uint16_t crc16_update(uint16_t crc, const uint8_t *data, uint32_t len) {
+    static const uint16_t table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+    };
+    for (uint32_t i = 0; i < len; i++) {
+        crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] >> 4)]);
+        crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] & 0x0F)]);
+    }
+    return crc;
+}
+
+static uint16_t record_crc(uint8_t key, uint8_t len, const uint8_t *value) {
+    uint8_t head[2] = {key, len};
+    return crc16_update(crc16_update(0xFFFF, head, 2), value, len);
+}
+
+static uint16_t header_crc(const sector_header_t *header) {
+    return crc16_update(0xFFFF, (const uint8_t *)header, 8);
+}
+
+static const uint8_t *sector_ptr(uint8_t sector) {
+    return (const uint8_t *)(uintptr_t)(XIP_BASE + STORE_OFFSET + sector * FLASH_SECTOR_SIZE);
+}
+
+static bool key_valid(uint8_t key) {
+    return key > 0 && key < CONFIG_KEYS && s_keys[key].name != NULL;
+}
+
+// Replay the records of a sector into the RAM values
+static void scan_sector(uint8_t sector) {
+    const uint8_t *base = sector_ptr(sector);
+    uint32_t offset = HEADER_SIZE;
+
+    while (offset + RECORD_HEADER_SIZE <= FLASH_SECTOR_SIZE) {
+        record_header_t record;
+        memcpy(&record, base + offset, sizeof(record));
+        if (record.key == KEY_ERASED) {
+            break;
+        }
+
+        const uint8_t *value = base + offset + RECORD_HEADER_SIZE;
+        if (!key_valid(record.key) || record.len > CONFIG_VALUE_MAX ||
+            offset + RECORD_SIZE(record.len) > FLASH_SECTOR_SIZE ||
+            record_crc(record.key, record.len, value) != record.crc) {
+            // Torn or corrupt tail: keep what was read, compact on the next write
+            offset = FLASH_SECTOR_SIZE;
+            break;
+        }
+
+        memcpy(s_values[record.key], value, record.len);
+        s_len[record.key] = record.len;
+        offset += RECORD_SIZE(record.len);
+    }
+    s_used = offset;
+}
+
+// Serialize one record at buf (returns its size)
+static uint32_t put_record(uint8_t *buf, uint8_t key) {
+    record_header_t record = {
+        .key = key,
+        .len = s_len[key],
+        .crc = record_crc(key, s_len[key], s_values[key]),
+    };
+    memcpy(buf, &record, sizeof(record));
+    memcpy(buf + RECORD_HEADER_SIZE, s_values[key], s_len[key]);
+    return RECORD_SIZE(s_len[key]);
+}
+
+// Runs with the other core parked and IRQs masked
+static void do_flash_op(void *param) {
+    const flash_op_t *op = (const flash_op_t *)param;
+    if (op->data == NULL) {
+        flash_range_erase(op->offset, FLASH_SECTOR_SIZE);
+    } else {
+        flash_range_program(op->offset, op->data, op->len);
+    }
+}
+
+static bool flash_op(uint32_t offset, const uint8_t *data, uint32_t len) {
+    flash_op_t op = {offset, data, len};
+    return flash_safe_execute(do_flash_op, &op, FLASH_OP_TIMEOUT_MS) == PICO_OK;
+}
+
+// Program pages of s_page_buf at a sector offset, then read them back
+// (false if the flash op was refused; *bad set if it did not read back)
+static bool program_pages(uint8_t sector, uint32_t page_offset, uint32_t len, bool *bad) {
+    uint32_t offset = STORE_OFFSET + sector * FLASH_SECTOR_SIZE + page_offset;
+    *bad = false;
+    if (!flash_op(offset, s_page_buf, len)) {
+        return false;
+    }
+
+    // 0xFF bytes were left untouched: only compare what was written
+    const uint8_t *flash = sector_ptr(sector) + page_offset;
+    for (uint32_t i = 0; i < len; i++) {
+        if (s_page_buf[i] != 0xFF && flash[i] != s_page_buf[i]) {
+            *bad = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Rewrite every current value into the next sector of the ring
+static bool compact(void) {
+    uint8_t sector = (s_generation == 0) ? 0 : (uint8_t)((s_sector + 1) % CONFIG_STORE_SECTORS);
+    if (!flash_op(STORE_OFFSET + sector * FLASH_SECTOR_SIZE, NULL, 0)) {
+        return false;
+    }
+
+    sector_header_t header = {
+        .magic = STORE_MAGIC,
+        .generation = s_generation + 1,
+        .reserved = 0xFFFF,
+    };
+    header.crc = header_crc(&header);
+
+    memset(s_page_buf, 0xFF, FLASH_PAGE_SIZE);
+    memcpy(s_page_buf, &header, sizeof(header));
+    uint32_t used = HEADER_SIZE;
+    for (uint8_t key = 1; key < CONFIG_KEYS; key++) {
+        if (key_valid(key) && s_len[key] > 0) {
+            used += put_record(s_page_buf + used, key);
+        }
+    }
+
+    bool bad;
+    if (!program_pages(sector, 0, FLASH_PAGE_SIZE, &bad)) {
+        return false;
+    }
+
+    s_sector = sector;
+    s_generation = header.generation;
+    s_used = used;
+    s_compactions++;
+    return true;
+}
+
+// Flash space taken by the records of the changed keys
+static uint32_t records_size(uint32_t dirty) {
+    uint32_t size = 0;
+    for (uint8_t key = 1; key < CONFIG_KEYS; key++) {
+        if (dirty & (1u << key)) {
+            size += RECORD_SIZE(s_len[key]);
+        }
+    }
+    return size;
+}
+
+// Append the changed keys to the active sector (the caller checked they fit)
+static bool append(uint32_t dirty, uint32_t size) {
+    uint32_t page_offset = s_used & ~(FLASH_PAGE_SIZE - 1);
+    uint32_t pos = s_used - page_offset;
+    uint32_t len = (pos + size + FLASH_PAGE_SIZE - 1) & ~(FLASH_PAGE_SIZE - 1);
+
+    memset(s_page_buf, 0xFF, len);
+    for (uint8_t key = 1; key < CONFIG_KEYS; key++) {
+        if (dirty & (1u << key)) {
+            pos += put_record(s_page_buf + pos, key);
+        }
+    }
+
+    bool bad;
+    if (!program_pages(s_sector, page_offset, len, &bad)) {
+        if (bad) {
+            s_used = FLASH_SECTOR_SIZE;     // Don't build on a bad page: compact next
+        }
+        return false;
+    }
+    s_used += size;
+    return true;
+}
+
+//--------------------------------------------------------------------
+// Public Functions
+//--------------------------------------------------------------------
+
+void config_store_init(void) {
+    memset(s_len, 0, sizeof(s_len));
+    s_dirty = 0;
+    s_generation = 0;
+    s_sector = 0;
+    s_used = FLASH_SECTOR_SIZE;
+
+    // Newest valid header; only that sector is scanned
+    for (uint8_t sector = 0; sector < CONFIG_STORE_SECTORS; sector++) {
+        sector_header_t header;
+        memcpy(&header, sector_ptr(sector), sizeof(header));
+        if (header.magic != STORE_MAGIC || header.crc != header_crc(&header)) {
+            continue;
+        }
+        if (s_generation == 0 || header.generation > s_generation) {
+            s_generation = header.generation;
+            s_sector = sector;
+        }
+    }
+
+    if (s_generation != 0) {
+        scan_sector(s_sector);
+    }
+}
+
+uint8_t config_store_get(config_key_t key, void *value, uint8_t size) {
+    if (!key_valid(key) || s_len[key] == 0) {
+        return 0;
+    }
+    uint8_t len = (s_len[key] < size) ? s_len[key] : size;
+    memcpy(value, s_values[key], len);
+    return len;
+}
+
+bool config_store_get_u32(config_key_t key, uint32_t *value) {
+    uint32_t v;
+    if (config_store_get(key, &v, sizeof(v)) != sizeof(v)) {
+        return false;
+    }
+    *value = v;
+    return true;
+}
+
+bool config_store_set(config_key_t key, const void *value, uint8_t len) {
+    if (!key_valid(key) || len > CONFIG_VALUE_MAX) {
+        return false;
+    }
+    if (s_keys[key].type == CONFIG_TYPE_U32 && len != 0 && len != sizeof(uint32_t)) {
+        return false;
+    }
+    if (s_keys[key].type == CONFIG_TYPE_U8_LIST && len != 0 && len != MAX_CONTROLLERS) {
+        return false;
+    }
+
+    // Same value: nothing to write (value may be NULL when len is 0)
+    if (len == s_len[key] && (len == 0 || memcmp(s_values[key], value, len) == 0)) {
+        return true;
+    }
+    if (len > 0) {
+        memcpy(s_values[key], value, len);
+    }
+    s_len[key] = len;
+    s_dirty |= 1u << key;
+    return true;
+}
+
+bool config_store_task(void) {
+    if (s_dirty == 0) {
+        return false;
+    }
+
+    // Append if the records fit, else rewrite the current values compacted
+    uint32_t dirty = s_dirty;
+    uint32_t size = records_size(dirty);
+    bool fits = s_generation != 0 && s_used + size <= FLASH_SECTOR_SIZE;
+    if (!(fits ? append(dirty, size) : compact())) {
+        return false;   // Flash busy or failed: retry on the next call
+    }
+    s_dirty &= ~dirty;
+    s_writes += (uint32_t)__builtin_popcount(dirty);
+    return true;
+}
+
+void config_store_get_status(config_store_status_t *status) {
+    status->generation = s_generation;
+    status->sector = s_sector;
+    status->used = (uint16_t)s_used;
+    status->writes = s_writes;
+    status->compactions = s_compactions;
+    status->pending = (s_dirty != 0);
+}
+
+const char *config_key_name(config_key_t key) {
+    return key_valid(key) ? s_keys[key].name : NULL;
+}
+
+config_key_t config_key_from_name(const char *name) {
+    for (uint8_t key = 1; key < CONFIG_KEYS; key++) {
+        if (key_valid(key) && strcmp(s_keys[key].name, name) == 0) {
+            return (config_key_t)key;
+        }
+    }
+    return CONFIG_KEYS;
+}
+
+config_type_t config_key_type(config_key_t key) {
+    return key_valid(key) ? s_keys[key].type : CONFIG_TYPE_U32;
+}
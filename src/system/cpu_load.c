@@ -0,0 +1,62 @@
+/*
+ * CPU Load Counter Implementation
+ */
+
+#include "cpu_load.h"
+#include "pico/stdlib.h"
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+
+static void roll_window(cpu_load_t *load, uint64_t now) {
+    uint64_t elapsed = now - load->window_start_us;
+    if (elapsed < CPU_LOAD_WINDOW_US) {
+        return;
+    }
+
+    // Close any open busy section at the window boundary
+    if (load->in_busy) {
+        load->busy_us += now - load->busy_start_us;
+        load->busy_start_us = now;
+    }
+
+    load->load_permille = (uint32_t)((load->busy_us * 1000) / elapsed);
+    load->busy_us = 0;
+    load->window_start_us = now;
+}
+
+//--------------------------------------------------------------------
+// Public Functions
+//--------------------------------------------------------------------
+
+void cpu_load_init(cpu_load_t *load) {
+    load->window_start_us = time_us_64();
+    load->busy_start_us = 0;
+    load->busy_us = 0;
+    load->in_busy = false;
+    load->load_permille = 0;
+}
+
+void cpu_load_begin(cpu_load_t *load) {
+    uint64_t now = time_us_64();
+    roll_window(load, now);
+    load->busy_start_us = now;
+    load->in_busy = true;
+}
+
+uint32_t cpu_load_end(cpu_load_t *load) {
+    uint64_t now = time_us_64();
+    uint32_t section_us = 0;
+    if (load->in_busy) {
+        section_us = (uint32_t)(now - load->busy_start_us);
+        load->busy_us += section_us;
+        load->in_busy = false;
+    }
+    roll_window(load, now);
+    return section_us;
+}
+
+uint32_t cpu_load_get_permille(const cpu_load_t *load) {
+    return load->load_permille;
+}
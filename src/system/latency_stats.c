@@ -0,0 +1,105 @@
+/*
+ * Latency Statistics Implementation
+ * Bucket search is a short linear scan (13 limits): cheaper than a divide
+ * on the Cortex-M0+ and bounded.
+ */
+
+#include "latency_stats.h"
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+const uint32_t latency_bucket_limit_us[LATENCY_BUCKETS] = {
+    10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, UINT32_MAX
+};
+
+static const char *const s_stage_names[LATENCY_STAGES] = {
+    "wire", "convert", "queue", "host", "total"
+};
+
+static latency_hist_t s_hist[MAX_CONTROLLERS][LATENCY_STAGES];
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+
+static void reset_hist(latency_hist_t *hist) {
+    memset(hist, 0, sizeof(*hist));
+    hist->min_us = UINT32_MAX;
+}
+
+//--------------------------------------------------------------------
+// Public Functions
+//--------------------------------------------------------------------
+
+void latency_stats_init(void) {
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        latency_stats_reset(i);
+    }
+}
+
+void latency_stats_record(uint8_t port, latency_stage_t stage, uint32_t us) {
+    if (port >= MAX_CONTROLLERS || stage >= LATENCY_STAGES) {
+        return;
+    }
+    latency_hist_t *hist = &s_hist[port][stage];
+
+    uint32_t bucket = 0;
+    while (us > latency_bucket_limit_us[bucket]) {
+        bucket++;
+    }
+    hist->buckets[bucket]++;
+
+    hist->count++;
+    hist->sum_us += us;
+    if (us < hist->min_us) {
+        hist->min_us = us;
+    }
+    if (us > hist->max_us) {
+        hist->max_us = us;
+    }
+}
+
+void latency_stats_get(uint8_t port, latency_stage_t stage, latency_hist_t *hist) {
+    if (port >= MAX_CONTROLLERS || stage >= LATENCY_STAGES) {
+        reset_hist(hist);
+        return;
+    }
+    *hist = s_hist[port][stage];
+}
+
+void latency_stats_reset(uint8_t port) {
+    if (port >= MAX_CONTROLLERS) {
+        return;
+    }
+    for (int stage = 0; stage < LATENCY_STAGES; stage++) {
+        reset_hist(&s_hist[port][stage]);
+    }
+}
+
+uint32_t latency_hist_percentile(const latency_hist_t *hist, uint32_t permille) {
+    if (hist->count == 0) {
+        return 0;
+    }
+
+    // Rank of the percentile sample (1-based, rounded up)
+    uint64_t rank = ((uint64_t)hist->count * permille + 999) / 1000;
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            uint32_t limit = latency_bucket_limit_us[i];
+            return (limit < hist->max_us) ? limit : hist->max_us;
+        }
+    }
+    return hist->max_us;
+}
+
+const char *latency_stage_name(latency_stage_t stage) {
+    return (stage < LATENCY_STAGES) ? s_stage_names[stage] : "?";
+}
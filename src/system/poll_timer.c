@@ -0,0 +1,122 @@
+/*
+ * Poll Timer Implementation
+ * One-shot hardware alarm re-armed on every deadline. Deadlines advance by
+ * exactly one period so the rate never drifts; if the loop falls more than
+ * a period behind, missed deadlines are skipped and counted.
+ */
+
+#include "poll_timer.h"
+#include "pico/stdlib.h"
+#include "hardware/timer.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+#define NUM_HARDWARE_ALARMS     4
+
+static poll_timer_t *s_alarm_owner[NUM_HARDWARE_ALARMS];
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+
+static void alarm_callback(uint alarm_num) {
+    poll_timer_t *timer = s_alarm_owner[alarm_num];
+    if (timer != NULL) {
+        timer->due = true;
+        __sev();  // Wake the other core if it is waiting on this deadline
+    }
+}
+
+static void arm_alarm(poll_timer_t *timer) {
+    // Target already in the past: deadline is due right away
+    if (hardware_alarm_set_target((uint)timer->alarm_num,
+                                  from_us_since_boot(timer->deadline_us))) {
+        timer->due = true;
+    }
+}
+
+static void reset_stats(poll_timer_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->min_dev_us = INT32_MAX;
+    stats->max_dev_us = INT32_MIN;
+}
+
+//--------------------------------------------------------------------
+// Public Functions
+//--------------------------------------------------------------------
+
+bool poll_timer_init(poll_timer_t *timer, uint32_t period_us) {
+    timer->alarm_num = -1;
+    timer->due = false;
+
+    int alarm_num = hardware_alarm_claim_unused(false);
+    if (alarm_num < 0) {
+        return false;
+    }
+
+    timer->alarm_num = alarm_num;
+    timer->period_us = period_us;
+    timer->due = false;
+    reset_stats(&timer->stats);
+
+    s_alarm_owner[alarm_num] = timer;
+    hardware_alarm_set_callback((uint)alarm_num, alarm_callback);
+
+    timer->deadline_us = time_us_64() + period_us;
+    arm_alarm(timer);
+    return true;
+}
+
+void poll_timer_schedule(poll_timer_t *timer, uint64_t deadline_us) {
+    if (timer->alarm_num < 0) {
+        return;
+    }
+
+    // Drop the pending deadline (and a callback that may have just fired)
+    hardware_alarm_cancel((uint)timer->alarm_num);
+    timer->due = false;
+
+    timer->deadline_us = deadline_us;
+    arm_alarm(timer);
+}
+
+bool poll_timer_take(poll_timer_t *timer) {
+    if (!timer->due) {
+        return false;
+    }
+    timer->due = false;
+
+    uint64_t now = time_us_64();
+    int32_t deviation = (int32_t)(now - timer->deadline_us);
+
+    poll_timer_stats_t *stats = &timer->stats;
+    stats->count++;
+    stats->sum_dev_us += deviation;
+    if (deviation < stats->min_dev_us) {
+        stats->min_dev_us = deviation;
+    }
+    if (deviation > stats->max_dev_us) {
+        stats->max_dev_us = deviation;
+    }
+
+    // Next ideal deadline; skip whole periods if we are already past it
+    timer->deadline_us += timer->period_us;
+    while (timer->deadline_us <= now) {
+        timer->deadline_us += timer->period_us;
+        stats->missed++;
+    }
+    arm_alarm(timer);
+
+    return true;
+}
+
+void poll_timer_get_stats(const poll_timer_t *timer, poll_timer_stats_t *stats) {
+    *stats = timer->stats;
+}
+
+void poll_timer_reset_stats(poll_timer_t *timer) {
+    reset_stats(&timer->stats);
+}
@@ -0,0 +1,171 @@
+/*
+ * Section Profiler Implementation
+ * The cost of an empty probe is measured at init and removed from every
+ * sample, so short sections are not dominated by the probe itself.
+ */
+
+#include "profiler.h"
+#include <stdio.h>
+#include <string.h>
+
+#if PICO_ON_DEVICE
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
+#else
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_HOST_TSC   1
+#endif
+#endif
+
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+#define SYSTICK_MAX         0x00FFFFFFu // 24-bit reload value
+#define OVERHEAD_SAMPLES    16
+
+static const char *const s_probe_names[PROF_PROBES] = {
+    "n64_start", "n64_read_poll", "n64_transfer_poll", "unpack_response", "reset_sm", "device_parse",
+    "device_to_usb_report", "usb_send_report", "tud_task"
+};
+
+static profiler_stats_t s_probes[PROF_PROBES];
+static uint32_t s_overhead;             // Ticks of an empty probe
+static uint32_t s_ticks_per_us;
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+
+static uint32_t elapsed_ticks(uint32_t start) {
+#if PICO_ON_DEVICE
+    // SysTick counts down and wraps at 24 bits
+    return (start - profiler_ticks()) & SYSTICK_MAX;
+#else
+    return profiler_ticks() - start;
+#endif
+}
+
+static uint32_t measure_ticks_per_us(void) {
+#if PICO_ON_DEVICE
+    return clock_get_hz(clk_sys) / 1000000;
+#elif PROFILER_HOST_TSC
+    // TSC rate from a 10 ms busy wait on the monotonic clock
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    uint64_t tsc0 = __rdtsc();
+    uint64_t ns;
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ns = (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000u + (uint64_t)t1.tv_nsec -
+             (uint64_t)t0.tv_nsec;
+    } while (ns < 10000000u);
+    uint32_t rate = (uint32_t)((__rdtsc() - tsc0) * 1000 / ns);
+    return rate ? rate : 1;
+#else
+    return 1000;    // Nanosecond ticks
+#endif
+}
+
+static void reset_probe(profiler_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->min = UINT32_MAX;
+}
+
+//--------------------------------------------------------------------
+// Public Functions
+//--------------------------------------------------------------------
+
+void profiler_init(void) {
+    profiler_init_core();
+    s_ticks_per_us = measure_ticks_per_us();
+
+    // Cheapest empty section = fixed cost of a probe
+    s_overhead = 0;
+    uint32_t overhead = UINT32_MAX;
+    for (int i = 0; i < OVERHEAD_SAMPLES; i++) {
+        uint32_t start = profiler_ticks();
+        uint32_t ticks = elapsed_ticks(start);
+        if (ticks < overhead) {
+            overhead = ticks;
+        }
+    }
+    s_overhead = overhead;
+
+    profiler_reset();
+}
+
+void profiler_init_core(void) {
+#if PICO_ON_DEVICE
+    // Free-running down-counter on the processor clock, no interrupt
+    systick_hw->rvr = SYSTICK_MAX;
+    systick_hw->cvr = 0;
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+#endif
+}
+
+uint32_t profiler_ticks(void) {
+#if PICO_ON_DEVICE
+    return systick_hw->cvr;
+#elif PROFILER_HOST_TSC
+    return (uint32_t)__rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+#endif
+}
+
+void profiler_record(profiler_probe_t probe, uint32_t start) {
+    uint32_t ticks = elapsed_ticks(start);
+    if (probe >= PROF_PROBES) {
+        return;
+    }
+    ticks = (ticks > s_overhead) ? ticks - s_overhead : 0;
+
+    profiler_stats_t *stats = &s_probes[probe];
+    stats->calls++;
+    stats->total += ticks;
+    if (ticks < stats->min) {
+        stats->min = ticks;
+    }
+    if (ticks > stats->max) {
+        stats->max = ticks;
+    }
+}
+
+void profiler_get(profiler_probe_t probe, profiler_stats_t *stats) {
+    if (probe >= PROF_PROBES) {
+        reset_probe(stats);
+        return;
+    }
+    *stats = s_probes[probe];
+}
+
+void profiler_reset(void) {
+    for (int i = 0; i < PROF_PROBES; i++) {
+        reset_probe(&s_probes[i]);
+    }
+}
+
+void profiler_dump(void) {
+    uint32_t rate = s_ticks_per_us ? s_ticks_per_us : 1;
+
+    printf("[PROF] %lu ticks/us, probe overhead %lu ticks removed\n",
+           (unsigned long)rate, (unsigned long)s_overhead);
+    printf("[PROF] %-18s %8s %10s %8s %8s %8s %10s\n",
+           "probe", "calls", "avg ticks", "min", "max", "avg ns", "total us");
+    for (int i = 0; i < PROF_PROBES; i++) {
+        const profiler_stats_t *stats = &s_probes[i];
+        if (stats->calls == 0) {
+            continue;
+        }
+        uint32_t avg = (uint32_t)(stats->total / stats->calls);
+        printf("[PROF] %-18s %8lu %10lu %8lu %8lu %8lu %10lu\n",
+               s_probe_names[i], (unsigned long)stats->calls, (unsigned long)avg,
+               (unsigned long)stats->min, (unsigned long)stats->max,
+               (unsigned long)((uint64_t)avg * 1000 / rate),
+               (unsigned long)(stats->total / rate));
+    }
+}
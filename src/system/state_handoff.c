@@ -0,0 +1,78 @@
+/*
+ * Controller State Handoff Implementation
+ * Seqlock between the polling core (writer) and the USB core (reader)
+ */
+
+#include "state_handoff.h"
+#include "hardware/sync.h"
+
+//--------------------------------------------------------------------
+// Configuration
+//--------------------------------------------------------------------
+#define HANDOFF_READ_ATTEMPTS   4   // Retries before giving up for this loop
+
+//--------------------------------------------------------------------
+// Public Functions
+//--------------------------------------------------------------------
+
+void state_handoff_init(state_handoff_t *handoff) {
+    handoff->seq = 0;
+    for (int i = 0; i < N64_DEVICE_STATE_SIZE / 4; i++) {
+        handoff->state.words[i] = 0;
+    }
+    handoff->state.type = N64_DEVICE_NONE;
+    handoff->responding = false;
+    handoff->sample_us = 0;
+    handoff->capture_seq = 0;
+}
+
+void state_handoff_publish(state_handoff_t *handoff, const n64_device_state_t *state,
+                           bool responding, uint32_t sample_us, uint16_t capture_seq) {
+    uint32_t seq = handoff->seq;
+
+    // Odd sequence: snapshot is being written
+    handoff->seq = seq + 1;
+    __dmb();
+
+    // Two words whatever the device (8-byte GameCube state included)
+    handoff->state.words[0] = state->words[0];
+    handoff->state.words[1] = state->words[1];
+    handoff->state.type = state->type;
+    handoff->responding = responding;
+    handoff->sample_us = sample_us;
+    handoff->capture_seq = capture_seq;
+
+    // Even sequence: snapshot is stable again
+    __dmb();
+    handoff->seq = seq + 2;
+
+    // Wake the consumer if it is sleeping in __wfe()
+    __sev();
+}
+
+bool state_handoff_read(const state_handoff_t *handoff, n64_device_state_t *state,
+                        bool *responding, uint32_t *sample_us, uint16_t *capture_seq,
+                        uint32_t *seq) {
+    for (int attempt = 0; attempt < HANDOFF_READ_ATTEMPTS; attempt++) {
+        uint32_t start_seq = handoff->seq;
+        if (start_seq & 1) {
+            continue;  // Writer in progress
+        }
+        __dmb();
+
+        state->words[0] = handoff->state.words[0];
+        state->words[1] = handoff->state.words[1];
+        state->type = handoff->state.type;
+        *responding = handoff->responding;
+        *sample_us = handoff->sample_us;
+        *capture_seq = handoff->capture_seq;
+
+        __dmb();
+        if (handoff->seq == start_seq) {
+            *seq = start_seq;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,162 @@
+/*
+ * Binary Event Trace Implementation
+ * Each record goes out as one text-safe line, '~' + 24 hex digits + '\n',
+ * so it can share the debug UART with the printf logs: the decoder picks
+ * the trace lines and passes everything else through.
+ */
+
+#include "trace.h"
+#include "pico/stdlib.h"
+#include "hardware/uart.h"
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+#define TRACE_LINE_SIZE     (1 + 2 * sizeof(trace_record_t) + 1)
+
+trace_ring_t g_trace_rings[TRACE_CORES];
+
+// Loss reporting, per ring
+typedef struct {
+    uint32_t reported;          // Ring drop count already taken into account
+    uint32_t pending;           // Records lost, not reported yet
+    uint32_t position;          // Ring position the loss follows
+    uint32_t last_us;           // Time of the last record sent from the ring
+} drop_state_t;
+
+static drop_state_t s_drop[TRACE_CORES];
+#if N64_TRACE
+static char s_line[TRACE_LINE_SIZE];
+#endif
+static uint32_t s_line_pos = TRACE_LINE_SIZE;  // == size: no line in progress
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+#if N64_TRACE
+
+static void format_line(const trace_record_t *record) {
+    static const char hex[] = "0123456789abcdef";
+    const uint8_t *bytes = (const uint8_t *)record;
+
+    s_line[0] = '~';
+    for (uint32_t i = 0; i < sizeof(*record); i++) {
+        s_line[1 + 2 * i] = hex[bytes[i] >> 4];
+        s_line[2 + 2 * i] = hex[bytes[i] & 0x0F];
+    }
+    s_line[TRACE_LINE_SIZE - 1] = '\n';
+    s_line_pos = 0;
+}
+
+// Oldest pending item of a ring: its next record, or the loss report once
+// every record written before the loss has been sent (false if none)
+static bool peek_ring(int core, trace_record_t *record) {
+    trace_ring_t *ring = &g_trace_rings[core];
+    drop_state_t *drop = &s_drop[core];
+
+    // New loss: it happened after the records currently in the ring
+    uint32_t dropped = ring->dropped;
+    if (drop->pending == 0 && dropped != drop->reported) {
+        drop->pending = dropped - drop->reported;
+        drop->reported = dropped;
+        drop->position = ring->head;
+    }
+
+    uint32_t tail = ring->tail;
+    if (drop->pending != 0 && tail == drop->position) {
+        record->timestamp_us = drop->last_us;
+        record->event = TRACE_EV_DROPPED;
+        record->port = TRACE_PORT_NONE;
+        record->arg0 = 0;
+        record->arg1 = drop->pending;
+        return true;
+    }
+
+    if (ring->head == tail) {
+        return false;
+    }
+    __dmb();
+    *record = ring->records[tail & (TRACE_RING_SIZE - 1)];
+    return true;
+}
+
+// Next item to send, oldest first across the rings (false if none)
+static bool next_record(trace_record_t *record) {
+    trace_record_t candidates[TRACE_CORES];
+    int best = -1;
+
+    for (int core = 0; core < TRACE_CORES; core++) {
+        if (!peek_ring(core, &candidates[core])) {
+            continue;
+        }
+        if (best < 0 ||
+            (int32_t)(candidates[core].timestamp_us - candidates[best].timestamp_us) < 0) {
+            best = core;
+        }
+    }
+    if (best < 0) {
+        return false;
+    }
+
+    *record = candidates[best];
+    drop_state_t *drop = &s_drop[best];
+    if (record->event == TRACE_EV_DROPPED && drop->pending != 0 &&
+        g_trace_rings[best].tail == drop->position) {
+        drop->pending = 0;
+    } else {
+        // Slot copied before the producer may reuse it
+        drop->last_us = record->timestamp_us;
+        __dmb();
+        g_trace_rings[best].tail++;
+    }
+
+    if (best == 1) {
+        record->port |= TRACE_PORT_CORE1;
+    }
+    return true;
+}
+
+#endif /* N64_TRACE */
+
+//--------------------------------------------------------------------
+// Public Functions
+//--------------------------------------------------------------------
+
+void trace_init(void) {
+    memset(g_trace_rings, 0, sizeof(g_trace_rings));
+    memset(s_drop, 0, sizeof(s_drop));
+    s_line_pos = TRACE_LINE_SIZE;
+}
+
+bool trace_drain(void) {
+#if N64_TRACE
+    uart_inst_t *uart = uart_default;
+
+    while (true) {
+        // Push the current line as far as the TX FIFO allows
+        while (s_line_pos < TRACE_LINE_SIZE) {
+            if (!uart_is_writable(uart)) {
+                return true;
+            }
+            uart_putc_raw(uart, s_line[s_line_pos++]);
+        }
+
+        trace_record_t record;
+        if (!next_record(&record)) {
+            return false;
+        }
+        format_line(&record);
+    }
+#else
+    return false;
+#endif
+}
+
+void trace_drain_sync(void) {
+#if N64_TRACE
+    while (s_line_pos < TRACE_LINE_SIZE) {
+        uart_putc_raw(uart_default, s_line[s_line_pos++]);
+    }
+#endif
+}
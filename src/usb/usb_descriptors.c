@@ -1,9 +1,12 @@
 /*
  * USB Descriptors Implementation for N64-USB Gamepad
- * Dual gamepad support - 2 separate HID interfaces, one per controller
+ * Multi gamepad support - separate HID interfaces, one per controller,
+ * or one shared interface with a Report ID per player (N64_HID_REPORT_ID)
  */
 
+#include <stdio.h>
 #include "usb_descriptors.h"
+#include "usb_raw_stream.h"
 #include "tusb.h"
 
 //--------------------------------------------------------------------
@@ -15,7 +18,7 @@ static const uint8_t hid_report_descriptor_single[] = {
     0x09, 0x05,        // Usage (Game Pad)
     0xA1, 0x01,        // Collection (Application)
 
-    // 16 Buttons (only first 10 used)
+    // 16 Buttons (10 used by N64 devices, 12 by GameCube controllers)
     0x05, 0x09,        //   Usage Page (Button)
     0x19, 0x01,        //   Usage Minimum (Button 1)
     0x29, 0x10,        //   Usage Maximum (Button 16)
@@ -52,9 +55,73 @@ static const uint8_t hid_report_descriptor_single[] = {
     0x95, 0x02,        //   Report Count (2)
     0x81, 0x02,        //   Input (Data, Var, Abs)
 
+    // Latency statistics (GET_FEATURE, SET_FEATURE resets them)
+    0x06, 0x00, 0xFF,  //   Usage Page (Vendor Defined 0xFF00)
+    0x09, 0x10,        //   Usage (Vendor Usage 0x10)
+    0x15, 0x00,        //   Logical Minimum (0)
+    0x26, 0xFF, 0x00,  //   Logical Maximum (255)
+    0x75, 0x08,        //   Report Size (8)
+    0x95, USB_LATENCY_FEATURE_SIZE, //   Report Count (63)
+    0xB1, 0x02,        //   Feature (Data, Var, Abs)
+
+#if N64_RUMBLE
+    // Rumble (SET_REPORT Output): strength, duration in 10 ms units
+    0x09, 0x20,        //   Usage (Vendor Usage 0x20)
+    0x95, USB_RUMBLE_REPORT_SIZE,   //   Report Count (2)
+    0x91, 0x02,        //   Output (Data, Var, Abs)
+#endif
+
     0xC0               // End Collection
 };
 
+//--------------------------------------------------------------------
+// HID Report Descriptor (raw Joybus stream)
+// Vendor-defined: opaque 64-byte input reports, read through hidraw
+//--------------------------------------------------------------------
+static const uint8_t hid_report_descriptor_stream[] = {
+    0x06, 0x00, 0xFF,  // Usage Page (Vendor Defined 0xFF00)
+    0x09, 0x01,        // Usage (Vendor Usage 1)
+    0xA1, 0x01,        // Collection (Application)
+    0x09, 0x02,        //   Usage (Vendor Usage 2)
+    0x15, 0x00,        //   Logical Minimum (0)
+    0x26, 0xFF, 0x00,  //   Logical Maximum (255)
+    0x75, 0x08,        //   Report Size (8)
+    0x95, RAW_STREAM_REPORT_SIZE, //   Report Count (64)
+    0x81, 0x02,        //   Input (Data, Var, Abs)
+    0xC0               // End Collection
+};
+
+//--------------------------------------------------------------------
+// HID Report Descriptor (Report ID mode)
+// The single-gamepad collection repeated per player, with a Report ID
+// item inserted after Collection (Application)
+//--------------------------------------------------------------------
+#define HID_COLLECTION_HEADER_LEN   6   // Usage Page, Usage, Collection
+#define HID_REPORT_ID_ITEM_LEN      2   // Report ID (n)
+
+#if N64_HID_REPORT_ID
+#define HID_REPORT_DESC_LEN \
+    (MAX_CONTROLLERS * (sizeof(hid_report_descriptor_single) + HID_REPORT_ID_ITEM_LEN))
+
+static uint8_t hid_report_descriptor_multi[HID_REPORT_DESC_LEN];
+
+static void build_report_descriptor(void) {
+    uint8_t *desc = hid_report_descriptor_multi;
+
+    for (uint8_t port = 0; port < MAX_CONTROLLERS; port++) {
+        memcpy(desc, hid_report_descriptor_single, HID_COLLECTION_HEADER_LEN);
+        desc += HID_COLLECTION_HEADER_LEN;
+        *desc++ = 0x85;                 //   Report ID
+        *desc++ = HID_REPORT_ID(port);
+        memcpy(desc, hid_report_descriptor_single + HID_COLLECTION_HEADER_LEN,
+               sizeof(hid_report_descriptor_single) - HID_COLLECTION_HEADER_LEN);
+        desc += sizeof(hid_report_descriptor_single) - HID_COLLECTION_HEADER_LEN;
+    }
+}
+#else
+#define HID_REPORT_DESC_LEN         sizeof(hid_report_descriptor_single)
+#endif
+
 //--------------------------------------------------------------------
 // Device Descriptor
 //--------------------------------------------------------------------
@@ -77,22 +144,90 @@ static const tusb_desc_device_t device_descriptor = {
 
 //--------------------------------------------------------------------
 // Configuration Descriptor
-// Two separate HID interfaces, each with its own endpoint
+// One HID interface per controller port, each with its own IN endpoint
+// (or a single one in Report ID mode). Built in RAM from a single-interface
+// template: the port count comes from the build, bInterval from the
+// boot-time rate selection.
 //--------------------------------------------------------------------
-#define CONFIG_TOTAL_LEN  (TUD_CONFIG_DESC_LEN + 2 * TUD_HID_DESC_LEN)
-#define EPNUM_HID1        0x81
-#define EPNUM_HID2        0x82
+#define CONFIG_TOTAL_LEN  (TUD_CONFIG_DESC_LEN + USB_HID_TOTAL * TUD_HID_DESC_LEN + \
+                           N64_MSC * TUD_MSC_DESC_LEN + N64_TPAK * TUD_VENDOR_DESC_LEN)
 
-static const uint8_t config_descriptor[] = {
-    // Configuration descriptor (2 interfaces)
-    TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
+static const uint8_t config_header[] = {
+    TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100)
+};
 
-    // HID Interface 0 - Gamepad 1
-    TUD_HID_DESCRIPTOR(ITF_NUM_HID1, 4, HID_ITF_PROTOCOL_NONE, sizeof(hid_report_descriptor_single), EPNUM_HID1, CFG_TUD_HID_EP_BUFSIZE, 8),
+// Interface number, string index, endpoint and bInterval are patched per port
+static const uint8_t hid_interface_template[] = {
+    TUD_HID_DESCRIPTOR(ITF_NUM_HID(0), STRID_INTERFACE, HID_ITF_PROTOCOL_NONE, HID_REPORT_DESC_LEN, EPNUM_HID(0), USB_GAMEPAD_EP_SIZE, USB_HID_POLL_INTERVAL_MS)
+};
 
-    // HID Interface 1 - Gamepad 2
-    TUD_HID_DESCRIPTOR(ITF_NUM_HID2, 5, HID_ITF_PROTOCOL_NONE, sizeof(hid_report_descriptor_single), EPNUM_HID2, CFG_TUD_HID_EP_BUFSIZE, 8)
+#if N64_RAW_STREAM
+// Raw stream interface, appended after the gamepads
+static const uint8_t hid_stream_interface[] = {
+    TUD_HID_DESCRIPTOR(ITF_NUM_HID(USB_STREAM_INSTANCE), STRID_STREAM, HID_ITF_PROTOCOL_NONE, sizeof(hid_report_descriptor_stream), EPNUM_HID(USB_STREAM_INSTANCE), USB_STREAM_EP_SIZE, USB_STREAM_POLL_INTERVAL_MS)
 };
+#endif
+
+#if N64_MSC
+// Controller Pak drive, after the HID interfaces
+static const uint8_t msc_interface[] = {
+    TUD_MSC_DESCRIPTOR(ITF_NUM_MSC, STRID_MSC, EPNUM_MSC_OUT, EPNUM_MSC_IN, USB_MSC_EP_SIZE)
+};
+#endif
+
+#if N64_TPAK
+// Transfer Pak dump stream, last interface
+static const uint8_t tpak_interface[] = {
+    TUD_VENDOR_DESCRIPTOR(ITF_NUM_TPAK, STRID_TPAK, EPNUM_TPAK_OUT, EPNUM_TPAK_IN, USB_TPAK_EP_SIZE)
+};
+#endif
+
+static uint8_t config_descriptor[CONFIG_TOTAL_LEN];
+static bool s_config_built = false;
+static uint8_t s_poll_interval_ms = USB_HID_POLL_INTERVAL_MS;
+static uint8_t s_report_interval_ms = USB_HID_POLL_INTERVAL_MS;     // Per player
+
+static void build_config_descriptor(void) {
+#if N64_HID_REPORT_ID
+    build_report_descriptor();
+#endif
+
+    memcpy(config_descriptor, config_header, sizeof(config_header));
+    uint8_t *itf = config_descriptor + sizeof(config_header);
+
+    for (uint8_t port = 0; port < USB_HID_INSTANCES; port++) {
+        memcpy(itf, hid_interface_template, sizeof(hid_interface_template));
+
+        // Walk the interface's descriptors and patch the per-port fields
+        uint32_t pos = 0;
+        while (pos + 1 < sizeof(hid_interface_template)) {
+            uint8_t *desc = &itf[pos];
+            if (desc[1] == TUSB_DESC_INTERFACE) {
+                desc[2] = ITF_NUM_HID(port);            // bInterfaceNumber
+                desc[8] = STRID_INTERFACE + port;       // iInterface
+            } else if (desc[1] == TUSB_DESC_ENDPOINT) {
+                desc[2] = EPNUM_HID(port);              // bEndpointAddress
+                desc[6] = s_poll_interval_ms;           // bInterval
+            }
+            pos += desc[0];
+        }
+        itf += sizeof(hid_interface_template);
+    }
+
+#if N64_RAW_STREAM
+    memcpy(itf, hid_stream_interface, sizeof(hid_stream_interface));
+    itf += sizeof(hid_stream_interface);
+#endif
+#if N64_MSC
+    memcpy(itf, msc_interface, sizeof(msc_interface));
+    itf += sizeof(msc_interface);
+#endif
+#if N64_TPAK
+    memcpy(itf, tpak_interface, sizeof(tpak_interface));
+#endif
+
+    s_config_built = true;
+}
 
 //--------------------------------------------------------------------
 // String Descriptors
@@ -102,10 +237,39 @@ static const char *string_descriptors[] = {
     "N64-USB",                       // 1: Manufacturer
     "N64 Dual Controller Adapter",   // 2: Product
     "0003",                          // 3: Serial Number
-    "N64 Gamepad P1",                // 4: Interface 0 string
-    "N64 Gamepad P2",                // 5: Interface 1 string
+    // 4+: "N64 Gamepad P<n>", one per interface (generated)
+    //     or "N64 Gamepads" for the shared interface (Report ID mode)
+    //     then "N64 Joybus Stream" (raw stream interface)
+    //     then "N64 Controller Pak" (mass-storage interface)
+    //     then "N64 Transfer Pak" (vendor dump interface)
 };
 
+//--------------------------------------------------------------------
+// Public Functions
+//--------------------------------------------------------------------
+
+void usb_descriptors_set_poll_interval(uint8_t interval_ms) {
+#if N64_HID_REPORT_ID
+    // One endpoint carries every player's reports in turn
+    interval_ms /= MAX_CONTROLLERS;
+#endif
+    s_poll_interval_ms = (interval_ms == 0) ? 1 : interval_ms;
+#if N64_HID_REPORT_ID
+    s_report_interval_ms = (uint8_t)(s_poll_interval_ms * MAX_CONTROLLERS);
+#else
+    s_report_interval_ms = s_poll_interval_ms;
+#endif
+    build_config_descriptor();
+}
+
+uint8_t usb_descriptors_get_poll_interval(void) {
+    return s_poll_interval_ms;
+}
+
+uint8_t usb_descriptors_get_report_interval(void) {
+    return s_report_interval_ms;
+}
+
 //--------------------------------------------------------------------
 // TinyUSB Callbacks
 //--------------------------------------------------------------------
@@ -118,14 +282,27 @@ const uint8_t *tud_descriptor_device_cb(void) {
 // Invoked when host requests configuration descriptor
 const uint8_t *tud_descriptor_configuration_cb(uint8_t index) {
     (void)index;  // Only one configuration
+    if (!s_config_built) {
+        build_config_descriptor();
+    }
     return config_descriptor;
 }
 
 // Invoked when host requests HID report descriptor
-// Each instance gets the same single-gamepad descriptor (no Report IDs)
+// Each instance gets the same single-gamepad descriptor (no Report IDs),
+// or the shared instance gets one collection per player (Report ID mode)
 const uint8_t *tud_hid_descriptor_report_cb(uint8_t instance) {
-    (void)instance;
+    if (N64_RAW_STREAM && instance == USB_STREAM_INSTANCE) {
+        return hid_report_descriptor_stream;
+    }
+#if N64_HID_REPORT_ID
+    if (!s_config_built) {
+        build_config_descriptor();
+    }
+    return hid_report_descriptor_multi;
+#else
     return hid_report_descriptor_single;
+#endif
 }
 
 // Invoked when host requests string descriptor
@@ -139,11 +316,28 @@ const uint16_t *tud_descriptor_string_cb(uint8_t index, uint16_t langid) {
         memcpy(&str_desc[1], string_descriptors[0], 2);
         chr_count = 1;
     } else {
-        if (index >= sizeof(string_descriptors) / sizeof(string_descriptors[0])) {
+        const char *str;
+
+        if (N64_RAW_STREAM && index == STRID_STREAM) {
+            str = "N64 Joybus Stream";
+        } else if (N64_MSC && index == STRID_MSC) {
+            str = "N64 Controller Pak";
+        } else if (N64_TPAK && index == STRID_TPAK) {
+            str = "N64 Transfer Pak";
+        } else if (index >= STRID_INTERFACE && index < STRID_INTERFACE + USB_HID_INSTANCES) {
+#if N64_HID_REPORT_ID
+            str = "N64 Gamepads";
+#else
+            static char name[24];
+            snprintf(name, sizeof(name), "N64 Gamepad P%d", index - STRID_INTERFACE + 1);
+            str = name;
+#endif
+        } else if (index < sizeof(string_descriptors) / sizeof(string_descriptors[0])) {
+            str = string_descriptors[index];
+        } else {
             return NULL;
         }
 
-        const char *str = string_descriptors[index];
         chr_count = (uint8_t)strlen(str);
         if (chr_count > 31) {
             chr_count = 31;
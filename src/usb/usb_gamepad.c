@@ -1,11 +1,20 @@
 /*
  * USB HID Gamepad Implementation
- * Converts N64 controller state to USB HID gamepad report
- * Supports dual controllers via separate HID interfaces
+ * Converts device states to USB HID gamepad reports, one mapping per
+ * device type (selected by the type the driver's parser wrote)
+ * Supports dual controllers via separate HID interfaces, or one shared
+ * interface with a Report ID per player (N64_HID_REPORT_ID)
+ *
+ * Each instance caches the last report queued on its endpoint: identical
+ * reports are suppressed until the refresh interval elapses, and a report
+ * refused by a busy endpoint is kept (newer reports replace it) until
+ * usb_gamepad_flush() can queue it.
  */
 
 #include "usb_gamepad.h"
 #include "n64_protocol.h"
+#include "gc_protocol.h"
+#include "profiler.h"
 #include "tusb.h"
 #include <string.h>
 
@@ -32,10 +41,320 @@ static const uint8_t dpad_to_hat[16] = {
     HAT_CENTER       // 0b1111 - all (invalid, center)
 };
 
+//--------------------------------------------------------------------
+// Conversion Lookup Tables
+// Built once by usb_gamepad_init() from the per-bit mappings below,
+// indexed by the raw N64 byte
+//--------------------------------------------------------------------
+static uint16_t s_buttons0_lut[256];    // buttons0 -> USB button bits
+static uint16_t s_buttons1_lut[256];    // buttons1 -> USB button bits
+static uint8_t s_axis_x_lut[256];       // stick_x -> USB X
+static uint8_t s_axis_y_lut[256];       // stick_y -> USB Y (inverted)
+
+// GameCube: same idea, indexed by the parsed gc_state_t bytes
+static uint16_t s_gc_buttons0_lut[GC_MASK_BUTTONS0 + 1];
+static uint16_t s_gc_buttons1_lut[128];     // L, R, Z (D-Pad goes to the hat)
+static uint8_t s_gc_hat[16];
+static uint8_t s_gc_axis_x_lut[256];
+static uint8_t s_gc_axis_y_lut[256];
+
+//--------------------------------------------------------------------
+// Per-instance Report Cache
+//--------------------------------------------------------------------
+typedef struct {
+    usb_gamepad_report_t last;      // Last report queued on the endpoint
+    usb_gamepad_report_t pending;   // Report waiting for the endpoint
+    uint32_t last_ms;               // Time the last report was queued
+    bool valid;                     // last holds a report the host has
+    bool has_pending;
+    usb_report_stats_t stats;
+} report_cache_t;
+
+static report_cache_t s_cache[MAX_CONTROLLERS];
+static uint32_t s_refresh_ms;
+static uint8_t s_flush_next;            // Round-robin start of the next flush
+static usb_rumble_cb_t s_rumble_cb;
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+
+static bool queue_report(uint8_t instance, const usb_gamepad_report_t *report,
+                         uint32_t now_ms) {
+    if (!usb_gamepad_send_report(instance, report)) {
+        return false;
+    }
+
+    report_cache_t *cache = &s_cache[instance];
+    cache->last = *report;
+    cache->last_ms = now_ms;
+    cache->valid = true;
+    cache->stats.sent++;
+    return true;
+}
+
+// Controller port addressed by a control request (-1 if none)
+static int report_port(uint8_t instance, uint8_t report_id) {
+#if N64_HID_REPORT_ID
+    if (instance != 0 || report_id < HID_REPORT_ID(0) || report_id > HID_REPORT_ID(MAX_CONTROLLERS - 1)) {
+        return -1;
+    }
+    return report_id - HID_REPORT_ID(0);
+#else
+    (void)report_id;
+    return (instance < USB_HID_INSTANCES) ? instance : -1;
+#endif
+}
+
+// Host gone or asleep: no motor left running
+static void stop_rumble(void) {
+    static const usb_rumble_report_t off = {0};
+    if (s_rumble_cb == NULL) {
+        return;
+    }
+    for (uint8_t port = 0; port < MAX_CONTROLLERS; port++) {
+        s_rumble_cb(port, &off);
+    }
+}
+
+static uint16_t saturate_u16(uint32_t value) {
+    return (value > UINT16_MAX) ? UINT16_MAX : (uint16_t)value;
+}
+
+static void fill_latency_feature(uint8_t port, usb_latency_feature_t *feature) {
+    feature->version = USB_LATENCY_FEATURE_VERSION;
+    feature->port = port;
+    feature->stages = LATENCY_STAGES;
+
+    for (int stage = 0; stage < LATENCY_STAGES; stage++) {
+        latency_hist_t hist;
+        latency_stats_get(port, (latency_stage_t)stage, &hist);
+
+        usb_latency_stage_t *out = &feature->stage[stage];
+        out->count = hist.count;
+        out->p50_us = saturate_u16(latency_hist_percentile(&hist, 500));
+        out->p90_us = saturate_u16(latency_hist_percentile(&hist, 900));
+        out->p99_us = saturate_u16(latency_hist_percentile(&hist, 990));
+        out->max_us = saturate_u16(hist.max_us);
+    }
+}
+
+static void reset_caches(void) {
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        s_cache[i].valid = false;
+        s_cache[i].has_pending = false;
+    }
+}
+
+// Map buttons from byte 0 (A, B, Z, Start)
+static uint16_t map_buttons0(uint8_t buttons0) {
+    uint16_t buttons = 0;
+
+    if (buttons0 & N64_MASK_A) {
+        buttons |= USB_BTN_A;
+    }
+    if (buttons0 & N64_MASK_B) {
+        buttons |= USB_BTN_B;
+    }
+    if (buttons0 & N64_MASK_Z) {
+        buttons |= USB_BTN_Z;
+    }
+    if (buttons0 & N64_MASK_START) {
+        buttons |= USB_BTN_START;
+    }
+    return buttons;
+}
+
+// Map buttons from byte 1 (L, R, C-buttons as separate buttons)
+static uint16_t map_buttons1(uint8_t buttons1) {
+    uint16_t buttons = 0;
+
+    if (buttons1 & N64_MASK_L) {
+        buttons |= USB_BTN_L;
+    }
+    if (buttons1 & N64_MASK_R) {
+        buttons |= USB_BTN_R;
+    }
+
+    uint8_t c_buttons = buttons1 & N64_MASK_C;
+    if (c_buttons & N64_C_UP) {
+        buttons |= USB_BTN_C_UP;
+    }
+    if (c_buttons & N64_C_DOWN) {
+        buttons |= USB_BTN_C_DOWN;
+    }
+    if (c_buttons & N64_C_LEFT) {
+        buttons |= USB_BTN_C_LEFT;
+    }
+    if (c_buttons & N64_C_RIGHT) {
+        buttons |= USB_BTN_C_RIGHT;
+    }
+    return buttons;
+}
+
+// Map GameCube buttons from byte 0 (A, B, X, Y, Start)
+static uint16_t map_gc_buttons0(uint8_t buttons0) {
+    uint16_t buttons = 0;
+
+    if (buttons0 & GC_MASK_A) {
+        buttons |= USB_BTN_A;
+    }
+    if (buttons0 & GC_MASK_B) {
+        buttons |= USB_BTN_B;
+    }
+    if (buttons0 & GC_MASK_X) {
+        buttons |= USB_BTN_X;
+    }
+    if (buttons0 & GC_MASK_Y) {
+        buttons |= USB_BTN_Y;
+    }
+    if (buttons0 & GC_MASK_START) {
+        buttons |= USB_BTN_START;
+    }
+    return buttons;
+}
+
+// Map GameCube buttons from byte 1 (L, R, Z; the D-Pad is the hat)
+static uint16_t map_gc_buttons1(uint8_t buttons1) {
+    uint16_t buttons = 0;
+
+    if (buttons1 & GC_MASK_L) {
+        buttons |= USB_BTN_L;
+    }
+    if (buttons1 & GC_MASK_R) {
+        buttons |= USB_BTN_R;
+    }
+    if (buttons1 & GC_MASK_Z) {
+        buttons |= USB_BTN_Z;
+    }
+    return buttons;
+}
+
+// GameCube D-Pad bits in N64 order (Left and Right swapped)
+static uint8_t gc_dpad_to_n64(uint8_t dpad) {
+    uint8_t n64 = dpad & (GC_DPAD_UP | GC_DPAD_DOWN);
+    if (dpad & GC_DPAD_LEFT) {
+        n64 |= N64_DPAD_LEFT;
+    }
+    if (dpad & GC_DPAD_RIGHT) {
+        n64 |= N64_DPAD_RIGHT;
+    }
+    return n64;
+}
+
+// GameCube stick relative to its origin (-100 to +100) to USB HID range
+static uint8_t scale_gc_axis(int8_t gc_value) {
+    int16_t clamped = gc_value;
+    if (clamped > GC_STICK_MAX) {
+        clamped = GC_STICK_MAX;
+    }
+    if (clamped < -GC_STICK_MAX) {
+        clamped = -GC_STICK_MAX;
+    }
+    return (uint8_t)(((clamped + GC_STICK_MAX) * 255) / (GC_STICK_MAX * 2));
+}
+
+// C-stick past the threshold: the matching C button
+static uint16_t map_cstick(int8_t x, int8_t y) {
+    uint16_t buttons = 0;
+
+    if (x >= GC_CSTICK_THRESHOLD) {
+        buttons |= USB_BTN_C_RIGHT;
+    } else if (x <= -GC_CSTICK_THRESHOLD) {
+        buttons |= USB_BTN_C_LEFT;
+    }
+    if (y >= GC_CSTICK_THRESHOLD) {
+        buttons |= USB_BTN_C_UP;
+    } else if (y <= -GC_CSTICK_THRESHOLD) {
+        buttons |= USB_BTN_C_DOWN;
+    }
+    return buttons;
+}
+
+// Mouse motion since the previous poll, amplified onto the stick
+static uint8_t scale_mouse_axis(int8_t motion) {
+    int32_t value = motion * USB_MOUSE_GAIN;
+    if (value > N64_JOYSTICK_MAX) {
+        value = N64_JOYSTICK_MAX;
+    }
+    if (value < -N64_JOYSTICK_MAX) {
+        value = -N64_JOYSTICK_MAX;
+    }
+    return scale_n64_axis((int8_t)value);
+}
+
+//--------------------------------------------------------------------
+// Device Mappings (indexed by n64_device_type_t)
+//--------------------------------------------------------------------
+typedef void (*device_map_t)(const n64_device_state_t *state, usb_gamepad_report_t *usb);
+
+static void map_none(const n64_device_state_t *state, usb_gamepad_report_t *usb) {
+    (void)state;
+    usb_gamepad_init_neutral(usb);
+}
+
+static void map_controller(const n64_device_state_t *state, usb_gamepad_report_t *usb) {
+    n64_to_usb_report(&state->n64, usb);
+}
+
+static void map_mouse(const n64_device_state_t *state, usb_gamepad_report_t *usb) {
+    const n64_state_t *mouse = &state->n64;
+
+    usb->buttons = s_buttons0_lut[mouse->buttons0 & (N64_MASK_A | N64_MASK_B)];
+    usb->hat = HAT_CENTER;
+    usb->lx = scale_mouse_axis(mouse->stick_x);
+    usb->ly = 255 - scale_mouse_axis(mouse->stick_y);
+}
+
+static void map_gamecube(const n64_device_state_t *state, usb_gamepad_report_t *usb) {
+    const gc_state_t *gc = &state->gc;
+
+    usb->buttons = s_gc_buttons0_lut[gc->buttons0 & GC_MASK_BUTTONS0] |
+                   s_gc_buttons1_lut[gc->buttons1 & 0x7F] |
+                   map_cstick(gc->cstick_x, gc->cstick_y);
+    usb->hat = s_gc_hat[gc->buttons1 & GC_MASK_DPAD];
+    usb->lx = s_gc_axis_x_lut[(uint8_t)gc->stick_x];
+    usb->ly = s_gc_axis_y_lut[(uint8_t)gc->stick_y];
+}
+
+static const device_map_t s_device_map[N64_DEVICE_TYPES] = {
+    [N64_DEVICE_NONE] = map_none,
+    [N64_DEVICE_CONTROLLER] = map_controller,
+    [N64_DEVICE_MOUSE] = map_mouse,
+    [N64_DEVICE_GAMECUBE] = map_gamecube,
+};
+
 //--------------------------------------------------------------------
 // Public Functions
 //--------------------------------------------------------------------
 
+void usb_gamepad_init(uint32_t refresh_ms) {
+    s_refresh_ms = refresh_ms;
+    memset(s_cache, 0, sizeof(s_cache));
+
+    for (int i = 0; i < 256; i++) {
+        s_buttons0_lut[i] = map_buttons0((uint8_t)i);
+        s_buttons1_lut[i] = map_buttons1((uint8_t)i);
+
+        // Index is the raw axis byte: reinterpret as signed
+        s_axis_x_lut[i] = scale_n64_axis((int8_t)i);
+        s_axis_y_lut[i] = 255 - scale_n64_axis((int8_t)i);  // Invert Y (USB convention)
+
+        s_gc_axis_x_lut[i] = scale_gc_axis((int8_t)i);
+        s_gc_axis_y_lut[i] = 255 - scale_gc_axis((int8_t)i);
+    }
+
+    for (int i = 0; i < 128; i++) {
+        s_gc_buttons1_lut[i] = map_gc_buttons1((uint8_t)i);
+    }
+    for (int i = 0; i <= GC_MASK_BUTTONS0; i++) {
+        s_gc_buttons0_lut[i] = map_gc_buttons0((uint8_t)i);
+    }
+    for (int i = 0; i < 16; i++) {
+        s_gc_hat[i] = dpad_to_hat[gc_dpad_to_n64((uint8_t)i)];
+    }
+}
+
 uint8_t scale_n64_axis(int8_t n64_value) {
     // N64 typical range: -80 to +80
     // USB HID range: 0 to 255 (128 = center)
@@ -69,55 +388,87 @@ void usb_gamepad_init_neutral(usb_gamepad_report_t *usb) {
 }
 
 void n64_to_usb_report(const n64_state_t *n64, usb_gamepad_report_t *usb) {
-    // Clear buttons
-    usb->buttons = 0;
+    // Table lookups only: no per-bit branches, no clamp or divide
+    usb->buttons = s_buttons0_lut[n64->buttons0] | s_buttons1_lut[n64->buttons1];
+    usb->hat = dpad_to_hat[n64->buttons0 & N64_MASK_DPAD];
+    usb->lx = s_axis_x_lut[(uint8_t)n64->stick_x];
+    usb->ly = s_axis_y_lut[(uint8_t)n64->stick_y];
+}
 
-    // Map buttons from byte 0 (A, B, Z, Start)
-    if (n64->buttons0 & N64_MASK_A) {
-        usb->buttons |= USB_BTN_A;
-    }
-    if (n64->buttons0 & N64_MASK_B) {
-        usb->buttons |= USB_BTN_B;
-    }
-    if (n64->buttons0 & N64_MASK_Z) {
-        usb->buttons |= USB_BTN_Z;
-    }
-    if (n64->buttons0 & N64_MASK_START) {
-        usb->buttons |= USB_BTN_START;
-    }
+void device_to_usb_report(const n64_device_state_t *state, usb_gamepad_report_t *usb) {
+    PROFILE_SCOPE(PROF_USB_CONVERT);
 
-    // Map buttons from byte 1 (L, R, C-buttons)
-    if (n64->buttons1 & N64_MASK_L) {
-        usb->buttons |= USB_BTN_L;
-    }
-    if (n64->buttons1 & N64_MASK_R) {
-        usb->buttons |= USB_BTN_R;
-    }
+    uint8_t type = (state->type < N64_DEVICE_TYPES) ? state->type : N64_DEVICE_NONE;
+    s_device_map[type](state, usb);
+}
 
-    // Map C-buttons as separate buttons
-    uint8_t c_buttons = n64->buttons1 & N64_MASK_C;
-    if (c_buttons & N64_C_UP) {
-        usb->buttons |= USB_BTN_C_UP;
+usb_report_result_t usb_gamepad_submit_report(uint8_t instance,
+                                              const usb_gamepad_report_t *report,
+                                              uint32_t now_ms) {
+    if (instance >= MAX_CONTROLLERS) {
+        return USB_REPORT_SUPPRESSED;
     }
-    if (c_buttons & N64_C_DOWN) {
-        usb->buttons |= USB_BTN_C_DOWN;
+    report_cache_t *cache = &s_cache[instance];
+
+    // A newer report supersedes the one still waiting for the endpoint
+    if (cache->has_pending) {
+        cache->has_pending = false;
+        cache->stats.coalesced++;
     }
-    if (c_buttons & N64_C_LEFT) {
-        usb->buttons |= USB_BTN_C_LEFT;
+
+    // Host already has this state and the keep-alive is not due
+    bool unchanged = cache->valid &&
+                     memcmp(report, &cache->last, sizeof(*report)) == 0;
+    if (unchanged && s_refresh_ms != 0 && now_ms - cache->last_ms < s_refresh_ms) {
+        cache->stats.suppressed++;
+        return USB_REPORT_SUPPRESSED;
     }
-    if (c_buttons & N64_C_RIGHT) {
-        usb->buttons |= USB_BTN_C_RIGHT;
+
+    if (queue_report(instance, report, now_ms)) {
+        return USB_REPORT_SENT;
     }
 
-    // Map D-Pad to hat switch
-    usb->hat = map_dpad_to_hat(n64->buttons0 & N64_MASK_DPAD);
+    cache->pending = *report;
+    cache->has_pending = true;
+    return USB_REPORT_PENDING;
+}
+
+uint32_t usb_gamepad_flush(uint32_t now_ms) {
+    uint32_t flushed = 0;
 
-    // Map analog stick (invert Y axis for standard USB convention)
-    usb->lx = scale_n64_axis(n64->stick_x);
-    usb->ly = 255 - scale_n64_axis(n64->stick_y);  // Invert Y
+    // Rotate the first port: with a shared endpoint (Report ID mode) only
+    // one report fits per host read, every player gets its turn
+    for (int n = 0; n < MAX_CONTROLLERS; n++) {
+        uint8_t i = (uint8_t)((s_flush_next + n) % MAX_CONTROLLERS);
+        report_cache_t *cache = &s_cache[i];
+        if (cache->has_pending && queue_report(i, &cache->pending, now_ms)) {
+            cache->has_pending = false;
+            flushed |= 1u << i;
+            s_flush_next = (uint8_t)((i + 1) % MAX_CONTROLLERS);
+        }
+    }
+    return flushed;
+}
+
+void usb_gamepad_get_report_stats(uint8_t instance, usb_report_stats_t *stats) {
+    if (instance >= MAX_CONTROLLERS) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    *stats = s_cache[instance].stats;
+    memset(&s_cache[instance].stats, 0, sizeof(s_cache[instance].stats));
 }
 
 bool usb_gamepad_send_report(uint8_t instance, const usb_gamepad_report_t *report) {
+    PROFILE_SCOPE(PROF_USB_SEND);
+
+#if N64_HID_REPORT_ID
+    // Every player shares HID instance 0, the Report ID selects the player
+    if (!tud_hid_n_ready(0)) {
+        return false;
+    }
+    return tud_hid_n_report(0, HID_REPORT_ID(instance), report, sizeof(usb_gamepad_report_t));
+#else
     // Only send if this HID instance is ready
     if (!tud_hid_n_ready(instance)) {
         return false;
@@ -125,6 +476,29 @@ bool usb_gamepad_send_report(uint8_t instance, const usb_gamepad_report_t *repor
 
     // Send HID report on specific instance (report_id=0, no Report ID prefix)
     return tud_hid_n_report(instance, 0, report, sizeof(usb_gamepad_report_t));
+#endif
+}
+
+void usb_gamepad_set_rumble_cb(usb_rumble_cb_t cb) {
+    s_rumble_cb = cb;
+}
+
+//--------------------------------------------------------------------
+// TinyUSB Device Callbacks
+//--------------------------------------------------------------------
+
+// Invoked when the device is configured: the host has no report yet
+void tud_mount_cb(void) {
+    reset_caches();
+}
+
+void tud_umount_cb(void) {
+    stop_rumble();
+}
+
+void tud_suspend_cb(bool remote_wakeup_en) {
+    (void)remote_wakeup_en;
+    stop_rumble();
 }
 
 //--------------------------------------------------------------------
@@ -132,17 +506,20 @@ bool usb_gamepad_send_report(uint8_t instance, const usb_gamepad_report_t *repor
 //--------------------------------------------------------------------
 
 // Invoked when received GET_REPORT control request
+// Feature report: latency statistics of the addressed port
 uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id,
                                 hid_report_type_t report_type,
                                 uint8_t *buffer, uint16_t reqlen) {
-    (void)instance;
-    (void)report_id;
-    (void)report_type;
-    (void)buffer;
-    (void)reqlen;
+    int port = report_port(instance, report_id);
+    if (report_type != HID_REPORT_TYPE_FEATURE || port < 0 ||
+        reqlen < sizeof(usb_latency_feature_t)) {
+        return 0;
+    }
 
-    // Not used for gamepad
-    return 0;
+    usb_latency_feature_t feature;
+    fill_latency_feature((uint8_t)port, &feature);
+    memcpy(buffer, &feature, sizeof(feature));
+    return sizeof(feature);
 }
 
 // Invoked when received SET_REPORT control request or
@@ -150,11 +527,17 @@ uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id,
 void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id,
                            hid_report_type_t report_type,
                            uint8_t const *buffer, uint16_t bufsize) {
-    (void)instance;
-    (void)report_id;
-    (void)report_type;
-    (void)buffer;
-    (void)bufsize;
+    // SET_FEATURE on the latency report clears the port's histograms
+    int port = report_port(instance, report_id);
+    if (report_type == HID_REPORT_TYPE_FEATURE && port >= 0) {
+        latency_stats_reset((uint8_t)port);
+    }
 
-    // Could be used for rumble in the future
+    // Output report: rumble command, handed over without waiting
+    if (report_type == HID_REPORT_TYPE_OUTPUT && port >= 0 && s_rumble_cb != NULL &&
+        bufsize >= sizeof(usb_rumble_report_t)) {
+        usb_rumble_report_t report;
+        memcpy(&report, buffer, sizeof(report));
+        s_rumble_cb((uint8_t)port, &report);
+    }
 }
@@ -0,0 +1,317 @@
+/*
+ * Controller Pak USB Drive Implementation
+ * TinyUSB mass-storage callbacks. A sector that is not cached yet is
+ * answered with 0 bytes: TinyUSB calls again later, so USB keeps running
+ * while the polling core reads the line from the pak.
+ */
+
+#include "usb_pak_drive.h"
+#include "usb_descriptors.h"
+#include "tusb.h"
+#include <stdio.h>
+#include <string.h>
+
+#if N64_MSC
+
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+#define SCSI_CMD_SYNCHRONIZE_CACHE_10   0x35
+#define FAT_DATE_2000_01_01             ((20 << 9) | (1 << 5) | 1)
+
+// Medium seen by the host, per logical unit (= port)
+typedef struct {
+    uint16_t medium;            // Cache medium counter last reported
+    bool ejected;               // Host ejected the volume (until a new pak)
+    bool changed;               // UNIT ATTENTION still to be reported
+} pak_lun_t;
+
+static n64_pak_cache_t *s_cache;
+static pak_lun_t s_luns[MAX_CONTROLLERS];
+static uint8_t s_sector[PAK_DRIVE_SECTOR_SIZE];    // Generated or partial sectors
+
+//--------------------------------------------------------------------
+// Private Functions - Volume
+//--------------------------------------------------------------------
+
+static void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void volume_label(uint8_t lun, uint8_t label[11]) {
+    memcpy(label, "N64 PAK P1 ", 11);
+    label[9] = (uint8_t)('1' + lun);
+}
+
+static void build_boot_sector(uint8_t lun, uint8_t *s) {
+    s[0] = 0xEB;                                // Jump, NOP
+    s[1] = 0x3C;
+    s[2] = 0x90;
+    memcpy(&s[3], "MSDOS5.0", 8);               // OEM name
+    put16(&s[11], PAK_DRIVE_SECTOR_SIZE);       // Bytes per sector
+    s[13] = 1;                                  // Sectors per cluster
+    put16(&s[14], 1);                           // Reserved sectors (this one)
+    s[16] = 1;                                  // FAT copies
+    put16(&s[17], PAK_DRIVE_ROOT_ENTRIES);
+    put16(&s[19], PAK_DRIVE_SECTORS);
+    s[21] = 0xF8;                               // Media descriptor (fixed disk)
+    put16(&s[22], 1);                           // Sectors per FAT
+    put16(&s[24], 1);                           // Sectors per track
+    put16(&s[26], 1);                           // Heads
+    s[36] = 0x80;                               // Drive number
+    s[38] = 0x29;                               // Extended boot signature
+
+    // Serial number changes with the pak: the host rereads the volume
+    put32(&s[39], 0x6E340000u | ((uint32_t)lun << 12) | (s_luns[lun].medium & 0x0FFF));
+    volume_label(lun, &s[43]);
+    memcpy(&s[54], "FAT12   ", 8);
+    s[510] = 0x55;
+    s[511] = 0xAA;
+}
+
+static void set_fat_entry(uint8_t *fat, uint cluster, uint16_t value) {
+    uint8_t *p = &fat[cluster * 3 / 2];
+    if (cluster & 1) {
+        p[0] = (uint8_t)((p[0] & 0x0F) | (value << 4));
+        p[1] = (uint8_t)(value >> 4);
+    } else {
+        p[0] = (uint8_t)value;
+        p[1] = (uint8_t)((p[1] & 0xF0) | (value >> 8));
+    }
+}
+
+// One chain: clusters 2 .. 2 + N64_PAK_CACHE_PAK_LINES - 1
+static void build_fat(uint8_t *s) {
+    set_fat_entry(s, 0, 0xFF8);
+    set_fat_entry(s, 1, 0xFFF);
+    uint last = 2 + N64_PAK_CACHE_PAK_LINES - 1;
+    for (uint cluster = 2; cluster < last; cluster++) {
+        set_fat_entry(s, cluster, (uint16_t)(cluster + 1));
+    }
+    set_fat_entry(s, last, 0xFFF);
+}
+
+static void build_root_dir(uint8_t lun, uint8_t *s) {
+    // Volume label entry
+    volume_label(lun, &s[0]);
+    s[11] = 0x08;
+    put16(&s[24], FAT_DATE_2000_01_01);
+
+    // PAK<n>.MPK, archive attribute
+    uint8_t *file = &s[32];
+    memcpy(&file[0], "PAK1    MPK", 11);
+    file[3] = (uint8_t)('1' + lun);
+    file[11] = 0x20;
+    put16(&file[16], FAT_DATE_2000_01_01);      // Creation date
+    put16(&file[18], FAT_DATE_2000_01_01);      // Access date
+    put16(&file[24], FAT_DATE_2000_01_01);      // Write date
+    put16(&file[26], 2);                        // First cluster
+    put32(&file[28], N64_PAK_SIZE);
+}
+
+static void build_sector(uint8_t lun, uint32_t lba, uint8_t *s) {
+    memset(s, 0, PAK_DRIVE_SECTOR_SIZE);
+    switch (lba) {
+        case PAK_DRIVE_BOOT_SECTOR:
+            build_boot_sector(lun, s);
+            break;
+        case PAK_DRIVE_FAT_SECTOR:
+            build_fat(s);
+            break;
+        case PAK_DRIVE_ROOT_SECTOR:
+            build_root_dir(lun, s);
+            break;
+    }
+}
+
+//--------------------------------------------------------------------
+// Private Functions - Medium State
+//--------------------------------------------------------------------
+
+// false with the sense data set when the command must not go ahead
+static bool medium_ready(uint8_t lun) {
+    pak_lun_t *l = &s_luns[lun];
+    uint16_t medium;
+    bool present = n64_pak_cache_present(s_cache, lun, &medium);
+
+    if (present && medium != l->medium) {
+        l->medium = medium;
+        l->ejected = false;
+        l->changed = true;
+    }
+    if (!present || l->ejected) {
+        tud_msc_set_sense(lun, SCSI_SENSE_NOT_READY, 0x3A, 0x00);      // Medium not present
+        return false;
+    }
+    if (l->changed) {
+        l->changed = false;
+        tud_msc_set_sense(lun, SCSI_SENSE_UNIT_ATTENTION, 0x28, 0x00); // Medium may have changed
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------
+// Public Functions
+//--------------------------------------------------------------------
+
+void usb_pak_drive_init(n64_pak_cache_t *cache) {
+    s_cache = cache;
+    memset(s_luns, 0, sizeof(s_luns));
+}
+
+//--------------------------------------------------------------------
+// TinyUSB MSC Callbacks
+//--------------------------------------------------------------------
+
+// Number of logical units (one per controller port)
+uint8_t tud_msc_get_maxlun_cb(void) {
+    return MAX_CONTROLLERS;
+}
+
+void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16],
+                        uint8_t product_rev[4]) {
+    // Room for any LUN number; the SCSI field keeps the first 16 characters
+    char product[sizeof("Controller Pak 256")];
+    int len = snprintf(product, sizeof(product), "Controller Pak %u", lun + 1u);
+    if (len < 0) {
+        len = 0;
+    } else if (len > 16) {
+        len = 16;
+    }
+    memcpy(vendor_id, "N64-USB ", 8);
+    memset(product_id, ' ', 16);
+    memcpy(product_id, product, (size_t)len);
+    memcpy(product_rev, "1.0 ", 4);
+}
+
+bool tud_msc_test_unit_ready_cb(uint8_t lun) {
+    return lun < MAX_CONTROLLERS && medium_ready(lun);
+}
+
+void tud_msc_capacity_cb(uint8_t lun, uint32_t *block_count, uint16_t *block_size) {
+    // Zero = not ready, with the sense set by medium_ready()
+    bool ready = lun < MAX_CONTROLLERS && medium_ready(lun);
+    *block_count = ready ? PAK_DRIVE_SECTORS : 0;
+    *block_size = ready ? PAK_DRIVE_SECTOR_SIZE : 0;
+}
+
+// Eject writes the cached sectors back right away; the volume stays
+// "not present" until a pak is inserted again or the host loads it
+bool tud_msc_start_stop_cb(uint8_t lun, uint8_t power_condition, bool start, bool load_eject) {
+    (void)power_condition;
+    if (lun >= MAX_CONTROLLERS || !load_eject) {
+        return true;
+    }
+    if (start) {
+        s_luns[lun].ejected = false;
+    } else {
+        n64_pak_cache_flush(s_cache, lun);
+        s_luns[lun].ejected = true;
+    }
+    return true;
+}
+
+int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void *buffer,
+                          uint32_t bufsize) {
+    if (lun >= MAX_CONTROLLERS || lba >= PAK_DRIVE_SECTORS) {
+        tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x21, 0x00);    // LBA out of range
+        return -1;
+    }
+    if (!medium_ready(lun)) {
+        return -1;
+    }
+
+    // One sector per call (TinyUSB calls again for the rest)
+    uint32_t len = PAK_DRIVE_SECTOR_SIZE - offset;
+    if (len > bufsize) {
+        len = bufsize;
+    }
+
+    if (lba < PAK_DRIVE_DATA_SECTOR) {
+        build_sector(lun, lba, s_sector);
+    } else {
+        uint8_t *dst = (offset == 0 && len == PAK_DRIVE_SECTOR_SIZE) ? buffer : s_sector;
+        switch (n64_pak_cache_read(s_cache, lun, lba - PAK_DRIVE_DATA_SECTOR, dst)) {
+            case N64_PAK_CACHE_OK:
+                if (dst == buffer) {
+                    return (int32_t)len;
+                }
+                break;
+            case N64_PAK_CACHE_BUSY:
+                return 0;
+            case N64_PAK_CACHE_NO_MEDIUM:
+                tud_msc_set_sense(lun, SCSI_SENSE_NOT_READY, 0x3A, 0x00);
+                return -1;
+        }
+    }
+    memcpy(buffer, &s_sector[offset], len);
+    return (int32_t)len;
+}
+
+bool tud_msc_is_writable_cb(uint8_t lun) {
+    (void)lun;
+    return true;
+}
+
+int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t *buffer,
+                           uint32_t bufsize) {
+    if (lun >= MAX_CONTROLLERS || lba >= PAK_DRIVE_SECTORS) {
+        tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x21, 0x00);
+        return -1;
+    }
+    if (!medium_ready(lun)) {
+        return -1;
+    }
+
+    // The endpoint buffer holds a whole sector (CFG_TUD_MSC_EP_BUFSIZE)
+    if (offset != 0 || bufsize < PAK_DRIVE_SECTOR_SIZE) {
+        tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x24, 0x00);    // Invalid field in CDB
+        return -1;
+    }
+
+    // Boot sector, FAT and directory are fixed: accepted and ignored
+    if (lba < PAK_DRIVE_DATA_SECTOR) {
+        return PAK_DRIVE_SECTOR_SIZE;
+    }
+    switch (n64_pak_cache_write(s_cache, lun, lba - PAK_DRIVE_DATA_SECTOR, buffer)) {
+        case N64_PAK_CACHE_OK:
+            return PAK_DRIVE_SECTOR_SIZE;
+        case N64_PAK_CACHE_BUSY:
+            return 0;
+        case N64_PAK_CACHE_NO_MEDIUM:
+        default:
+            tud_msc_set_sense(lun, SCSI_SENSE_NOT_READY, 0x3A, 0x00);
+            return -1;
+    }
+}
+
+// SCSI commands not handled by TinyUSB itself
+int32_t tud_msc_scsi_cb(uint8_t lun, uint8_t const scsi_cmd[16], void *buffer,
+                        uint16_t bufsize) {
+    (void)buffer;
+    (void)bufsize;
+
+    switch (scsi_cmd[0]) {
+        case SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL:
+            return 0;
+
+        case SCSI_CMD_SYNCHRONIZE_CACHE_10:
+            if (lun < MAX_CONTROLLERS) {
+                n64_pak_cache_flush(s_cache, lun);
+            }
+            return 0;
+
+        default:
+            tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x20, 0x00);    // Invalid command
+            return -1;
+    }
+}
+
+#endif /* N64_MSC */
@@ -0,0 +1,78 @@
+/*
+ * Raw Joybus Stream Implementation
+ * Poll results are queued in a ring (core0 only) and packed by up to
+ * RAW_STREAM_FRAMES_PER_REPORT into the next report as soon as the stream
+ * endpoint is free. Sequence numbers come from the polling core, so a frame
+ * dropped because the ring is full, or a result overwritten in the dual-core
+ * handoff before core0 read it, both show up as a gap on the host.
+ */
+
+#include "usb_raw_stream.h"
+#include "usb_descriptors.h"
+#include "tusb.h"
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+#define RAW_STREAM_QUEUE_SIZE   64      // Frames (power of two)
+
+static raw_stream_frame_t s_queue[RAW_STREAM_QUEUE_SIZE];
+static uint32_t s_head = 0;             // Next frame to write
+static uint32_t s_tail = 0;             // Next frame to send
+static usb_raw_stream_stats_t s_stats;
+
+//--------------------------------------------------------------------
+// Public Functions
+//--------------------------------------------------------------------
+
+void usb_raw_stream_push(uint8_t port, const n64_device_state_t *state, bool responding,
+                         uint32_t sample_us, uint16_t seq) {
+    if (s_head - s_tail >= RAW_STREAM_QUEUE_SIZE) {
+        s_stats.dropped++;
+        return;
+    }
+
+    raw_stream_frame_t *frame = &s_queue[s_head % RAW_STREAM_QUEUE_SIZE];
+    frame->timestamp_us = sample_us;
+    frame->seq = seq;
+    frame->port = port;
+    frame->flags = (uint8_t)((responding ? RAW_FRAME_RESPONDING : 0) |
+                             ((state->type << RAW_FRAME_DEVICE_SHIFT) & RAW_FRAME_DEVICE_MASK));
+    frame->state = state->n64;
+    s_head++;
+}
+
+bool usb_raw_stream_task(void) {
+#if N64_RAW_STREAM
+    if (s_head == s_tail || !tud_hid_n_ready(USB_STREAM_INSTANCE)) {
+        return false;
+    }
+
+    raw_stream_report_t report;
+    memset(&report, 0, sizeof(report));
+    report.magic = RAW_STREAM_MAGIC;
+
+    uint32_t tail = s_tail;
+    while (tail != s_head && report.count < RAW_STREAM_FRAMES_PER_REPORT) {
+        report.frames[report.count++] = s_queue[tail % RAW_STREAM_QUEUE_SIZE];
+        tail++;
+    }
+
+    if (!tud_hid_n_report(USB_STREAM_INSTANCE, 0, &report, sizeof(report))) {
+        return false;
+    }
+
+    s_tail = tail;
+    s_stats.frames += report.count;
+    s_stats.reports++;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void usb_raw_stream_get_stats(usb_raw_stream_stats_t *stats) {
+    *stats = s_stats;
+    memset(&s_stats, 0, sizeof(s_stats));
+}
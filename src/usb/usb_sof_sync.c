@@ -0,0 +1,266 @@
+/*
+ * USB SOF Synchronisation Implementation
+ *
+ * TinyUSB runs tud_sof_cb() and tud_hid_report_complete_cb() from tud_task(),
+ * so their timestamps are late by the task latency. That latency is always
+ * positive: the earliest timestamp of a window is the best estimate of the
+ * real event. The SOF phase is re-estimated that way every
+ * SOF_SYNC_PHASE_WINDOW frames (following the host clock drift), and the
+ * host read slot of each endpoint every SOF_SYNC_SLOT_WINDOW reads.
+ */
+
+#include "usb_sof_sync.h"
+#include "latency_stats.h"
+#include "pico/stdlib.h"
+#include "tusb.h"
+
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+#define SOF_FRAME_MASK      0x7FF       // 11-bit USB frame number
+
+// Sync state targeted by the TinyUSB callbacks
+static usb_sof_sync_t *s_sync = NULL;
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+
+static void reset_phase(usb_sof_sync_t *sync) {
+    sync->phase_valid = false;
+    sync->window_min_err = INT32_MAX;
+    sync->window_count = 0;
+}
+
+static void reset_age(usb_sof_age_t *age) {
+    age->count = 0;
+    age->sum_us = 0;
+    age->max_us = 0;
+}
+
+//--------------------------------------------------------------------
+// Public Functions
+//--------------------------------------------------------------------
+
+void usb_sof_sync_init(usb_sof_sync_t *sync, uint8_t interval_frames, bool track_sof) {
+    sync->interval_frames = interval_frames ? interval_frames : 1;
+    sync->sof_enabled = track_sof;
+    sync->sof_us = 0;
+    sync->last_frame = 0;
+    sync->last_sof_us = 0;
+    sync->cycle_anchor_us = 0;
+    sync->ready_us = SOF_SYNC_LEAD_INIT_US;
+    sync->lead_us = SOF_SYNC_LEAD_INIT_US + SOF_SYNC_GUARD_US;
+    reset_phase(sync);
+
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        usb_sof_endpoint_t *ep = &sync->endpoints[i];
+        ep->slot = -1;
+        ep->window_count = 0;
+        ep->window_min = UINT32_MAX;
+        ep->queued = false;
+        ep->queued_sample_us = 0;
+        reset_age(&ep->age);
+    }
+
+    s_sync = sync;
+    if (track_sof) {
+        tud_sof_cb_enable(true);
+    }
+}
+
+void usb_sof_sync_report_queued(usb_sof_sync_t *sync, uint8_t instance,
+                                uint32_t sample_us) {
+    if (instance >= MAX_CONTROLLERS) {
+        return;
+    }
+    sync->endpoints[instance].queued_sample_us = sample_us;
+    sync->endpoints[instance].queued_us = time_us_32();
+    sync->endpoints[instance].queued = true;
+}
+
+void usb_sof_sync_record_ready(usb_sof_sync_t *sync, uint32_t duration_us) {
+    // Stale cycle start (USB core fell behind a whole host cycle): ignore
+    if (duration_us > (uint32_t)sync->interval_frames * SOF_SYNC_FRAME_US) {
+        return;
+    }
+
+    uint32_t ready = sync->ready_us;
+    if (duration_us > ready) {
+        ready += (duration_us - ready + 1) / 2;
+    } else {
+        ready -= (ready - duration_us) >> 4;
+    }
+    sync->ready_us = ready;
+    sync->lead_us = ready + SOF_SYNC_GUARD_US;
+}
+
+bool usb_sof_sync_locked(const usb_sof_sync_t *sync) {
+    return sync->phase_valid &&
+           (time_us_32() - sync->last_sof_us) < SOF_SYNC_TIMEOUT_US;
+}
+
+bool usb_sof_sync_next_poll(const usb_sof_sync_t *sync, uint32_t instance_mask,
+                            uint32_t after_us, uint32_t *start_us) {
+    if (!usb_sof_sync_locked(sync)) {
+        return false;
+    }
+
+    uint32_t cycle_us = (uint32_t)sync->interval_frames * SOF_SYNC_FRAME_US;
+    uint32_t anchor = sync->cycle_anchor_us;
+    uint32_t lead = sync->lead_us;
+    bool found = false;
+    uint32_t best = 0;
+
+    for (int i = 0; i < MAX_CONTROLLERS; i++) {
+        int8_t slot = sync->endpoints[i].slot;
+        if (!(instance_mask & (1u << i)) || slot < 0) {
+            continue;
+        }
+
+        // Move the host read onto the first cycle whose start is >= after_us
+        uint32_t start = anchor + (uint32_t)slot * SOF_SYNC_FRAME_US - lead;
+        int32_t ahead = (int32_t)(start - after_us);
+        if (ahead < 0) {
+            start += ((uint32_t)(-ahead) + cycle_us - 1) / cycle_us * cycle_us;
+        } else {
+            start -= (uint32_t)ahead / cycle_us * cycle_us;
+        }
+
+        // Several endpoints: serve the earliest host read first
+        if (!found || (int32_t)(start - best) < 0) {
+            best = start;
+            found = true;
+        }
+    }
+
+    if (found) {
+        *start_us = best;
+    }
+    return found;
+}
+
+void usb_sof_sync_get_age(usb_sof_sync_t *sync, uint8_t instance, usb_sof_age_t *age) {
+    if (instance >= MAX_CONTROLLERS) {
+        reset_age(age);
+        return;
+    }
+    *age = sync->endpoints[instance].age;
+    reset_age(&sync->endpoints[instance].age);
+}
+
+//--------------------------------------------------------------------
+// TinyUSB Callbacks (run from tud_task on the USB core)
+//--------------------------------------------------------------------
+
+// Start Of Frame (enabled with tud_sof_cb_enable)
+void tud_sof_cb(uint32_t frame_count) {
+    usb_sof_sync_t *sync = s_sync;
+    if (sync == NULL) {
+        return;
+    }
+
+    uint32_t now = time_us_32();
+    uint32_t frame = frame_count & SOF_FRAME_MASK;
+    bool resync = (now - sync->last_sof_us) >= SOF_SYNC_TIMEOUT_US;
+    sync->last_sof_us = now;
+
+    if (!resync) {
+        // Advance the estimate by the frames elapsed since the last callback
+        sync->sof_us += ((frame - sync->last_frame) & SOF_FRAME_MASK) * SOF_SYNC_FRAME_US;
+        int32_t err = (int32_t)(now - sync->sof_us);
+
+        // Callback earlier than a whole frame before the estimate: lost track
+        resync = err < -SOF_SYNC_FRAME_US;
+        if (!resync && err < sync->window_min_err) {
+            sync->window_min_err = err;
+        }
+    }
+    sync->last_frame = frame;
+
+    if (resync) {
+        // First SOF after reset/suspend: seed the estimate, wait for a window
+        reset_phase(sync);
+        sync->sof_us = now;
+        return;
+    }
+
+    if (++sync->window_count >= SOF_SYNC_PHASE_WINDOW) {
+        sync->sof_us += sync->window_min_err;
+        sync->window_min_err = INT32_MAX;
+        sync->window_count = 0;
+        sync->phase_valid = true;
+    }
+
+    sync->cycle_anchor_us = sync->sof_us -
+                            (frame % sync->interval_frames) * SOF_SYNC_FRAME_US;
+}
+
+// Report read by the host
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint16_t len) {
+    usb_sof_sync_t *sync = s_sync;
+    if (instance >= USB_HID_INSTANCES) {
+        return;     // Not a gamepad endpoint (raw stream)
+    }
+#if N64_HID_REPORT_ID
+    // Shared endpoint: the Report ID (first byte) tells which port was read
+    if (sync == NULL || len == 0) {
+        return;
+    }
+    uint8_t port = (uint8_t)(report[0] - HID_REPORT_ID(0));
+#else
+    (void)report;
+    (void)len;
+    uint8_t port = instance;
+#endif
+    if (sync == NULL || port >= MAX_CONTROLLERS) {
+        return;
+    }
+
+    uint32_t now = time_us_32();
+    usb_sof_endpoint_t *ep = &sync->endpoints[port];
+
+    // Input age seen by the host (upper bound: includes the task latency)
+    if (ep->queued) {
+        ep->queued = false;
+        uint32_t age_us = now - ep->queued_sample_us;
+        ep->age.count++;
+        ep->age.sum_us += age_us;
+        if (age_us > ep->age.max_us) {
+            ep->age.max_us = age_us;
+        }
+
+        // Read time: with the SOF phase tracked, the start of the current
+        // frame is a tighter estimate than the (deferred) callback time
+        uint32_t read_us = now;
+        int32_t since_sof = (int32_t)(now - sync->sof_us);
+        if (sync->sof_enabled && sync->phase_valid && since_sof >= 0) {
+            uint32_t frame_us = sync->sof_us +
+                                (uint32_t)since_sof / SOF_SYNC_FRAME_US * SOF_SYNC_FRAME_US;
+            if ((int32_t)(frame_us - ep->queued_us) > 0) {
+                read_us = frame_us;
+            }
+        }
+        latency_stats_record(port, LATENCY_HOST, read_us - ep->queued_us);
+        latency_stats_record(port, LATENCY_TOTAL, read_us - ep->queued_sample_us);
+    }
+
+    if (!sync->sof_enabled || !sync->phase_valid) {
+        return;
+    }
+
+    // Position of the read within the host poll cycle. The bias keeps reads
+    // landing just before a slightly late phase estimate in the right frame.
+    int32_t cycle_us = (int32_t)sync->interval_frames * SOF_SYNC_FRAME_US;
+    int32_t offset = (int32_t)(now - sync->cycle_anchor_us) + SOF_SYNC_SLOT_BIAS_US;
+    offset = ((offset % cycle_us) + cycle_us) % cycle_us;
+
+    if ((uint32_t)offset < ep->window_min) {
+        ep->window_min = (uint32_t)offset;
+    }
+    if (++ep->window_count >= SOF_SYNC_SLOT_WINDOW) {
+        ep->slot = (int8_t)(ep->window_min / SOF_SYNC_FRAME_US);
+        ep->window_min = UINT32_MAX;
+        ep->window_count = 0;
+    }
+}
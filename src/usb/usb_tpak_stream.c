@@ -0,0 +1,220 @@
+/*
+ * Transfer Pak Dump Stream Implementation
+ * One request at a time: response header, data, trailer, each written to
+ * the vendor TX FIFO only when it fits, so the task never waits on USB.
+ * A chunk is handed back to the polling core as soon as it is copied into
+ * the FIFO, and the FIFO holds a whole chunk: the next cartridge read runs
+ * while the previous chunk is still going out on the bus.
+ */
+
+#include "usb_tpak_stream.h"
+#include "usb_descriptors.h"
+#include "n64_tpak.h"
+#include "tusb.h"
+#include <string.h>
+
+#if N64_TPAK
+
+_Static_assert(TPAK_CMD_ROM == N64_TPAK_ROM && TPAK_CMD_SRAM == N64_TPAK_SRAM &&
+               TPAK_CMD_HEADER == N64_TPAK_HEADER, "stream commands are dump targets");
+
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+typedef enum {
+    STREAM_IDLE,
+    STREAM_WAIT_CART,           // Dump started, header not read yet
+    STREAM_DATA,                // Sending `length` bytes
+    STREAM_TRAILER,             // Data sent, dump finishing
+    STREAM_ABORTING             // Host gone: wait for the dump to stop
+} stream_state_t;
+
+static n64_tpak_t *s_tpak;
+static stream_state_t s_state = STREAM_IDLE;
+static tpak_request_t s_request;
+static uint8_t s_status;                // Rejected request: status to report
+static uint32_t s_length;               // Data bytes announced
+static uint32_t s_sent;
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+
+// Whole packet into the FIFO, or nothing
+static bool send(const void *data, uint32_t len) {
+    if (tud_vendor_write_available() < len) {
+        return false;
+    }
+    tud_vendor_write(data, len);
+    tud_vendor_write_flush();
+    return true;
+}
+
+static bool send_response(void) {
+    tpak_response_t response;
+    memset(&response, 0, sizeof(response));
+    memcpy(response.magic, TPAK_RESPONSE_MAGIC, 2);
+    response.version = TPAK_STREAM_VERSION;
+    response.port = s_request.port;
+    response.command = s_request.command;
+
+    if (s_status != N64_TPAK_OK) {
+        response.status = s_status;
+    } else if (!s_tpak->cart_ready) {
+        response.status = (uint8_t)s_tpak->error;
+    } else {
+        const n64_tpak_cart_t *cart = &s_tpak->cart;
+        response.checksum_ok = cart->checksum_ok;
+        response.length = s_tpak->total;
+        response.rom_size = cart->rom_size;
+        response.ram_size = cart->ram_size;
+        memcpy(response.gb_header, &cart->header[TPAK_GB_HEADER_START - GB_HEADER_ADDRESS],
+               TPAK_GB_HEADER_LEN);
+    }
+    if (!send(&response, sizeof(response))) {
+        return false;
+    }
+    s_length = response.length;
+    s_sent = 0;
+    return true;
+}
+
+static bool send_trailer(void) {
+    tpak_trailer_t trailer;
+    memset(&trailer, 0, sizeof(trailer));
+    memcpy(trailer.magic, TPAK_TRAILER_MAGIC, 2);
+    trailer.version = TPAK_STREAM_VERSION;
+    trailer.status = s_status;
+
+    if (s_status == N64_TPAK_OK) {
+        const n64_tpak_t *t = s_tpak;
+        uint32_t elapsed_us = t->start_us ? (uint32_t)(t->end_us - t->start_us) : 0;
+        trailer.status = (uint8_t)t->error;
+        trailer.bytes = t->produced;
+        trailer.retries = t->retries;
+        trailer.stalls = t->stalls;
+        trailer.elapsed_us = elapsed_us;
+        trailer.wire_us = (uint32_t)t->wire_us;
+        trailer.bytes_per_s = elapsed_us ? (uint32_t)((uint64_t)t->produced * 1000000 / elapsed_us) : 0;
+    }
+    return send(&trailer, sizeof(trailer));
+}
+
+// Chunks as they are read, then zeros if the dump stopped short
+static void send_data(void) {
+    static const uint8_t zeros[USB_TPAK_EP_SIZE];
+
+    while (s_sent < s_length) {
+        // State first: once finished, every chunk it read is visible
+        bool finished = (s_tpak->state != N64_TPAK_RUNNING);
+        uint len;
+        const uint8_t *chunk = n64_tpak_chunk(s_tpak, &len);
+        if (chunk != NULL) {
+            if (!send(chunk, len)) {
+                return;
+            }
+            n64_tpak_chunk_done(s_tpak);
+            s_sent += len;
+        } else if (finished) {
+            uint32_t pad = s_length - s_sent;
+            if (pad > sizeof(zeros)) {
+                pad = sizeof(zeros);
+            }
+            if (!send(zeros, pad)) {
+                return;
+            }
+            s_sent += pad;
+        } else {
+            return;
+        }
+    }
+    s_state = STREAM_TRAILER;
+}
+
+static void take_request(void) {
+    if (tud_vendor_available() < sizeof(s_request)) {
+        return;
+    }
+    tud_vendor_read(&s_request, sizeof(s_request));
+
+    s_status = N64_TPAK_OK;
+    if (memcmp(s_request.magic, TPAK_REQUEST_MAGIC, 2) != 0 ||
+        s_request.version != TPAK_STREAM_VERSION ||
+        s_request.command > TPAK_CMD_SRAM || s_request.port >= MAX_CONTROLLERS) {
+        s_status = TPAK_STATUS_BAD_REQUEST;
+    } else if (s_tpak->state == N64_TPAK_RUNNING) {
+        s_status = TPAK_STATUS_BUSY;        // Console dump
+    } else {
+        n64_tpak_start(s_tpak, s_request.port, (n64_tpak_target_t)s_request.command);
+    }
+    s_state = STREAM_WAIT_CART;
+}
+
+//--------------------------------------------------------------------
+// Public Functions
+//--------------------------------------------------------------------
+
+void usb_tpak_stream_init(n64_tpak_t *tpak) {
+    s_tpak = tpak;
+    s_state = STREAM_IDLE;
+}
+
+bool usb_tpak_stream_task(void) {
+    if (s_state != STREAM_IDLE && s_state != STREAM_ABORTING && !tud_mounted()) {
+        if (s_status == N64_TPAK_OK) {
+            n64_tpak_abort(s_tpak);
+        }
+        s_state = STREAM_ABORTING;
+    }
+
+    switch (s_state) {
+        case STREAM_IDLE:
+            if (tud_mounted()) {
+                take_request();
+            }
+            break;
+
+        case STREAM_WAIT_CART:
+            if (s_status == N64_TPAK_OK && !s_tpak->cart_ready &&
+                s_tpak->state == N64_TPAK_RUNNING) {
+                break;
+            }
+            if (send_response()) {
+                s_state = STREAM_DATA;
+                send_data();
+            }
+            break;
+
+        case STREAM_DATA:
+            send_data();
+            break;
+
+        case STREAM_TRAILER:
+            // Results are final once the dump has powered the pak off
+            if (s_status == N64_TPAK_OK && s_tpak->state == N64_TPAK_RUNNING) {
+                break;
+            }
+            if (send_trailer()) {
+                s_state = STREAM_IDLE;
+            }
+            break;
+
+        case STREAM_ABORTING:
+            if (s_tpak->state == N64_TPAK_RUNNING) {
+                uint len;
+                if (n64_tpak_chunk(s_tpak, &len) != NULL) {
+                    n64_tpak_chunk_done(s_tpak);
+                }
+                break;
+            }
+            s_state = STREAM_IDLE;
+            break;
+    }
+    return s_state != STREAM_IDLE;
+}
+
+bool usb_tpak_stream_active(void) {
+    return s_state != STREAM_IDLE;
+}
+
+#endif /* N64_TPAK */
@@ -0,0 +1,116 @@
+/*
+ * Packed FIFO Benchmark (host)
+ * Built twice: with the default N64_RX_WORD_MAX (responses of up to 4
+ * bytes autopushed as one word) and with N64_RX_WORD_MAX=0 (one FIFO word
+ * per byte, the path before packing). Each build
+ *   - round-trips every response length from 1 to 8 bytes, random data,
+ *     from the device through the FIFO and DMA into the response buffer
+ *   - counts TX/RX FIFO words and DMA transfers per status poll
+ *   - times the CPU side of a status poll (start, then collect)
+ * The TX side is packed in both builds (header word carrying the command
+ * byte); before packing a status poll also took a second TX word.
+ */
+
+#include "test_common.h"
+#include "test_rig.h"
+#include "n64_controller.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define PIN                 18
+#define ROUND_TRIPS         2000
+#define POLLS               20000
+
+static mock_device_t s_pad;
+static n64_controller_t s_ctrl;
+static uint8_t s_reply[8];
+static uint s_reply_len;
+
+static void echo_device(void *ctx, const uint8_t *cmd, uint cmd_len, mock_joybus_reply_t *reply) {
+    memcpy(reply->data, s_reply, s_reply_len);
+    reply->len = s_reply_len;
+}
+
+static void test_round_trip(void) {
+    // Responses longer than N64_RX_WORD_MAX take the byte-per-word path
+    static const uint8_t cmd[] = {0x55};
+    uint failures = 0;
+    srand(12);
+
+    mock_joybus_attach(PIN, echo_device, NULL);
+    for (uint i = 0; i < ROUND_TRIPS; i++) {
+        s_reply_len = 1 + i % sizeof(s_reply);
+        for (uint b = 0; b < s_reply_len; b++) {
+            s_reply[b] = (uint8_t)rand();
+        }
+        uint8_t response[sizeof(s_reply) + 1];
+        memset(response, 0xA5, sizeof(response));
+
+        n64_xfer_status_t status = N64_XFER_ERROR;
+        if (n64_command_async(&s_ctrl, cmd, sizeof(cmd), response, s_reply_len)) {
+            while ((status = n64_transfer_poll(&s_ctrl)) == N64_XFER_BUSY) {
+            }
+        }
+        if (status != N64_XFER_DONE || memcmp(response, s_reply, s_reply_len) != 0 ||
+            response[s_reply_len] != 0xA5) {
+            failures++;
+        }
+    }
+    CHECK_EQ(failures, 0);
+    mock_device_plug(PIN, &s_pad);
+}
+
+static void bench_status_poll(void) {
+    n64_device_state_t state;
+    mock_device_set_n64(&s_pad, N64_MASK_START, N64_MASK_R, -12, 34);
+    CHECK(n64_read_start(&s_ctrl));
+    while (n64_read_poll(&s_ctrl, &state) == N64_XFER_BUSY) {
+    }
+
+    mock_joybus_stats_t before, after;
+    mock_joybus_get_stats(&before);
+    uint64_t cpu_ns = 0;
+    uint done = 0;
+    for (uint i = 0; i < POLLS; i++) {
+        // Only the CPU work is timed: the frame runs while the clock is advanced
+        uint64_t start = rig_host_ns();
+        bool started = n64_read_start(&s_ctrl);
+        cpu_ns += rig_host_ns() - start;
+        if (!started) {
+            continue;
+        }
+        mock_advance_us(200);
+        start = rig_host_ns();
+        n64_xfer_status_t status = n64_read_poll(&s_ctrl, &state);
+        cpu_ns += rig_host_ns() - start;
+        done += (status == N64_XFER_DONE && state.n64.buttons0 == N64_MASK_START &&
+                 state.n64.buttons1 == N64_MASK_R && state.n64.stick_x == -12 &&
+                 state.n64.stick_y == 34);
+    }
+    mock_joybus_get_stats(&after);
+
+    printf("N64_RX_WORD_MAX %d: per status poll %.2f TX words, %.2f RX words, "
+           "%.2f DMA transfers, %.0f ns CPU (start + collect)\n",
+           N64_RX_WORD_MAX,
+           (double)(after.tx_words - before.tx_words) / POLLS,
+           (double)(after.rx_words - before.rx_words) / POLLS,
+           (double)(after.dma_beats - before.dma_beats) / POLLS,
+           (double)cpu_ns / POLLS);
+    CHECK_EQ(done, POLLS);
+    CHECK_EQ(after.rx_overflows, before.rx_overflows);
+    if (N64_RX_WORD_MAX >= N64_STATUS_SIZE) {
+        CHECK_EQ(after.rx_words - before.rx_words, POLLS);
+    }
+}
+
+int main(void) {
+    rig_reset();
+    mock_device_init(&s_pad, MOCK_DEVICE_N64);
+    mock_device_plug(PIN, &s_pad);
+    CHECK(n64_init(&s_ctrl, PIN));
+    CHECK(s_ctrl.connected);
+
+    test_round_trip();
+    bench_status_poll();
+    return test_result("bench_fifo");
+}
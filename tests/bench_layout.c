@@ -0,0 +1,86 @@
+/*
+ * USB Layout Benchmark (host)
+ * Built twice with four controllers: one HID interface per port, and one
+ * shared interface with a Report ID per player (N64_HID_REPORT_ID). With
+ * every stick moving, each build reports
+ *   - host transfers/s (reports read, and IN polls with nothing queued)
+ *   - reports/s per player, which must stay at the poll rate
+ *   - host CPU time per USB frame (firmware plus the USB model)
+ * and checks the per-player report rate the firmware announces.
+ */
+
+#include "test_common.h"
+#include "test_rig.h"
+#include <stdio.h>
+
+#define RUN_MS              2000
+#define POLL_US             8000
+
+static mock_device_t s_pad[MAX_CONTROLLERS];
+
+static void test_report_rate(void) {
+    char line[64];
+    uint interval = usb_descriptors_get_report_interval();
+    snprintf(line, sizeof(line), "Report rate: %u Hz (bInterval %d ms)", 1000 / interval,
+             USB_HID_POLL_INTERVAL_MS / (N64_HID_REPORT_ID ? MAX_CONTROLLERS : 1));
+    CHECK(mock_console_find(line) != NULL);
+    CHECK_EQ(interval, USB_HID_POLL_INTERVAL_MS);
+    for (uint i = 0; i < USB_HID_INSTANCES; i++) {
+        CHECK_EQ(mock_tusb_hid_interval(i), usb_descriptors_get_poll_interval());
+    }
+}
+
+static void bench_layout(void) {
+    mock_tusb_clear_log();
+    mock_tusb_stats_t before, after;
+    mock_tusb_get_stats(&before);
+    uint64_t from_ns = mock_now_ns();
+    uint64_t host_start = rig_host_ns();
+    for (int ms = 0; ms < RUN_MS; ms += POLL_US / 1000) {
+        for (uint p = 0; p < MAX_CONTROLLERS; p++) {
+            mock_device_set_n64(&s_pad[p], 0, 0, (int8_t)(ms % 160 - 80), (int8_t)(p * 10));
+        }
+        mock_firmware_run_us(POLL_US);
+    }
+    uint64_t host_ns = rig_host_ns() - host_start;
+    mock_tusb_get_stats(&after);
+
+    size_t count;
+    const mock_hid_read_t *log = mock_tusb_log(&count);
+    uint player_reads[MAX_CONTROLLERS] = {0};
+    for (size_t i = 0; i < count; i++) {
+        uint port;
+        usb_gamepad_report_t report;
+        if (log[i].read_ns >= from_ns && rig_decode_read(&log[i], &port, &report)) {
+            player_reads[port]++;
+        }
+    }
+
+    uint frames = after.frames - before.frames;
+    printf("%s, %d ports: %u transfers/s, %u empty IN polls/s, %u tud_task events/s, "
+           "%.0f ns host CPU per frame\n",
+           N64_HID_REPORT_ID ? "Report ID layout" : "per-interface layout", MAX_CONTROLLERS,
+           (after.reads - before.reads) * 1000 / RUN_MS,
+           (after.naks - before.naks) * 1000 / RUN_MS,
+           (after.task_events - before.task_events) * 1000 / RUN_MS,
+           (double)host_ns / frames);
+    for (uint p = 0; p < MAX_CONTROLLERS; p++) {
+        uint per_s = player_reads[p] * 1000 / RUN_MS;
+        printf("  P%u: %u reports/s\n", p + 1, per_s);
+        CHECK(per_s >= 1000000 / POLL_US * 95 / 100);
+    }
+}
+
+int main(void) {
+    rig_reset();
+    for (uint p = 0; p < MAX_CONTROLLERS; p++) {
+        mock_device_init(&s_pad[p], MOCK_DEVICE_N64);
+        rig_plug(p, &s_pad[p]);
+    }
+    rig_boot();
+    mock_firmware_run_us(100000);
+
+    test_report_rate();
+    bench_layout();
+    return test_result("bench_layout");
+}
@@ -0,0 +1,120 @@
+/*
+ * Poll Path Benchmark (host)
+ * Four N64 controllers on the firmware main loop:
+ *   - host CPU time per poll cycle (firmware plus the PIO/DMA model)
+ *   - report generation throughput (device_to_usb_report + submit)
+ *   - end-to-end simulated latency, button press to host read, over
+ *     presses spread across the poll and host read phases
+ * Fails only on gross regressions (latency past its bound, no reports).
+ */
+
+#include "test_common.h"
+#include "test_rig.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define RUN_MS              2000
+#define PRESSES             200
+#define CONVERT_LOOPS       2000000
+#define POLL_US             8000
+#define INTERVAL_US         (USB_HID_POLL_INTERVAL_MS * 1000)
+
+static mock_device_t s_pad[MAX_CONTROLLERS];
+
+static void bench_poll_cost(void) {
+    // Moving sticks: every poll is a new report on every port
+    mock_tusb_stats_t before, after;
+    mock_tusb_get_stats(&before);
+    uint64_t host_start = rig_host_ns();
+    for (int ms = 0; ms < RUN_MS; ms += POLL_US / 1000) {
+        for (uint p = 0; p < MAX_CONTROLLERS; p++) {
+            mock_device_set_n64(&s_pad[p], 0, 0, (int8_t)(ms % 160 - 80), (int8_t)p);
+        }
+        mock_firmware_run_us(POLL_US);
+    }
+    uint64_t host_ns = rig_host_ns() - host_start;
+    mock_tusb_get_stats(&after);
+
+    uint cycles = RUN_MS * 1000 / POLL_US;
+    uint reads = after.reads - before.reads;
+    printf("poll cycle, %d ports:   %8.0f ns host CPU per cycle (firmware + PIO/DMA model)\n",
+           MAX_CONTROLLERS, (double)host_ns / cycles);
+    printf("host reads:             %8u in %d ms (%u per port)\n", reads, RUN_MS,
+           reads / MAX_CONTROLLERS);
+    CHECK(reads >= (uint)(cycles * MAX_CONTROLLERS * 9 / 10));
+}
+
+static void bench_convert(void) {
+    n64_device_state_t state = {0};
+    usb_gamepad_report_t report;
+    uint32_t sink = 0;
+    state.type = N64_DEVICE_CONTROLLER;
+
+    uint64_t start = rig_host_ns();
+    for (uint32_t i = 0; i < CONVERT_LOOPS; i++) {
+        state.words[0] = i * 2654435761u;
+        device_to_usb_report(&state, &report);
+        sink += report.buttons + report.lx;
+    }
+    uint64_t ns = rig_host_ns() - start;
+    printf("device_to_usb_report:   %8.1f ns/report, %.1f M reports/s (%u)\n",
+           (double)ns / CONVERT_LOOPS, CONVERT_LOOPS * 1000.0 / (double)ns, sink & 1);
+}
+
+static void bench_latency(void) {
+    uint64_t sum_us = 0;
+    uint64_t min_us = UINT64_MAX;
+    uint64_t max_us = 0;
+    uint missed = 0;
+    srand(64);
+
+    for (int i = 0; i < PRESSES; i++) {
+        // Press at a random phase, release once the host saw it
+        mock_firmware_run_us(1000 + (uint64_t)(rand() % POLL_US));
+        uint port = (uint)i % MAX_CONTROLLERS;
+        uint64_t press_ns = mock_now_ns();
+        mock_device_set_n64(&s_pad[port], N64_MASK_B, 0, 0, 0);
+        mock_firmware_run_us(POLL_US + INTERVAL_US + 2000);
+
+        usb_gamepad_report_t report;
+        uint64_t after_ns = press_ns;
+        uint64_t read_ns;
+        while ((read_ns = rig_first_read(port, after_ns, &report)) != 0 &&
+               !(report.buttons & USB_BTN_B)) {
+            after_ns = read_ns + 1;
+        }
+        mock_device_set_n64(&s_pad[port], 0, 0, 0, 0);
+        mock_firmware_run_us(POLL_US + INTERVAL_US);
+        mock_tusb_clear_log();
+        if (read_ns == 0) {
+            missed++;
+            continue;
+        }
+
+        uint64_t us = (read_ns - press_ns) / 1000;
+        sum_us += us;
+        min_us = us < min_us ? us : min_us;
+        max_us = us > max_us ? us : max_us;
+    }
+
+    printf("press -> host read:     min %llu us, avg %llu us, max %llu us (%d presses)\n",
+           (unsigned long long)min_us, (unsigned long long)(sum_us / (PRESSES - missed)),
+           (unsigned long long)max_us, PRESSES);
+    CHECK_EQ(missed, 0);
+    CHECK(max_us <= POLL_US + INTERVAL_US + 1000);
+}
+
+int main(void) {
+    rig_reset();
+    for (uint p = 0; p < MAX_CONTROLLERS; p++) {
+        mock_device_init(&s_pad[p], MOCK_DEVICE_N64);
+        rig_plug(p, &s_pad[p]);
+    }
+    rig_boot();
+    mock_firmware_run_us(100000);
+
+    bench_poll_cost();
+    bench_convert();
+    bench_latency();
+    return test_result("bench_poll");
+}
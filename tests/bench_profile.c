@@ -0,0 +1,80 @@
+/*
+ * Profiler Benchmark (host)
+ * The firmware built with N64_PROFILE, two controllers with moving sticks:
+ * the probes in the polling path (transfer start, collect, unpack, parse,
+ * conversion, USB send, tud_task) count host TSC ticks, and the 'p' console
+ * command prints the table in the board's format. Checks that every probe
+ * is hit at the poll rate and that the table lists it.
+ */
+
+#include "test_common.h"
+#include "test_rig.h"
+#include "profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RUN_MS              2000
+#define POLL_US             8000
+#define POLLS               (MAX_CONTROLLERS * RUN_MS * 1000 / POLL_US)
+
+static mock_device_t s_pad[MAX_CONTROLLERS];
+
+static const char *const s_names[PROF_PROBES] = {
+    "n64_start", "n64_read_poll", "n64_transfer_poll", "unpack_response", "reset_sm",
+    "device_parse", "device_to_usb_report", "usb_send_report", "tud_task"
+};
+
+static void bench_probes(void) {
+    mock_console_input("P\n");
+    mock_firmware_run_us(POLL_US);
+    for (int ms = 0; ms < RUN_MS; ms += POLL_US / 1000) {
+        for (uint p = 0; p < MAX_CONTROLLERS; p++) {
+            mock_device_set_n64(&s_pad[p], 0, 0, (int8_t)(ms % 160 - 80), (int8_t)(p * 10));
+        }
+        mock_firmware_run_us(POLL_US);
+    }
+
+    profiler_stats_t start, read_poll, convert;
+    profiler_get(PROF_N64_START, &start);
+    profiler_get(PROF_N64_READ_POLL, &read_poll);
+    profiler_get(PROF_USB_CONVERT, &convert);
+    printf("%d ports, %d ms: %lu starts, %lu read polls, %lu conversions\n", MAX_CONTROLLERS,
+           RUN_MS, (unsigned long)start.calls, (unsigned long)read_poll.calls,
+           (unsigned long)convert.calls);
+
+    // One start and one collect at least per port and cycle
+    CHECK(start.calls >= POLLS * 98 / 100);
+    CHECK(read_poll.calls >= start.calls);
+    CHECK(convert.calls >= POLLS * 98 / 100);
+    CHECK(start.min <= start.max);
+
+    mock_console_clear();
+    mock_console_input("p\n");
+    mock_firmware_run_us(POLL_US);
+    if (getenv("N64_TEST_VERBOSE") == NULL) {
+        fputs(mock_console_output(), stdout);
+    }
+    CHECK(mock_console_find("ticks/us, probe overhead") != NULL);
+    for (int i = 0; i < PROF_PROBES; i++) {
+        // Every probe hit has its row (reset_sm only runs on reconfiguration)
+        profiler_stats_t stats;
+        char row[32];
+        profiler_get((profiler_probe_t)i, &stats);
+        snprintf(row, sizeof(row), "[PROF] %-18s ", s_names[i]);
+        CHECK_EQ(mock_console_find(row) != NULL, stats.calls > 0);
+        CHECK(stats.calls > 0 || i == PROF_N64_RESET_SM);
+    }
+}
+
+int main(void) {
+    rig_reset();
+    for (uint p = 0; p < MAX_CONTROLLERS; p++) {
+        mock_device_init(&s_pad[p], MOCK_DEVICE_N64);
+        rig_plug(p, &s_pad[p]);
+    }
+    rig_boot();
+    mock_firmware_run_us(100000);
+
+    bench_probes();
+    return test_result("bench_profile");
+}
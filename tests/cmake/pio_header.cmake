@@ -0,0 +1,56 @@
+# Host stand-in for pioasm: writes the <name>.pio.h of a PIO program for the
+# mocked hardware_pio (public defines, program length, get_default_config and
+# the "% c-sdk" block verbatim). The instructions are not assembled: the host
+# build models the program's behaviour in tests/mock/mock_joybus.c.
+#
+# cmake -DINPUT=<file.pio> -DOUTPUT=<file.pio.h> -P pio_header.cmake
+
+file(READ "${INPUT}" source)
+
+string(REGEX MATCH "\\.program[ \t]+([A-Za-z0-9_]+)" _ "${source}")
+set(program "${CMAKE_MATCH_1}")
+if(program STREQUAL "")
+    message(FATAL_ERROR "${INPUT}: no .program")
+endif()
+
+# C block first: it is copied as-is, semicolons included
+string(REGEX MATCH "% c-sdk {\n(.*)%}" _ "${source}")
+set(c_sdk "${CMAKE_MATCH_1}")
+
+# PIO comments start with ';', which CMake lists would split on
+string(REGEX REPLACE "% c-sdk {.*" "" body "${source}")
+string(REPLACE ";" "#" body "${body}")
+
+set(defines "")
+string(REGEX MATCHALL "\\.define[ \t]+public[ \t]+[A-Za-z0-9_]+[ \t]+[0-9]+" public_defines "${body}")
+foreach(define IN LISTS public_defines)
+    string(REGEX MATCH "public[ \t]+([A-Za-z0-9_]+)[ \t]+([0-9]+)" _ "${define}")
+    string(APPEND defines "#define ${program}_${CMAKE_MATCH_1} ${CMAKE_MATCH_2}\n")
+endforeach()
+
+# Instructions are the indented lines starting with a mnemonic
+string(REGEX MATCHALL "\n[ \t]+[a-z][^\n]*" instructions "${body}")
+list(LENGTH instructions length)
+
+file(WRITE "${OUTPUT}"
+"// Generated by tests/cmake/pio_header.cmake from ${program}.pio (host build)
+
+#pragma once
+
+#include \"hardware/pio.h\"
+
+${defines}
+static const uint16_t ${program}_program_instructions[${length}] = {0};
+
+static const pio_program_t ${program}_program = {
+    .instructions = ${program}_program_instructions,
+    .length = ${length},
+    .origin = -1,
+};
+
+static inline pio_sm_config ${program}_program_get_default_config(uint offset) {
+    (void)offset;
+    return pio_get_default_sm_config();
+}
+
+${c_sdk}")
@@ -0,0 +1,19 @@
+/*
+ * Host mock of hardware_clocks
+ */
+
+#ifndef MOCK_HARDWARE_CLOCKS_H
+#define MOCK_HARDWARE_CLOCKS_H
+
+#include <stdint.h>
+
+enum clock_index {
+    clk_sys = 5,
+};
+
+/**
+ * Clock frequency (clk_sys runs at the RP2040 default of 125 MHz)
+ */
+uint32_t clock_get_hz(enum clock_index clk_index);
+
+#endif /* MOCK_HARDWARE_CLOCKS_H */
@@ -0,0 +1,17 @@
+/*
+ * Host mock of hardware_flash (RAM flash, see mock_flash in mock_sdk.h)
+ */
+
+#ifndef MOCK_HARDWARE_FLASH_H
+#define MOCK_HARDWARE_FLASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FLASH_PAGE_SIZE     (1u << 8)
+#define FLASH_SECTOR_SIZE   (1u << 12)
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#endif /* MOCK_HARDWARE_FLASH_H */
@@ -0,0 +1,22 @@
+/*
+ * Host mock of hardware_gpio
+ */
+
+#ifndef MOCK_HARDWARE_GPIO_H
+#define MOCK_HARDWARE_GPIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+
+#define NUM_BANK0_GPIOS     30
+#define GPIO_OUT            1
+#define GPIO_IN             0
+
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+void gpio_pull_up(uint gpio);
+
+#endif /* MOCK_HARDWARE_GPIO_H */
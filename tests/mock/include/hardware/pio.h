@@ -0,0 +1,128 @@
+/*
+ * Host mock of hardware_pio
+ * No instruction is executed: mock_joybus.c models the Joybus program of
+ * n64_controller.pio (command header and words from the TX FIFO, device
+ * answer, autopush at the PUSH_THRESH of SHIFTCTRL, end-of-frame IRQ flag).
+ */
+
+#ifndef MOCK_HARDWARE_PIO_H
+#define MOCK_HARDWARE_PIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+#include "hardware/gpio.h"
+
+typedef volatile uint8_t io_rw_8;
+typedef volatile uint16_t io_rw_16;
+typedef volatile uint32_t io_rw_32;
+
+#define NUM_PIOS                    2
+#define NUM_PIO_STATE_MACHINES      4
+#define PIO_INSTRUCTION_COUNT       32
+
+#define PIO0_IRQ_0                  7
+#define PIO0_IRQ_1                  8
+#define PIO1_IRQ_0                  9
+#define PIO1_IRQ_1                  10
+
+#define PIO_SM0_SHIFTCTRL_PUSH_THRESH_LSB   20
+#define PIO_SM0_SHIFTCTRL_PUSH_THRESH_BITS  0x01f00000u
+#define PIO_SM0_SHIFTCTRL_PULL_THRESH_LSB   25
+#define PIO_SM0_SHIFTCTRL_PULL_THRESH_BITS  0x3e000000u
+#define PIO_SM0_SHIFTCTRL_AUTOPUSH_BITS     0x00010000u
+
+typedef struct {
+    io_rw_32 clkdiv;
+    io_rw_32 execctrl;
+    io_rw_32 shiftctrl;
+    io_rw_32 addr;
+    io_rw_32 instr;
+    io_rw_32 pinctrl;
+} pio_sm_hw_t;
+
+typedef struct {
+    io_rw_32 ctrl;
+    io_rw_32 fstat;
+    io_rw_32 fdebug;
+    io_rw_32 flevel;
+    io_rw_32 txf[NUM_PIO_STATE_MACHINES];
+    io_rw_32 rxf[NUM_PIO_STATE_MACHINES];
+    io_rw_32 irq;
+    io_rw_32 irq_force;
+    pio_sm_hw_t sm[NUM_PIO_STATE_MACHINES];
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+extern pio_hw_t *const pio0;
+extern pio_hw_t *const pio1;
+
+typedef struct {
+    uint32_t clkdiv;
+    uint32_t execctrl;
+    uint32_t shiftctrl;
+    uint32_t pinctrl;
+} pio_sm_config;
+
+typedef struct {
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+
+typedef enum {
+    pis_interrupt0 = 8,
+    pis_interrupt1,
+    pis_interrupt2,
+    pis_interrupt3,
+} pio_interrupt_source_t;
+
+static inline void hw_write_masked(io_rw_32 *addr, uint32_t values, uint32_t write_mask) {
+    *addr = (*addr & ~write_mask) | (values & write_mask);
+}
+
+//--------------------------------------------------------------------
+// Programs and State Machines
+//--------------------------------------------------------------------
+bool pio_can_add_program(PIO pio, const pio_program_t *program);
+uint pio_add_program(PIO pio, const pio_program_t *program);
+int pio_claim_unused_sm(PIO pio, bool required);
+void pio_sm_unclaim(PIO pio, uint sm);
+uint pio_get_index(PIO pio);
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+void pio_gpio_init(PIO pio, uint pin);
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_enable_sm_mask_in_sync(PIO pio, uint32_t mask);
+void pio_sm_restart(PIO pio, uint sm);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+void pio_sm_exec(PIO pio, uint sm, uint instr);
+void pio_sm_put(PIO pio, uint sm, uint32_t data);
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count,
+                                    bool is_out);
+uint pio_encode_jmp(uint addr);
+
+//--------------------------------------------------------------------
+// IRQ Flags
+//--------------------------------------------------------------------
+bool pio_interrupt_get(PIO pio, uint pio_interrupt_num);
+void pio_interrupt_clear(PIO pio, uint pio_interrupt_num);
+void pio_set_irq0_source_enabled(PIO pio, pio_interrupt_source_t source, bool enabled);
+
+//--------------------------------------------------------------------
+// State Machine Configuration
+//--------------------------------------------------------------------
+pio_sm_config pio_get_default_sm_config(void);
+void sm_config_set_in_pins(pio_sm_config *c, uint in_base);
+void sm_config_set_out_pins(pio_sm_config *c, uint out_base, uint out_count);
+void sm_config_set_sideset_pins(pio_sm_config *c, uint sideset_base);
+void sm_config_set_jmp_pin(pio_sm_config *c, uint pin);
+void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush,
+                            uint push_threshold);
+void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull,
+                             uint pull_threshold);
+void sm_config_set_clkdiv(pio_sm_config *c, float div);
+
+#endif /* MOCK_HARDWARE_PIO_H */
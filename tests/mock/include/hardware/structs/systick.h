@@ -0,0 +1,20 @@
+/*
+ * Host mock of the SysTick registers (unused on the host: the profiler
+ * reads the TSC or CLOCK_MONOTONIC)
+ */
+
+#ifndef MOCK_HARDWARE_STRUCTS_SYSTICK_H
+#define MOCK_HARDWARE_STRUCTS_SYSTICK_H
+
+#include <stdint.h>
+
+typedef struct {
+    volatile uint32_t csr, rvr, cvr, calib;
+} systick_hw_t;
+
+extern systick_hw_t *systick_hw;
+
+#define M0PLUS_SYST_CSR_CLKSOURCE_BITS  0x00000004u
+#define M0PLUS_SYST_CSR_ENABLE_BITS     0x00000001u
+
+#endif /* MOCK_HARDWARE_STRUCTS_SYSTICK_H */
@@ -0,0 +1,19 @@
+/*
+ * Host mock of the timer registers
+ * timerawl/timerawh are refreshed from the simulated clock on every
+ * mock_sdk time step, so raw reads see the current microsecond count.
+ */
+
+#ifndef MOCK_HARDWARE_STRUCTS_TIMER_H
+#define MOCK_HARDWARE_STRUCTS_TIMER_H
+
+#include <stdint.h>
+
+typedef struct {
+    volatile uint32_t timerawh;
+    volatile uint32_t timerawl;
+} timer_hw_t;
+
+extern timer_hw_t *timer_hw;
+
+#endif /* MOCK_HARDWARE_STRUCTS_TIMER_H */
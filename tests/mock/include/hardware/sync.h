@@ -0,0 +1,34 @@
+/*
+ * Host mock of hardware_sync
+ * Interrupt masking and WFE/SEV drive the simulated IRQs of mock_sdk.c.
+ */
+
+#ifndef MOCK_HARDWARE_SYNC_H
+#define MOCK_HARDWARE_SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+void mock_wfe(void);
+void mock_sev(void);
+
+static inline void __dmb(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void __compiler_memory_barrier(void) {
+    __asm__ volatile ("" ::: "memory");
+}
+
+static inline void __wfe(void) {
+    mock_wfe();
+}
+
+static inline void __sev(void) {
+    mock_sev();
+}
+
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+#endif /* MOCK_HARDWARE_SYNC_H */
@@ -0,0 +1,29 @@
+/*
+ * Host mock of hardware_timer (simulated clock and alarms)
+ */
+
+#ifndef MOCK_HARDWARE_TIMER_H
+#define MOCK_HARDWARE_TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+#include "hardware/structs/timer.h"
+
+typedef void (*hardware_alarm_callback_t)(uint alarm_num);
+
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+
+int hardware_alarm_claim_unused(bool required);
+void hardware_alarm_unclaim(uint alarm_num);
+void hardware_alarm_set_callback(uint alarm_num, hardware_alarm_callback_t callback);
+
+/**
+ * Arm an alarm (its callback runs as an IRQ)
+ * @return true if the target is already in the past (alarm not armed)
+ */
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t target);
+void hardware_alarm_cancel(uint alarm_num);
+
+#endif /* MOCK_HARDWARE_TIMER_H */
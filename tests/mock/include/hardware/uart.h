@@ -0,0 +1,19 @@
+/*
+ * Host mock of hardware_uart (debug UART, captured by mock_sdk.c)
+ */
+
+#ifndef MOCK_HARDWARE_UART_H
+#define MOCK_HARDWARE_UART_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct uart_inst uart_inst_t;
+
+extern uart_inst_t *const uart0;
+#define uart_default        uart0
+
+bool uart_is_writable(uart_inst_t *uart);
+void uart_putc_raw(uart_inst_t *uart, char c);
+
+#endif /* MOCK_HARDWARE_UART_H */
@@ -0,0 +1,17 @@
+/*
+ * Host mock of pico_flash (flash_safe_execute)
+ */
+
+#ifndef MOCK_PICO_FLASH_H
+#define MOCK_PICO_FLASH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PICO_OK                 0
+#define PICO_ERROR_TIMEOUT_FLASH (-1)
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms);
+bool flash_safe_execute_core_init(void);
+
+#endif /* MOCK_PICO_FLASH_H */
@@ -0,0 +1,16 @@
+/*
+ * Host mock of pico_multicore
+ * Only the declarations: the host build runs the single-core firmware.
+ */
+
+#ifndef MOCK_PICO_MULTICORE_H
+#define MOCK_PICO_MULTICORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+void multicore_launch_core1(void (*entry)(void));
+void multicore_fifo_push_blocking(uint32_t data);
+uint32_t multicore_fifo_pop_blocking(void);
+
+#endif /* MOCK_PICO_MULTICORE_H */
@@ -0,0 +1,30 @@
+/*
+ * Host mock of the Pico SDK platform definitions
+ * The flash XIP window is a host array (see mock_flash in mock_sdk.h).
+ */
+
+#ifndef MOCK_PICO_PLATFORM_H
+#define MOCK_PICO_PLATFORM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "pico/types.h"
+
+#ifndef count_of
+#define count_of(a)                 (sizeof(a) / sizeof((a)[0]))
+#endif
+#define __not_in_flash_func(f)      f
+#define __time_critical_func(f)     f
+
+extern uint8_t mock_flash[];
+#define XIP_BASE                    ((uintptr_t)mock_flash)
+
+static inline void tight_loop_contents(void) {}
+
+/**
+ * Core running the caller (the simulated core of mock_sdk.c)
+ * @return 0 or 1
+ */
+uint get_core_num(void);
+
+#endif /* MOCK_PICO_PLATFORM_H */
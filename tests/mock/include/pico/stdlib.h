@@ -0,0 +1,61 @@
+/*
+ * Host mock of the Pico SDK stdlib
+ * Time comes from the simulated clock of mock_sdk.c: every read costs a
+ * little simulated CPU time and runs the hardware events that are due.
+ */
+
+#ifndef MOCK_PICO_STDLIB_H
+#define MOCK_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "pico/types.h"
+#include "pico/platform.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+//--------------------------------------------------------------------
+// Time
+//--------------------------------------------------------------------
+absolute_time_t get_absolute_time(void);
+void busy_wait_us_32(uint32_t delay_us);
+void busy_wait_us(uint64_t delay_us);
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+
+static inline uint64_t to_us_since_boot(absolute_time_t t) {
+    return t;
+}
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t) {
+    return (uint32_t)(t / 1000);
+}
+
+static inline absolute_time_t from_us_since_boot(uint64_t us) {
+    return us;
+}
+
+static inline absolute_time_t make_timeout_time_us(uint64_t us) {
+    return get_absolute_time() + us;
+}
+
+//--------------------------------------------------------------------
+// Standard I/O (debug UART)
+//--------------------------------------------------------------------
+#define PICO_ERROR_TIMEOUT  (-1)
+
+bool stdio_init_all(void);
+int getchar_timeout_us(uint32_t timeout_us);
+
+//--------------------------------------------------------------------
+// Board
+//--------------------------------------------------------------------
+#define PICO_DEFAULT_LED_PIN    25
+#ifndef PICO_FLASH_SIZE_BYTES
+#define PICO_FLASH_SIZE_BYTES   (2 * 1024 * 1024)
+#endif
+
+#endif /* MOCK_PICO_STDLIB_H */
@@ -0,0 +1,14 @@
+/*
+ * Host mock of the Pico SDK basic types
+ */
+
+#ifndef MOCK_PICO_TYPES_H
+#define MOCK_PICO_TYPES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;   // Microseconds since boot
+
+#endif /* MOCK_PICO_TYPES_H */
@@ -0,0 +1,192 @@
+/*
+ * Host mock of the TinyUSB device stack
+ * Descriptor macros and types as in TinyUSB, device API implemented by
+ * mock_tusb.c: a simulated host enumerates the configuration descriptor
+ * and reads every HID IN endpoint at its bInterval; completions, SOF and
+ * control requests reach the firmware callbacks from tud_task().
+ */
+
+#ifndef MOCK_TUSB_H
+#define MOCK_TUSB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Options (tusb_option.h)
+//--------------------------------------------------------------------
+#define OPT_MCU_RP2040          1700
+#define OPT_OS_PICO             5
+#define OPT_MODE_DEVICE         0x0001
+#define OPT_MODE_FULL_SPEED     0x0000
+
+#ifndef CFG_TUSB_MCU
+#define CFG_TUSB_MCU            OPT_MCU_RP2040
+#endif
+
+#include "tusb_config.h"
+
+#ifndef CFG_TUD_HID
+#define CFG_TUD_HID             0
+#endif
+#ifndef CFG_TUD_MSC
+#define CFG_TUD_MSC             0
+#endif
+#ifndef CFG_TUD_VENDOR
+#define CFG_TUD_VENDOR          0
+#endif
+
+//--------------------------------------------------------------------
+// Descriptor Types
+//--------------------------------------------------------------------
+#define TU_BIT(n)               (1UL << (n))
+#define TU_U16_LOW(u16)         ((uint8_t)((u16) & 0x00ff))
+#define TU_U16_HIGH(u16)        ((uint8_t)(((u16) >> 8) & 0x00ff))
+#define U16_TO_U8S_LE(u16)      TU_U16_LOW(u16), TU_U16_HIGH(u16)
+
+enum {
+    TUSB_DESC_DEVICE = 0x01,
+    TUSB_DESC_CONFIGURATION = 0x02,
+    TUSB_DESC_STRING = 0x03,
+    TUSB_DESC_INTERFACE = 0x04,
+    TUSB_DESC_ENDPOINT = 0x05,
+};
+
+enum {
+    TUSB_XFER_CONTROL = 0,
+    TUSB_XFER_ISOCHRONOUS,
+    TUSB_XFER_BULK,
+    TUSB_XFER_INTERRUPT
+};
+
+enum {
+    TUSB_CLASS_HID = 3,
+    TUSB_CLASS_MSC = 8,
+    TUSB_CLASS_VENDOR_SPECIFIC = 0xFF
+};
+
+enum {
+    TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP = TU_BIT(5),
+    TUSB_DESC_CONFIG_ATT_SELF_POWERED = TU_BIT(6),
+};
+
+typedef struct __attribute__((packed)) {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint16_t bcdUSB;
+    uint8_t bDeviceClass;
+    uint8_t bDeviceSubClass;
+    uint8_t bDeviceProtocol;
+    uint8_t bMaxPacketSize0;
+    uint16_t idVendor;
+    uint16_t idProduct;
+    uint16_t bcdDevice;
+    uint8_t iManufacturer;
+    uint8_t iProduct;
+    uint8_t iSerialNumber;
+    uint8_t bNumConfigurations;
+} tusb_desc_device_t;
+
+//--------------------------------------------------------------------
+// Configuration Descriptor Templates (usbd.h)
+//--------------------------------------------------------------------
+#define TUD_CONFIG_DESC_LEN     (9)
+#define TUD_CONFIG_DESCRIPTOR(config_num, _itfcount, _stridx, _total_len, _attribute, _power_ma) \
+    9, TUSB_DESC_CONFIGURATION, U16_TO_U8S_LE(_total_len), _itfcount, config_num, _stridx, \
+    TU_BIT(7) | _attribute, (_power_ma) / 2
+
+#define HID_ITF_PROTOCOL_NONE   0
+#define HID_DESC_TYPE_HID       0x21
+#define HID_DESC_TYPE_REPORT    0x22
+
+#define TUD_HID_DESC_LEN        (9 + 9 + 7)
+#define TUD_HID_DESCRIPTOR(_itfnum, _stridx, _boot_protocol, _report_desc_len, _epin, _epsize, _ep_interval) \
+    9, TUSB_DESC_INTERFACE, _itfnum, 0, 1, TUSB_CLASS_HID, (uint8_t)((_boot_protocol) ? 1 : 0), \
+    _boot_protocol, _stridx, \
+    9, HID_DESC_TYPE_HID, U16_TO_U8S_LE(0x0111), 0, 1, HID_DESC_TYPE_REPORT, \
+    U16_TO_U8S_LE(_report_desc_len), \
+    7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_INTERRUPT, U16_TO_U8S_LE(_epsize), _ep_interval
+
+#define TUD_MSC_DESC_LEN        (9 + 7 + 7)
+#define TUD_MSC_DESCRIPTOR(_itfnum, _stridx, _epout, _epin, _epsize) \
+    9, TUSB_DESC_INTERFACE, _itfnum, 0, 2, TUSB_CLASS_MSC, 0x06, 0x50, _stridx, \
+    7, TUSB_DESC_ENDPOINT, _epout, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0, \
+    7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0
+
+#define TUD_VENDOR_DESC_LEN     (9 + 7 + 7)
+#define TUD_VENDOR_DESCRIPTOR(_itfnum, _stridx, _epout, _epin, _epsize) \
+    9, TUSB_DESC_INTERFACE, _itfnum, 0, 2, TUSB_CLASS_VENDOR_SPECIFIC, 0x00, 0x00, _stridx, \
+    7, TUSB_DESC_ENDPOINT, _epout, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0, \
+    7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0
+
+//--------------------------------------------------------------------
+// HID Class
+//--------------------------------------------------------------------
+typedef enum {
+    HID_REPORT_TYPE_INVALID = 0,
+    HID_REPORT_TYPE_INPUT,
+    HID_REPORT_TYPE_OUTPUT,
+    HID_REPORT_TYPE_FEATURE
+} hid_report_type_t;
+
+bool tud_hid_n_ready(uint8_t instance);
+bool tud_hid_n_report(uint8_t instance, uint8_t report_id, const void *report, uint16_t len);
+
+//--------------------------------------------------------------------
+// MSC Class
+//--------------------------------------------------------------------
+enum {
+    SCSI_SENSE_NONE = 0x00,
+    SCSI_SENSE_NOT_READY = 0x02,
+    SCSI_SENSE_ILLEGAL_REQUEST = 0x05,
+    SCSI_SENSE_UNIT_ATTENTION = 0x06,
+};
+
+enum {
+    SCSI_CMD_TEST_UNIT_READY = 0x00,
+    SCSI_CMD_INQUIRY = 0x12,
+    SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL = 0x1E,
+    SCSI_CMD_READ_CAPACITY_10 = 0x25,
+    SCSI_CMD_READ_10 = 0x28,
+    SCSI_CMD_WRITE_10 = 0x2A,
+};
+
+bool tud_msc_set_sense(uint8_t lun, uint8_t sense_key, uint8_t add_sense_code,
+                       uint8_t add_sense_qualifier);
+
+// Application callbacks (called by the class driver, or by a test as the host)
+uint8_t tud_msc_get_maxlun_cb(void);
+void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16],
+                        uint8_t product_rev[4]);
+bool tud_msc_test_unit_ready_cb(uint8_t lun);
+void tud_msc_capacity_cb(uint8_t lun, uint32_t *block_count, uint16_t *block_size);
+bool tud_msc_start_stop_cb(uint8_t lun, uint8_t power_condition, bool start, bool load_eject);
+int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void *buffer,
+                          uint32_t bufsize);
+bool tud_msc_is_writable_cb(uint8_t lun);
+int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t *buffer,
+                           uint32_t bufsize);
+int32_t tud_msc_scsi_cb(uint8_t lun, uint8_t const scsi_cmd[16], void *buffer,
+                        uint16_t bufsize);
+
+//--------------------------------------------------------------------
+// Vendor Class
+//--------------------------------------------------------------------
+uint32_t tud_vendor_available(void);
+uint32_t tud_vendor_read(void *buffer, uint32_t bufsize);
+uint32_t tud_vendor_write(const void *buffer, uint32_t bufsize);
+uint32_t tud_vendor_write_available(void);
+uint32_t tud_vendor_write_flush(void);
+
+//--------------------------------------------------------------------
+// Device
+//--------------------------------------------------------------------
+bool tusb_init(void);
+void tud_task(void);
+bool tud_task_event_ready(void);
+bool tud_mounted(void);
+void tud_sof_cb_enable(bool en);
+
+#endif /* MOCK_TUSB_H */
@@ -0,0 +1,428 @@
+/*
+ * Host Models of Joybus Devices
+ * N64 controller and accessories, N64 mouse, GameCube controller
+ * (see mock_devices.h)
+ */
+
+#include "mock_devices.h"
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Private Definitions
+//--------------------------------------------------------------------
+#define CMD_INFO            0x00
+#define CMD_STATUS          0x01
+#define CMD_PAK_READ        0x02
+#define CMD_PAK_WRITE       0x03
+#define CMD_GC_POLL         0x40
+#define CMD_GC_ORIGIN       0x41
+#define CMD_RESET           0xFF
+
+#define BLOCK               32
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+
+static uint32_t gb_rom_bank(const mock_gb_cart_t *cart) {
+    uint32_t bank;
+    switch (cart->mbc) {
+        case MOCK_MBC1:
+            // Only the 5 low bits are checked for 0: banks 0x20/0x40/0x60 read as +1
+            bank = (cart->rom_lo & 0x1F) ? (cart->rom_lo & 0x1F) : 1;
+            bank |= (cart->rom_hi & 3) << 5;
+            break;
+        case MOCK_MBC2:
+            bank = (cart->rom_lo & 0x0F) ? (cart->rom_lo & 0x0F) : 1;
+            break;
+        case MOCK_MBC3:
+            bank = (cart->rom_lo & 0x7F) ? (cart->rom_lo & 0x7F) : 1;
+            break;
+        case MOCK_MBC5:
+            bank = (cart->rom_lo & 0xFF) | ((cart->rom_hi & 1) << 8);
+            break;
+        default:
+            bank = 1;
+            break;
+    }
+    return bank;
+}
+
+static uint32_t gb_ram_offset(const mock_gb_cart_t *cart) {
+    if (cart->mbc == MOCK_MBC1) {
+        return cart->mbc1_mode ? (cart->rom_hi & 3) * 0x2000u : 0;
+    }
+    if (cart->mbc == MOCK_MBC2) {
+        return 0;
+    }
+    return (cart->ram_bank & 0x0F) * 0x2000u;
+}
+
+static void gb_write(mock_gb_cart_t *cart, uint32_t address, uint8_t value) {
+    if (address < 0x4000) {
+        if (cart->mbc == MOCK_MBC2) {
+            // Address bit 8 selects the register
+            if (address & 0x100) {
+                cart->rom_lo = value;
+            } else {
+                cart->ram_enabled = (value & 0x0F) == 0x0A;
+            }
+        } else if (address < 0x2000) {
+            cart->ram_enabled = (value & 0x0F) == 0x0A;
+        } else if (cart->mbc == MOCK_MBC5 && address >= 0x3000) {
+            cart->rom_hi = value & 1;
+        } else {
+            cart->rom_lo = value;
+        }
+    } else if (address < 0x6000) {
+        if (cart->mbc == MOCK_MBC1) {
+            cart->rom_hi = value & 3;
+        } else {
+            cart->ram_bank = value;
+        }
+    } else if (address < 0x8000) {
+        if (cart->mbc == MOCK_MBC1) {
+            cart->mbc1_mode = value & 1;
+        }
+    } else if (address >= 0xA000 && address < 0xC000 && cart->ram_enabled && cart->ram_size) {
+        cart->ram[(gb_ram_offset(cart) + (address - 0xA000)) % cart->ram_size] = value;
+    }
+}
+
+static uint8_t gb_read(const mock_gb_cart_t *cart, uint32_t address) {
+    if (address < 0x4000) {
+        // MBC1 mode 1 maps bank (upper bits << 5) at 0x0000
+        uint32_t bank = (cart->mbc == MOCK_MBC1 && cart->mbc1_mode) ? (cart->rom_hi & 3) << 5 : 0;
+        return cart->rom[(bank * 0x4000u + address) % cart->rom_size];
+    }
+    if (address < 0x8000) {
+        return cart->rom[(gb_rom_bank(cart) * 0x4000u + (address - 0x4000)) % cart->rom_size];
+    }
+    if (address >= 0xA000 && address < 0xC000) {
+        if (!cart->ram_enabled || cart->ram_size == 0) {
+            return 0xFF;
+        }
+        return cart->ram[(gb_ram_offset(cart) + (address - 0xA000)) % cart->ram_size];
+    }
+    return 0xFF;
+}
+
+static void accessory_write(mock_device_t *device, uint16_t address, const uint8_t *data) {
+    switch (device->accessory) {
+        case MOCK_ACCESSORY_CPAK:
+            if (address < MOCK_PAK_SIZE) {
+                memcpy(&device->pak[address], data, BLOCK);
+            } else if (address == 0x8000) {
+                memcpy(device->pak_id_block, data, BLOCK);
+            }
+            break;
+
+        case MOCK_ACCESSORY_RUMBLE:
+            if (address == 0x8000) {
+                device->rumble_id = data[BLOCK - 1];
+            } else if (address == 0xC000 && device->rumble_id == 0x80) {
+                bool motor = data[0] & 1;
+                if (motor != device->motor) {
+                    device->motor_toggles++;
+                }
+                device->motor = motor;
+                device->motor_writes++;
+            }
+            break;
+
+        case MOCK_ACCESSORY_TPAK:
+            if (address >= 0x8000 && address < 0xA000) {
+                device->tpak_last_power = data[0];
+                device->tpak_powered = (data[0] == 0x84);
+            } else if (address >= 0xA000 && address < 0xB000) {
+                if (device->tpak_powered) {
+                    device->tpak_bank = data[0] & 3;
+                }
+            } else if (address >= 0xB000 && address < 0xC000) {
+                if (device->tpak_powered) {
+                    device->tpak_access = data[0] & 1;
+                }
+            } else if (address >= 0xC000 && device->tpak_powered && device->tpak_access &&
+                       device->cart.present) {
+                for (uint i = 0; i < BLOCK; i++) {
+                    gb_write(&device->cart, device->tpak_bank * 0x4000u + (address - 0xC000) + i,
+                             data[i]);
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void accessory_read(mock_device_t *device, uint16_t address, uint8_t *data) {
+    memset(data, 0, BLOCK);
+    switch (device->accessory) {
+        case MOCK_ACCESSORY_CPAK:
+            if (address < MOCK_PAK_SIZE) {
+                memcpy(data, &device->pak[address], BLOCK);
+            } else if (address == 0x8000) {
+                memcpy(data, device->pak_id_block, BLOCK);
+            }
+            break;
+
+        case MOCK_ACCESSORY_RUMBLE:
+            if (address == 0x8000) {
+                memset(data, device->rumble_id == 0x80 ? 0x80 : 0x00, BLOCK);
+            }
+            break;
+
+        case MOCK_ACCESSORY_TPAK:
+            if (address >= 0x8000 && address < 0xA000) {
+                memset(data, device->tpak_powered ? 0x84 : 0x00, BLOCK);
+            } else if (address >= 0xB000 && address < 0xC000) {
+                uint8_t status = 0;
+                if (device->tpak_powered) {
+                    status = (uint8_t)(0x80 | (device->tpak_access ? 0x01 : 0) |
+                                       (device->cart.present ? 0 : 0x40));
+                }
+                memset(data, status, BLOCK);
+            } else if (address >= 0xC000 && device->tpak_powered && device->tpak_access &&
+                       device->cart.present) {
+                for (uint i = 0; i < BLOCK; i++) {
+                    data[i] = gb_read(&device->cart,
+                                      device->tpak_bank * 0x4000u + (address - 0xC000) + i);
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+static bool pak_command(mock_device_t *device, const uint8_t *cmd, uint cmd_len,
+                        mock_joybus_reply_t *reply) {
+    if (cmd_len < 3) {
+        return false;
+    }
+    uint16_t address = (uint16_t)((cmd[1] << 8) | cmd[2]);
+    if (mock_pak_address_crc(address) != address) {
+        device->address_crc_errors++;
+    }
+    address &= (uint16_t)~0x1F;
+    device->pak_transfers++;
+
+    if (cmd[0] == CMD_PAK_WRITE) {
+        if (cmd_len != 3 + BLOCK) {
+            return false;
+        }
+        accessory_write(device, address, &cmd[3]);
+        reply->data[0] = mock_pak_data_crc(&cmd[3]);
+        reply->len = 1;
+    } else {
+        accessory_read(device, address, reply->data);
+        reply->data[BLOCK] = mock_pak_data_crc(reply->data);
+        reply->len = BLOCK + 1;
+    }
+
+    // Empty slot: the controller answers with the CRC inverted
+    if (device->accessory == MOCK_ACCESSORY_NONE) {
+        reply->data[reply->len - 1] ^= 0xFF;
+    }
+    if (device->corrupt_every != 0 && device->pak_transfers % device->corrupt_every == 0) {
+        reply->data[0] ^= 0x10;
+    }
+    return true;
+}
+
+static void info_answer(mock_device_t *device, mock_joybus_reply_t *reply) {
+    switch (device->kind) {
+        case MOCK_DEVICE_N64:
+            reply->data[0] = 0x05;
+            reply->data[1] = 0x00;
+            reply->data[2] = (uint8_t)((device->accessory != MOCK_ACCESSORY_NONE ? 0x01 : 0) |
+                                       (device->accessory_removed ? 0x02 : 0));
+            device->accessory_removed = false;
+            break;
+        case MOCK_DEVICE_MOUSE:
+            reply->data[0] = 0x02;
+            reply->data[1] = 0x00;
+            reply->data[2] = 0x00;
+            break;
+        case MOCK_DEVICE_GAMECUBE:
+            reply->data[0] = 0x09;
+            reply->data[1] = 0x00;
+            reply->data[2] = 0x03;
+            break;
+        case MOCK_DEVICE_UNKNOWN:
+            reply->data[0] = 0x12;
+            reply->data[1] = 0x34;
+            reply->data[2] = 0x00;
+            break;
+    }
+    reply->len = 3;
+}
+
+//--------------------------------------------------------------------
+// Public Functions
+//--------------------------------------------------------------------
+
+void mock_device_init(mock_device_t *device, mock_device_kind_t kind) {
+    memset(device, 0, sizeof(*device));
+    device->kind = kind;
+    memset(device->pak, 0xFF, sizeof(device->pak));
+    if (kind == MOCK_DEVICE_GAMECUBE) {
+        static const uint8_t origin[10] = {0x00, 0x80, 128, 128, 128, 128, 20, 20, 0, 0};
+        memcpy(device->origin, origin, sizeof(origin));
+        memcpy(device->state, origin, 8);
+    }
+}
+
+void mock_device_plug(uint pin, mock_device_t *device) {
+    mock_joybus_attach(pin, device ? mock_device_answer : NULL, device);
+}
+
+void mock_device_set_accessory(mock_device_t *device, mock_accessory_t accessory) {
+    if (device->accessory != MOCK_ACCESSORY_NONE && accessory == MOCK_ACCESSORY_NONE) {
+        device->accessory_removed = true;
+    }
+    device->accessory = accessory;
+    device->rumble_id = 0;
+    device->motor = false;
+    device->tpak_powered = false;
+    device->tpak_access = false;
+    device->tpak_bank = 0;
+}
+
+void mock_device_set_n64(mock_device_t *device, uint8_t buttons0, uint8_t buttons1,
+                         int8_t stick_x, int8_t stick_y) {
+    device->state[0] = buttons0;
+    device->state[1] = buttons1;
+    device->state[2] = (uint8_t)stick_x;
+    device->state[3] = (uint8_t)stick_y;
+}
+
+void mock_device_insert_cart(mock_device_t *device, mock_mbc_t mbc, uint8_t *rom,
+                             uint32_t rom_size, uint32_t ram_size) {
+    mock_gb_cart_t *cart = &device->cart;
+    memset(cart, 0, sizeof(*cart));
+    cart->present = true;
+    cart->mbc = mbc;
+    cart->rom = rom;
+    cart->rom_size = rom_size;
+    cart->ram_size = ram_size;
+    cart->rom_lo = 1;
+    for (uint32_t i = 0; i < ram_size; i++) {
+        cart->ram[i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+}
+
+void mock_gb_make_rom(uint8_t *rom, uint32_t rom_size, uint8_t cart_type, uint8_t rom_code,
+                      uint8_t ram_code, const char *title) {
+    // Every byte tells its bank and offset apart from other banks
+    for (uint32_t i = 0; i < rom_size; i++) {
+        rom[i] = (uint8_t)((i >> 14) * 31 + (i * 13) + (i >> 8));
+    }
+    memset(&rom[0x134], 0, 16);
+    memcpy(&rom[0x134], title, strnlen(title, 16));
+    rom[0x147] = cart_type;
+    rom[0x148] = rom_code;
+    rom[0x149] = ram_code;
+    uint8_t checksum = 0;
+    for (uint a = 0x134; a < 0x14D; a++) {
+        checksum = (uint8_t)(checksum - rom[a] - 1);
+    }
+    rom[0x14D] = checksum;
+}
+
+uint8_t mock_pak_data_crc(const uint8_t *data) {
+    uint8_t crc = 0;
+    for (int i = 0; i <= BLOCK; i++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            uint8_t xor_tap = (crc & 0x80) ? 0x85 : 0x00;
+            crc = (uint8_t)(crc << 1);
+            if (i < BLOCK && ((data[i] >> bit) & 1)) {
+                crc |= 1;
+            }
+            crc ^= xor_tap;
+        }
+    }
+    return crc;
+}
+
+uint16_t mock_pak_address_crc(uint16_t address) {
+    static const uint16_t xor_table[16] = {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x15, 0x1F, 0x0B,
+        0x16, 0x19, 0x07, 0x0E, 0x1C, 0x0D, 0x1A, 0x01
+    };
+    uint16_t crc = 0;
+    address &= (uint16_t)~0x1F;
+    for (int bit = 15; bit >= 5; bit--) {
+        if ((address >> bit) & 1) {
+            crc ^= xor_table[bit];
+        }
+    }
+    return (uint16_t)(address | (crc & 0x1F));
+}
+
+void mock_device_answer(void *ctx, const uint8_t *cmd, uint cmd_len,
+                        mock_joybus_reply_t *reply) {
+    mock_device_t *device = ctx;
+    device->commands[cmd[0]]++;
+    if (device->reply_delay_ns != 0) {
+        reply->delay_ns = device->reply_delay_ns;
+    }
+
+    bool answered = false;
+    switch (cmd[0]) {
+        case CMD_INFO:
+        case CMD_RESET:
+            info_answer(device, reply);
+            answered = true;
+            break;
+
+        case CMD_STATUS:
+            if (device->kind == MOCK_DEVICE_N64 || device->kind == MOCK_DEVICE_MOUSE) {
+                memcpy(reply->data, device->state, 4);
+                reply->len = 4;
+                answered = true;
+            }
+            break;
+
+        case CMD_PAK_READ:
+        case CMD_PAK_WRITE:
+            if (device->kind == MOCK_DEVICE_N64) {
+                answered = pak_command(device, cmd, cmd_len, reply);
+            }
+            break;
+
+        case CMD_GC_POLL:
+            if (device->kind == MOCK_DEVICE_GAMECUBE && cmd_len == 3) {
+                memcpy(reply->data, device->state, 8);
+                reply->len = 8;
+                answered = true;
+            }
+            break;
+
+        case CMD_GC_ORIGIN:
+            if (device->kind == MOCK_DEVICE_GAMECUBE) {
+                memcpy(reply->data, device->origin, 10);
+                reply->len = 10;
+                answered = true;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (!answered) {
+        reply->len = 0;
+        return;
+    }
+    if (device->short_next > 0) {
+        device->short_next--;
+        reply->len = 1;
+    }
+    if (device->hold_next > 0) {
+        device->hold_next--;
+        reply->hold_irq = true;
+    }
+}
@@ -0,0 +1,169 @@
+/*
+ * Host Models of Joybus Devices - Test Interface
+ *
+ * Devices plugged on the mocked data lines (mock_joybus.h): N64 controller
+ * with an optional accessory (Controller Pak, Rumble Pak, Transfer Pak with
+ * a Game Boy cartridge), N64 mouse, GameCube controller and a device with an
+ * unknown identifier. Pak commands are checked the way the hardware does:
+ * address CRC, data CRC in the answer (inverted with an empty slot).
+ */
+
+#ifndef MOCK_DEVICES_H
+#define MOCK_DEVICES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+#include "mock_joybus.h"
+
+#define MOCK_PAK_SIZE           0x8000
+#define MOCK_GB_RAM_MAX         0x20000
+
+typedef enum {
+    MOCK_DEVICE_N64,
+    MOCK_DEVICE_MOUSE,
+    MOCK_DEVICE_GAMECUBE,
+    MOCK_DEVICE_UNKNOWN         // Answers INFO with an identifier no driver knows
+} mock_device_kind_t;
+
+typedef enum {
+    MOCK_ACCESSORY_NONE,
+    MOCK_ACCESSORY_CPAK,        // Controller Pak (32 KiB SRAM)
+    MOCK_ACCESSORY_RUMBLE,      // Rumble Pak
+    MOCK_ACCESSORY_TPAK         // Transfer Pak with a Game Boy cartridge
+} mock_accessory_t;
+
+typedef enum {
+    MOCK_MBC_NONE,
+    MOCK_MBC1,
+    MOCK_MBC2,
+    MOCK_MBC3,
+    MOCK_MBC5
+} mock_mbc_t;
+
+//--------------------------------------------------------------------
+// Game Boy Cartridge (in a Transfer Pak)
+//--------------------------------------------------------------------
+typedef struct {
+    bool present;
+    mock_mbc_t mbc;
+    uint8_t *rom;               // Owned by the test
+    uint32_t rom_size;
+    uint8_t ram[MOCK_GB_RAM_MAX];
+    uint32_t ram_size;
+
+    // Mapper registers
+    bool ram_enabled;
+    uint32_t rom_lo;            // 0x2000 register
+    uint32_t rom_hi;            // 0x4000 register (MBC1: bank bits 5-6 or RAM bank)
+    uint32_t ram_bank;
+    bool mbc1_mode;             // MBC1 0x6000 register
+} mock_gb_cart_t;
+
+//--------------------------------------------------------------------
+// Device
+//--------------------------------------------------------------------
+typedef struct {
+    mock_device_kind_t kind;
+    uint8_t state[8];           // Poll answer (4 bytes N64, 8 bytes GameCube)
+    uint8_t origin[10];         // GameCube origin answer
+
+    mock_accessory_t accessory;
+    bool accessory_removed;     // Reported once by the next INFO
+
+    // Controller Pak
+    uint8_t pak[MOCK_PAK_SIZE];
+    uint8_t pak_id_block[32];   // 0x8000 block (probe register)
+
+    // Rumble Pak
+    uint8_t rumble_id;          // Last byte written to 0x8000
+    bool motor;
+    uint32_t motor_writes;
+    uint32_t motor_toggles;
+
+    // Transfer Pak
+    bool tpak_powered;
+    uint8_t tpak_last_power;    // Last byte written to 0x8000
+    uint8_t tpak_bank;
+    bool tpak_access;
+    mock_gb_cart_t cart;
+
+    // Fault injection
+    uint32_t corrupt_every;     // Flip a data bit in every Nth pak answer (0 = never)
+    uint32_t short_next;        // Next answers cut to one byte
+    uint32_t hold_next;         // Next answers keep their end-of-frame IRQ held
+    uint32_t reply_delay_ns;    // Stop bit to start bit (0 = default)
+
+    // Statistics
+    uint32_t commands[256];     // Frames per command byte
+    uint32_t pak_transfers;
+    uint32_t address_crc_errors;
+} mock_device_t;
+
+/**
+ * Initialize a device (neutral state, no accessory, erased pak)
+ * @param device Device
+ * @param kind Device type
+ */
+void mock_device_init(mock_device_t *device, mock_device_kind_t kind);
+
+/**
+ * Plug a device on a data pin (NULL unplugs)
+ * @param pin Data GPIO
+ * @param device Device, must outlive the plug
+ */
+void mock_device_plug(uint pin, mock_device_t *device);
+
+/**
+ * Insert or remove the accessory (removal is flagged to the next INFO)
+ * @param device Device
+ * @param accessory New accessory
+ */
+void mock_device_set_accessory(mock_device_t *device, mock_accessory_t accessory);
+
+/**
+ * Set the N64 poll answer
+ */
+void mock_device_set_n64(mock_device_t *device, uint8_t buttons0, uint8_t buttons1,
+                         int8_t stick_x, int8_t stick_y);
+
+/**
+ * Insert a cartridge in the Transfer Pak
+ * @param device Device with MOCK_ACCESSORY_TPAK
+ * @param mbc Mapper
+ * @param rom ROM image (kept by pointer)
+ * @param rom_size ROM size
+ * @param ram_size Save RAM size (filled with a pattern)
+ */
+void mock_device_insert_cart(mock_device_t *device, mock_mbc_t mbc, uint8_t *rom,
+                             uint32_t rom_size, uint32_t ram_size);
+
+/**
+ * Fill a ROM image with a per-bank pattern and a valid header
+ * @param rom Image
+ * @param rom_size Size (32 KiB << rom_code)
+ * @param cart_type Header cartridge type byte
+ * @param rom_code Header ROM size code
+ * @param ram_code Header RAM size code
+ * @param title Header title (up to 16 characters)
+ */
+void mock_gb_make_rom(uint8_t *rom, uint32_t rom_size, uint8_t cart_type, uint8_t rom_code,
+                      uint8_t ram_code, const char *title);
+
+/**
+ * Reference data CRC (bit-serial, polynomial 0x85)
+ */
+uint8_t mock_pak_data_crc(const uint8_t *data);
+
+/**
+ * Reference address CRC (address with its 5-bit check)
+ */
+uint16_t mock_pak_address_crc(uint16_t address);
+
+/**
+ * Joybus answer function of the models (for mock_joybus_attach())
+ */
+void mock_device_answer(void *ctx, const uint8_t *cmd, uint cmd_len,
+                        mock_joybus_reply_t *reply);
+
+#endif /* MOCK_DEVICES_H */
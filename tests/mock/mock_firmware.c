@@ -0,0 +1,102 @@
+/*
+ * Host Runner of the Firmware Main Loop
+ * A ucontext coroutine: the step hook of mock_sdk.c switches back to the
+ * test once the clock reaches the stop time (see mock_firmware.h)
+ */
+
+#include "mock_firmware.h"
+#include "mock_sdk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+#define FIRMWARE_STACK_SIZE     (1024 * 1024)
+
+static ucontext_t s_test_ctx;
+static ucontext_t s_firmware_ctx;
+static void *s_stack;
+static bool s_started;
+static bool s_inside;               // Firmware context running
+static bool s_booting;              // Stop at the first sleep
+static uint64_t s_until_ns;
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+
+static void yield_to_test(void) {
+    s_inside = false;
+    swapcontext(&s_firmware_ctx, &s_test_ctx);
+    s_inside = true;
+}
+
+static void step_hook(bool wfe) {
+    if (!s_inside) {
+        return;
+    }
+    if (s_booting) {
+        if (wfe) {
+            s_booting = false;
+            yield_to_test();
+        }
+        return;
+    }
+    // Asleep with nothing due before the stop time: sleep up to it
+    if (wfe && mock_next_event_ns() > s_until_ns && mock_now_ns() < s_until_ns) {
+        mock_advance_to_ns(s_until_ns);
+    }
+    if (mock_now_ns() >= s_until_ns) {
+        yield_to_test();
+    }
+}
+
+static void firmware_entry(void) {
+    s_inside = true;
+    n64_firmware_main();
+    fprintf(stderr, "mock_firmware: main() returned\n");
+    abort();
+}
+
+//--------------------------------------------------------------------
+// Test Interface
+//--------------------------------------------------------------------
+
+void mock_firmware_start(void) {
+    if (s_started) {
+        fprintf(stderr, "mock_firmware: one firmware boot per process\n");
+        abort();
+    }
+    s_stack = malloc(FIRMWARE_STACK_SIZE);
+    if (s_stack == NULL) {
+        abort();
+    }
+    getcontext(&s_firmware_ctx);
+    s_firmware_ctx.uc_stack.ss_sp = s_stack;
+    s_firmware_ctx.uc_stack.ss_size = FIRMWARE_STACK_SIZE;
+    s_firmware_ctx.uc_link = NULL;
+    makecontext(&s_firmware_ctx, firmware_entry, 0);
+    s_started = true;
+
+    // Boot runs until the first sleep of the main loop
+    mock_set_step_hook(step_hook);
+    s_booting = true;
+    s_until_ns = UINT64_MAX;
+    s_inside = true;
+    swapcontext(&s_test_ctx, &s_firmware_ctx);
+}
+
+void mock_firmware_run_to_ns(uint64_t t_ns) {
+    if (!s_started) {
+        abort();
+    }
+    s_until_ns = t_ns;
+    s_inside = true;
+    swapcontext(&s_test_ctx, &s_firmware_ctx);
+}
+
+void mock_firmware_run_us(uint64_t us) {
+    mock_firmware_run_to_ns(mock_now_ns() + us * 1000);
+}
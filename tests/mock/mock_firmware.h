@@ -0,0 +1,40 @@
+/*
+ * Host Runner of the Firmware Main Loop - Test Interface
+ *
+ * Runs the firmware's main() (src/main.c built as n64_firmware_main) in
+ * its own stack, interleaved with the test on the simulated clock: the
+ * test lets it run up to a point in time, the firmware switches back at
+ * the first time read or __wfe() at or past that point (see the step hook
+ * in mock_sdk.h). Only the single-core build can run: there is no core1.
+ */
+
+#ifndef MOCK_FIRMWARE_H
+#define MOCK_FIRMWARE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Firmware entry point (main() of src/main.c, renamed by the host build)
+ */
+int n64_firmware_main(void);
+
+/**
+ * Start the firmware (after mock_sdk_reset(), mock_joybus_reset() and
+ * mock_tusb_reset()); it boots up to its first sleep
+ */
+void mock_firmware_start(void);
+
+/**
+ * Let the firmware run until the simulated clock reaches a time
+ * @param t_ns Stop time (simulated ns)
+ */
+void mock_firmware_run_to_ns(uint64_t t_ns);
+
+/**
+ * Let the firmware run for a duration
+ * @param us Microseconds of simulated time
+ */
+void mock_firmware_run_us(uint64_t us);
+
+#endif /* MOCK_FIRMWARE_H */
@@ -0,0 +1,748 @@
+/*
+ * Host Mock of the Joybus PIO Program and DMA
+ * Frame model of n64_controller.pio behind the hardware_pio and
+ * hardware_dma calls of the firmware (see mock_joybus.h)
+ */
+
+#include "mock_joybus.h"
+#include "mock_sdk.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Private Types
+//--------------------------------------------------------------------
+#define FIFO_DEPTH          4
+#define NUM_PINS            NUM_BANK0_GPIOS
+#define DREQ_TX(p, sm)      ((p) * 8 + (sm))
+#define DREQ_RX(p, sm)      ((p) * 8 + 4 + (sm))
+
+typedef enum {
+    PHASE_IDLE,         // Stalled on the header PULL
+    PHASE_PULL,         // Next command word due (pull ifempty)
+    PHASE_STALL,        // Waiting for a command word
+    PHASE_CMD_END,      // Command stop bit sent
+    PHASE_RX_BYTE,      // Next response byte due
+    PHASE_END,          // End-of-frame IRQ due
+    PHASE_HELD,         // End-of-frame IRQ held by the test
+    PHASE_STUCK         // Waiting for bits that never come
+} phase_t;
+
+typedef struct {
+    uint32_t data[FIFO_DEPTH];
+    uint head;
+    uint count;
+} fifo_t;
+
+typedef struct {
+    uint pio_index;
+    uint sm;
+    bool claimed;
+    bool enabled;
+    uint pin;
+
+    fifo_t tx;
+    fifo_t rx;
+
+    // Current frame
+    phase_t phase;
+    mock_event_t event;
+    uint64_t start_ns;
+    uint64_t bits_ns;           // Time of the first command bit
+    uint64_t stall_ns;          // Time lost waiting for command words
+    uint64_t stall_start_ns;
+    bool stalled;
+    uint expected;              // Response bytes (Y + 1)
+    uint cmd_bits;              // Command bits (X + 1)
+    uint words_needed;
+    uint words_pulled;
+    uint8_t cmd[MOCK_JOYBUS_CMD_MAX];
+    uint cmd_len;
+    mock_joybus_reply_t reply;
+    uint rx_index;
+    uint32_t isr;
+    uint isr_bits;
+} sm_model_t;
+
+typedef struct {
+    bool claimed;
+    bool busy;
+    uint32_t ctrl;
+    volatile void *write;
+    const volatile void *read;
+} dma_model_t;
+
+#define DMA_CTRL_SIZE_LSB   2
+#define DMA_CTRL_SIZE_BITS  (3u << DMA_CTRL_SIZE_LSB)
+#define DMA_CTRL_INCR_READ  (1u << 4)
+#define DMA_CTRL_INCR_WRITE (1u << 5)
+#define DMA_CTRL_TREQ_LSB   15
+#define DMA_CTRL_TREQ_BITS  (0x3Fu << DMA_CTRL_TREQ_LSB)
+#define DMA_TREQ_PERMANENT  0x3F
+
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+static pio_hw_t s_pio_regs[NUM_PIOS];
+pio_hw_t *const pio0 = &s_pio_regs[0];
+pio_hw_t *const pio1 = &s_pio_regs[1];
+
+static sm_model_t s_sm[NUM_PIOS][NUM_PIO_STATE_MACHINES];
+static uint s_program_used[NUM_PIOS];
+static uint32_t s_irq0_inte[NUM_PIOS];
+
+static dma_channel_hw_t s_dma_regs[NUM_DMA_CHANNELS];
+static dma_model_t s_dma[NUM_DMA_CHANNELS];
+
+static struct {
+    mock_joybus_device_fn_t fn;
+    void *ctx;
+    uint8_t last_cmd[MOCK_JOYBUS_CMD_MAX];
+    uint last_cmd_len;
+    uint64_t last_frame_ns;
+} s_pins[NUM_PINS];
+
+static mock_joybus_stats_t s_stats;
+static bool s_legacy;
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+
+static uint pio_index_of(PIO pio) {
+    return (pio == pio0) ? 0 : 1;
+}
+
+static bool fifo_push(fifo_t *fifo, uint32_t value) {
+    if (fifo->count == FIFO_DEPTH) {
+        return false;
+    }
+    fifo->data[(fifo->head + fifo->count) % FIFO_DEPTH] = value;
+    fifo->count++;
+    return true;
+}
+
+static bool fifo_pop(fifo_t *fifo, uint32_t *value) {
+    if (fifo->count == 0) {
+        return false;
+    }
+    *value = fifo->data[fifo->head];
+    fifo->head = (fifo->head + 1) % FIFO_DEPTH;
+    fifo->count--;
+    return true;
+}
+
+static uint dma_size(const dma_model_t *dma) {
+    return 1u << ((dma->ctrl & DMA_CTRL_SIZE_BITS) >> DMA_CTRL_SIZE_LSB);
+}
+
+static uint dma_dreq(const dma_model_t *dma) {
+    return (dma->ctrl & DMA_CTRL_TREQ_BITS) >> DMA_CTRL_TREQ_LSB;
+}
+
+static void start_frame(sm_model_t *model);
+
+// DREQ handshake: move what the FIFOs allow on every busy channel
+static void dma_service(void) {
+    for (uint chan = 0; chan < NUM_DMA_CHANNELS; chan++) {
+        dma_model_t *dma = &s_dma[chan];
+        if (!dma->busy) {
+            continue;
+        }
+        uint dreq = dma_dreq(dma);
+        if (dreq >= 16) {
+            continue;   // Only PIO-paced channels are modelled
+        }
+        sm_model_t *model = &s_sm[dreq / 8][dreq % 4];
+        bool rx = (dreq % 8) >= 4;
+        uint size = dma_size(dma);
+
+        while (s_dma_regs[chan].transfer_count > 0) {
+            uint32_t value;
+            if (rx) {
+                if (!fifo_pop(&model->rx, &value)) {
+                    break;
+                }
+                if (size == 1) {
+                    *(volatile uint8_t *)dma->write = (uint8_t)value;
+                } else if (size == 2) {
+                    *(volatile uint16_t *)dma->write = (uint16_t)value;
+                } else {
+                    *(volatile uint32_t *)dma->write = value;
+                }
+            } else {
+                if (model->tx.count == FIFO_DEPTH) {
+                    break;
+                }
+                if (size == 1) {
+                    value = *(const volatile uint8_t *)dma->read;
+                } else if (size == 2) {
+                    value = *(const volatile uint16_t *)dma->read;
+                } else {
+                    value = *(const volatile uint32_t *)dma->read;
+                }
+                fifo_push(&model->tx, value);
+            }
+            if (dma->ctrl & DMA_CTRL_INCR_WRITE) {
+                dma->write = (volatile uint8_t *)dma->write + size;
+            }
+            if (dma->ctrl & DMA_CTRL_INCR_READ) {
+                dma->read = (const volatile uint8_t *)dma->read + size;
+            }
+            s_dma_regs[chan].transfer_count--;
+            s_stats.dma_beats++;
+        }
+        if (s_dma_regs[chan].transfer_count == 0) {
+            dma->busy = false;
+        }
+
+        // A TX refill may unblock a waiting state machine
+        if (!rx && model->tx.count > 0) {
+            if (model->phase == PHASE_STALL) {
+                model->phase = PHASE_PULL;
+                mock_event_at(&model->event, mock_now_ns());
+            } else if (model->phase == PHASE_IDLE && model->enabled) {
+                start_frame(model);
+            }
+        }
+    }
+}
+
+static void raise_irq(sm_model_t *model) {
+    pio_hw_t *regs = &s_pio_regs[model->pio_index];
+    regs->irq |= 1u << model->sm;
+    if (s_irq0_inte[model->pio_index] & (1u << (pis_interrupt0 + model->sm))) {
+        mock_irq_set_pending(model->pio_index == 0 ? PIO0_IRQ_0 : PIO1_IRQ_0);
+    }
+}
+
+static void end_frame(sm_model_t *model) {
+    s_stats.busy_ns += mock_now_ns() - model->start_ns;
+    model->phase = PHASE_IDLE;
+    raise_irq(model);
+
+    // Wrap to the header PULL: the next command may already be queued
+    if (model->enabled && model->tx.count > 0) {
+        start_frame(model);
+    }
+}
+
+static void push_rx(sm_model_t *model, uint8_t byte) {
+    uint thresh = (s_pio_regs[model->pio_index].sm[model->sm].shiftctrl &
+                   PIO_SM0_SHIFTCTRL_PUSH_THRESH_BITS) >> PIO_SM0_SHIFTCTRL_PUSH_THRESH_LSB;
+    if (thresh == 0) {
+        thresh = 32;
+    }
+
+    model->isr = (model->isr << 8) | byte;
+    model->isr_bits += 8;
+    if (model->isr_bits >= thresh) {
+        if (!fifo_push(&model->rx, model->isr)) {
+            s_stats.rx_overflows++;
+        }
+        s_stats.rx_words++;
+        model->isr = 0;
+        model->isr_bits = 0;
+        dma_service();
+    }
+}
+
+static void take_command_word(sm_model_t *model, uint32_t word) {
+    s_stats.tx_words++;
+    uint bits_left = model->cmd_bits - 8 * model->cmd_len;
+    uint bytes = (bits_left >= 32) ? 4 : (bits_left + 7) / 8;
+    for (uint i = 0; i < bytes && model->cmd_len < MOCK_JOYBUS_CMD_MAX; i++) {
+        model->cmd[model->cmd_len++] = (uint8_t)~(word >> (24 - 8 * i));
+    }
+    model->words_pulled++;
+}
+
+static uint64_t cmd_end_ns(const sm_model_t *model) {
+    return model->bits_ns + model->stall_ns + (uint64_t)model->cmd_bits * MOCK_JOYBUS_BIT_NS +
+           MOCK_JOYBUS_STOP_NS;
+}
+
+static void schedule_next_pull(sm_model_t *model) {
+    if (model->words_pulled < model->words_needed) {
+        // PULL IFEMPTY after the last bit of the previous word
+        uint bits_before = 8 + 32 * (model->words_pulled - 1);
+        model->phase = PHASE_PULL;
+        mock_event_at(&model->event, model->bits_ns + model->stall_ns +
+                                     (uint64_t)bits_before * MOCK_JOYBUS_BIT_NS);
+    } else {
+        model->phase = PHASE_CMD_END;
+        mock_event_at(&model->event, cmd_end_ns(model));
+    }
+}
+
+static void start_frame(sm_model_t *model) {
+    uint32_t header;
+    if (!fifo_pop(&model->tx, &header)) {
+        return;
+    }
+
+    uint64_t now = mock_now_ns();
+    model->start_ns = now;
+    model->bits_ns = now + MOCK_JOYBUS_SETTLE_NS;
+    model->stall_ns = 0;
+    model->stalled = false;
+    model->cmd_len = 0;
+    model->isr = 0;
+    model->isr_bits = 0;
+    model->rx_index = 0;
+    s_stats.frames++;
+    s_stats.tx_words++;
+
+    if (s_legacy) {
+        // OUT Y, 8 with autopull at 8: the command byte is the next word
+        model->expected = ((header >> 24) & 0x1F) + 1;
+        model->cmd_bits = 8;
+        model->words_needed = 2;
+        model->words_pulled = 1;
+        model->phase = PHASE_PULL;
+        mock_event_at(&model->event, model->bits_ns);
+    } else {
+        model->expected = (header >> 24) + 1;
+        model->cmd_bits = ((header >> 8) & 0xFFFF) + 1;
+        model->cmd[model->cmd_len++] = (uint8_t)~header;
+        model->words_needed = 1 + (model->cmd_bits > 8 ? (model->cmd_bits - 8 + 31) / 32 : 0);
+        model->words_pulled = 1;
+        schedule_next_pull(model);
+    }
+
+    // Refill once the frame is under way, so the refill cannot start another
+    dma_service();
+}
+
+static void frame_event(mock_event_t *event) {
+    sm_model_t *model = event->arg;
+    uint64_t now = mock_now_ns();
+
+    switch (model->phase) {
+        case PHASE_PULL: {
+            uint32_t word;
+            if (!fifo_pop(&model->tx, &word)) {
+                s_stats.tx_stalls++;
+                model->phase = PHASE_STALL;
+                model->stall_start_ns = now;
+                model->stalled = true;
+                break;
+            }
+            if (model->stalled) {
+                // The bit clock resumes when the word arrives
+                model->stall_ns += now - model->stall_start_ns;
+                model->stalled = false;
+            }
+            if (s_legacy) {
+                s_stats.tx_words++;
+                model->cmd[model->cmd_len++] = (uint8_t)(word >> 24);
+                model->words_pulled++;
+            } else {
+                take_command_word(model, word);
+            }
+            dma_service();
+            schedule_next_pull(model);
+            break;
+        }
+
+        case PHASE_CMD_END: {
+            s_pins[model->pin].last_cmd_len = model->cmd_len;
+            memcpy(s_pins[model->pin].last_cmd, model->cmd, model->cmd_len);
+            s_pins[model->pin].last_frame_ns = model->start_ns;
+
+            memset(&model->reply, 0, sizeof(model->reply));
+            model->reply.delay_ns = MOCK_JOYBUS_REPLY_DELAY_NS;
+            if (s_pins[model->pin].fn != NULL) {
+                s_pins[model->pin].fn(s_pins[model->pin].ctx, model->cmd, model->cmd_len,
+                                      &model->reply);
+            }
+
+            if (model->reply.len == 0 || model->reply.delay_ns >= MOCK_JOYBUS_PRESENCE_NS) {
+                // No start bit in the presence window
+                s_stats.absent++;
+                model->phase = PHASE_END;
+                mock_event_at(&model->event, now + MOCK_JOYBUS_PRESENCE_NS);
+            } else {
+                model->phase = PHASE_RX_BYTE;
+                mock_event_at(&model->event,
+                              now + model->reply.delay_ns + 8 * MOCK_JOYBUS_BIT_NS);
+            }
+            break;
+        }
+
+        case PHASE_RX_BYTE:
+            push_rx(model, model->reply.data[model->rx_index]);
+            model->rx_index++;
+            if (model->rx_index == model->expected) {
+                if (model->reply.hold_irq) {
+                    model->phase = PHASE_HELD;
+                    break;
+                }
+                s_stats.completed++;
+                model->phase = PHASE_END;
+                mock_event_at(&model->event, now + MOCK_JOYBUS_DEVICE_STOP_NS);
+            } else if (model->rx_index == model->reply.len) {
+                // The PIO takes the device stop bit as data, then waits forever
+                s_stats.stuck++;
+                model->phase = PHASE_STUCK;
+            } else {
+                mock_event_at(&model->event, now + 8 * MOCK_JOYBUS_BIT_NS);
+            }
+            break;
+
+        case PHASE_END:
+            end_frame(model);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void cancel_frame(sm_model_t *model) {
+    if (model->phase != PHASE_IDLE) {
+        s_stats.aborted++;
+    }
+    mock_event_cancel(&model->event);
+    model->phase = PHASE_IDLE;
+    model->isr = 0;
+    model->isr_bits = 0;
+}
+
+static sm_model_t *model_of(PIO pio, uint sm) {
+    return &s_sm[pio_index_of(pio)][sm];
+}
+
+//--------------------------------------------------------------------
+// Test Interface
+//--------------------------------------------------------------------
+
+void mock_joybus_reset(void) {
+    memset(s_pio_regs, 0, sizeof(s_pio_regs));
+    memset(s_sm, 0, sizeof(s_sm));
+    memset(s_program_used, 0, sizeof(s_program_used));
+    memset(s_irq0_inte, 0, sizeof(s_irq0_inte));
+    memset(s_dma_regs, 0, sizeof(s_dma_regs));
+    memset(s_dma, 0, sizeof(s_dma));
+    memset(s_pins, 0, sizeof(s_pins));
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_legacy = false;
+
+    for (uint p = 0; p < NUM_PIOS; p++) {
+        for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+            s_sm[p][sm].pio_index = p;
+            s_sm[p][sm].sm = sm;
+            s_sm[p][sm].event.fire = frame_event;
+            s_sm[p][sm].event.arg = &s_sm[p][sm];
+        }
+    }
+}
+
+void mock_joybus_attach(uint pin, mock_joybus_device_fn_t fn, void *ctx) {
+    s_pins[pin].fn = fn;
+    s_pins[pin].ctx = ctx;
+}
+
+void mock_joybus_get_stats(mock_joybus_stats_t *stats) {
+    *stats = s_stats;
+}
+
+uint mock_joybus_last_command(uint pin, uint8_t *cmd) {
+    if (cmd != NULL) {
+        memcpy(cmd, s_pins[pin].last_cmd, s_pins[pin].last_cmd_len);
+    }
+    return s_pins[pin].last_cmd_len;
+}
+
+uint64_t mock_joybus_last_frame_ns(uint pin) {
+    return s_pins[pin].last_frame_ns;
+}
+
+bool mock_joybus_release_irq(uint pin) {
+    for (uint p = 0; p < NUM_PIOS; p++) {
+        for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+            sm_model_t *model = &s_sm[p][sm];
+            if (model->claimed && model->pin == pin && model->phase == PHASE_HELD) {
+                s_stats.completed++;
+                end_frame(model);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void mock_joybus_set_legacy_format(bool legacy) {
+    s_legacy = legacy;
+}
+
+//--------------------------------------------------------------------
+// hardware_pio
+//--------------------------------------------------------------------
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program) {
+    return s_program_used[pio_index_of(pio)] + program->length <= PIO_INSTRUCTION_COUNT;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t *program) {
+    uint index = pio_index_of(pio);
+    if (!pio_can_add_program(pio, program)) {
+        fprintf(stderr, "mock: no room for the PIO program\n");
+        abort();
+    }
+    uint offset = PIO_INSTRUCTION_COUNT - s_program_used[index] - program->length;
+    s_program_used[index] += program->length;
+    return offset;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required) {
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+        sm_model_t *model = model_of(pio, sm);
+        if (!model->claimed) {
+            model->claimed = true;
+            return (int)sm;
+        }
+    }
+    if (required) {
+        abort();
+    }
+    return -1;
+}
+
+void pio_sm_unclaim(PIO pio, uint sm) {
+    model_of(pio, sm)->claimed = false;
+}
+
+uint pio_get_index(PIO pio) {
+    return pio_index_of(pio);
+}
+
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx) {
+    uint p = pio_index_of(pio);
+    return is_tx ? DREQ_TX(p, sm) : DREQ_RX(p, sm);
+}
+
+void pio_gpio_init(PIO pio, uint pin) {
+    (void)pio;
+    (void)pin;
+}
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config) {
+    (void)initial_pc;
+    sm_model_t *model = model_of(pio, sm);
+    pio_sm_hw_t *regs = &pio->sm[sm];
+
+    regs->clkdiv = config->clkdiv;
+    regs->execctrl = config->execctrl;
+    regs->shiftctrl = config->shiftctrl;
+    regs->pinctrl = config->pinctrl;
+    model->pin = config->pinctrl & 0x1F;    // IN_BASE
+    model->enabled = false;
+    model->tx.count = 0;
+    model->rx.count = 0;
+    cancel_frame(model);
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
+    sm_model_t *model = model_of(pio, sm);
+    model->enabled = enabled;
+    if (enabled && model->phase == PHASE_IDLE && model->tx.count > 0) {
+        start_frame(model);
+    }
+}
+
+void pio_enable_sm_mask_in_sync(PIO pio, uint32_t mask) {
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+        if (mask & (1u << sm)) {
+            pio_sm_set_enabled(pio, sm, true);
+        }
+    }
+}
+
+void pio_sm_restart(PIO pio, uint sm) {
+    sm_model_t *model = model_of(pio, sm);
+    cancel_frame(model);
+}
+
+void pio_sm_clear_fifos(PIO pio, uint sm) {
+    sm_model_t *model = model_of(pio, sm);
+    model->tx.count = 0;
+    model->rx.count = 0;
+}
+
+void pio_sm_exec(PIO pio, uint sm, uint instr) {
+    (void)instr;
+    // Only used to jump back to the top of the program
+    cancel_frame(model_of(pio, sm));
+}
+
+void pio_sm_put(PIO pio, uint sm, uint32_t data) {
+    sm_model_t *model = model_of(pio, sm);
+    if (!fifo_push(&model->tx, data)) {
+        s_stats.tx_overflows++;
+        return;
+    }
+    if (model->phase == PHASE_STALL) {
+        model->phase = PHASE_PULL;
+        mock_event_at(&model->event, mock_now_ns());
+    } else if (model->phase == PHASE_IDLE && model->enabled) {
+        start_frame(model);
+    }
+}
+
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count,
+                                    bool is_out) {
+    (void)pio;
+    (void)sm;
+    (void)pin_base;
+    (void)pin_count;
+    (void)is_out;
+}
+
+uint pio_encode_jmp(uint addr) {
+    return addr & 0x1F;
+}
+
+bool pio_interrupt_get(PIO pio, uint pio_interrupt_num) {
+    return (pio->irq & (1u << pio_interrupt_num)) != 0;
+}
+
+void pio_interrupt_clear(PIO pio, uint pio_interrupt_num) {
+    pio->irq &= ~(1u << pio_interrupt_num);
+}
+
+void pio_set_irq0_source_enabled(PIO pio, pio_interrupt_source_t source, bool enabled) {
+    uint p = pio_index_of(pio);
+    if (enabled) {
+        s_irq0_inte[p] |= 1u << source;
+    } else {
+        s_irq0_inte[p] &= ~(1u << source);
+    }
+}
+
+pio_sm_config pio_get_default_sm_config(void) {
+    pio_sm_config c = {0};
+    c.clkdiv = 1u << 16;
+    return c;
+}
+
+void sm_config_set_in_pins(pio_sm_config *c, uint in_base) {
+    c->pinctrl = (c->pinctrl & ~0x1Fu) | (in_base & 0x1F);
+}
+
+void sm_config_set_out_pins(pio_sm_config *c, uint out_base, uint out_count) {
+    (void)c;
+    (void)out_base;
+    (void)out_count;
+}
+
+void sm_config_set_sideset_pins(pio_sm_config *c, uint sideset_base) {
+    (void)c;
+    (void)sideset_base;
+}
+
+void sm_config_set_jmp_pin(pio_sm_config *c, uint pin) {
+    (void)c;
+    (void)pin;
+}
+
+void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush,
+                            uint push_threshold) {
+    (void)shift_right;
+    c->shiftctrl = (c->shiftctrl & ~(PIO_SM0_SHIFTCTRL_PUSH_THRESH_BITS |
+                                     PIO_SM0_SHIFTCTRL_AUTOPUSH_BITS)) |
+                   ((push_threshold & 0x1Fu) << PIO_SM0_SHIFTCTRL_PUSH_THRESH_LSB) |
+                   (autopush ? PIO_SM0_SHIFTCTRL_AUTOPUSH_BITS : 0);
+}
+
+void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull,
+                             uint pull_threshold) {
+    (void)shift_right;
+    (void)autopull;
+    c->shiftctrl = (c->shiftctrl & ~PIO_SM0_SHIFTCTRL_PULL_THRESH_BITS) |
+                   ((pull_threshold & 0x1Fu) << PIO_SM0_SHIFTCTRL_PULL_THRESH_LSB);
+}
+
+void sm_config_set_clkdiv(pio_sm_config *c, float div) {
+    c->clkdiv = (uint32_t)(div * 65536.0f);
+}
+
+//--------------------------------------------------------------------
+// hardware_dma
+//--------------------------------------------------------------------
+
+int dma_claim_unused_channel(bool required) {
+    for (uint chan = 0; chan < NUM_DMA_CHANNELS; chan++) {
+        if (!s_dma[chan].claimed) {
+            s_dma[chan].claimed = true;
+            return (int)chan;
+        }
+    }
+    if (required) {
+        abort();
+    }
+    return -1;
+}
+
+void dma_channel_unclaim(uint channel) {
+    s_dma[channel].claimed = false;
+    s_dma[channel].busy = false;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    (void)channel;
+    dma_channel_config c = {
+        .ctrl = (DMA_SIZE_32 << DMA_CTRL_SIZE_LSB) | DMA_CTRL_INCR_READ |
+                ((uint32_t)DMA_TREQ_PERMANENT << DMA_CTRL_TREQ_LSB),
+    };
+    return c;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c,
+                                           enum dma_channel_transfer_size size) {
+    c->ctrl = (c->ctrl & ~DMA_CTRL_SIZE_BITS) | ((uint32_t)size << DMA_CTRL_SIZE_LSB);
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+    c->ctrl = incr ? (c->ctrl | DMA_CTRL_INCR_READ) : (c->ctrl & ~DMA_CTRL_INCR_READ);
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+    c->ctrl = incr ? (c->ctrl | DMA_CTRL_INCR_WRITE) : (c->ctrl & ~DMA_CTRL_INCR_WRITE);
+}
+
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) {
+    c->ctrl = (c->ctrl & ~DMA_CTRL_TREQ_BITS) | ((dreq & 0x3Fu) << DMA_CTRL_TREQ_LSB);
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config,
+                           volatile void *write_addr, const volatile void *read_addr,
+                           uint transfer_count, bool trigger) {
+    dma_model_t *dma = &s_dma[channel];
+    dma->ctrl = config->ctrl;
+    dma->write = write_addr;
+    dma->read = read_addr;
+    s_dma_regs[channel].write_addr = (uint32_t)(uintptr_t)write_addr;
+    s_dma_regs[channel].read_addr = (uint32_t)(uintptr_t)read_addr;
+    s_dma_regs[channel].transfer_count = transfer_count;
+    s_dma_regs[channel].ctrl_trig = config->ctrl;
+    dma->busy = trigger && transfer_count > 0;
+    if (dma->busy) {
+        dma_service();
+    }
+}
+
+void dma_channel_abort(uint channel) {
+    s_dma[channel].busy = false;
+}
+
+bool dma_channel_is_busy(uint channel) {
+    return s_dma[channel].busy;
+}
+
+dma_channel_hw_t *dma_channel_hw_addr(uint channel) {
+    return &s_dma_regs[channel];
+}
@@ -0,0 +1,124 @@
+/*
+ * Host Mock of the Joybus PIO Program and DMA - Test Interface
+ *
+ * Each state machine models n64_controller.pio frame by frame: a frame
+ * starts when the enabled, idle state machine has a TX word, decodes the
+ * header (response bytes, command bits, first byte), pulls a further
+ * command word every 32 bits, hands the command to the device attached to
+ * its pin at the stop bit, then either times out the presence window
+ * (end-of-frame IRQ with no data: empty port) or receives the answer one
+ * byte every 32 us, autopushing at the PUSH_THRESH of SHIFTCTRL. The IRQ
+ * flag goes up on the device stop bit after the expected byte count; a
+ * shorter answer leaves the state machine waiting for bits that never come
+ * (no IRQ) until it is restarted.
+ *
+ * Paced DMA channels move RX words out and TX words in as the FIFOs fill
+ * and drain, like the DREQ handshake.
+ */
+
+#ifndef MOCK_JOYBUS_H
+#define MOCK_JOYBUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+
+#define MOCK_JOYBUS_CMD_MAX         64      // Command bytes captured per frame
+#define MOCK_JOYBUS_REPLY_MAX       300
+
+// Wire timing (ns)
+#define MOCK_JOYBUS_SETTLE_NS       8000    // Header PULL to first command bit
+#define MOCK_JOYBUS_BIT_NS          4000
+#define MOCK_JOYBUS_STOP_NS         1750    // Command stop bit
+#define MOCK_JOYBUS_PRESENCE_NS     16500   // Presence window with loop overhead
+#define MOCK_JOYBUS_REPLY_DELAY_NS  2000    // Default stop bit to response start bit
+#define MOCK_JOYBUS_DEVICE_STOP_NS  3000    // Last response bit to end-of-frame IRQ
+
+//--------------------------------------------------------------------
+// Devices
+//--------------------------------------------------------------------
+typedef struct {
+    uint8_t data[MOCK_JOYBUS_REPLY_MAX];
+    uint len;               // Bytes sent (0 = no start bit: empty port)
+    uint32_t delay_ns;      // Command stop bit to response start bit
+    bool hold_irq;          // Keep the end-of-frame IRQ until mock_joybus_release_irq()
+} mock_joybus_reply_t;
+
+/**
+ * Device answer to a command (called at the command stop bit)
+ * @param ctx Device context given to mock_joybus_attach()
+ * @param cmd Command bytes as seen on the wire
+ * @param cmd_len Command length in bytes
+ * @param reply Zeroed with the default delay; fill data and len to answer
+ */
+typedef void (*mock_joybus_device_fn_t)(void *ctx, const uint8_t *cmd, uint cmd_len,
+                                        mock_joybus_reply_t *reply);
+
+/**
+ * Plug a device on a data pin (replaces any device there)
+ * @param pin Data GPIO
+ * @param fn Answer function, NULL to unplug
+ * @param ctx Passed to fn
+ */
+void mock_joybus_attach(uint pin, mock_joybus_device_fn_t fn, void *ctx);
+
+//--------------------------------------------------------------------
+// Statistics
+//--------------------------------------------------------------------
+typedef struct {
+    uint32_t frames;            // Frames started
+    uint32_t absent;            // Frames ended by the presence window
+    uint32_t completed;         // Frames ended by the device stop bit
+    uint32_t stuck;             // Frames left waiting for missing bits
+    uint32_t aborted;           // Frames cut by a restart or FIFO clear
+    uint32_t tx_words;          // Words pulled from the TX FIFO
+    uint32_t rx_words;          // Words autopushed into the RX FIFO
+    uint32_t dma_beats;         // DMA transfers (both directions)
+    uint32_t tx_stalls;         // PULLs that found the TX FIFO empty mid-command
+    uint32_t tx_overflows;      // Writes to a full TX FIFO (lost)
+    uint32_t rx_overflows;      // Pushes to a full RX FIFO (lost)
+    uint64_t busy_ns;           // Line time of all frames
+} mock_joybus_stats_t;
+
+void mock_joybus_get_stats(mock_joybus_stats_t *stats);
+
+/**
+ * Last command seen on a pin
+ * @param pin Data GPIO
+ * @param cmd Filled with up to MOCK_JOYBUS_CMD_MAX bytes (may be NULL)
+ * @return Command length in bytes (0 if none yet)
+ */
+uint mock_joybus_last_command(uint pin, uint8_t *cmd);
+
+/**
+ * Start time of the last frame on a pin
+ * @return Simulated ns
+ */
+uint64_t mock_joybus_last_frame_ns(uint pin);
+
+//--------------------------------------------------------------------
+// Control
+//--------------------------------------------------------------------
+
+/**
+ * Reset the PIO blocks, DMA channels, devices and statistics
+ * (call after mock_sdk_reset(), before the firmware initializes)
+ */
+void mock_joybus_reset(void);
+
+/**
+ * Raise an end-of-frame IRQ held by a reply with hold_irq set
+ * @param pin Data GPIO
+ * @return false if no IRQ is held on that pin
+ */
+bool mock_joybus_release_irq(uint pin);
+
+/**
+ * Decode the TX FIFO the way the byte-per-word program of the first
+ * DMA version did (response length - 1 in bits 28-24 of the first word,
+ * then one command byte per word in bits 31-24, not inverted)
+ * @param legacy true for that format, false for the packed header
+ */
+void mock_joybus_set_legacy_format(bool legacy);
+
+#endif /* MOCK_JOYBUS_H */
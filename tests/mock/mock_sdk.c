@@ -0,0 +1,731 @@
+/*
+ * Host Mock of the Pico SDK
+ * Simulated clock, timed events, IRQ dispatch, alarms, flash, console,
+ * UART and GPIO (see mock_sdk.h)
+ */
+
+#include "mock_sdk.h"
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "pico/multicore.h"
+#include "hardware/timer.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+#include "hardware/flash.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+#define NUM_ALARMS          4
+#define ALARM_IRQ_BASE      0           // TIMER_IRQ_0 to TIMER_IRQ_3
+#define SHARED_HANDLERS_MAX 4
+#define CONSOLE_INPUT_MAX   1024
+#define UART_CAPTURE_MAX    (1024 * 1024)
+
+// Clock and events
+static uint64_t s_now_ns;
+static uint32_t s_read_cost_ns = MOCK_DEFAULT_READ_COST_NS;
+static mock_event_t *s_events;
+static bool s_firing;
+
+// IRQs
+static irq_handler_t s_handlers[MOCK_IRQ_COUNT][SHARED_HANDLERS_MAX];
+static uint32_t s_irq_enabled;
+static uint32_t s_irq_pending;
+static bool s_irq_masked_flag;
+static bool s_in_irq;
+static bool s_event_flag;           // WFE event register
+static void (*s_disable_hook)(void *);
+static void *s_disable_hook_arg;
+static bool s_disable_hook_masked;
+
+// Cores and the firmware runner hook
+static uint s_core;
+static void (*s_step_hook)(bool wfe);
+
+// Alarms
+static bool s_alarm_claimed[NUM_ALARMS];
+static hardware_alarm_callback_t s_alarm_callbacks[NUM_ALARMS];
+static mock_event_t s_alarm_events[NUM_ALARMS];
+
+// Timer registers, refreshed on every step
+static timer_hw_t s_timer_regs;
+timer_hw_t *timer_hw = &s_timer_regs;
+static systick_hw_t s_systick_regs;
+systick_hw_t *systick_hw = &s_systick_regs;
+
+// Flash
+uint8_t mock_flash[PICO_FLASH_SIZE_BYTES];
+static mock_flash_stats_t s_flash_stats;
+static uint32_t s_flash_fail;
+static uint32_t s_flash_erase_us = 45000;      // W25Q16 typical sector erase
+static uint32_t s_flash_program_us = 400;      // W25Q16 typical page program
+
+// Console
+static char s_console_in[CONSOLE_INPUT_MAX];
+static size_t s_console_in_head;
+static size_t s_console_in_len;
+static char *s_console_out;
+static size_t s_console_out_len;
+static size_t s_console_out_cap;
+static int s_verbose = -1;
+
+// Debug UART
+struct uart_inst {
+    int index;
+};
+static struct uart_inst s_uart0 = {0};
+uart_inst_t *const uart0 = &s_uart0;
+static uint8_t *s_uart_out;
+static size_t s_uart_len;
+static uint32_t s_uart_fifo_depth = 32;
+static uint32_t s_uart_byte_ns = 86806;     // 115200 baud, 10 bits per byte
+static uint64_t s_uart_busy_until_ns;       // Last queued byte leaves the FIFO
+
+// GPIO
+static bool s_gpio_out[NUM_BANK0_GPIOS];
+static bool s_gpio_dir[NUM_BANK0_GPIOS];
+static bool s_gpio_in[NUM_BANK0_GPIOS];
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+
+static void update_timer_regs(void) {
+    uint64_t us = s_now_ns / 1000;
+    s_timer_regs.timerawl = (uint32_t)us;
+    s_timer_regs.timerawh = (uint32_t)(us >> 32);
+}
+
+static void dispatch_irqs(void) {
+    if (s_irq_masked_flag || s_in_irq) {
+        return;
+    }
+
+    uint32_t ready;
+    while ((ready = s_irq_pending & s_irq_enabled) != 0) {
+        uint num = (uint)__builtin_ctz(ready);
+        s_irq_pending &= ~(1u << num);
+        s_in_irq = true;
+        for (int i = 0; i < SHARED_HANDLERS_MAX && s_handlers[num][i] != NULL; i++) {
+            s_handlers[num][i]();
+        }
+        s_in_irq = false;
+        s_event_flag = true;    // Exception return wakes WFE
+        if (s_irq_masked_flag) {
+            break;              // Handler returned with IRQs masked (should not happen)
+        }
+    }
+}
+
+// Move the clock to t_ns, firing every event due on the way
+static void step_to(uint64_t t_ns) {
+    if (!s_firing) {
+        s_firing = true;
+        while (s_events != NULL && s_events->at_ns <= t_ns) {
+            mock_event_t *event = s_events;
+            s_events = event->next;
+            event->armed = false;
+            if (event->at_ns > s_now_ns) {
+                s_now_ns = event->at_ns;
+                update_timer_regs();
+            }
+            event->fire(event);
+        }
+        s_firing = false;
+    }
+    if (t_ns > s_now_ns) {
+        s_now_ns = t_ns;
+    }
+    update_timer_regs();
+    dispatch_irqs();
+}
+
+static void cpu_step(void) {
+    step_to(s_now_ns + s_read_cost_ns);
+    if (s_step_hook != NULL && !s_in_irq && !s_irq_masked_flag) {
+        s_step_hook(false);
+    }
+}
+
+static void alarm_fire(mock_event_t *event) {
+    uint alarm = (uint)(uintptr_t)event->arg;
+    mock_irq_set_pending(ALARM_IRQ_BASE + alarm);
+}
+
+static void alarm_irq_handler(uint alarm) {
+    if (s_alarm_callbacks[alarm] != NULL) {
+        s_alarm_callbacks[alarm](alarm);
+    }
+}
+
+static void alarm_irq_0(void) { alarm_irq_handler(0); }
+static void alarm_irq_1(void) { alarm_irq_handler(1); }
+static void alarm_irq_2(void) { alarm_irq_handler(2); }
+static void alarm_irq_3(void) { alarm_irq_handler(3); }
+
+static bool verbose(void) {
+    if (s_verbose < 0) {
+        const char *env = getenv("N64_TEST_VERBOSE");
+        s_verbose = (env != NULL && env[0] != '\0' && env[0] != '0') ? 1 : 0;
+    }
+    return s_verbose == 1;
+}
+
+static void console_append(const char *text, size_t len) {
+    if (s_console_out_len + len + 1 > s_console_out_cap) {
+        size_t cap = s_console_out_cap ? s_console_out_cap : 4096;
+        while (cap < s_console_out_len + len + 1) {
+            cap *= 2;
+        }
+        s_console_out = realloc(s_console_out, cap);
+        if (s_console_out == NULL) {
+            abort();
+        }
+        s_console_out_cap = cap;
+    }
+    memcpy(s_console_out + s_console_out_len, text, len);
+    s_console_out_len += len;
+    s_console_out[s_console_out_len] = '\0';
+}
+
+// Device format strings print uint32_t with %lu/%ld/%lx: drop the 'l'
+static void host_format(const char *format, char *out, size_t size) {
+    size_t o = 0;
+    for (const char *p = format; *p != '\0' && o + 1 < size; p++) {
+        out[o++] = *p;
+        if (*p != '%') {
+            continue;
+        }
+        // Copy flags, width and precision
+        p++;
+        while (*p != '\0' && strchr("-+ #0123456789.*", *p) != NULL && o + 1 < size) {
+            out[o++] = *p++;
+        }
+        if (p[0] == 'l' && p[1] != 'l' && strchr("diuxXo", p[1]) != NULL) {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        if (o + 1 < size) {
+            out[o++] = *p;
+        }
+    }
+    out[o] = '\0';
+}
+
+//--------------------------------------------------------------------
+// Test Interface
+//--------------------------------------------------------------------
+
+void mock_event_at(mock_event_t *event, uint64_t at_ns) {
+    mock_event_cancel(event);
+    event->at_ns = at_ns;
+    event->armed = true;
+
+    // Sorted by time, same-time events fire in scheduling order
+    mock_event_t **link = &s_events;
+    while (*link != NULL && (*link)->at_ns <= at_ns) {
+        link = &(*link)->next;
+    }
+    event->next = *link;
+    *link = event;
+}
+
+void mock_event_cancel(mock_event_t *event) {
+    if (!event->armed) {
+        return;
+    }
+    for (mock_event_t **link = &s_events; *link != NULL; link = &(*link)->next) {
+        if (*link == event) {
+            *link = event->next;
+            break;
+        }
+    }
+    event->armed = false;
+}
+
+void mock_sdk_reset(void) {
+    s_now_ns = 0;
+    s_read_cost_ns = MOCK_DEFAULT_READ_COST_NS;
+    s_events = NULL;
+    s_firing = false;
+
+    memset(s_handlers, 0, sizeof(s_handlers));
+    s_irq_enabled = 0;
+    s_irq_pending = 0;
+    s_irq_masked_flag = false;
+    s_in_irq = false;
+    s_event_flag = false;
+    s_disable_hook = NULL;
+    s_core = 0;
+    s_step_hook = NULL;
+
+    for (uint i = 0; i < NUM_ALARMS; i++) {
+        s_alarm_claimed[i] = false;
+        s_alarm_callbacks[i] = NULL;
+        memset(&s_alarm_events[i], 0, sizeof(s_alarm_events[i]));
+    }
+    update_timer_regs();
+
+    memset(mock_flash, 0xFF, sizeof(mock_flash));
+    memset(&s_flash_stats, 0, sizeof(s_flash_stats));
+    s_flash_fail = 0;
+
+    s_console_in_head = 0;
+    s_console_in_len = 0;
+    mock_console_clear();
+    mock_uart_clear();
+    s_uart_busy_until_ns = 0;
+
+    for (int i = 0; i < NUM_BANK0_GPIOS; i++) {
+        s_gpio_out[i] = false;
+        s_gpio_dir[i] = false;
+        s_gpio_in[i] = true;
+    }
+}
+
+uint64_t mock_now_ns(void) {
+    return s_now_ns;
+}
+
+uint64_t mock_now_us(void) {
+    return s_now_ns / 1000;
+}
+
+void mock_set_read_cost_ns(uint32_t ns) {
+    s_read_cost_ns = ns;
+}
+
+void mock_advance_to_ns(uint64_t t_ns) {
+    step_to(t_ns);
+}
+
+void mock_advance_us(uint64_t us) {
+    step_to(s_now_ns + us * 1000);
+}
+
+uint64_t mock_next_event_ns(void) {
+    return (s_events != NULL) ? s_events->at_ns : UINT64_MAX;
+}
+
+void mock_irq_set_pending(uint num) {
+    s_irq_pending |= 1u << num;
+    s_event_flag = true;
+    dispatch_irqs();
+}
+
+void mock_on_next_irq_disable(void (*fn)(void *arg), void *arg, bool masked) {
+    s_disable_hook = fn;
+    s_disable_hook_arg = arg;
+    s_disable_hook_masked = masked;
+}
+
+bool mock_irq_masked(void) {
+    return s_irq_masked_flag;
+}
+
+void mock_set_core(uint core) {
+    s_core = core;
+}
+
+void mock_set_step_hook(void (*hook)(bool wfe)) {
+    s_step_hook = hook;
+}
+
+void mock_flash_fail_next(uint32_t count) {
+    s_flash_fail = count;
+}
+
+void mock_flash_set_timing(uint32_t erase_us, uint32_t program_us) {
+    s_flash_erase_us = erase_us;
+    s_flash_program_us = program_us;
+}
+
+void mock_flash_get_stats(mock_flash_stats_t *stats) {
+    *stats = s_flash_stats;
+}
+
+void mock_console_input(const char *text) {
+    size_t len = strlen(text);
+    if (s_console_in_head > 0) {
+        memmove(s_console_in, s_console_in + s_console_in_head,
+                s_console_in_len - s_console_in_head);
+        s_console_in_len -= s_console_in_head;
+        s_console_in_head = 0;
+    }
+    if (s_console_in_len + len > sizeof(s_console_in)) {
+        abort();
+    }
+    memcpy(s_console_in + s_console_in_len, text, len);
+    s_console_in_len += len;
+}
+
+const char *mock_console_find(const char *needle) {
+    return (s_console_out != NULL) ? strstr(s_console_out, needle) : NULL;
+}
+
+const char *mock_console_output(void) {
+    return (s_console_out != NULL) ? s_console_out : "";
+}
+
+void mock_console_clear(void) {
+    s_console_out_len = 0;
+    if (s_console_out != NULL) {
+        s_console_out[0] = '\0';
+    }
+}
+
+void mock_uart_set_model(uint32_t fifo_depth, uint32_t byte_ns) {
+    s_uart_fifo_depth = fifo_depth;
+    s_uart_byte_ns = byte_ns;
+}
+
+const uint8_t *mock_uart_output(size_t *len) {
+    *len = s_uart_len;
+    return s_uart_out;
+}
+
+void mock_uart_clear(void) {
+    s_uart_len = 0;
+}
+
+void mock_gpio_set_input(uint gpio, bool level) {
+    s_gpio_in[gpio] = level;
+}
+
+bool mock_gpio_get_output(uint gpio) {
+    return s_gpio_out[gpio];
+}
+
+bool mock_gpio_is_output(uint gpio) {
+    return s_gpio_dir[gpio];
+}
+
+int mock_printf(const char *restrict format, ...) {
+    char host[512];
+    char text[2048];
+    host_format(format, host, sizeof(host));
+
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(text, sizeof(text), host, args);
+    va_end(args);
+    if (len < 0) {
+        return len;
+    }
+    size_t used = ((size_t)len < sizeof(text)) ? (size_t)len : sizeof(text) - 1;
+    console_append(text, used);
+    if (verbose()) {
+        fwrite(text, 1, used, stdout);
+    }
+    return len;
+}
+
+//--------------------------------------------------------------------
+// pico_time / hardware_timer
+//--------------------------------------------------------------------
+
+uint64_t time_us_64(void) {
+    cpu_step();
+    return s_now_ns / 1000;
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t)time_us_64();
+}
+
+absolute_time_t get_absolute_time(void) {
+    return time_us_64();
+}
+
+void busy_wait_us_32(uint32_t delay_us) {
+    step_to(s_now_ns + (uint64_t)delay_us * 1000);
+}
+
+void busy_wait_us(uint64_t delay_us) {
+    step_to(s_now_ns + delay_us * 1000);
+}
+
+void sleep_us(uint64_t us) {
+    busy_wait_us(us);
+}
+
+void sleep_ms(uint32_t ms) {
+    busy_wait_us((uint64_t)ms * 1000);
+}
+
+int hardware_alarm_claim_unused(bool required) {
+    for (uint i = 0; i < NUM_ALARMS; i++) {
+        if (!s_alarm_claimed[i]) {
+            s_alarm_claimed[i] = true;
+            return (int)i;
+        }
+    }
+    if (required) {
+        abort();
+    }
+    return -1;
+}
+
+void hardware_alarm_unclaim(uint alarm_num) {
+    hardware_alarm_cancel(alarm_num);
+    s_alarm_claimed[alarm_num] = false;
+}
+
+void hardware_alarm_set_callback(uint alarm_num, hardware_alarm_callback_t callback) {
+    static const irq_handler_t handlers[NUM_ALARMS] = {
+        alarm_irq_0, alarm_irq_1, alarm_irq_2, alarm_irq_3
+    };
+    s_alarm_callbacks[alarm_num] = callback;
+    s_handlers[ALARM_IRQ_BASE + alarm_num][0] = callback ? handlers[alarm_num] : NULL;
+    s_irq_enabled |= 1u << (ALARM_IRQ_BASE + alarm_num);
+}
+
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t target) {
+    mock_event_t *event = &s_alarm_events[alarm_num];
+    mock_event_cancel(event);
+    if (target * 1000 <= s_now_ns) {
+        return true;    // Missed
+    }
+    event->fire = alarm_fire;
+    event->arg = (void *)(uintptr_t)alarm_num;
+    mock_event_at(event, target * 1000);
+    return false;
+}
+
+void hardware_alarm_cancel(uint alarm_num) {
+    mock_event_cancel(&s_alarm_events[alarm_num]);
+    s_irq_pending &= ~(1u << (ALARM_IRQ_BASE + alarm_num));
+}
+
+//--------------------------------------------------------------------
+// hardware_sync / hardware_irq
+//--------------------------------------------------------------------
+
+uint32_t save_and_disable_interrupts(void) {
+    void (*hook)(void *) = s_disable_hook;
+    if (hook != NULL && !s_disable_hook_masked) {
+        s_disable_hook = NULL;
+        hook(s_disable_hook_arg);
+        dispatch_irqs();
+    }
+
+    uint32_t status = s_irq_masked_flag ? 1u : 0u;
+    s_irq_masked_flag = true;
+
+    hook = s_disable_hook;
+    if (hook != NULL && s_disable_hook_masked) {
+        s_disable_hook = NULL;
+        hook(s_disable_hook_arg);
+    }
+    return status;
+}
+
+void restore_interrupts(uint32_t status) {
+    s_irq_masked_flag = (status != 0);
+    dispatch_irqs();
+}
+
+void mock_wfe(void) {
+    if (s_step_hook != NULL) {
+        s_step_hook(true);
+    }
+    if (s_event_flag) {
+        s_event_flag = false;
+        return;
+    }
+
+    // Sleep until the next hardware event (or 1 ms if nothing is scheduled)
+    uint64_t wake_ns = mock_next_event_ns();
+    if (wake_ns == UINT64_MAX) {
+        wake_ns = s_now_ns + 1000000;
+    }
+    step_to(wake_ns > s_now_ns ? wake_ns : s_now_ns);
+    s_event_flag = false;
+}
+
+void mock_sev(void) {
+    s_event_flag = true;
+}
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority) {
+    (void)order_priority;
+    for (int i = 0; i < SHARED_HANDLERS_MAX; i++) {
+        if (s_handlers[num][i] == NULL) {
+            s_handlers[num][i] = handler;
+            return;
+        }
+    }
+    abort();
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+    memset(s_handlers[num], 0, sizeof(s_handlers[num]));
+    s_handlers[num][0] = handler;
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+    if (enabled) {
+        s_irq_enabled |= 1u << num;
+        dispatch_irqs();
+    } else {
+        s_irq_enabled &= ~(1u << num);
+    }
+}
+
+//--------------------------------------------------------------------
+// Platform, clocks, stdio, multicore
+//--------------------------------------------------------------------
+
+uint get_core_num(void) {
+    return s_core;
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index) {
+    (void)clk_index;
+    return 125000000;
+}
+
+bool stdio_init_all(void) {
+    return true;
+}
+
+int getchar_timeout_us(uint32_t timeout_us) {
+    (void)timeout_us;
+    if (s_console_in_head >= s_console_in_len) {
+        return PICO_ERROR_TIMEOUT;
+    }
+    return (unsigned char)s_console_in[s_console_in_head++];
+}
+
+void multicore_launch_core1(void (*entry)(void)) {
+    (void)entry;
+    fprintf(stderr, "mock: multicore_launch_core1 is not supported on the host\n");
+    abort();
+}
+
+void multicore_fifo_push_blocking(uint32_t data) {
+    (void)data;
+}
+
+uint32_t multicore_fifo_pop_blocking(void) {
+    return 0;
+}
+
+//--------------------------------------------------------------------
+// Flash
+//--------------------------------------------------------------------
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms) {
+    (void)enter_exit_timeout_ms;
+    s_flash_stats.safe_calls++;
+    if (s_flash_fail > 0) {
+        s_flash_fail--;
+        s_flash_stats.failures++;
+        return PICO_ERROR_TIMEOUT_FLASH;
+    }
+
+    // Both cores stop executing from flash: IRQs masked for the whole op
+    uint32_t status = save_and_disable_interrupts();
+    uint64_t start_ns = s_now_ns;
+    func(param);
+    uint32_t busy_us = (uint32_t)((s_now_ns - start_ns) / 1000);
+    restore_interrupts(status);
+
+    s_flash_stats.busy_us += busy_us;
+    if (busy_us > s_flash_stats.max_busy_us) {
+        s_flash_stats.max_busy_us = busy_us;
+    }
+    return PICO_OK;
+}
+
+bool flash_safe_execute_core_init(void) {
+    return true;
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    if (flash_offs % FLASH_SECTOR_SIZE != 0 || count % FLASH_SECTOR_SIZE != 0 ||
+        flash_offs + count > PICO_FLASH_SIZE_BYTES) {
+        fprintf(stderr, "mock: bad flash erase 0x%x + %zu\n", flash_offs, count);
+        abort();
+    }
+    memset(&mock_flash[flash_offs], 0xFF, count);
+    s_flash_stats.erases += (uint32_t)(count / FLASH_SECTOR_SIZE);
+    step_to(s_now_ns + (uint64_t)s_flash_erase_us * 1000 * (count / FLASH_SECTOR_SIZE));
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count) {
+    if (flash_offs % FLASH_PAGE_SIZE != 0 || count % FLASH_PAGE_SIZE != 0 ||
+        flash_offs + count > PICO_FLASH_SIZE_BYTES) {
+        fprintf(stderr, "mock: bad flash program 0x%x + %zu\n", flash_offs, count);
+        abort();
+    }
+    // NOR flash: programming only clears bits
+    for (size_t i = 0; i < count; i++) {
+        mock_flash[flash_offs + i] &= data[i];
+    }
+    s_flash_stats.programs += (uint32_t)(count / FLASH_PAGE_SIZE);
+    step_to(s_now_ns + (uint64_t)s_flash_program_us * 1000 * (count / FLASH_PAGE_SIZE));
+}
+
+//--------------------------------------------------------------------
+// Debug UART
+//--------------------------------------------------------------------
+
+bool uart_is_writable(uart_inst_t *uart) {
+    (void)uart;
+    if (s_uart_fifo_depth == 0) {
+        return false;
+    }
+    // Bytes still in the FIFO at the current time
+    uint64_t pending_ns = (s_uart_busy_until_ns > s_now_ns) ? s_uart_busy_until_ns - s_now_ns : 0;
+    uint64_t level = s_uart_byte_ns ? (pending_ns + s_uart_byte_ns - 1) / s_uart_byte_ns : 0;
+    return level < s_uart_fifo_depth;
+}
+
+void uart_putc_raw(uart_inst_t *uart, char c) {
+    (void)uart;
+    if (s_uart_out == NULL) {
+        s_uart_out = malloc(UART_CAPTURE_MAX);
+        if (s_uart_out == NULL) {
+            abort();
+        }
+    }
+    if (s_uart_len < UART_CAPTURE_MAX) {
+        s_uart_out[s_uart_len++] = (uint8_t)c;
+    }
+    uint64_t start_ns = (s_uart_busy_until_ns > s_now_ns) ? s_uart_busy_until_ns : s_now_ns;
+    s_uart_busy_until_ns = start_ns + s_uart_byte_ns;
+}
+
+//--------------------------------------------------------------------
+// GPIO
+//--------------------------------------------------------------------
+
+void gpio_init(uint gpio) {
+    s_gpio_dir[gpio] = false;
+    s_gpio_out[gpio] = false;
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    s_gpio_dir[gpio] = out;
+}
+
+void gpio_put(uint gpio, bool value) {
+    s_gpio_out[gpio] = value;
+}
+
+bool gpio_get(uint gpio) {
+    return s_gpio_dir[gpio] ? s_gpio_out[gpio] : s_gpio_in[gpio];
+}
+
+void gpio_pull_up(uint gpio) {
+    (void)gpio;
+}
@@ -0,0 +1,219 @@
+/*
+ * Host Mock of the Pico SDK - Test Interface
+ *
+ * Simulated time: a nanosecond clock that only moves when the firmware
+ * reads the time (each read costs MOCK_DEFAULT_READ_COST_NS of CPU time),
+ * busy-waits, sleeps in __wfe(), or when a test advances it. Hardware
+ * activity (PIO frames, USB host reads, alarms) is a list of timed events
+ * fired as the clock passes them; IRQ handlers run after the events, only
+ * while interrupts are not masked and no other handler is active, like
+ * on a single Cortex-M0+ core.
+ *
+ * Also here: the RAM flash behind XIP_BASE, the console (printf capture
+ * and getchar input), the debug UART and the GPIOs.
+ */
+
+#ifndef MOCK_SDK_H
+#define MOCK_SDK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "pico/types.h"
+
+#define MOCK_DEFAULT_READ_COST_NS   50      // CPU time charged per time read
+#define MOCK_IRQ_COUNT              32
+
+//--------------------------------------------------------------------
+// Timed Events
+//--------------------------------------------------------------------
+typedef struct mock_event mock_event_t;
+typedef void (*mock_event_fn_t)(mock_event_t *event);
+
+struct mock_event {
+    uint64_t at_ns;             // Fire time
+    mock_event_fn_t fire;       // Called from the clock, never from an IRQ
+    void *arg;
+    bool armed;
+    mock_event_t *next;
+};
+
+/**
+ * Schedule (or move) an event; a time in the past fires on the next step
+ * @param event Event with fire and arg set
+ * @param at_ns Fire time (simulated ns)
+ */
+void mock_event_at(mock_event_t *event, uint64_t at_ns);
+
+/**
+ * Cancel an event (no effect if not armed)
+ * @param event Event
+ */
+void mock_event_cancel(mock_event_t *event);
+
+//--------------------------------------------------------------------
+// Clock
+//--------------------------------------------------------------------
+
+/**
+ * Reset the whole mock (clock at 0, no events, IRQs, flash erased,
+ * console and UART empty); mock devices must be attached again
+ */
+void mock_sdk_reset(void);
+
+uint64_t mock_now_ns(void);
+uint64_t mock_now_us(void);
+
+/**
+ * Set the CPU time charged for every time read (0 = free)
+ * @param ns Simulated nanoseconds per read
+ */
+void mock_set_read_cost_ns(uint32_t ns);
+
+/**
+ * Advance the clock (test context), firing events and IRQs on the way
+ * @param t_ns Target time (simulated ns)
+ */
+void mock_advance_to_ns(uint64_t t_ns);
+
+/**
+ * Advance the clock by a duration (test context)
+ * @param us Microseconds
+ */
+void mock_advance_us(uint64_t us);
+
+/**
+ * Time of the next armed event
+ * @return Fire time in ns, or UINT64_MAX if none
+ */
+uint64_t mock_next_event_ns(void);
+
+//--------------------------------------------------------------------
+// IRQs
+//--------------------------------------------------------------------
+
+/**
+ * Latch an IRQ as pending (dispatched at once if unmasked and enabled,
+ * otherwise when it becomes so)
+ * @param num IRQ number
+ */
+void mock_irq_set_pending(uint num);
+
+/**
+ * Run a function once, from the next save_and_disable_interrupts(),
+ * either just before the mask is taken or just after
+ * @param fn Function
+ * @param arg Its argument
+ * @param masked true to run it inside the masked section
+ */
+void mock_on_next_irq_disable(void (*fn)(void *arg), void *arg, bool masked);
+
+bool mock_irq_masked(void);
+
+//--------------------------------------------------------------------
+// Cores
+//--------------------------------------------------------------------
+
+/**
+ * Core number returned by get_core_num()
+ * @param core 0 or 1
+ */
+void mock_set_core(uint core);
+
+/**
+ * Called whenever the firmware sleeps in __wfe() or the clock moves
+ * (mock_firmware.c uses it to switch back to the test)
+ * @param hook Function, NULL to remove
+ */
+void mock_set_step_hook(void (*hook)(bool wfe));
+
+//--------------------------------------------------------------------
+// Flash (XIP_BASE points at mock_flash)
+//--------------------------------------------------------------------
+typedef struct {
+    uint32_t erases;            // Sectors erased
+    uint32_t programs;          // Pages programmed
+    uint32_t safe_calls;        // flash_safe_execute() calls
+    uint32_t failures;          // Refused flash_safe_execute() calls
+    uint64_t busy_us;           // Time spent with IRQs masked in flash ops
+    uint32_t max_busy_us;       // Longest single flash_safe_execute()
+} mock_flash_stats_t;
+
+extern uint8_t mock_flash[];
+
+/**
+ * Make the next flash_safe_execute() calls fail without running
+ * @param count Number of calls to refuse
+ */
+void mock_flash_fail_next(uint32_t count);
+
+/**
+ * Set the simulated flash operation times (IRQs masked meanwhile)
+ * @param erase_us Sector erase
+ * @param program_us Page program
+ */
+void mock_flash_set_timing(uint32_t erase_us, uint32_t program_us);
+
+void mock_flash_get_stats(mock_flash_stats_t *stats);
+
+//--------------------------------------------------------------------
+// Console (printf of the firmware, getchar_timeout_us input)
+//--------------------------------------------------------------------
+
+/**
+ * Queue console input
+ * @param text Characters returned by getchar_timeout_us()
+ */
+void mock_console_input(const char *text);
+
+/**
+ * Find text printed since the last mock_console_clear()
+ * @param needle Text to look for
+ * @return Pointer to the first match in the capture, NULL if absent
+ */
+const char *mock_console_find(const char *needle);
+
+/**
+ * Captured console output (NUL-terminated)
+ */
+const char *mock_console_output(void);
+
+void mock_console_clear(void);
+
+//--------------------------------------------------------------------
+// Debug UART (raw bytes: trace records)
+//--------------------------------------------------------------------
+
+/**
+ * Set the UART model: FIFO depth and time per byte
+ * @param fifo_depth Bytes the TX FIFO holds (0 = never writable)
+ * @param byte_ns Drain time of one byte
+ */
+void mock_uart_set_model(uint32_t fifo_depth, uint32_t byte_ns);
+
+/**
+ * Raw bytes written so far
+ * @param len Filled with the byte count
+ * @return Capture buffer
+ */
+const uint8_t *mock_uart_output(size_t *len);
+
+void mock_uart_clear(void);
+
+//--------------------------------------------------------------------
+// GPIO
+//--------------------------------------------------------------------
+
+/**
+ * Level read by gpio_get() on an input (default high: pull-ups)
+ */
+void mock_gpio_set_input(uint gpio, bool level);
+
+/**
+ * Last level written with gpio_put()
+ */
+bool mock_gpio_get_output(uint gpio);
+
+bool mock_gpio_is_output(uint gpio);
+
+#endif /* MOCK_SDK_H */
@@ -0,0 +1,18 @@
+/*
+ * Console capture for the firmware sources (forced include, host build)
+ * printf() of the firmware goes to mock_printf(), which keeps the text for
+ * the tests and echoes it when N64_TEST_VERBOSE is set. The device prints
+ * uint32_t (unsigned long on the RP2040) with %lu: the length modifier is
+ * dropped before formatting, so the 32-bit values print right on LP64.
+ */
+
+#ifndef MOCK_STDIO_H
+#define MOCK_STDIO_H
+
+#include <stdio.h>
+
+int mock_printf(const char *restrict format, ...);
+
+#define printf mock_printf
+
+#endif /* MOCK_STDIO_H */
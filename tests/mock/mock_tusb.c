@@ -0,0 +1,540 @@
+/*
+ * Host Mock of the TinyUSB Device Stack
+ * Simulated full-speed host (see mock_tusb.h): SOF and HID IN reads are
+ * timed events of the mock clock, everything the firmware sees goes
+ * through the event queue drained by tud_task()
+ */
+
+#include "mock_tusb.h"
+#include "mock_sdk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Firmware Callbacks (weak defaults for builds without the class code)
+//--------------------------------------------------------------------
+const uint8_t *tud_descriptor_configuration_cb(uint8_t index);
+
+__attribute__((weak)) void tud_mount_cb(void) {}
+__attribute__((weak)) void tud_umount_cb(void) {}
+__attribute__((weak)) void tud_suspend_cb(bool remote_wakeup_en) { (void)remote_wakeup_en; }
+__attribute__((weak)) void tud_sof_cb(uint32_t frame_count) { (void)frame_count; }
+
+__attribute__((weak)) void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report,
+                                                      uint16_t len) {
+    (void)instance;
+    (void)report;
+    (void)len;
+}
+
+__attribute__((weak)) uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id,
+                                                      hid_report_type_t report_type,
+                                                      uint8_t *buffer, uint16_t reqlen) {
+    (void)instance;
+    (void)report_id;
+    (void)report_type;
+    (void)buffer;
+    (void)reqlen;
+    return 0;
+}
+
+__attribute__((weak)) void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id,
+                                                 hid_report_type_t report_type,
+                                                 uint8_t const *buffer, uint16_t bufsize) {
+    (void)instance;
+    (void)report_id;
+    (void)report_type;
+    (void)buffer;
+    (void)bufsize;
+}
+
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+#define FRAME_NS            1000000u
+#define FRAME_MASK          0x7FF
+#define EVENT_QUEUE_SIZE    64
+#define LOG_MAX             65536
+#define VENDOR_FIFO_SIZE    (64 * 1024)
+#define MSC_LUN_MAX         8
+
+typedef enum {
+    EV_MOUNT,
+    EV_UMOUNT,
+    EV_SOF,
+    EV_XFER_COMPLETE,
+    EV_SET_REPORT
+} event_type_t;
+
+typedef struct {
+    event_type_t type;
+    uint8_t instance;
+    uint8_t report_id;
+    hid_report_type_t report_type;
+    uint32_t frame;
+    uint16_t len;
+    uint8_t data[MOCK_TUSB_REPORT_MAX];
+} task_event_t;
+
+typedef struct {
+    uint8_t interval;           // bInterval (frames)
+    bool busy;                  // Report queued or completion not processed
+    bool queued;                // Report waiting for the host
+    uint8_t len;
+    uint8_t data[MOCK_TUSB_REPORT_MAX];
+    uint64_t submit_ns;
+} hid_endpoint_t;
+
+// Device state
+static bool s_initialized;
+static bool s_connected;
+static bool s_mounted;
+static bool s_sof_enabled;
+static uint32_t s_frame;
+
+// Host timing
+static uint32_t s_read_offset_ns = 100000;
+static uint32_t s_task_cost_ns = 2000;
+static mock_event_t s_sof_event;
+static mock_event_t s_read_event;
+static mock_event_t s_mount_event;
+
+// HID endpoints (from the configuration descriptor)
+static hid_endpoint_t s_hid[MOCK_TUSB_HID_MAX];
+static uint s_hid_count;
+
+// Event queue drained by tud_task()
+static task_event_t s_queue[EVENT_QUEUE_SIZE];
+static uint s_queue_head;
+static uint s_queue_len;
+
+// Read log and statistics
+static mock_hid_read_t *s_log;
+static size_t s_log_len;
+static mock_tusb_stats_t s_stats;
+
+// Vendor bulk interface
+static uint8_t s_vendor_rx[VENDOR_FIFO_SIZE];   // Host -> device
+static uint32_t s_vendor_rx_head;
+static uint32_t s_vendor_rx_len;
+static uint8_t s_vendor_tx[CFG_TUD_VENDOR_TX_BUFSIZE ? CFG_TUD_VENDOR_TX_BUFSIZE : 1];
+static uint32_t s_vendor_tx_len;                // Written by the firmware
+static uint32_t s_vendor_tx_flushed;            // Of which flushed to the host
+static uint8_t s_vendor_host[VENDOR_FIFO_SIZE]; // Received by the host
+static uint32_t s_vendor_host_len;
+static uint32_t s_vendor_rate = 1216;
+
+// Mass storage sense per LUN
+static uint8_t s_sense_key[MSC_LUN_MAX];
+static uint8_t s_sense_asc[MSC_LUN_MAX];
+static uint8_t s_sense_ascq[MSC_LUN_MAX];
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+
+static task_event_t *queue_event(event_type_t type) {
+    if (s_queue_len >= EVENT_QUEUE_SIZE) {
+        fprintf(stderr, "mock_tusb: event queue overflow (tud_task not called)\n");
+        abort();
+    }
+    task_event_t *event = &s_queue[(s_queue_head + s_queue_len) % EVENT_QUEUE_SIZE];
+    s_queue_len++;
+    memset(event, 0, sizeof(*event));
+    event->type = type;
+    return event;
+}
+
+static void log_read(uint8_t instance, const hid_endpoint_t *ep) {
+    if (s_log == NULL) {
+        s_log = malloc(LOG_MAX * sizeof(*s_log));
+        if (s_log == NULL) {
+            abort();
+        }
+    }
+    if (s_log_len >= LOG_MAX) {
+        return;
+    }
+    mock_hid_read_t *entry = &s_log[s_log_len++];
+    entry->instance = instance;
+    entry->len = ep->len;
+    memcpy(entry->data, ep->data, ep->len);
+    entry->submit_ns = ep->submit_ns;
+    entry->read_ns = mock_now_ns();
+}
+
+// One HID interface after another: the endpoint following each HID
+// interface descriptor gives that instance's bInterval
+static void parse_configuration(void) {
+    const uint8_t *desc = tud_descriptor_configuration_cb(0);
+    uint total = (uint)desc[2] | ((uint)desc[3] << 8);
+    bool in_hid = false;
+
+    s_hid_count = 0;
+    for (uint pos = 0; pos + 1 < total && desc[pos] != 0; pos += desc[pos]) {
+        const uint8_t *d = &desc[pos];
+        if (d[1] == TUSB_DESC_INTERFACE) {
+            in_hid = (d[5] == TUSB_CLASS_HID);
+        } else if (d[1] == TUSB_DESC_ENDPOINT && in_hid && (d[2] & 0x80)) {
+            if (s_hid_count >= MOCK_TUSB_HID_MAX) {
+                abort();
+            }
+            memset(&s_hid[s_hid_count], 0, sizeof(s_hid[s_hid_count]));
+            s_hid[s_hid_count].interval = d[6] ? d[6] : 1;
+            s_hid_count++;
+            in_hid = false;
+        }
+    }
+}
+
+static void mount_fire(mock_event_t *event) {
+    (void)event;
+    parse_configuration();
+    queue_event(EV_MOUNT);
+}
+
+static void read_fire(mock_event_t *event) {
+    (void)event;
+    if (!s_mounted) {
+        return;
+    }
+
+    // Endpoints spread over the frames of their interval, like host schedules
+    for (uint i = 0; i < s_hid_count; i++) {
+        hid_endpoint_t *ep = &s_hid[i];
+        if ((s_frame % ep->interval) != (i % ep->interval)) {
+            continue;
+        }
+        if (!ep->queued) {
+            s_stats.naks++;
+            continue;
+        }
+        ep->queued = false;
+        s_stats.reads++;
+        log_read((uint8_t)i, ep);
+
+        task_event_t *complete = queue_event(EV_XFER_COMPLETE);
+        complete->instance = (uint8_t)i;
+        complete->len = ep->len;
+        memcpy(complete->data, ep->data, ep->len);
+    }
+}
+
+static void vendor_take(void) {
+    uint32_t take = s_vendor_tx_flushed < s_vendor_rate ? s_vendor_tx_flushed : s_vendor_rate;
+    if (take > sizeof(s_vendor_host) - s_vendor_host_len) {
+        take = (uint32_t)(sizeof(s_vendor_host) - s_vendor_host_len);
+    }
+    if (take == 0) {
+        return;
+    }
+    memcpy(&s_vendor_host[s_vendor_host_len], s_vendor_tx, take);
+    s_vendor_host_len += take;
+    memmove(s_vendor_tx, &s_vendor_tx[take], s_vendor_tx_len - take);
+    s_vendor_tx_len -= take;
+    s_vendor_tx_flushed -= take;
+}
+
+static void sof_fire(mock_event_t *event) {
+    s_frame = (s_frame + 1) & FRAME_MASK;
+    s_stats.frames++;
+    if (s_mounted && s_sof_enabled) {
+        queue_event(EV_SOF)->frame = s_frame;
+    }
+    if (s_mounted) {
+        vendor_take();
+    }
+    mock_event_at(&s_read_event, event->at_ns + s_read_offset_ns);
+    mock_event_at(&s_sof_event, event->at_ns + FRAME_NS);
+}
+
+//--------------------------------------------------------------------
+// Test Interface
+//--------------------------------------------------------------------
+
+void mock_tusb_reset(void) {
+    mock_event_cancel(&s_sof_event);
+    mock_event_cancel(&s_read_event);
+    mock_event_cancel(&s_mount_event);
+    s_sof_event.fire = sof_fire;
+    s_read_event.fire = read_fire;
+    s_mount_event.fire = mount_fire;
+
+    s_initialized = false;
+    s_connected = false;
+    s_mounted = false;
+    s_sof_enabled = false;
+    s_frame = 0;
+    s_read_offset_ns = 100000;
+    s_task_cost_ns = 2000;
+    memset(s_hid, 0, sizeof(s_hid));
+    s_hid_count = 0;
+    s_queue_head = 0;
+    s_queue_len = 0;
+    s_log_len = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    s_vendor_rx_head = 0;
+    s_vendor_rx_len = 0;
+    s_vendor_tx_len = 0;
+    s_vendor_tx_flushed = 0;
+    s_vendor_host_len = 0;
+    s_vendor_rate = 1216;
+    memset(s_sense_key, 0, sizeof(s_sense_key));
+}
+
+void mock_tusb_connect(uint32_t enumerate_us) {
+    if (!s_initialized) {
+        fprintf(stderr, "mock_tusb: connect before tusb_init()\n");
+        abort();
+    }
+    s_connected = true;
+    mock_event_at(&s_sof_event, mock_now_ns() + FRAME_NS);
+    mock_event_at(&s_mount_event, mock_now_ns() + (uint64_t)enumerate_us * 1000);
+}
+
+void mock_tusb_disconnect(void) {
+    s_connected = false;
+    mock_event_cancel(&s_sof_event);
+    mock_event_cancel(&s_read_event);
+    mock_event_cancel(&s_mount_event);
+    for (uint i = 0; i < s_hid_count; i++) {
+        s_hid[i].queued = false;
+    }
+    queue_event(EV_UMOUNT);
+}
+
+void mock_tusb_set_read_offset_ns(uint32_t offset_ns) {
+    s_read_offset_ns = offset_ns;
+}
+
+void mock_tusb_set_task_cost_ns(uint32_t ns) {
+    s_task_cost_ns = ns;
+}
+
+uint mock_tusb_hid_instances(void) {
+    return s_hid_count;
+}
+
+uint8_t mock_tusb_hid_interval(uint8_t instance) {
+    return (instance < s_hid_count) ? s_hid[instance].interval : 0;
+}
+
+const mock_hid_read_t *mock_tusb_log(size_t *count) {
+    *count = s_log_len;
+    return s_log;
+}
+
+void mock_tusb_clear_log(void) {
+    s_log_len = 0;
+}
+
+void mock_tusb_get_stats(mock_tusb_stats_t *stats) {
+    *stats = s_stats;
+}
+
+void mock_tusb_set_report(uint8_t instance, uint8_t report_id, hid_report_type_t type,
+                          const void *data, uint16_t len) {
+    if (len > MOCK_TUSB_REPORT_MAX) {
+        abort();
+    }
+    task_event_t *event = queue_event(EV_SET_REPORT);
+    event->instance = instance;
+    event->report_id = report_id;
+    event->report_type = type;
+    event->len = len;
+    memcpy(event->data, data, len);
+}
+
+uint16_t mock_tusb_get_report(uint8_t instance, uint8_t report_id, hid_report_type_t type,
+                              void *buffer, uint16_t reqlen) {
+    return tud_hid_get_report_cb(instance, report_id, type, buffer, reqlen);
+}
+
+void mock_tusb_vendor_send(const void *data, uint32_t len) {
+    if (s_vendor_rx_head > 0) {
+        memmove(s_vendor_rx, &s_vendor_rx[s_vendor_rx_head], s_vendor_rx_len);
+        s_vendor_rx_head = 0;
+    }
+    if (s_vendor_rx_len + len > sizeof(s_vendor_rx)) {
+        abort();
+    }
+    memcpy(&s_vendor_rx[s_vendor_rx_len], data, len);
+    s_vendor_rx_len += len;
+}
+
+uint32_t mock_tusb_vendor_receive(void *buffer, uint32_t max) {
+    uint32_t len = s_vendor_host_len < max ? s_vendor_host_len : max;
+    memcpy(buffer, s_vendor_host, len);
+    memmove(s_vendor_host, &s_vendor_host[len], s_vendor_host_len - len);
+    s_vendor_host_len -= len;
+    return len;
+}
+
+void mock_tusb_vendor_set_rate(uint32_t bytes) {
+    s_vendor_rate = bytes;
+}
+
+uint8_t mock_tusb_msc_take_sense(uint8_t lun, uint8_t *asc, uint8_t *ascq) {
+    if (lun >= MSC_LUN_MAX) {
+        return 0;
+    }
+    uint8_t key = s_sense_key[lun];
+    if (asc != NULL) {
+        *asc = s_sense_asc[lun];
+    }
+    if (ascq != NULL) {
+        *ascq = s_sense_ascq[lun];
+    }
+    s_sense_key[lun] = 0;
+    return key;
+}
+
+//--------------------------------------------------------------------
+// Device API
+//--------------------------------------------------------------------
+
+bool tusb_init(void) {
+    s_initialized = true;
+    return true;
+}
+
+void tud_task(void) {
+    s_stats.task_calls++;
+    while (s_queue_len > 0) {
+        task_event_t event = s_queue[s_queue_head];
+        s_queue_head = (s_queue_head + 1) % EVENT_QUEUE_SIZE;
+        s_queue_len--;
+        s_stats.task_events++;
+        mock_advance_to_ns(mock_now_ns() + s_task_cost_ns);
+
+        switch (event.type) {
+            case EV_MOUNT:
+                s_mounted = true;
+                tud_mount_cb();
+                break;
+
+            case EV_UMOUNT:
+                s_mounted = false;
+                for (uint i = 0; i < s_hid_count; i++) {
+                    s_hid[i].busy = false;
+                }
+                tud_umount_cb();
+                break;
+
+            case EV_SOF:
+                if (s_sof_enabled) {
+                    tud_sof_cb(event.frame);
+                }
+                break;
+
+            case EV_XFER_COMPLETE:
+                s_hid[event.instance].busy = false;
+                tud_hid_report_complete_cb(event.instance, event.data, event.len);
+                break;
+
+            case EV_SET_REPORT:
+                tud_hid_set_report_cb(event.instance, event.report_id, event.report_type,
+                                      event.data, event.len);
+                break;
+        }
+    }
+}
+
+bool tud_task_event_ready(void) {
+    return s_queue_len > 0;
+}
+
+bool tud_mounted(void) {
+    return s_mounted;
+}
+
+void tud_sof_cb_enable(bool en) {
+    s_sof_enabled = en;
+}
+
+//--------------------------------------------------------------------
+// HID Class
+//--------------------------------------------------------------------
+
+bool tud_hid_n_ready(uint8_t instance) {
+    return s_mounted && instance < s_hid_count && !s_hid[instance].busy;
+}
+
+bool tud_hid_n_report(uint8_t instance, uint8_t report_id, const void *report, uint16_t len) {
+    if (!tud_hid_n_ready(instance)) {
+        s_stats.rejects++;
+        return false;
+    }
+    hid_endpoint_t *ep = &s_hid[instance];
+    uint prefix = report_id ? 1 : 0;
+    if (len + prefix > MOCK_TUSB_REPORT_MAX) {
+        s_stats.rejects++;
+        return false;
+    }
+
+    // Like TinyUSB: a non-zero Report ID goes first on the wire
+    ep->data[0] = report_id;
+    memcpy(&ep->data[prefix], report, len);
+    ep->len = (uint8_t)(len + prefix);
+    ep->submit_ns = mock_now_ns();
+    ep->busy = true;
+    ep->queued = true;
+    s_stats.submits++;
+    return true;
+}
+
+//--------------------------------------------------------------------
+// MSC Class
+//--------------------------------------------------------------------
+
+bool tud_msc_set_sense(uint8_t lun, uint8_t sense_key, uint8_t add_sense_code,
+                       uint8_t add_sense_qualifier) {
+    if (lun >= MSC_LUN_MAX) {
+        return false;
+    }
+    s_sense_key[lun] = sense_key;
+    s_sense_asc[lun] = add_sense_code;
+    s_sense_ascq[lun] = add_sense_qualifier;
+    return true;
+}
+
+//--------------------------------------------------------------------
+// Vendor Class
+//--------------------------------------------------------------------
+
+uint32_t tud_vendor_available(void) {
+    return s_mounted ? s_vendor_rx_len : 0;
+}
+
+uint32_t tud_vendor_read(void *buffer, uint32_t bufsize) {
+    uint32_t len = tud_vendor_available();
+    if (len > bufsize) {
+        len = bufsize;
+    }
+    memcpy(buffer, &s_vendor_rx[s_vendor_rx_head], len);
+    s_vendor_rx_head += len;
+    s_vendor_rx_len -= len;
+    return len;
+}
+
+uint32_t tud_vendor_write_available(void) {
+    return s_mounted ? (uint32_t)(sizeof(s_vendor_tx) - s_vendor_tx_len) : 0;
+}
+
+uint32_t tud_vendor_write(const void *buffer, uint32_t bufsize) {
+    uint32_t len = tud_vendor_write_available();
+    if (len > bufsize) {
+        len = bufsize;
+    }
+    memcpy(&s_vendor_tx[s_vendor_tx_len], buffer, len);
+    s_vendor_tx_len += len;
+    return len;
+}
+
+uint32_t tud_vendor_write_flush(void) {
+    uint32_t added = s_vendor_tx_len - s_vendor_tx_flushed;
+    s_vendor_tx_flushed = s_vendor_tx_len;
+    return added;
+}
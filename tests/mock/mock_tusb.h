@@ -0,0 +1,143 @@
+/*
+ * Host Mock of the TinyUSB Device Stack - Test Interface
+ *
+ * A simulated full-speed host: Start Of Frame every 1 ms, every HID IN
+ * endpoint read at SOF + read offset in the frames its bInterval selects
+ * (parsed from the firmware's configuration descriptor). A read takes the
+ * queued report, if any, and posts a transfer-complete event; like TinyUSB
+ * the endpoint stays busy until tud_task() processes that event, then
+ * tud_hid_report_complete_cb() runs. Mount, SOF (when enabled) and control
+ * requests go through the same event queue. Every read is logged with the
+ * time the report was queued and the time the host took it.
+ */
+
+#ifndef MOCK_TUSB_H_TEST
+#define MOCK_TUSB_H_TEST
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "pico/types.h"
+#include "tusb.h"
+
+#define MOCK_TUSB_HID_MAX           10
+#define MOCK_TUSB_REPORT_MAX        64
+
+//--------------------------------------------------------------------
+// Host Reads
+//--------------------------------------------------------------------
+typedef struct {
+    uint8_t instance;
+    uint8_t len;                            // Report ID byte included
+    uint8_t data[MOCK_TUSB_REPORT_MAX];     // As sent on the wire
+    uint64_t submit_ns;                     // tud_hid_n_report() call
+    uint64_t read_ns;                       // Host IN transaction
+} mock_hid_read_t;
+
+typedef struct {
+    uint32_t frames;            // SOFs sent
+    uint32_t reads;             // IN transactions with data
+    uint32_t naks;              // IN transactions with nothing queued
+    uint32_t submits;           // Reports accepted by tud_hid_n_report()
+    uint32_t rejects;           // tud_hid_n_report() calls on a busy endpoint
+    uint32_t task_events;       // Events processed by tud_task()
+    uint32_t task_calls;        // tud_task() calls
+} mock_tusb_stats_t;
+
+/**
+ * Reset the stack (not connected, empty log); call before the firmware starts
+ */
+void mock_tusb_reset(void);
+
+/**
+ * Plug the device: SOFs start now, the host configures it after a delay
+ * (the firmware must have called tusb_init())
+ * @param enumerate_us Time to SET_CONFIGURATION
+ */
+void mock_tusb_connect(uint32_t enumerate_us);
+
+/**
+ * Unplug the device (tud_umount_cb() from the next tud_task())
+ */
+void mock_tusb_disconnect(void);
+
+/**
+ * Set the position of the host reads in the frame
+ * @param offset_ns Time after the SOF (default 100 us)
+ */
+void mock_tusb_set_read_offset_ns(uint32_t offset_ns);
+
+/**
+ * Set the CPU time tud_task() spends per event
+ * @param ns Simulated nanoseconds (default 2000)
+ */
+void mock_tusb_set_task_cost_ns(uint32_t ns);
+
+/**
+ * Number of HID interfaces and the bInterval of their IN endpoint
+ */
+uint mock_tusb_hid_instances(void);
+uint8_t mock_tusb_hid_interval(uint8_t instance);
+
+/**
+ * Reads logged since the last mock_tusb_clear_log()
+ * @param count Filled with the entry count
+ * @return Log (valid until the next read or clear)
+ */
+const mock_hid_read_t *mock_tusb_log(size_t *count);
+
+void mock_tusb_clear_log(void);
+
+void mock_tusb_get_stats(mock_tusb_stats_t *stats);
+
+//--------------------------------------------------------------------
+// Control Requests (processed by the next tud_task())
+//--------------------------------------------------------------------
+
+/**
+ * Queue a SET_REPORT request
+ */
+void mock_tusb_set_report(uint8_t instance, uint8_t report_id, hid_report_type_t type,
+                          const void *data, uint16_t len);
+
+/**
+ * GET_REPORT request, answered at once (test context)
+ * @return Bytes returned by tud_hid_get_report_cb()
+ */
+uint16_t mock_tusb_get_report(uint8_t instance, uint8_t report_id, hid_report_type_t type,
+                              void *buffer, uint16_t reqlen);
+
+//--------------------------------------------------------------------
+// Vendor Bulk Interface
+//--------------------------------------------------------------------
+
+/**
+ * Send bytes to the device (returned by tud_vendor_read())
+ */
+void mock_tusb_vendor_send(const void *data, uint32_t len);
+
+/**
+ * Take the bytes the host received
+ * @param buffer Destination
+ * @param max Buffer size
+ * @return Bytes copied
+ */
+uint32_t mock_tusb_vendor_receive(void *buffer, uint32_t max);
+
+/**
+ * Set how many flushed bytes the host takes per frame (0 = host stalled)
+ * @param bytes Bytes per frame (default 1216: 19 full-speed packets)
+ */
+void mock_tusb_vendor_set_rate(uint32_t bytes);
+
+//--------------------------------------------------------------------
+// Mass Storage
+//--------------------------------------------------------------------
+
+/**
+ * Last sense set by the firmware on a LUN
+ * @return Sense key (0 = none since the last call)
+ */
+uint8_t mock_tusb_msc_take_sense(uint8_t lun, uint8_t *asc, uint8_t *ascq);
+
+#endif /* MOCK_TUSB_H_TEST */
@@ -0,0 +1,48 @@
+/*
+ * Host Test Checks
+ * A failed check prints its location and the test carries on; the test
+ * returns test_result() so CTest sees every failure of a run at once.
+ */
+
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+extern int test_failures;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            test_failures++; \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        } \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) \
+    do { \
+        long long _a = (long long)(actual); \
+        long long _e = (long long)(expected); \
+        if (_a != _e) { \
+            test_failures++; \
+            fprintf(stderr, "%s:%d: %s == %lld, expected %s == %lld\n", __FILE__, __LINE__, \
+                    #actual, _a, #expected, _e); \
+        } \
+    } while (0)
+
+/**
+ * Print the outcome of the test
+ * @param name Test name
+ * @return Process exit code (0 = every check passed)
+ */
+static inline int test_result(const char *name) {
+    if (test_failures != 0) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, test_failures);
+        return 1;
+    }
+    printf("%s: passed\n", name);
+    return 0;
+}
+
+#endif /* TEST_COMMON_H */
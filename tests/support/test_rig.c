@@ -0,0 +1,93 @@
+/*
+ * Host Test Rig Implementation
+ */
+
+#include "test_rig.h"
+#include "test_common.h"
+#include "n64_controller.h"
+#include <string.h>
+#include <time.h>
+
+int test_failures;
+
+void rig_reset(void) {
+    mock_sdk_reset();
+    mock_joybus_reset();
+    mock_tusb_reset();
+}
+
+void rig_plug(uint port, mock_device_t *device) {
+    mock_device_plug(N64_DATA_PINS[port], device);
+}
+
+void rig_boot(void) {
+    mock_firmware_start();
+    mock_tusb_connect(RIG_ENUMERATE_US);
+    while (!tud_mounted()) {
+        mock_firmware_run_us(1000);
+    }
+}
+
+const char *rig_console(const char *line) {
+    mock_console_clear();
+    mock_console_input(line);
+    mock_console_input("\r");
+    mock_firmware_run_us(2000);
+    return mock_console_output();
+}
+
+bool rig_decode_read(const mock_hid_read_t *read, uint *port, usb_gamepad_report_t *report) {
+    if (read->instance >= USB_HID_INSTANCES) {
+        return false;
+    }
+#if N64_HID_REPORT_ID
+    if (read->len != 1 + sizeof(*report) || read->data[0] < HID_REPORT_ID(0) ||
+        read->data[0] > HID_REPORT_ID(MAX_CONTROLLERS - 1)) {
+        return false;
+    }
+    *port = (uint)(read->data[0] - HID_REPORT_ID(0));
+    memcpy(report, &read->data[1], sizeof(*report));
+#else
+    if (read->len != sizeof(*report)) {
+        return false;
+    }
+    *port = read->instance;
+    memcpy(report, read->data, sizeof(*report));
+#endif
+    return true;
+}
+
+uint64_t rig_first_read(uint port, uint64_t after_ns, usb_gamepad_report_t *report) {
+    size_t count;
+    const mock_hid_read_t *log = mock_tusb_log(&count);
+    for (size_t i = 0; i < count; i++) {
+        uint read_port;
+        usb_gamepad_report_t decoded;
+        if (log[i].read_ns >= after_ns && rig_decode_read(&log[i], &read_port, &decoded) &&
+            read_port == port) {
+            if (report != NULL) {
+                *report = decoded;
+            }
+            return log[i].read_ns;
+        }
+    }
+    return 0;
+}
+
+bool rig_last_report(uint port, usb_gamepad_report_t *report) {
+    size_t count;
+    const mock_hid_read_t *log = mock_tusb_log(&count);
+    for (size_t i = count; i-- > 0;) {
+        uint read_port;
+        if (rig_decode_read(&log[i], &read_port, report) && read_port == port) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t rig_host_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,77 @@
+/*
+ * Host Test Rig
+ * Boots the firmware main loop (mock_firmware.h) with Joybus device models
+ * on the data pins and a simulated USB host, and decodes what the host
+ * reads back into per-port gamepad reports for either USB layout.
+ */
+
+#ifndef TEST_RIG_H
+#define TEST_RIG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "mock_sdk.h"
+#include "mock_joybus.h"
+#include "mock_devices.h"
+#include "mock_tusb.h"
+#include "mock_firmware.h"
+#include "usb_gamepad.h"
+
+#define RIG_ENUMERATE_US    20000       // Plug to SET_CONFIGURATION
+
+/**
+ * Reset every mock (clock, PIO/DMA, USB host); call before rig_boot()
+ */
+void rig_reset(void);
+
+/**
+ * Plug a device model on a controller port
+ * @param port Controller port (its data pin comes from N64_DATA_PINS)
+ * @param device Device, NULL to unplug
+ */
+void rig_plug(uint port, mock_device_t *device);
+
+/**
+ * Boot the firmware, connect USB and run until the host configured it
+ */
+void rig_boot(void);
+
+/**
+ * Type a console line and run the firmware until it was handled
+ * @param line Command without the line ending
+ * @return Console output of the command (valid until the next clear)
+ */
+const char *rig_console(const char *line);
+
+/**
+ * Decode a host read as a gamepad report
+ * @param read Logged read
+ * @param port Filled with the controller port
+ * @param report Filled with the gamepad report
+ * @return false if the read is not a gamepad report (raw stream)
+ */
+bool rig_decode_read(const mock_hid_read_t *read, uint *port, usb_gamepad_report_t *report);
+
+/**
+ * First gamepad report the host read for a port at or after a time
+ * @param port Controller port
+ * @param after_ns Earliest host read time
+ * @param report Filled with the report (may be NULL)
+ * @return Read time, or 0 if there is none
+ */
+uint64_t rig_first_read(uint port, uint64_t after_ns, usb_gamepad_report_t *report);
+
+/**
+ * Last gamepad report the host read for a port
+ * @return false if the host read nothing for that port
+ */
+bool rig_last_report(uint port, usb_gamepad_report_t *report);
+
+/**
+ * Elapsed host CPU time (benchmarks)
+ * @return Monotonic nanoseconds
+ */
+uint64_t rig_host_ns(void);
+
+#endif /* TEST_RIG_H */
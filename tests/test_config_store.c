@@ -0,0 +1,224 @@
+/*
+ * Configuration Store Test (host)
+ * config_store.c on the mocked flash: records appended to the active
+ * sector, compaction rotating over the sector ring, a refused
+ * flash_safe_execute() retried on the next call, a torn last record
+ * dropped at reload, then the firmware booting with the saved values and
+ * its 'cfg' console command ('set' without a value refused).
+ */
+
+#include "test_common.h"
+#include "test_rig.h"
+#include "config_store.h"
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include <string.h>
+
+#define STORE_OFFSET        (PICO_FLASH_SIZE_BYTES - CONFIG_STORE_SECTORS * FLASH_SECTOR_SIZE)
+#define U32_RECORD_SIZE     8
+
+static mock_device_t s_pad;
+
+static bool set_u32(config_key_t key, uint32_t value) {
+    return config_store_set(key, &value, sizeof(value));
+}
+
+static uint32_t get_u32(config_key_t key) {
+    uint32_t value = 0;
+    CHECK(config_store_get_u32(key, &value));
+    return value;
+}
+
+static void test_append(void) {
+    config_store_status_t status;
+    mock_flash_stats_t flash;
+    config_store_init();
+    config_store_get_status(&status);
+    CHECK_EQ(status.generation, 0);
+    CHECK(!config_store_task());
+
+    // First write on an empty store: sector 0 erased and written
+    CHECK(set_u32(CONFIG_KEY_POLL_INTERVAL_US, 4000));
+    CHECK(config_store_task());
+    config_store_get_status(&status);
+    CHECK_EQ(status.generation, 1);
+    CHECK_EQ(status.sector, 0);
+    CHECK_EQ(status.compactions, 1);
+    CHECK(!status.pending);
+    uint16_t used = status.used;
+
+    // Next change appended after it: one page programmed, no erase
+    mock_flash_get_stats(&flash);
+    uint32_t erases = flash.erases;
+    uint32_t programs = flash.programs;
+    CHECK(set_u32(CONFIG_KEY_REPORT_REFRESH_MS, 50));
+    CHECK(config_store_task());
+    config_store_get_status(&status);
+    mock_flash_get_stats(&flash);
+    CHECK_EQ(status.used, used + U32_RECORD_SIZE);
+    CHECK_EQ(status.compactions, 1);
+    CHECK_EQ(flash.erases, erases);
+    CHECK_EQ(flash.programs, programs + 1);
+
+    // Same value, or removing a key that is not set: nothing to write
+    CHECK(set_u32(CONFIG_KEY_REPORT_REFRESH_MS, 50));
+    CHECK(config_store_set(CONFIG_KEY_HIGH_RATE, NULL, 0));
+    config_store_get_status(&status);
+    CHECK(!status.pending);
+    CHECK(!config_store_task());
+
+    // Invalid keys and lengths refused
+    uint8_t pins[MAX_CONTROLLERS + 1] = {0};
+    CHECK(!config_store_set(CONFIG_KEY_POLL_INTERVAL_US, pins, 2));
+    CHECK(!config_store_set(CONFIG_KEY_DATA_PINS, pins, MAX_CONTROLLERS + 1));
+    CHECK(!config_store_set(CONFIG_KEYS, pins, 4));
+}
+
+static void test_compaction(void) {
+    // Enough changes to fill every sector twice: each compaction moves to
+    // the next sector of the ring, the other keys carried along
+    config_store_status_t status;
+    config_store_get_status(&status);
+    uint32_t compactions = status.compactions;
+    uint8_t sector = status.sector;
+    uint visits[CONFIG_STORE_SECTORS] = {0};
+    uint32_t value = 0;
+
+    while (status.compactions < compactions + 2 * CONFIG_STORE_SECTORS) {
+        CHECK(set_u32(CONFIG_KEY_POLL_INTERVAL_US, 5000 + value++));
+        CHECK(config_store_task());
+        config_store_get_status(&status);
+        if (status.sector != sector) {
+            CHECK_EQ(status.sector, (sector + 1) % CONFIG_STORE_SECTORS);
+            sector = status.sector;
+            visits[sector]++;
+        }
+    }
+    for (uint i = 0; i < CONFIG_STORE_SECTORS; i++) {
+        CHECK_EQ(visits[i], 2);
+    }
+    printf("%lu changes, %lu compactions, generation %lu\n", (unsigned long)value,
+           (unsigned long)(status.compactions - compactions), (unsigned long)status.generation);
+
+    // Reload: newest sector wins
+    uint32_t generation = status.generation;
+    config_store_init();
+    config_store_get_status(&status);
+    CHECK_EQ(status.generation, generation);
+    CHECK_EQ(status.sector, sector);
+    CHECK_EQ(get_u32(CONFIG_KEY_POLL_INTERVAL_US), 5000 + value - 1);
+    CHECK_EQ(get_u32(CONFIG_KEY_REPORT_REFRESH_MS), 50);
+}
+
+static void test_flash_refused(void) {
+    // Other core not parked in time: the change stays pending, and the
+    // sector it was going to is not given up (appended once retried)
+    config_store_status_t status;
+    mock_flash_stats_t flash;
+    config_store_get_status(&status);
+    uint32_t compactions = status.compactions;
+    uint16_t used = status.used;
+    CHECK(set_u32(CONFIG_KEY_REPORT_REFRESH_MS, 60));
+    mock_flash_fail_next(2);
+    CHECK(!config_store_task());
+    CHECK(!config_store_task());
+    config_store_get_status(&status);
+    CHECK(status.pending);
+    mock_flash_get_stats(&flash);
+    CHECK_EQ(flash.failures, 2);
+
+    CHECK(config_store_task());
+    config_store_get_status(&status);
+    CHECK(!status.pending);
+    CHECK_EQ(status.compactions, compactions);
+    CHECK_EQ(status.used, used + U32_RECORD_SIZE);
+    config_store_init();
+    CHECK_EQ(get_u32(CONFIG_KEY_REPORT_REFRESH_MS), 60);
+}
+
+static void test_torn_record(void) {
+    // Power lost while the last record was programmed: some of its bits
+    // never cleared, the CRC no longer matches
+    config_store_status_t status;
+    CHECK(set_u32(CONFIG_KEY_REPORT_REFRESH_MS, 0x12345678));
+    CHECK(config_store_task());
+    config_store_get_status(&status);
+    uint32_t record = STORE_OFFSET + status.sector * FLASH_SECTOR_SIZE + status.used - U32_RECORD_SIZE;
+    CHECK_EQ(mock_flash[record], CONFIG_KEY_REPORT_REFRESH_MS);
+    mock_flash[record + 4] |= 0xF0;
+
+    // Reload: previous value kept, the next write compacts
+    uint32_t compactions = status.compactions;
+    uint8_t sector = status.sector;
+    config_store_init();
+    CHECK_EQ(get_u32(CONFIG_KEY_REPORT_REFRESH_MS), 60);
+    CHECK(set_u32(CONFIG_KEY_HIGH_RATE, 1));
+    CHECK(config_store_task());
+    config_store_get_status(&status);
+    CHECK_EQ(status.compactions, compactions + 1);
+    CHECK_EQ(status.sector, (sector + 1) % CONFIG_STORE_SECTORS);
+
+    config_store_init();
+    CHECK_EQ(get_u32(CONFIG_KEY_REPORT_REFRESH_MS), 60);
+    CHECK_EQ(get_u32(CONFIG_KEY_HIGH_RATE), 1);
+
+    // Removal saved too
+    CHECK(config_store_set(CONFIG_KEY_HIGH_RATE, NULL, 0));
+    CHECK(config_store_task());
+    config_store_init();
+    uint32_t value;
+    CHECK(!config_store_get_u32(CONFIG_KEY_HIGH_RATE, &value));
+    CHECK(get_u32(CONFIG_KEY_POLL_INTERVAL_US) >= 5000);
+}
+
+static void test_firmware(void) {
+    // Saved values applied at boot
+    CHECK(set_u32(CONFIG_KEY_POLL_INTERVAL_US, 4000));
+    CHECK(config_store_task());
+    rig_boot();
+    mock_firmware_run_us(100000);
+    CHECK(mock_console_find("Config: loaded in") != NULL);
+    CHECK(strstr(rig_console("stats"), "[STATS] Poll timer: period 4000 us") != NULL);
+
+    // 'set' needs a value: only 'unset' removes a key
+    CHECK(strstr(rig_console("cfg set refresh_ms"), "[CFG] Invalid command or value") != NULL);
+    CHECK_EQ(get_u32(CONFIG_KEY_REPORT_REFRESH_MS), 60);
+    CHECK(strstr(rig_console("cfg set refresh_ms 20"), "refresh_ms updated") != NULL);
+    CHECK(strstr(rig_console("cfg unset poll_us"), "poll_us updated") != NULL);
+    CHECK(strstr(rig_console("cfg"), "[CFG] poll_us    (build default)") != NULL);
+
+    // Saved while no controller is connected
+    mock_firmware_run_us(10000);
+    config_store_status_t status;
+    config_store_get_status(&status);
+    CHECK(!status.pending);
+
+    // With a controller connected the write waits
+    rig_plug(0, &s_pad);
+    mock_firmware_run_us(100000);
+    rig_console("cfg set refresh_ms 30");
+    mock_firmware_run_us(100000);
+    config_store_get_status(&status);
+    CHECK(status.pending);
+    rig_plug(0, NULL);
+    mock_firmware_run_us(1000000);
+    config_store_get_status(&status);
+    CHECK(!status.pending);
+
+    config_store_init();
+    uint32_t value;
+    CHECK(!config_store_get_u32(CONFIG_KEY_POLL_INTERVAL_US, &value));
+    CHECK_EQ(get_u32(CONFIG_KEY_REPORT_REFRESH_MS), 30);
+}
+
+int main(void) {
+    rig_reset();
+    mock_device_init(&s_pad, MOCK_DEVICE_N64);
+
+    test_append();
+    test_compaction();
+    test_flash_refused();
+    test_torn_record();
+    test_firmware();
+    return test_result("test_config_store");
+}
@@ -0,0 +1,184 @@
+/*
+ * Device Driver Test (host)
+ * Each Joybus device model on the port, through n64_controller.c and the
+ * driver table: N64 controller and mouse (identify, then poll), GameCube
+ * controller (identify, origin, poll, origin again on request) and a
+ * device with an unknown identifier (ABSENT). One controller handle for
+ * the whole test: each device is identified after an unplug, the way a
+ * port sees a swap, and a swap between two polls is caught as well.
+ */
+
+#include "test_common.h"
+#include "test_rig.h"
+#include "n64_controller.h"
+#include <string.h>
+
+#define PIN                 18
+#define CMD_INFO            0x00
+#define CMD_STATUS          0x01
+
+static mock_device_t s_device;
+static n64_controller_t s_ctrl;
+
+static n64_xfer_status_t read_once(n64_device_state_t *state) {
+    n64_xfer_status_t status = N64_XFER_ERROR;
+    memset(state, 0xEE, sizeof(*state));
+    if (n64_read_start(&s_ctrl)) {
+        while ((status = n64_read_poll(&s_ctrl, state)) == N64_XFER_BUSY) {
+        }
+    }
+    return status;
+}
+
+static bool is_neutral(const n64_device_state_t *state) {
+    for (uint i = 0; i < N64_DEVICE_STATE_SIZE / 4; i++) {
+        if (state->words[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Unplug (the next read is ABSENT and resets the port), plug another
+// device, then identify it: neutral state of the new device type
+static n64_xfer_status_t swap(mock_device_kind_t kind) {
+    n64_device_state_t state;
+    mock_device_plug(PIN, NULL);
+    mock_advance_us(1000);
+    CHECK_EQ(read_once(&state), N64_XFER_ABSENT);
+    CHECK(!s_ctrl.connected);
+
+    mock_device_init(&s_device, kind);
+    mock_device_plug(PIN, &s_device);
+    mock_advance_us(1000);
+    n64_xfer_status_t status = read_once(&state);
+    CHECK_EQ(s_device.commands[CMD_INFO], 1);
+    if (status == N64_XFER_DONE) {
+        CHECK(is_neutral(&state));
+        CHECK(s_ctrl.driver != NULL && state.type == s_ctrl.driver->type);
+    }
+    return status;
+}
+
+static void test_n64(mock_device_kind_t kind, n64_device_type_t type) {
+    if (kind != MOCK_DEVICE_N64) {
+        CHECK_EQ(swap(kind), N64_XFER_DONE);
+    }
+    CHECK(s_ctrl.connected);
+    CHECK(s_ctrl.driver != NULL && s_ctrl.driver->type == type);
+    CHECK_EQ(s_ctrl.driver->accessory, kind == MOCK_DEVICE_N64);
+    CHECK_EQ(s_device.commands[CMD_INFO], 1);
+
+    // No calibration: the next read is already a poll
+    n64_device_state_t state;
+    mock_device_set_n64(&s_device, N64_MASK_A | N64_DPAD_UP, N64_MASK_R, 25, -40);
+    CHECK_EQ(read_once(&state), N64_XFER_DONE);
+    CHECK_EQ(s_device.commands[CMD_STATUS], 1);
+    CHECK_EQ(state.type, type);
+    CHECK_EQ(state.n64.buttons0, N64_MASK_A | N64_DPAD_UP);
+    CHECK_EQ(state.n64.buttons1, N64_MASK_R);
+    CHECK_EQ(state.n64.stick_x, 25);
+    CHECK_EQ(state.n64.stick_y, -40);
+    CHECK_EQ(s_device.commands[CMD_INFO], 1);
+}
+
+static void test_gamecube(void) {
+    CHECK_EQ(swap(MOCK_DEVICE_GAMECUBE), N64_XFER_DONE);
+    CHECK(s_ctrl.connected);
+    CHECK(s_ctrl.driver != NULL && s_ctrl.driver->type == N64_DEVICE_GAMECUBE);
+    CHECK(!s_ctrl.driver->accessory);
+
+    // Origin read: neutral state, origin taken from the answer
+    n64_device_state_t state;
+    CHECK_EQ(read_once(&state), N64_XFER_DONE);
+    CHECK_EQ(s_device.commands[GC_CMD_ORIGIN], 1);
+    CHECK_EQ(state.type, N64_DEVICE_GAMECUBE);
+    CHECK(is_neutral(&state));
+
+    // Poll: axes relative to the origin
+    s_device.state[0] = GC_MASK_A | GC_MASK_START;
+    s_device.state[1] = 0x80 | GC_MASK_Z;
+    s_device.state[2] = 128 + 60;       // Stick X
+    s_device.state[3] = 128 - 45;       // Stick Y
+    s_device.state[4] = 128 + 70;       // C-stick X
+    s_device.state[5] = 128;            // C-stick Y
+    s_device.state[6] = 20 + 100;       // L travel
+    s_device.state[7] = 10;             // R below its origin
+    CHECK_EQ(read_once(&state), N64_XFER_DONE);
+    CHECK_EQ(s_device.commands[GC_CMD_POLL], 1);
+    CHECK_EQ(state.type, N64_DEVICE_GAMECUBE);
+    CHECK_EQ(state.gc.buttons0, GC_MASK_A | GC_MASK_START);
+    CHECK_EQ(state.gc.buttons1, GC_MASK_Z);
+    CHECK_EQ(state.gc.stick_x, 60);
+    CHECK_EQ(state.gc.stick_y, -45);
+    CHECK_EQ(state.gc.cstick_x, 70);
+    CHECK_EQ(state.gc.cstick_y, 0);
+    CHECK_EQ(state.gc.trigger_l, 100);
+    CHECK_EQ(state.gc.trigger_r, 0);
+
+    // Recalibrated controller: this poll still counts, the next read is
+    // the origin again (new rest position), then polls resume
+    s_device.state[0] |= GC_NEED_ORIGIN;
+    CHECK_EQ(read_once(&state), N64_XFER_DONE);
+    CHECK_EQ(state.gc.buttons0, GC_MASK_A | GC_MASK_START);
+    s_device.origin[2] = 128 + 60;
+    s_device.state[0] = 0;
+    CHECK_EQ(read_once(&state), N64_XFER_DONE);
+    CHECK_EQ(s_device.commands[GC_CMD_ORIGIN], 2);
+    CHECK_EQ(read_once(&state), N64_XFER_DONE);
+    CHECK_EQ(s_device.commands[GC_CMD_POLL], 3);
+    CHECK_EQ(state.gc.stick_x, 0);
+    CHECK_EQ(s_device.commands[CMD_INFO], 1);
+}
+
+static void test_unknown(void) {
+    CHECK_EQ(swap(MOCK_DEVICE_UNKNOWN), N64_XFER_ABSENT);
+    CHECK(!s_ctrl.connected);
+    CHECK(s_ctrl.driver == NULL);
+
+    // Identified again on every read, never polled
+    n64_device_state_t state;
+    CHECK_EQ(read_once(&state), N64_XFER_ABSENT);
+    CHECK_EQ(read_once(&state), N64_XFER_ABSENT);
+    CHECK(!s_ctrl.connected);
+    CHECK_EQ(s_device.commands[CMD_INFO], 3);
+    CHECK_EQ(s_device.commands[CMD_STATUS], 0);
+    CHECK_EQ(s_device.commands[GC_CMD_POLL], 0);
+}
+
+static void test_swap(void) {
+    // N64 controller replaced by a GameCube controller between two polls:
+    // the N64 poll goes unanswered, then the port is identified again
+    CHECK_EQ(swap(MOCK_DEVICE_N64), N64_XFER_DONE);
+    n64_device_state_t state;
+    CHECK_EQ(read_once(&state), N64_XFER_DONE);
+    CHECK_EQ(state.type, N64_DEVICE_CONTROLLER);
+
+    mock_device_init(&s_device, MOCK_DEVICE_GAMECUBE);
+    mock_device_plug(PIN, &s_device);
+    mock_advance_us(1000);
+    n64_xfer_status_t status = read_once(&state);
+    CHECK(status == N64_XFER_ABSENT || status == N64_XFER_ERROR);
+    CHECK(!s_ctrl.connected);
+
+    CHECK_EQ(read_once(&state), N64_XFER_DONE);     // INFO
+    CHECK(s_ctrl.driver != NULL && s_ctrl.driver->type == N64_DEVICE_GAMECUBE);
+    CHECK_EQ(read_once(&state), N64_XFER_DONE);     // Origin
+    CHECK_EQ(read_once(&state), N64_XFER_DONE);     // Poll
+    CHECK_EQ(state.type, N64_DEVICE_GAMECUBE);
+    CHECK_EQ(s_device.commands[GC_CMD_POLL], 1);
+}
+
+int main(void) {
+    rig_reset();
+    mock_device_init(&s_device, MOCK_DEVICE_N64);
+    mock_device_plug(PIN, &s_device);
+    CHECK(n64_init(&s_ctrl, PIN));
+
+    test_n64(MOCK_DEVICE_N64, N64_DEVICE_CONTROLLER);
+    test_n64(MOCK_DEVICE_MOUSE, N64_DEVICE_MOUSE);
+    test_gamecube();
+    test_unknown();
+    test_swap();
+    return test_result("test_devices");
+}
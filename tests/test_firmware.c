@@ -0,0 +1,186 @@
+/*
+ * Firmware Main Loop Test (host)
+ * Boots src/main.c against the mocks: enumeration, controller detection,
+ * button press to host read latency, hot-plug on both ports, the
+ * change-driven report refresh, and the statistics and latency histograms
+ * printed on the 'stats' and 'lat' console commands only.
+ */
+
+#include "test_common.h"
+#include "test_rig.h"
+#include "n64_hotplug.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define POLL_US             8000
+#define INTERVAL_US         (USB_HID_POLL_INTERVAL_MS * 1000)
+
+static mock_device_t s_pad[2];
+
+static bool is_neutral(const usb_gamepad_report_t *report) {
+    usb_gamepad_report_t neutral;
+    usb_gamepad_init_neutral(&neutral);
+    return memcmp(report, &neutral, sizeof(neutral)) == 0;
+}
+
+static uint count_reads(uint port, uint64_t from_ns, uint64_t to_ns) {
+    size_t count;
+    const mock_hid_read_t *log = mock_tusb_log(&count);
+    uint reads = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint read_port;
+        usb_gamepad_report_t report;
+        if (log[i].read_ns >= from_ns && log[i].read_ns < to_ns &&
+            rig_decode_read(&log[i], &read_port, &report) && read_port == port) {
+            reads++;
+        }
+    }
+    return reads;
+}
+
+// First host read of a port with some buttons down
+static uint64_t first_press(uint port, uint64_t after_ns, uint16_t buttons,
+                            usb_gamepad_report_t *report) {
+    uint64_t read_ns;
+    while ((read_ns = rig_first_read(port, after_ns, report)) != 0 &&
+           (report->buttons & buttons) != buttons) {
+        after_ns = read_ns + 1;
+    }
+    return read_ns;
+}
+
+static void test_boot(void) {
+    CHECK(mock_console_find("Controller 1 on GP18: OK (N64 controller)") != NULL);
+    CHECK(mock_console_find("Controller 2 on GP19: OK (empty)") != NULL);
+    CHECK_EQ(mock_tusb_hid_instances(), 2);
+    CHECK_EQ(mock_tusb_hid_interval(0), USB_HID_POLL_INTERVAL_MS);
+    CHECK_EQ(mock_tusb_hid_interval(1), USB_HID_POLL_INTERVAL_MS);
+
+    // First poll cycles after the mount: P1 reports its neutral state
+    mock_firmware_run_us(50000);
+    usb_gamepad_report_t report;
+    CHECK(rig_last_report(0, &report));
+    CHECK_EQ(report.buttons, 0);
+    CHECK_EQ(report.hat, HAT_CENTER);
+    CHECK(!rig_last_report(1, &report));
+}
+
+static void test_press_latency(void) {
+    uint64_t press_ns = mock_now_ns();
+    mock_device_set_n64(&s_pad[0], N64_MASK_A, N64_MASK_L, 80, -80);
+    mock_firmware_run_us(40000);
+
+    usb_gamepad_report_t report = {0};
+    uint64_t read_ns = first_press(0, press_ns, USB_BTN_A, &report);
+    CHECK(read_ns != 0);
+    CHECK_EQ(report.buttons, USB_BTN_A | USB_BTN_L);
+    CHECK_EQ(report.lx, JOYSTICK_MAX);
+    CHECK_EQ(report.ly, JOYSTICK_MAX);
+
+    // Worst case: sampled just before the press, then a whole host interval
+    uint64_t latency_us = (read_ns - press_ns) / 1000;
+    printf("press -> host read: %llu us\n", (unsigned long long)latency_us);
+    CHECK(latency_us <= POLL_US + INTERVAL_US + 1000);
+}
+
+static void test_hotplug(void) {
+    // Empty port probed with back-off (250 ms at most); the identification
+    // cycle reports a neutral state, the next poll the buttons held
+    uint64_t plug_ns = mock_now_ns();
+    mock_device_set_n64(&s_pad[1], N64_MASK_START, 0, 0, 0);
+    rig_plug(1, &s_pad[1]);
+    mock_firmware_run_us(300000);
+
+    usb_gamepad_report_t report;
+    uint64_t read_ns = first_press(1, plug_ns, USB_BTN_START, &report);
+    CHECK(read_ns != 0);
+    CHECK((read_ns - plug_ns) / 1000 <= N64_HOTPLUG_BACKOFF_MAX_MS * 1000 + POLL_US + INTERVAL_US);
+
+    // Unplugged with buttons held: the host gets a neutral report
+    rig_plug(0, NULL);
+    mock_firmware_run_us(100000);
+    CHECK(rig_last_report(0, &report));
+    CHECK(is_neutral(&report));
+
+    // And the held buttons again once plugged back
+    rig_plug(0, &s_pad[0]);
+    mock_firmware_run_us(300000);
+    CHECK(rig_last_report(0, &report));
+    CHECK_EQ(report.buttons, USB_BTN_A | USB_BTN_L);
+}
+
+static void test_refresh(void) {
+    // Unchanged state: one report per refresh period, not one per poll
+    uint64_t from_ns = mock_now_ns();
+    mock_firmware_run_us(1000000);
+    uint reads = count_reads(1, from_ns, mock_now_ns());
+    printf("unchanged port: %u reports/s\n", reads);
+    CHECK(reads >= 1000 / N64_REPORT_REFRESH_MS - 1);
+    CHECK(reads <= 1000 / N64_REPORT_REFRESH_MS + 1);
+
+    // Moving stick: every poll is a new report
+    from_ns = mock_now_ns();
+    for (int i = 0; i < 125; i++) {
+        mock_device_set_n64(&s_pad[1], 0, 0, (int8_t)(i % 2 ? 40 : -40), 0);
+        mock_firmware_run_us(POLL_US);
+    }
+    reads = count_reads(1, from_ns, mock_now_ns());
+    printf("moving stick: %u reports/s\n", reads);
+    CHECK(reads >= 120);
+}
+
+static void test_console_stats(void) {
+    // Nothing printed while playing unless asked for
+    mock_console_clear();
+    mock_firmware_run_us(6000000);
+    CHECK(mock_console_find("[STATS]") == NULL);
+    CHECK(mock_console_find("[LAT]") == NULL);
+
+    // Counters since boot, then since this command
+    mock_console_input("stats\n");
+    mock_firmware_run_us(10000);
+    CHECK(mock_console_find("[STATS] CPU load: core0 ") != NULL);
+    CHECK(mock_console_find("[STATS] Poll cost: ") != NULL);
+    CHECK(mock_console_find("[STATS] Joybus STATUS: ") != NULL);
+    mock_console_clear();
+    mock_firmware_run_us(1000000);
+    mock_console_input("stats\n");
+    mock_firmware_run_us(10000);
+    const char *period = mock_console_find("[STATS] Over the last ");
+    CHECK(period != NULL);
+    if (period != NULL) {
+        uint32_t ms = (uint32_t)strtoul(period + strlen("[STATS] Over the last "), NULL, 10);
+        CHECK(ms >= 1000 && ms <= 1020);
+    }
+    CHECK(mock_console_find("[STATS] USB: ") != NULL);
+
+    // Polling core counters cleared by the first command: one second of cycles
+    const char *cost = mock_console_find("[STATS] Poll cost: ");
+    const char *cycles = (cost != NULL) ? strchr(cost, '(') : NULL;
+    CHECK(cycles != NULL);
+    if (cycles != NULL) {
+        uint32_t count = (uint32_t)strtoul(cycles + 1, NULL, 10);
+        CHECK(count >= 1000000 / POLL_US - 2 && count <= 1020000 / POLL_US + 1);
+    }
+
+    mock_console_input("lat\n");
+    mock_firmware_run_us(10000);
+    CHECK(mock_console_find("[LAT] Bucket limits (us):") != NULL);
+    CHECK(mock_console_find("[LAT] P1 wire ") != NULL);
+    CHECK(mock_console_find("[LAT] P2 total ") != NULL);
+}
+
+int main(void) {
+    rig_reset();
+    mock_device_init(&s_pad[0], MOCK_DEVICE_N64);
+    mock_device_init(&s_pad[1], MOCK_DEVICE_N64);
+    rig_plug(0, &s_pad[0]);
+    rig_boot();
+
+    test_boot();
+    test_press_latency();
+    test_hotplug();
+    test_refresh();
+    test_console_stats();
+    return test_result("test_firmware");
+}
@@ -0,0 +1,151 @@
+/*
+ * Gamepad Mapping Test (host)
+ * Every N64 button byte pair and every stick byte pair through the lookup
+ * tables (n64_to_usb_report and device_to_usb_report), compared byte for
+ * byte with the per-bit mapping the tables replaced.
+ */
+
+#include "test_common.h"
+#include "usb_gamepad.h"
+#include "n64_device.h"
+#include "pico/types.h"
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Reference: the per-bit mapping before the lookup tables
+//--------------------------------------------------------------------
+static const uint8_t ref_dpad_to_hat[16] = {
+    HAT_CENTER,      // 0b0000 - nothing
+    HAT_RIGHT,       // 0b0001 - right
+    HAT_LEFT,        // 0b0010 - left
+    HAT_CENTER,      // 0b0011 - left+right (invalid, center)
+    HAT_DOWN,        // 0b0100 - down
+    HAT_DOWN_RIGHT,  // 0b0101 - down+right
+    HAT_DOWN_LEFT,   // 0b0110 - down+left
+    HAT_DOWN,        // 0b0111 - down+left+right (invalid, down)
+    HAT_UP,          // 0b1000 - up
+    HAT_UP_RIGHT,    // 0b1001 - up+right
+    HAT_UP_LEFT,     // 0b1010 - up+left
+    HAT_UP,          // 0b1011 - up+left+right (invalid, up)
+    HAT_CENTER,      // 0b1100 - up+down (invalid, center)
+    HAT_RIGHT,       // 0b1101 - up+down+right (invalid, right)
+    HAT_LEFT,        // 0b1110 - up+down+left (invalid, left)
+    HAT_CENTER       // 0b1111 - all (invalid, center)
+};
+
+static uint8_t ref_scale_axis(int8_t n64_value) {
+    int16_t clamped = n64_value;
+    if (clamped > N64_JOYSTICK_MAX) {
+        clamped = N64_JOYSTICK_MAX;
+    }
+    if (clamped < -N64_JOYSTICK_MAX) {
+        clamped = -N64_JOYSTICK_MAX;
+    }
+    int32_t scaled = ((clamped + N64_JOYSTICK_MAX) * 255) / (N64_JOYSTICK_MAX * 2);
+    return (uint8_t)scaled;
+}
+
+static void ref_n64_to_usb_report(const n64_state_t *n64, usb_gamepad_report_t *usb) {
+    usb->buttons = 0;
+    if (n64->buttons0 & N64_MASK_A) {
+        usb->buttons |= USB_BTN_A;
+    }
+    if (n64->buttons0 & N64_MASK_B) {
+        usb->buttons |= USB_BTN_B;
+    }
+    if (n64->buttons0 & N64_MASK_Z) {
+        usb->buttons |= USB_BTN_Z;
+    }
+    if (n64->buttons0 & N64_MASK_START) {
+        usb->buttons |= USB_BTN_START;
+    }
+    if (n64->buttons1 & N64_MASK_L) {
+        usb->buttons |= USB_BTN_L;
+    }
+    if (n64->buttons1 & N64_MASK_R) {
+        usb->buttons |= USB_BTN_R;
+    }
+    uint8_t c_buttons = n64->buttons1 & N64_MASK_C;
+    if (c_buttons & N64_C_UP) {
+        usb->buttons |= USB_BTN_C_UP;
+    }
+    if (c_buttons & N64_C_DOWN) {
+        usb->buttons |= USB_BTN_C_DOWN;
+    }
+    if (c_buttons & N64_C_LEFT) {
+        usb->buttons |= USB_BTN_C_LEFT;
+    }
+    if (c_buttons & N64_C_RIGHT) {
+        usb->buttons |= USB_BTN_C_RIGHT;
+    }
+    usb->hat = ref_dpad_to_hat[n64->buttons0 & N64_MASK_DPAD];
+    usb->lx = ref_scale_axis(n64->stick_x);
+    usb->ly = 255 - ref_scale_axis(n64->stick_y);
+}
+
+//--------------------------------------------------------------------
+// Comparison
+//--------------------------------------------------------------------
+
+static uint s_mismatches;
+
+static void compare(uint8_t buttons0, uint8_t buttons1, int8_t stick_x, int8_t stick_y) {
+    n64_device_state_t state;
+    usb_gamepad_report_t expected, lut, device;
+    memset(&state, 0, sizeof(state));
+    memset(&expected, 0xEE, sizeof(expected));
+    memset(&lut, 0x11, sizeof(lut));
+    memset(&device, 0x22, sizeof(device));
+
+    state.type = N64_DEVICE_CONTROLLER;
+    state.n64.buttons0 = buttons0;
+    state.n64.buttons1 = buttons1;
+    state.n64.stick_x = stick_x;
+    state.n64.stick_y = stick_y;
+
+    ref_n64_to_usb_report(&state.n64, &expected);
+    n64_to_usb_report(&state.n64, &lut);
+    device_to_usb_report(&state, &device);
+
+    if (memcmp(&lut, &expected, sizeof(expected)) != 0 ||
+        memcmp(&device, &expected, sizeof(expected)) != 0) {
+        if (s_mismatches++ < 10) {
+            printf("mismatch: %02x %02x %d %d\n", buttons0, buttons1, stick_x, stick_y);
+        }
+    }
+}
+
+static void test_buttons(void) {
+    // Every button byte pair, with sticks at rest, at the limits and past them
+    static const int8_t sticks[] = {-128, -81, -80, -79, -1, 0, 1, 79, 80, 81, 127};
+    s_mismatches = 0;
+    for (uint b0 = 0; b0 < 256; b0++) {
+        for (uint b1 = 0; b1 < 256; b1++) {
+            for (size_t s = 0; s < sizeof(sticks); s++) {
+                compare((uint8_t)b0, (uint8_t)b1, sticks[s], sticks[sizeof(sticks) - 1 - s]);
+            }
+        }
+    }
+    CHECK_EQ(s_mismatches, 0);
+}
+
+static void test_sticks(void) {
+    // Every stick byte pair, with no buttons, all of them and a mix
+    static const uint8_t buttons[][2] = {{0x00, 0x00}, {0xFF, 0xFF}, {0xA5, 0x5A}, {0x5A, 0xA5}};
+    s_mismatches = 0;
+    for (int x = -128; x < 128; x++) {
+        for (int y = -128; y < 128; y++) {
+            for (size_t b = 0; b < sizeof(buttons) / sizeof(buttons[0]); b++) {
+                compare(buttons[b][0], buttons[b][1], (int8_t)x, (int8_t)y);
+            }
+        }
+    }
+    CHECK_EQ(s_mismatches, 0);
+}
+
+int main(void) {
+    usb_gamepad_init(0);
+    test_buttons();
+    test_sticks();
+    return test_result("test_gamepad_map");
+}
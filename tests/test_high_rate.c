@@ -0,0 +1,128 @@
+/*
+ * 1000 Hz Mode Throughput Test (host)
+ * Four controllers on the firmware built with N64_HIGH_RATE: bInterval 1
+ * on every HID endpoint, a new controller state every millisecond on every
+ * port, and each of them converted, sent and read by the host without
+ * reports dropped or states skipped.
+ */
+
+#include "test_common.h"
+#include "test_rig.h"
+#include <string.h>
+
+#define RUN_MS              1000
+#define STICK_STEPS         161         // -80 to +80
+
+static mock_device_t s_pad[MAX_CONTROLLERS];
+
+static int8_t stick_at(uint step) {
+    return (int8_t)((int)(step % STICK_STEPS) - 80);
+}
+
+static uint8_t expected_lx(uint step) {
+    n64_device_state_t state = {0};
+    usb_gamepad_report_t report;
+    state.type = N64_DEVICE_CONTROLLER;
+    state.n64.stick_x = stick_at(step);
+    device_to_usb_report(&state, &report);
+    return report.lx;
+}
+
+static void test_boot(void) {
+    CHECK(mock_console_find("Report rate: 1000 Hz (bInterval 1 ms)") != NULL);
+    CHECK_EQ(mock_tusb_hid_instances(), USB_HID_INSTANCES);
+    for (uint i = 0; i < USB_HID_INSTANCES; i++) {
+        CHECK_EQ(mock_tusb_hid_interval(i), 1);
+    }
+}
+
+static void test_throughput(void) {
+    mock_firmware_run_us(100000);
+    mock_tusb_clear_log();
+    mock_tusb_stats_t before, after;
+    mock_tusb_get_stats(&before);
+
+    // Every port changes state every millisecond
+    uint64_t from_ns = mock_now_ns();
+    uint64_t host_start = rig_host_ns();
+    for (uint step = 0; step < RUN_MS; step++) {
+        for (uint p = 0; p < MAX_CONTROLLERS; p++) {
+            mock_device_set_n64(&s_pad[p], 0, 0, stick_at(step), (int8_t)p);
+        }
+        mock_firmware_run_us(1000);
+    }
+    uint64_t host_ns = rig_host_ns() - host_start;
+    mock_tusb_get_stats(&after);
+
+    // Walk each port's reads through the state sequence
+    size_t count;
+    const mock_hid_read_t *log = mock_tusb_log(&count);
+    uint reads[MAX_CONTROLLERS] = {0};
+    uint skipped[MAX_CONTROLLERS] = {0};
+    int last_step[MAX_CONTROLLERS];
+    for (uint p = 0; p < MAX_CONTROLLERS; p++) {
+        last_step[p] = -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        uint port;
+        usb_gamepad_report_t report;
+        if (log[i].read_ns < from_ns || !rig_decode_read(&log[i], &port, &report)) {
+            continue;
+        }
+        reads[port]++;
+        int first = last_step[port] < 0 ? 0 : last_step[port];
+        for (int step = first; step < first + 8 && step < RUN_MS; step++) {
+            if (expected_lx((uint)step) == report.lx) {
+                if (last_step[port] >= 0 && step > last_step[port] + 1) {
+                    skipped[port] += (uint)(step - last_step[port] - 1);
+                }
+                last_step[port] = step;
+                break;
+            }
+        }
+    }
+
+    printf("1000 Hz, %d ports: %.0f ns host CPU per ms, %u rejected submits\n",
+           MAX_CONTROLLERS, (double)host_ns / RUN_MS, after.rejects - before.rejects);
+    for (uint p = 0; p < MAX_CONTROLLERS; p++) {
+        printf("port %u: %u reads/s, %u states skipped, last state %d\n", p + 1, reads[p],
+               skipped[p], last_step[p]);
+        CHECK(reads[p] >= RUN_MS - 10);
+        CHECK(skipped[p] <= RUN_MS / 100);
+        CHECK(last_step[p] >= RUN_MS - 4);
+    }
+}
+
+static void test_latency(void) {
+    // Sampled within a millisecond, read within the next one
+    mock_firmware_run_us(1500);
+    uint64_t press_ns = mock_now_ns();
+    mock_device_set_n64(&s_pad[2], N64_MASK_Z, 0, 0, 0);
+    mock_firmware_run_us(10000);
+
+    usb_gamepad_report_t report;
+    uint64_t read_ns;
+    uint64_t after_ns = press_ns;
+    while ((read_ns = rig_first_read(2, after_ns, &report)) != 0 &&
+           !(report.buttons & USB_BTN_Z)) {
+        after_ns = read_ns + 1;
+    }
+    CHECK(read_ns != 0);
+    uint64_t latency_us = (read_ns - press_ns) / 1000;
+    printf("press -> host read: %llu us\n", (unsigned long long)latency_us);
+    CHECK(latency_us <= 3000);
+}
+
+int main(void) {
+    rig_reset();
+    for (uint p = 0; p < MAX_CONTROLLERS; p++) {
+        mock_device_init(&s_pad[p], MOCK_DEVICE_N64);
+        rig_plug(p, &s_pad[p]);
+    }
+    rig_boot();
+
+    test_boot();
+    test_throughput();
+    test_latency();
+    return test_result("test_high_rate");
+}
@@ -0,0 +1,53 @@
+/*
+ * Hot-Plug Scheduler Test (host)
+ * Probe intervals of an empty port: the minimum after the first miss,
+ * doubling up to the ceiling, and back to the minimum after an unplug.
+ */
+
+#include "test_common.h"
+#include "n64_hotplug.h"
+
+static n64_hotplug_t s_hotplug;
+
+// Miss a probe at now_ms, return the interval to the next one
+static uint32_t miss(uint32_t now_ms) {
+    n64_hotplug_update(&s_hotplug, 0, false, now_ms);
+    return s_hotplug.ports[0].next_probe_ms - now_ms;
+}
+
+static void test_empty_port(void) {
+    n64_hotplug_init(&s_hotplug);
+    CHECK_EQ(n64_hotplug_due_mask(&s_hotplug, 0), (1u << MAX_CONTROLLERS) - 1);
+
+    static const uint32_t expected[] = {8, 16, 32, 64, 128, 250, 250};
+    uint32_t now_ms = 0;
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        uint32_t interval = miss(now_ms);
+        CHECK_EQ(interval, expected[i]);
+        CHECK(!(n64_hotplug_due_mask(&s_hotplug, now_ms + interval - 1) & 1));
+        CHECK(n64_hotplug_due_mask(&s_hotplug, now_ms + interval) & 1);
+        now_ms += interval;
+    }
+}
+
+static void test_unplug(void) {
+    n64_hotplug_init(&s_hotplug);
+    CHECK_EQ(n64_hotplug_update(&s_hotplug, 0, true, 100), N64_HOTPLUG_CONNECTED);
+    CHECK_EQ(n64_hotplug_update(&s_hotplug, 0, true, 108), N64_HOTPLUG_NONE);
+
+    // Unplug: probed again after the minimum, then backing off
+    CHECK_EQ(n64_hotplug_update(&s_hotplug, 0, false, 116), N64_HOTPLUG_DISCONNECTED);
+    CHECK_EQ(s_hotplug.ports[0].next_probe_ms, 116 + N64_HOTPLUG_BACKOFF_MIN_MS);
+    CHECK_EQ(miss(124), 2 * N64_HOTPLUG_BACKOFF_MIN_MS);
+
+    // Back after a long absence: the next unplug starts over
+    CHECK_EQ(n64_hotplug_update(&s_hotplug, 0, true, 200), N64_HOTPLUG_RECONNECTED);
+    CHECK_EQ(n64_hotplug_update(&s_hotplug, 0, false, 208), N64_HOTPLUG_DISCONNECTED);
+    CHECK_EQ(s_hotplug.ports[0].next_probe_ms, 208 + N64_HOTPLUG_BACKOFF_MIN_MS);
+}
+
+int main(void) {
+    test_empty_port();
+    test_unplug();
+    return test_result("test_hotplug");
+}
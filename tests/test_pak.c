@@ -0,0 +1,184 @@
+/*
+ * Controller Pak Test (host)
+ * n64_pak.c against the Controller Pak model: block CRCs, a whole 32 KiB
+ * dump and restore through the block job, a corrupted answer retried until
+ * the block goes through, N64_PAK_RETRIES running out, an empty slot (CRC
+ * inverted) and a job that never starts a block ending past until_us.
+ */
+
+#include "test_common.h"
+#include "test_rig.h"
+#include "n64_controller.h"
+#include "n64_pak.h"
+#include "pico/stdlib.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define PIN                 18
+
+static mock_device_t s_pad;
+static n64_controller_t s_ctrl[1];
+static uint8_t s_image[N64_PAK_SIZE];
+
+static n64_pak_job_state_t run_job(n64_pak_job_t *job) {
+    while (job->state == N64_PAK_JOB_RUNNING) {
+        n64_pak_job_task(job, s_ctrl, time_us_64() + 10 * N64_PAK_BLOCK_US);
+    }
+    return job->state;
+}
+
+static void fill_random(uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        data[i] = (uint8_t)rand();
+    }
+}
+
+static void test_crc(void) {
+    // Same CRCs as the bit-serial reference of the model
+    uint8_t block[N64_PAK_BLOCK_SIZE];
+    for (uint i = 0; i < 200; i++) {
+        fill_random(block, sizeof(block));
+        CHECK_EQ(n64_pak_data_crc(block), mock_pak_data_crc(block));
+    }
+    for (uint address = 0; address < 0x10000; address += N64_PAK_BLOCK_SIZE) {
+        CHECK_EQ(n64_pak_address_crc((uint16_t)address), mock_pak_address_crc((uint16_t)address));
+    }
+}
+
+static void test_dump_restore(void) {
+    n64_pak_job_t job;
+    fill_random(s_pad.pak, sizeof(s_pad.pak));
+    memset(s_image, 0, sizeof(s_image));
+
+    // Dump: every block read and checked
+    n64_pak_job_start(&job, N64_PAK_OP_READ, 0, s_image, 0, N64_PAK_BLOCKS);
+    CHECK_EQ(run_job(&job), N64_PAK_JOB_DONE);
+    CHECK_EQ(job.done, N64_PAK_BLOCKS);
+    CHECK_EQ(job.retries, 0);
+    CHECK(memcmp(s_image, s_pad.pak, sizeof(s_image)) == 0);
+    CHECK_EQ(s_pad.address_crc_errors, 0);
+    printf("dump: %llu us for %d blocks, %llu us on the wire\n",
+           (unsigned long long)(job.end_us - job.start_us), N64_PAK_BLOCKS,
+           (unsigned long long)job.wire_us);
+
+    // Restore: a different image written back, write CRCs checked
+    fill_random(s_image, sizeof(s_image));
+    n64_pak_job_start(&job, N64_PAK_OP_WRITE, 0, s_image, 0, N64_PAK_BLOCKS);
+    CHECK_EQ(run_job(&job), N64_PAK_JOB_DONE);
+    CHECK_EQ(job.done, N64_PAK_BLOCKS);
+    CHECK(memcmp(s_image, s_pad.pak, sizeof(s_image)) == 0);
+    CHECK_EQ(s_pad.address_crc_errors, 0);
+}
+
+static void test_crc_retry(void) {
+    // One answer in 7 corrupted: retried, the dump still matches
+    n64_pak_job_t job;
+    fill_random(s_pad.pak, sizeof(s_pad.pak));
+    s_pad.corrupt_every = 7;
+    s_pad.pak_transfers = 0;
+    n64_pak_job_start(&job, N64_PAK_OP_READ, 0, s_image, 0, 64);
+    CHECK_EQ(run_job(&job), N64_PAK_JOB_DONE);
+    CHECK(job.retries > 0);
+    CHECK_EQ(s_pad.pak_transfers, 64 + job.retries);
+    CHECK(memcmp(s_image, s_pad.pak, 64 * N64_PAK_BLOCK_SIZE) == 0);
+
+    // A single block corrupted once, then read correctly
+    uint8_t block[N64_PAK_BLOCK_SIZE];
+    s_pad.corrupt_every = 1;
+    CHECK_EQ(n64_pak_read(s_ctrl, 0x0400, block), N64_PAK_CRC_ERROR);
+    s_pad.corrupt_every = 0;
+    CHECK_EQ(n64_pak_read(s_ctrl, 0x0400, block), N64_PAK_OK);
+    CHECK(memcmp(block, &s_pad.pak[0x0400], sizeof(block)) == 0);
+}
+
+static void test_retries_exhausted(void) {
+    // Every answer corrupted: the first block fails after its retries
+    n64_pak_job_t job;
+    s_pad.corrupt_every = 1;
+    s_pad.pak_transfers = 0;
+    n64_pak_job_start(&job, N64_PAK_OP_WRITE, 0, s_image, 16, 4);
+    CHECK_EQ(run_job(&job), N64_PAK_JOB_FAILED);
+    CHECK_EQ(job.result, N64_PAK_CRC_ERROR);
+    CHECK_EQ(job.done, 0);
+    CHECK_EQ(job.retries, N64_PAK_RETRIES);
+    CHECK_EQ(s_pad.pak_transfers, 1 + N64_PAK_RETRIES);
+    s_pad.corrupt_every = 0;
+}
+
+static void test_no_pak(void) {
+    // Empty slot: inverted CRC, reported at once without retries
+    n64_pak_job_t job;
+    uint8_t block[N64_PAK_BLOCK_SIZE];
+    mock_device_set_accessory(&s_pad, MOCK_ACCESSORY_NONE);
+    CHECK_EQ(n64_pak_read(s_ctrl, 0x0000, block), N64_PAK_NO_PAK);
+    CHECK_EQ(n64_pak_write(s_ctrl, 0x0000, block), N64_PAK_NO_PAK);
+
+    s_pad.pak_transfers = 0;
+    n64_pak_job_start(&job, N64_PAK_OP_READ, 0, s_image, 0, N64_PAK_BLOCKS);
+    CHECK_EQ(run_job(&job), N64_PAK_JOB_FAILED);
+    CHECK_EQ(job.result, N64_PAK_NO_PAK);
+    CHECK_EQ(job.retries, 0);
+    CHECK_EQ(s_pad.pak_transfers, 1);
+    mock_device_set_accessory(&s_pad, MOCK_ACCESSORY_CPAK);
+}
+
+static void test_until(void) {
+    // Poll cycles of 8 ms with a 4 ms gap for pak blocks: every block ends
+    // inside its gap, nothing is started while only collecting
+    n64_pak_job_t job;
+    fill_random(s_pad.pak, sizeof(s_pad.pak));
+    s_pad.pak_transfers = 0;
+    n64_pak_job_start(&job, N64_PAK_OP_READ, 0, s_image, 0, 40);
+
+    // No room at all, or less than one block: nothing goes on the wire
+    CHECK(!n64_pak_job_task(&job, s_ctrl, 0));
+    CHECK(!n64_pak_job_task(&job, s_ctrl, time_us_64() + N64_PAK_BLOCK_US - 1));
+    CHECK_EQ(s_pad.pak_transfers, 0);
+    CHECK_EQ(job.state, N64_PAK_JOB_RUNNING);
+
+    uint late = 0;
+    uint cycles = 0;
+    uint64_t last_done_us = 0;
+    while (job.state == N64_PAK_JOB_RUNNING && cycles < 100) {
+        uint64_t gap_end = time_us_64() + 4000;
+        while (time_us_64() < gap_end && job.state == N64_PAK_JOB_RUNNING) {
+            n64_pak_job_task(&job, s_ctrl, gap_end);
+            if (s_ctrl[0].xfer_done_us != last_done_us) {
+                last_done_us = s_ctrl[0].xfer_done_us;
+                late += (last_done_us > gap_end);
+            }
+        }
+
+        // Poll part of the cycle: collect only
+        uint transfers = s_pad.pak_transfers;
+        uint64_t cycle_end = gap_end + 4000;
+        while (time_us_64() < cycle_end) {
+            n64_pak_job_task(&job, s_ctrl, 0);
+            mock_advance_us(100);
+        }
+        CHECK(s_pad.pak_transfers == transfers);
+        cycles++;
+    }
+    printf("40 blocks in %u cycles of 8 ms (4 ms gaps)\n", cycles);
+    CHECK_EQ(job.state, N64_PAK_JOB_DONE);
+    CHECK_EQ(late, 0);
+    CHECK(cycles >= 40 / (4000 / N64_PAK_BLOCK_US));
+    CHECK(memcmp(s_image, s_pad.pak, 40 * N64_PAK_BLOCK_SIZE) == 0);
+}
+
+int main(void) {
+    rig_reset();
+    srand(21);
+    mock_device_init(&s_pad, MOCK_DEVICE_N64);
+    mock_device_set_accessory(&s_pad, MOCK_ACCESSORY_CPAK);
+    mock_device_plug(PIN, &s_pad);
+    CHECK(n64_init(&s_ctrl[0], PIN));
+
+    test_crc();
+    test_dump_restore();
+    test_crc_retry();
+    test_retries_exhausted();
+    test_no_pak();
+    test_until();
+    return test_result("test_pak");
+}
@@ -0,0 +1,230 @@
+/*
+ * Controller Pak USB Drive Test (host)
+ * The firmware built with N64_MSC, a Controller Pak on port 1, the
+ * mass-storage callbacks called the way TinyUSB does for the host: the
+ * FAT12 volume and the pak image read through the block cache, a rewritten
+ * sector written back block run by block run (only the blocks that
+ * changed), a pak swapped before the write-back delay (the cached blocks
+ * are lost, the new pak is left untouched), and eject and SYNCHRONIZE
+ * CACHE writing back at once.
+ */
+
+#include "test_common.h"
+#include "test_rig.h"
+#include "n64_pak_cache.h"
+#include "usb_pak_drive.h"
+#include "tusb.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LUN                 0
+#define CMD_PAK_WRITE       0x03
+#define SECTOR              PAK_DRIVE_SECTOR_SIZE
+#define TIMEOUT_US          2000000
+
+static mock_device_t s_pad;
+static uint8_t s_other_pak[MOCK_PAK_SIZE];
+
+static void fill_random(uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        data[i] = (uint8_t)rand();
+    }
+}
+
+// Callbacks answer 0 while the line is read or locked: run and ask again
+static bool read_sector(uint32_t lba, uint8_t *buffer) {
+    uint64_t start_us = mock_now_us();
+    while (mock_now_us() - start_us < TIMEOUT_US) {
+        int32_t len = tud_msc_read10_cb(LUN, lba, 0, buffer, SECTOR);
+        if (len != 0) {
+            return len == SECTOR;
+        }
+        mock_firmware_run_us(1000);
+    }
+    return false;
+}
+
+static bool write_sector(uint32_t lba, uint8_t *buffer) {
+    uint64_t start_us = mock_now_us();
+    while (mock_now_us() - start_us < TIMEOUT_US) {
+        int32_t len = tud_msc_write10_cb(LUN, lba, 0, buffer, SECTOR);
+        if (len != 0) {
+            return len == SECTOR;
+        }
+        mock_firmware_run_us(1000);
+    }
+    return false;
+}
+
+static uint8_t take_sense(void) {
+    uint8_t asc, ascq;
+    return mock_tusb_msc_take_sense(LUN, &asc, &ascq);
+}
+
+// Cumulative cache counter from the 'stats' line ("..., <n> <name>")
+static uint32_t cache_stat(const char *name) {
+    const char *line = strstr(rig_console("stats"), "[STATS] Pak cache: ");
+    CHECK(line != NULL);
+    if (line == NULL) {
+        return 0;
+    }
+    char needle[32];
+    snprintf(needle, sizeof(needle), " %s", name);
+    const char *end = strchr(line, '\n');
+    const char *at = strstr(line, needle);
+    CHECK(at != NULL && (end == NULL || at < end));
+    if (at == NULL) {
+        return 0;
+    }
+    while (at > line && at[-1] != ' ') {
+        at--;
+    }
+    return (uint32_t)strtoul(at, NULL, 10);
+}
+
+static void test_volume(void) {
+    // First access after the pak was found: medium changed, then ready
+    CHECK(!tud_msc_test_unit_ready_cb(LUN));
+    CHECK_EQ(take_sense(), SCSI_SENSE_UNIT_ATTENTION);
+    CHECK(tud_msc_test_unit_ready_cb(LUN));
+    uint32_t blocks;
+    uint16_t block_size;
+    tud_msc_capacity_cb(LUN, &blocks, &block_size);
+    CHECK_EQ(blocks, PAK_DRIVE_SECTORS);
+    CHECK_EQ(block_size, SECTOR);
+
+    // Empty port: no medium
+    CHECK(!tud_msc_test_unit_ready_cb(1));
+    uint8_t asc, ascq;
+    CHECK_EQ(mock_tusb_msc_take_sense(1, &asc, &ascq), SCSI_SENSE_NOT_READY);
+    CHECK_EQ(asc, 0x3A);
+
+    uint8_t sector[SECTOR];
+    CHECK(read_sector(PAK_DRIVE_BOOT_SECTOR, sector));
+    CHECK(sector[510] == 0x55 && sector[511] == 0xAA);
+    CHECK_EQ(sector[11] | (sector[12] << 8), SECTOR);
+    CHECK_EQ(sector[19] | (sector[20] << 8), PAK_DRIVE_SECTORS);
+    CHECK(memcmp(&sector[54], "FAT12   ", 8) == 0);
+
+    // One file, PAK1.MPK, 32 KiB from cluster 2, contiguous
+    CHECK(read_sector(PAK_DRIVE_ROOT_SECTOR, sector));
+    const uint8_t *file = &sector[32];
+    CHECK(memcmp(file, "PAK1    MPK", 11) == 0);
+    CHECK_EQ(file[26] | (file[27] << 8), 2);
+    CHECK_EQ(file[28] | (file[29] << 8) | (file[30] << 16) | ((uint32_t)file[31] << 24),
+             N64_PAK_SIZE);
+    CHECK(read_sector(PAK_DRIVE_FAT_SECTOR, sector));
+    CHECK_EQ(sector[3] | ((sector[4] & 0x0F) << 8), 3);     // Cluster 2 -> 3
+
+    // The file is the pak image
+    uint bad = 0;
+    for (uint line = 0; line < N64_PAK_CACHE_PAK_LINES; line++) {
+        CHECK(read_sector(PAK_DRIVE_DATA_SECTOR + line, sector));
+        bad += memcmp(sector, &s_pad.pak[line * SECTOR], SECTOR) != 0;
+    }
+    CHECK_EQ(bad, 0);
+    CHECK_EQ(s_pad.commands[CMD_PAK_WRITE], 0);
+}
+
+static void test_write_back(void) {
+    // Three blocks of one sector changed: two runs (2-3, 9) written back
+    // after the delay, nothing else
+    uint line = 5;
+    uint8_t sector[SECTOR];
+    CHECK(read_sector(PAK_DRIVE_DATA_SECTOR + line, sector));
+    sector[2 * N64_PAK_BLOCK_SIZE] ^= 0xFF;
+    sector[3 * N64_PAK_BLOCK_SIZE + 31] ^= 0xFF;
+    sector[9 * N64_PAK_BLOCK_SIZE + 7] ^= 0xFF;
+    uint32_t writes = s_pad.commands[CMD_PAK_WRITE];
+    uint32_t written = cache_stat("blocks written");
+    CHECK(write_sector(PAK_DRIVE_DATA_SECTOR + line, sector));
+
+    mock_firmware_run_us(N64_PAK_CACHE_FLUSH_MS * 1000 / 2);
+    CHECK_EQ(s_pad.commands[CMD_PAK_WRITE], writes);
+    mock_firmware_run_us(N64_PAK_CACHE_FLUSH_MS * 1000);
+    CHECK_EQ(s_pad.commands[CMD_PAK_WRITE], writes + 3);
+    CHECK_EQ(cache_stat("blocks written"), written + 3);
+    CHECK(memcmp(sector, &s_pad.pak[line * SECTOR], SECTOR) == 0);
+
+    // Same data again: no write at all
+    uint32_t unchanged = cache_stat("unchanged");
+    CHECK(write_sector(PAK_DRIVE_DATA_SECTOR + line, sector));
+    mock_firmware_run_us(N64_PAK_CACHE_FLUSH_MS * 2000);
+    CHECK_EQ(s_pad.commands[CMD_PAK_WRITE], writes + 3);
+    CHECK_EQ(cache_stat("unchanged"), unchanged + N64_PAK_CACHE_LINE_BLOCKS);
+}
+
+static void test_swap(void) {
+    // Sector written, then another pak in the slot before the write-back:
+    // the ID check before writing sees the swap, the blocks are dropped
+    uint line = 7;
+    uint8_t sector[SECTOR];
+    CHECK(read_sector(PAK_DRIVE_DATA_SECTOR + line, sector));
+    sector[4 * N64_PAK_BLOCK_SIZE] ^= 0x5A;
+    sector[5 * N64_PAK_BLOCK_SIZE] ^= 0x5A;
+    uint32_t writes = s_pad.commands[CMD_PAK_WRITE];
+    uint32_t lost = cache_stat("lost");
+    CHECK(write_sector(PAK_DRIVE_DATA_SECTOR + line, sector));
+
+    fill_random(s_other_pak, sizeof(s_other_pak));
+    memcpy(s_pad.pak, s_other_pak, sizeof(s_other_pak));
+    mock_firmware_run_us(N64_PAK_CACHE_FLUSH_MS * 3000);
+    CHECK_EQ(s_pad.commands[CMD_PAK_WRITE], writes);
+    CHECK(memcmp(s_pad.pak, s_other_pak, sizeof(s_other_pak)) == 0);
+    CHECK_EQ(cache_stat("lost"), lost + 2);
+
+    // The host is told, then reads the new pak
+    CHECK(!tud_msc_test_unit_ready_cb(LUN));
+    CHECK_EQ(take_sense(), SCSI_SENSE_UNIT_ATTENTION);
+    CHECK(tud_msc_test_unit_ready_cb(LUN));
+    CHECK(read_sector(PAK_DRIVE_DATA_SECTOR + line, sector));
+    CHECK(memcmp(sector, &s_other_pak[line * SECTOR], SECTOR) == 0);
+}
+
+static void test_flush_now(void) {
+    // SYNCHRONIZE CACHE: written back without waiting for the delay
+    static const uint8_t sync_cmd[16] = {0x35};
+    uint line = 12;
+    uint8_t sector[SECTOR];
+    CHECK(read_sector(PAK_DRIVE_DATA_SECTOR + line, sector));
+    sector[0] ^= 0x01;
+    uint32_t writes = s_pad.commands[CMD_PAK_WRITE];
+    CHECK(write_sector(PAK_DRIVE_DATA_SECTOR + line, sector));
+    CHECK_EQ(tud_msc_scsi_cb(LUN, sync_cmd, NULL, 0), 0);
+    mock_firmware_run_us(N64_PAK_CACHE_FLUSH_MS * 1000 / 3);
+    CHECK_EQ(s_pad.commands[CMD_PAK_WRITE], writes + 1);
+    CHECK(memcmp(sector, &s_pad.pak[line * SECTOR], SECTOR) == 0);
+
+    // Eject: written back at once, then no medium until loaded again
+    line = 20;
+    CHECK(read_sector(PAK_DRIVE_DATA_SECTOR + line, sector));
+    sector[31 * N64_PAK_BLOCK_SIZE / 2] ^= 0x80;
+    writes = s_pad.commands[CMD_PAK_WRITE];
+    CHECK(write_sector(PAK_DRIVE_DATA_SECTOR + line, sector));
+    CHECK(tud_msc_start_stop_cb(LUN, 0, false, true));
+    mock_firmware_run_us(N64_PAK_CACHE_FLUSH_MS * 1000 / 3);
+    CHECK_EQ(s_pad.commands[CMD_PAK_WRITE], writes + 1);
+    CHECK(memcmp(sector, &s_pad.pak[line * SECTOR], SECTOR) == 0);
+
+    CHECK(!tud_msc_test_unit_ready_cb(LUN));
+    CHECK_EQ(take_sense(), SCSI_SENSE_NOT_READY);
+    CHECK(tud_msc_start_stop_cb(LUN, 0, true, true));
+    CHECK(tud_msc_test_unit_ready_cb(LUN));
+}
+
+int main(void) {
+    rig_reset();
+    srand(22);
+    mock_device_init(&s_pad, MOCK_DEVICE_N64);
+    mock_device_set_accessory(&s_pad, MOCK_ACCESSORY_CPAK);
+    fill_random(s_pad.pak, sizeof(s_pad.pak));
+    rig_plug(0, &s_pad);
+    rig_boot();
+    mock_firmware_run_us(N64_PAK_CACHE_PROBE_MS * 1000 + 100000);
+
+    test_volume();
+    test_write_back();
+    test_swap();
+    test_flush_now();
+    return test_result("test_pak_drive");
+}
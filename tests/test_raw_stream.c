@@ -0,0 +1,141 @@
+/*
+ * Raw Joybus Stream Test (host)
+ * Built at a poll rate the stream can carry and at one past its capacity
+ * (8 ports at 1 kHz): frames carry the poll results in sequence order, a
+ * result that does not reach the host leaves a sequence gap, and the boot
+ * log announces the overload. Also checks that the dual-core handoff
+ * carries the poll result number, so an overwritten snapshot is a gap too.
+ */
+
+#include "test_common.h"
+#include "test_rig.h"
+#include "state_handoff.h"
+#include "usb_raw_stream.h"
+#include <string.h>
+
+#define RUN_MS              1000
+#define POLL_RESULTS_PER_S  ((uint)MAX_CONTROLLERS * (1000000u / POLL_INTERVAL_US))
+#define STREAM_CAPACITY     ((uint)RAW_STREAM_FRAMES_PER_REPORT * 1000u)   // 1 report per ms
+
+static mock_device_t s_pad[MAX_CONTROLLERS];
+
+typedef struct {
+    uint frames;
+    uint gaps;                          // Sequence numbers never received
+    uint port_frames[MAX_CONTROLLERS];
+    uint bad_state;                     // Frames whose bytes differ from the pad
+} stream_count_t;
+
+static void count_stream(uint64_t from_ns, stream_count_t *count) {
+    memset(count, 0, sizeof(*count));
+    size_t reads;
+    const mock_hid_read_t *log = mock_tusb_log(&reads);
+    bool first = true;
+    uint16_t next_seq = 0;
+
+    for (size_t i = 0; i < reads; i++) {
+        if (log[i].read_ns < from_ns || log[i].instance != USB_STREAM_INSTANCE) {
+            continue;
+        }
+        raw_stream_report_t report;
+        CHECK_EQ(log[i].len, sizeof(report));
+        memcpy(&report, log[i].data, sizeof(report));
+        CHECK_EQ(report.magic, RAW_STREAM_MAGIC);
+
+        for (uint f = 0; f < report.count; f++) {
+            const raw_stream_frame_t *frame = &report.frames[f];
+            if (!first) {
+                count->gaps += (uint16_t)(frame->seq - next_seq);
+            }
+            first = false;
+            next_seq = (uint16_t)(frame->seq + 1);
+            count->frames++;
+            if (frame->port < MAX_CONTROLLERS) {
+                count->port_frames[frame->port]++;
+                if (!(frame->flags & RAW_FRAME_RESPONDING) ||
+                    memcmp(&frame->state, s_pad[frame->port].state, sizeof(frame->state)) != 0) {
+                    count->bad_state++;
+                }
+            }
+        }
+    }
+}
+
+static void test_boot(void) {
+    CHECK(mock_console_find("USB raw stream:") != NULL);
+    bool over = POLL_RESULTS_PER_S > STREAM_CAPACITY;
+    CHECK_EQ(mock_console_find("over capacity") != NULL, over);
+}
+
+static void test_stream(void) {
+    mock_firmware_run_us(100000);
+    mock_tusb_clear_log();
+    uint64_t from_ns = mock_now_ns();
+    mock_firmware_run_us(RUN_MS * 1000);
+
+    stream_count_t count;
+    count_stream(from_ns, &count);
+    printf("%d ports every %d us: %u poll results/s, %u frames/s received, %u gaps\n",
+           MAX_CONTROLLERS, POLL_INTERVAL_US, POLL_RESULTS_PER_S, count.frames, count.gaps);
+    CHECK_EQ(count.bad_state, 0);
+
+    // Every result is either received or a gap
+    CHECK(count.frames + count.gaps >= POLL_RESULTS_PER_S * 98 / 100);
+    CHECK(count.frames + count.gaps <= POLL_RESULTS_PER_S * 102 / 100);
+    if (POLL_RESULTS_PER_S <= STREAM_CAPACITY) {
+        CHECK_EQ(count.gaps, 0);
+        for (uint p = 0; p < MAX_CONTROLLERS; p++) {
+            CHECK(count.port_frames[p] >= 1000000 / POLL_INTERVAL_US * 98 / 100);
+        }
+    } else {
+        CHECK(count.frames <= STREAM_CAPACITY);
+        CHECK(count.gaps >= (POLL_RESULTS_PER_S - STREAM_CAPACITY) * 9 / 10);
+    }
+}
+
+static void test_handoff_seq(void) {
+    // Two results published before the consumer looks: it reads the second,
+    // whose number is two past the last one it saw
+    state_handoff_t handoff;
+    n64_device_state_t state = {0}, read_state;
+    bool responding;
+    uint32_t sample_us, seq;
+    uint16_t capture_seq;
+    state_handoff_init(&handoff);
+    state.type = N64_DEVICE_CONTROLLER;
+
+    state.n64.buttons0 = N64_MASK_A;
+    state_handoff_publish(&handoff, &state, true, 100, 41);
+    CHECK(state_handoff_read(&handoff, &read_state, &responding, &sample_us, &capture_seq, &seq));
+    CHECK_EQ(capture_seq, 41);
+
+    state_handoff_publish(&handoff, &state, true, 200, 42);
+    state.n64.buttons0 = N64_MASK_B;
+    state_handoff_publish(&handoff, &state, true, 300, 43);
+    CHECK(state_handoff_read(&handoff, &read_state, &responding, &sample_us, &capture_seq, &seq));
+    CHECK_EQ(capture_seq, 43);
+    CHECK_EQ(sample_us, 300);
+    CHECK_EQ(read_state.n64.buttons0, N64_MASK_B);
+
+    // Wraps with the 16-bit stream sequence
+    state_handoff_publish(&handoff, &state, false, 400, 0xFFFF);
+    CHECK(state_handoff_read(&handoff, &read_state, &responding, &sample_us, &capture_seq, &seq));
+    CHECK_EQ(capture_seq, 0xFFFF);
+    CHECK(!responding);
+}
+
+int main(void) {
+    rig_reset();
+    for (uint p = 0; p < MAX_CONTROLLERS; p++) {
+        mock_device_init(&s_pad[p], MOCK_DEVICE_N64);
+        mock_device_set_n64(&s_pad[p], (uint8_t)(N64_MASK_A >> (p % 4)), (uint8_t)p,
+                            (int8_t)(p * 7), (int8_t)-p);
+        rig_plug(p, &s_pad[p]);
+    }
+    rig_boot();
+
+    test_boot();
+    test_stream();
+    test_handoff_seq();
+    return test_result("test_raw_stream");
+}
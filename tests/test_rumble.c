@@ -0,0 +1,225 @@
+/*
+ * Rumble Pak Test (host)
+ * The firmware with a Rumble Pak on port 1 and a Controller Pak on port 2,
+ * rumble output reports sent the way a host does: identification (0xFE
+ * then 0x80 written to 0x8000) before the first motor write, a Controller
+ * Pak reported as no Rumble Pak and never written at 0xC000, a burst of
+ * reports coalesced into one motor write, repeated states counted as
+ * unchanged, and the motor writes of port 1 never moving the polls of
+ * port 2.
+ */
+
+#include "test_common.h"
+#include "test_rig.h"
+#include "n64_rumble.h"
+#include "tusb.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define CMD_STATUS          0x01
+#define CMD_PAK_WRITE       0x03
+#define POLL_US             8000
+#define STATUS_LOG_MAX      512
+#define ID_WRITES_MAX       8
+
+// Frames a port sees, recorded in front of the device model
+typedef struct {
+    mock_device_t device;
+    uint8_t id_writes[ID_WRITES_MAX];   // Last byte of each 0x8000 write
+    uint id_write_count;
+    uint32_t motor_block_writes;        // Writes to 0xC000, any content
+    uint64_t status_ns[STATUS_LOG_MAX];
+    uint status_count;
+} port_log_t;
+
+static port_log_t s_port[2];
+
+static void record(void *ctx, const uint8_t *cmd, uint cmd_len, mock_joybus_reply_t *reply) {
+    port_log_t *log = ctx;
+    if (cmd_len >= 1 && cmd[0] == CMD_STATUS && log->status_count < STATUS_LOG_MAX) {
+        log->status_ns[log->status_count++] = mock_now_ns();
+    } else if (cmd_len == 3 + N64_PAK_BLOCK_SIZE && cmd[0] == CMD_PAK_WRITE) {
+        uint16_t address = (uint16_t)((cmd[1] << 8) | cmd[2]) & 0xFFE0;
+        if (address == N64_RUMBLE_ID_ADDRESS && log->id_write_count < ID_WRITES_MAX) {
+            log->id_writes[log->id_write_count++] = cmd[cmd_len - 1];
+        } else if (address == N64_RUMBLE_MOTOR_ADDRESS) {
+            log->motor_block_writes++;
+        }
+    }
+    mock_device_answer(&log->device, cmd, cmd_len, reply);
+}
+
+static void rumble(uint port, uint8_t strength, uint8_t duration) {
+    usb_rumble_report_t report = {.strength = strength, .duration = duration};
+    mock_tusb_set_report((uint8_t)port, 0, HID_REPORT_TYPE_OUTPUT, &report, sizeof(report));
+}
+
+// Rumble line of a port from 'stats' (empty if it has none)
+static const char *rumble_line(uint port) {
+    static char line[256];
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "[STATS] P%u rumble (", port + 1);
+    const char *at = strstr(rig_console("stats"), prefix);
+    line[0] = '\0';
+    if (at != NULL) {
+        size_t len = strcspn(at, "\n");
+        if (len >= sizeof(line)) {
+            len = sizeof(line) - 1;
+        }
+        memcpy(line, at, len);
+        line[len] = '\0';
+    }
+    return line;
+}
+
+// Cumulative rumble counter of a port ("..., <n> <name>")
+static uint32_t rumble_stat(uint port, const char *name) {
+    const char *line = rumble_line(port);
+    char needle[32];
+    snprintf(needle, sizeof(needle), " %s", name);
+    const char *at = strstr(line, needle);
+    CHECK(at != NULL);
+    if (at == NULL) {
+        return 0;
+    }
+    while (at > line && at[-1] != ' ') {
+        at--;
+    }
+    return (uint32_t)strtoul(at, NULL, 10);
+}
+
+static void test_identify(void) {
+    // First command: 0xFE (kept only by a Controller Pak), then 0x80,
+    // then the motor block
+    mock_device_t *pad = &s_port[0].device;
+    CHECK_EQ(s_port[0].id_write_count, 0);
+    rumble(0, 255, 0);
+    mock_firmware_run_us(100000);
+    CHECK_EQ(s_port[0].id_write_count, 2);
+    CHECK_EQ(s_port[0].id_writes[0], N64_RUMBLE_PROBE);
+    CHECK_EQ(s_port[0].id_writes[1], N64_RUMBLE_ID);
+    CHECK_EQ(pad->rumble_id, N64_RUMBLE_ID);
+    CHECK(pad->motor);
+    CHECK_EQ(pad->motor_writes, 1);
+    CHECK(strstr(rumble_line(0), "(Rumble Pak): 1 commands") != NULL);
+    CHECK_EQ(rumble_stat(0, "motor writes"), 1);
+}
+
+static void test_controller_pak(void) {
+    // The probe byte reads back: no Rumble Pak, nothing sent to 0xC000
+    mock_device_t *pad = &s_port[1].device;
+    uint8_t pak[MOCK_PAK_SIZE];
+    memcpy(pak, pad->pak, sizeof(pak));
+    rumble(1, 255, 0);
+    mock_firmware_run_us(100000);
+    CHECK_EQ(s_port[1].id_write_count, 1);
+    CHECK_EQ(s_port[1].id_writes[0], N64_RUMBLE_PROBE);
+    CHECK_EQ(s_port[1].motor_block_writes, 0);
+    CHECK_EQ(pad->motor_writes, 0);
+    CHECK(strstr(rumble_line(1), "(no Rumble Pak)") != NULL);
+    CHECK(memcmp(pak, pad->pak, sizeof(pak)) == 0);
+
+    // Stopped before the retry: counted as ignored, never identified again
+    uint32_t ignored = rumble_stat(1, "ignored");
+    rumble(1, 0, 0);
+    mock_firmware_run_us(N64_RUMBLE_RETRY_MS * 2000);
+    CHECK_EQ(rumble_stat(1, "ignored"), ignored + 1);
+    CHECK_EQ(s_port[1].id_write_count, 1);
+    CHECK_EQ(s_port[1].motor_block_writes, 0);
+}
+
+static void test_burst(void) {
+    // Nine reports in one USB task, each one a change: only the last one
+    // reaches the motor
+    mock_device_t *pad = &s_port[0].device;
+    CHECK(pad->motor);
+    uint32_t writes = pad->motor_writes;
+    uint32_t toggles = pad->motor_toggles;
+    uint32_t coalesced = rumble_stat(0, "coalesced");
+    for (uint i = 0; i < 9; i++) {
+        rumble(0, (i % 2) ? 255 : 0, 0);
+    }
+    mock_firmware_run_us(50000);
+    CHECK(!pad->motor);
+    CHECK_EQ(pad->motor_writes, writes + 1);
+    CHECK_EQ(pad->motor_toggles, toggles + 1);
+    CHECK_EQ(rumble_stat(0, "coalesced"), coalesced + 8);
+}
+
+static void test_unchanged(void) {
+    // Off again, three times: no write, each one counted
+    mock_device_t *pad = &s_port[0].device;
+    uint32_t writes = pad->motor_writes;
+    uint32_t unchanged = rumble_stat(0, "unchanged");
+    for (uint i = 0; i < 3; i++) {
+        rumble(0, 0, 0);
+        mock_firmware_run_us(20000);
+    }
+    CHECK_EQ(pad->motor_writes, writes);
+    CHECK_EQ(rumble_stat(0, "unchanged"), unchanged + 3);
+
+    // On, then on again
+    rumble(0, 255, 0);
+    mock_firmware_run_us(20000);
+    rumble(0, 255, 0);
+    mock_firmware_run_us(20000);
+    CHECK_EQ(pad->motor_writes, writes + 1);
+    CHECK_EQ(rumble_stat(0, "unchanged"), unchanged + 4);
+}
+
+static void test_other_port(void) {
+    // Half strength for a second: the duty cycle writes the motor block
+    // every 50 ms, with host reports arriving at random times; port 2 is
+    // polled every period all along
+    mock_device_t *pad = &s_port[0].device;
+    uint32_t writes = pad->motor_writes;
+    s_port[1].status_count = 0;
+    rumble(0, 128, 0);
+    for (uint i = 0; i < 100; i++) {
+        mock_firmware_run_us(5000 + (uint)(rand() % 10000));
+        if (i % 10 == 0) {
+            rumble(0, 128, 0);
+        }
+    }
+    rumble(0, 0, 0);
+    mock_firmware_run_us(20000);
+    CHECK(pad->motor_writes >= writes + 15);
+
+    uint polls = s_port[1].status_count;
+    int64_t max_dev_ns = 0;
+    for (uint i = 1; i < polls; i++) {
+        int64_t dev = (int64_t)(s_port[1].status_ns[i] - s_port[1].status_ns[i - 1]) -
+                      (int64_t)POLL_US * 1000;
+        if (llabs(dev) > max_dev_ns) {
+            max_dev_ns = llabs(dev);
+        }
+    }
+    printf("P1 %lu motor writes, P2 %u polls, interval off by %lld ns at most\n",
+           (unsigned long)(pad->motor_writes - writes), polls, (long long)max_dev_ns);
+    CHECK(polls > 100);
+    CHECK(max_dev_ns < 20000);
+}
+
+int main(void) {
+    rig_reset();
+    srand(23);
+    mock_device_init(&s_port[0].device, MOCK_DEVICE_N64);
+    mock_device_set_accessory(&s_port[0].device, MOCK_ACCESSORY_RUMBLE);
+    mock_device_init(&s_port[1].device, MOCK_DEVICE_N64);
+    mock_device_set_accessory(&s_port[1].device, MOCK_ACCESSORY_CPAK);
+    for (uint i = 0; i < 2; i++) {
+        for (uint j = 0; j < MOCK_PAK_SIZE; j++) {
+            s_port[i].device.pak[j] = (uint8_t)rand();
+        }
+        mock_joybus_attach(N64_DATA_PINS[i], record, &s_port[i]);
+    }
+    rig_boot();
+    mock_firmware_run_us(100000);
+
+    test_identify();
+    test_controller_pak();
+    test_burst();
+    test_unchanged();
+    test_other_port();
+    return test_result("test_rumble");
+}
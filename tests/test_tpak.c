@@ -0,0 +1,209 @@
+/*
+ * Transfer Pak Test (host)
+ * The firmware built with N64_TPAK, a Transfer Pak on port 1, requests sent
+ * on the vendor interface as tools/n64_tpak_dump.c does: header read, ROM
+ * dumps of a banked MBC5 cartridge and of an MBC1 cartridge whose bank
+ * 0x20 needs banking mode 1, an SRAM dump, a Transfer Pak without a
+ * cartridge, and a host that stops reading (both chunk buffers waiting for
+ * USB: the cartridge reads stall). Every dump ends with the power-off
+ * write of 0xFE to 0x8000.
+ */
+
+#include "test_common.h"
+#include "test_rig.h"
+#include "n64_tpak.h"
+#include "usb_tpak_stream.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ROM_MAX             (1024 * 1024)
+#define TIMEOUT_US          (120 * 1000000ull)
+
+static mock_device_t s_pad;
+static uint8_t s_rom[ROM_MAX];
+static uint8_t s_data[ROM_MAX];
+
+typedef struct {
+    tpak_response_t response;
+    uint32_t length;                // Data bytes received
+    tpak_trailer_t trailer;
+    bool complete;
+} dump_t;
+
+// Send a request and take the stream until its trailer (or a timeout)
+static void run_dump(uint8_t command, dump_t *dump) {
+    tpak_request_t request = {
+        .magic = {'T', 'P'},
+        .version = TPAK_STREAM_VERSION,
+        .command = command,
+        .port = 0,
+    };
+    static uint8_t stream[sizeof(tpak_response_t) + ROM_MAX + sizeof(tpak_trailer_t)];
+    uint32_t received = 0;
+
+    memset(dump, 0, sizeof(*dump));
+    mock_tusb_vendor_send(&request, sizeof(request));
+    uint64_t start_us = mock_now_us();
+    while (mock_now_us() - start_us < TIMEOUT_US) {
+        mock_firmware_run_us(10000);
+        received += mock_tusb_vendor_receive(&stream[received], sizeof(stream) - received);
+        if (received < sizeof(tpak_response_t)) {
+            continue;
+        }
+        memcpy(&dump->response, stream, sizeof(dump->response));
+        uint32_t end = (uint32_t)sizeof(tpak_response_t) + dump->response.length;
+        if (received >= end + sizeof(tpak_trailer_t)) {
+            memcpy(s_data, &stream[sizeof(tpak_response_t)], dump->response.length);
+            memcpy(&dump->trailer, &stream[end], sizeof(dump->trailer));
+            dump->length = dump->response.length;
+            dump->complete = true;
+            break;
+        }
+    }
+    CHECK(dump->complete);
+    CHECK(memcmp(dump->response.magic, TPAK_RESPONSE_MAGIC, 2) == 0);
+    if (dump->complete) {
+        CHECK(memcmp(dump->trailer.magic, TPAK_TRAILER_MAGIC, 2) == 0);
+    }
+
+    // Cartridge access and power off whatever the result
+    mock_firmware_run_us(10000);
+    CHECK_EQ(s_pad.tpak_last_power, N64_TPAK_POWER_OFF);
+    CHECK(!s_pad.tpak_powered);
+}
+
+static void insert(mock_mbc_t mbc, uint8_t type, uint8_t rom_code, uint8_t ram_code,
+                   uint32_t ram_size, const char *title) {
+    mock_device_set_accessory(&s_pad, MOCK_ACCESSORY_TPAK);
+    mock_gb_make_rom(s_rom, 0x8000u << rom_code, type, rom_code, ram_code, title);
+    mock_device_insert_cart(&s_pad, mbc, s_rom, 0x8000u << rom_code, ram_size);
+}
+
+static void test_header(void) {
+    insert(MOCK_MBC5, 0x1B, 3, 0x02, 0x2000, "POKEMON TEST");
+    dump_t dump;
+    run_dump(TPAK_CMD_HEADER, &dump);
+    CHECK_EQ(dump.response.status, N64_TPAK_OK);
+    CHECK(dump.response.checksum_ok);
+    CHECK_EQ(dump.response.length, 0);
+    CHECK_EQ(dump.response.rom_size, 256 * 1024);
+    CHECK_EQ(dump.response.ram_size, 0x2000);
+    CHECK(memcmp(dump.response.gb_header, "POKEMON TEST", 12) == 0);
+    CHECK_EQ(dump.trailer.status, N64_TPAK_OK);
+
+    // The console command reads it as well
+    const char *out = rig_console("tpak 1");
+    CHECK(strstr(out, "[TPAK] P1: reading the cartridge header") != NULL);
+    mock_firmware_run_us(200000);
+    CHECK(mock_console_find("[TPAK] P1 cartridge \"POKEMON TEST\": type 0x1B, ROM 256 KiB") != NULL);
+    CHECK_EQ(s_pad.tpak_last_power, N64_TPAK_POWER_OFF);
+}
+
+static void test_rom(mock_mbc_t mbc, uint8_t type, uint8_t rom_code) {
+    insert(mbc, type, rom_code, 0x00, 0, "ROM DUMP");
+    uint32_t size = 0x8000u << rom_code;
+    dump_t dump;
+    run_dump(TPAK_CMD_ROM, &dump);
+    CHECK_EQ(dump.response.status, N64_TPAK_OK);
+    CHECK_EQ(dump.length, size);
+    CHECK_EQ(dump.trailer.status, N64_TPAK_OK);
+    CHECK_EQ(dump.trailer.bytes, size);
+    CHECK_EQ(dump.trailer.retries, 0);
+
+    uint bad_banks = 0;
+    for (uint32_t bank = 0; bank < size / GB_ROM_BANK_SIZE; bank++) {
+        bad_banks += memcmp(&s_data[bank * GB_ROM_BANK_SIZE], &s_rom[bank * GB_ROM_BANK_SIZE],
+                            GB_ROM_BANK_SIZE) != 0;
+    }
+    printf("%s %lu KiB ROM: %lu bytes/s sustained, %lu reads waited for USB, %u bad banks\n",
+           mbc == MOCK_MBC1 ? "MBC1" : "MBC5", (unsigned long)(size / 1024),
+           (unsigned long)dump.trailer.bytes_per_s, (unsigned long)dump.trailer.stalls, bad_banks);
+    CHECK_EQ(bad_banks, 0);
+}
+
+static void test_sram(void) {
+    insert(MOCK_MBC5, 0x1B, 2, 0x03, 0x8000, "SAVE");
+    dump_t dump;
+    run_dump(TPAK_CMD_SRAM, &dump);
+    CHECK_EQ(dump.response.status, N64_TPAK_OK);
+    CHECK_EQ(dump.length, 0x8000);
+    CHECK_EQ(dump.trailer.status, N64_TPAK_OK);
+    CHECK(memcmp(s_data, s_pad.cart.ram, 0x8000) == 0);
+    CHECK(!s_pad.cart.ram_enabled);
+}
+
+static void test_no_cartridge(void) {
+    mock_device_set_accessory(&s_pad, MOCK_ACCESSORY_TPAK);
+    memset(&s_pad.cart, 0, sizeof(s_pad.cart));
+    dump_t dump;
+    run_dump(TPAK_CMD_ROM, &dump);
+    CHECK_EQ(dump.response.status, N64_TPAK_NO_CARTRIDGE);
+    CHECK_EQ(dump.length, 0);
+    CHECK_EQ(dump.trailer.status, N64_TPAK_NO_CARTRIDGE);
+    CHECK_EQ(dump.trailer.bytes, 0);
+}
+
+static void test_host_stalled(void) {
+    // Host stops reading: the FIFO and both chunks fill, cartridge reads
+    // wait; once it reads again the dump completes intact
+    insert(MOCK_MBC5, 0x1B, 1, 0x00, 0, "STALL");
+    tpak_request_t request = {
+        .magic = {'T', 'P'},
+        .version = TPAK_STREAM_VERSION,
+        .command = TPAK_CMD_ROM,
+    };
+    mock_tusb_vendor_set_rate(0);
+    mock_tusb_vendor_send(&request, sizeof(request));
+    mock_firmware_run_us(500000);
+    CHECK(s_pad.tpak_powered);
+    uint32_t transfers = s_pad.pak_transfers;
+    mock_firmware_run_us(500000);
+    CHECK_EQ(s_pad.pak_transfers, transfers);       // Nothing read meanwhile
+
+    // Player input still reported while the dump waits
+    mock_device_set_n64(&s_pad, N64_MASK_A, 0, 0, 0);
+    uint64_t from_ns = mock_now_ns();
+    mock_firmware_run_us(100000);
+    mock_tusb_vendor_set_rate(1216);
+
+    // The rest of the stream: header, data, trailer
+    static uint8_t stream[sizeof(tpak_response_t) + 0x10000 + sizeof(tpak_trailer_t)];
+    uint32_t received = 0;
+    for (int i = 0; i < 1000 && received < sizeof(stream); i++) {
+        mock_firmware_run_us(10000);
+        received += mock_tusb_vendor_receive(&stream[received], sizeof(stream) - received);
+    }
+    CHECK_EQ(received, sizeof(stream));
+    tpak_trailer_t trailer;
+    memcpy(&trailer, &stream[sizeof(tpak_response_t) + 0x10000], sizeof(trailer));
+    CHECK_EQ(trailer.status, N64_TPAK_OK);
+    CHECK(trailer.stalls > 0);
+    CHECK(memcmp(&stream[sizeof(tpak_response_t)], s_rom, 0x10000) == 0);
+    printf("stalled host: %lu reads waited for USB\n", (unsigned long)trailer.stalls);
+
+    usb_gamepad_report_t report;
+    uint64_t read_ns = rig_first_read(0, from_ns, &report);
+    CHECK(read_ns != 0 && read_ns < from_ns + 100000000ull);
+    CHECK(report.buttons & USB_BTN_A);
+    mock_firmware_run_us(10000);
+    CHECK_EQ(s_pad.tpak_last_power, N64_TPAK_POWER_OFF);
+    mock_device_set_n64(&s_pad, 0, 0, 0, 0);
+}
+
+int main(void) {
+    rig_reset();
+    mock_device_init(&s_pad, MOCK_DEVICE_N64);
+    mock_device_set_accessory(&s_pad, MOCK_ACCESSORY_TPAK);
+    rig_plug(0, &s_pad);
+    rig_boot();
+    mock_firmware_run_us(100000);
+    CHECK(mock_console_find("USB Transfer Pak stream: vendor interface") != NULL);
+
+    test_header();
+    test_rom(MOCK_MBC5, 0x1B, 3);       // 256 KiB, banks 1-15 through 0x2000/0x3000
+    test_rom(MOCK_MBC1, 0x01, 5);       // 1 MiB, bank 0x20 read in mode 1
+    test_sram();
+    test_no_cartridge();
+    test_host_stalled();
+    return test_result("test_tpak");
+}
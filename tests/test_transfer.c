@@ -0,0 +1,251 @@
+/*
+ * Asynchronous Transfer Test (host)
+ * Drives n64_controller.c directly against the PIO/DMA model: the
+ * BUSY/DONE/ERROR/ABSENT states of n64_read_poll and n64_transfer_poll,
+ * timeouts of short frames, end-of-frame IRQs arriving late or at the
+ * deadline, batched release and the DMA-fed long pak commands.
+ */
+
+#include "test_common.h"
+#include "test_rig.h"
+#include "n64_controller.h"
+#include <string.h>
+
+#define PIN_A               18
+#define PIN_B               19
+#define STATUS_TIMEOUT_US   (N64_TIMEOUT_FIRST_US + N64_TIMEOUT_BYTE_US * N64_STATUS_SIZE)
+
+static mock_device_t s_pad[2];
+static n64_controller_t s_ctrl[2];
+
+static n64_xfer_status_t wait_read(n64_controller_t *controller, n64_device_state_t *state) {
+    n64_xfer_status_t status;
+    while ((status = n64_read_poll(controller, state)) == N64_XFER_BUSY) {
+    }
+    return status;
+}
+
+static n64_xfer_status_t wait_transfer(n64_controller_t *controller) {
+    n64_xfer_status_t status;
+    while ((status = n64_transfer_poll(controller)) == N64_XFER_BUSY) {
+    }
+    return status;
+}
+
+static void release_irq(void *arg) {
+    mock_joybus_release_irq(*(const uint *)arg);
+}
+
+static void test_init(void) {
+    // n64_init identifies the device with a blocking read
+    CHECK(n64_init(&s_ctrl[0], PIN_A));
+    CHECK(s_ctrl[0].connected);
+    CHECK(s_ctrl[0].driver != NULL && s_ctrl[0].driver->type == N64_DEVICE_CONTROLLER);
+    CHECK_EQ(s_ctrl[0].device_step, N64_DEVICE_STEP_POLL);
+    CHECK_EQ(s_ctrl[0].xfer_state, N64_XFER_IDLE);
+
+    CHECK(n64_init(&s_ctrl[1], PIN_B));
+    CHECK(!s_ctrl[1].connected);
+    CHECK_EQ(s_ctrl[1].device_step, N64_DEVICE_STEP_IDENTIFY);
+}
+
+static void test_done(void) {
+    n64_controller_t *c = &s_ctrl[0];
+    n64_device_state_t state;
+    mock_device_set_n64(&s_pad[0], N64_MASK_A, N64_MASK_L, 40, -40);
+
+    // Starting returns with the frame on the wire, a second start is refused
+    uint64_t start_ns = mock_now_ns();
+    CHECK(n64_read_start(c));
+    CHECK(mock_now_ns() - start_ns < 20000);
+    CHECK_EQ(n64_read_poll(c, &state), N64_XFER_BUSY);
+    CHECK(!n64_read_start(c));
+
+    // The PIO IRQ completes the frame without being polled
+    mock_advance_us(300);
+    CHECK_EQ(c->xfer_state, N64_XFER_DONE);
+    uint32_t wire_us = (uint32_t)(c->xfer_done_us - c->xfer_start_us);
+    printf("status frame: %u us\n", wire_us);
+    CHECK(wire_us >= 150 && wire_us <= 200);
+
+    // Reported once, then back to IDLE
+    CHECK_EQ(n64_read_poll(c, &state), N64_XFER_DONE);
+    CHECK_EQ(state.type, N64_DEVICE_CONTROLLER);
+    CHECK_EQ(state.n64.buttons0, N64_MASK_A);
+    CHECK_EQ(state.n64.buttons1, N64_MASK_L);
+    CHECK_EQ(state.n64.stick_x, 40);
+    CHECK_EQ(state.n64.stick_y, -40);
+    CHECK_EQ(c->xfer_state, N64_XFER_IDLE);
+    CHECK_EQ(n64_transfer_poll(c), N64_XFER_IDLE);
+    CHECK_EQ(c->next_xfer_us, c->xfer_done_us + N64_FRAME_GAP_US);
+
+    n64_xfer_stats_t stats;
+    CHECK(n64_get_xfer_stats(N64_CMD_STATUS, &stats));
+    CHECK(stats.count >= 1);
+    CHECK_EQ(stats.max_us, wire_us);
+}
+
+static void test_absent(void) {
+    // Empty port: ended by the presence window, well before the timeout
+    n64_controller_t *c = &s_ctrl[1];
+    n64_device_state_t state;
+    CHECK(n64_read_start(c));
+    uint64_t start_us = mock_now_us();
+    CHECK_EQ(wait_read(c, &state), N64_XFER_ABSENT);
+    CHECK(mock_now_us() - start_us < N64_TIMEOUT_FIRST_US / 2);
+    CHECK(!c->connected);
+    CHECK_EQ(c->xfer_state, N64_XFER_IDLE);
+}
+
+static void test_short_frame(void) {
+    n64_controller_t *c = &s_ctrl[0];
+    n64_device_state_t state;
+    mock_joybus_stats_t before, after;
+    mock_joybus_get_stats(&before);
+
+    // One byte instead of four: no end-of-frame IRQ, ERROR at the deadline
+    s_pad[0].short_next = 1;
+    CHECK(n64_read_start(c));
+    uint64_t start_us = c->xfer_start_us;
+    mock_advance_us(STATUS_TIMEOUT_US - 50);
+    CHECK_EQ(n64_read_poll(c, &state), N64_XFER_BUSY);
+    CHECK_EQ(wait_read(c, &state), N64_XFER_ERROR);
+    CHECK(mock_now_us() - start_us > STATUS_TIMEOUT_US);
+    CHECK(!c->connected);
+    CHECK_EQ(c->device_step, N64_DEVICE_STEP_IDENTIFY);
+
+    mock_joybus_get_stats(&after);
+    CHECK_EQ(after.stuck - before.stuck, 1);
+    CHECK_EQ(after.aborted - before.aborted, 1);
+
+    // Identified again (neutral state), then polled
+    CHECK(n64_read_start(c));
+    CHECK_EQ(wait_read(c, &state), N64_XFER_DONE);
+    CHECK(c->connected);
+    CHECK_EQ(state.n64.buttons0, 0);
+    CHECK(n64_read_start(c));
+    CHECK_EQ(wait_read(c, &state), N64_XFER_DONE);
+    CHECK_EQ(state.n64.buttons0, N64_MASK_A);
+}
+
+static void test_late_irq(void) {
+    n64_controller_t *c = &s_ctrl[0];
+    n64_device_state_t state;
+    uint pin = PIN_A;
+
+    // IRQ held past the end of the frame but raised before the deadline
+    s_pad[0].hold_next = 1;
+    CHECK(n64_read_start(c));
+    mock_advance_us(STATUS_TIMEOUT_US / 2);
+    CHECK_EQ(n64_read_poll(c, &state), N64_XFER_BUSY);
+    CHECK(mock_joybus_release_irq(pin));
+    CHECK_EQ(n64_read_poll(c, &state), N64_XFER_DONE);
+    CHECK_EQ(state.n64.buttons0, N64_MASK_A);
+
+    // Raised while the deadline is being handled, before the mask: the
+    // masked re-check finds the frame complete
+    s_pad[0].hold_next = 1;
+    CHECK(n64_read_start(c));
+    mock_advance_us(STATUS_TIMEOUT_US + 100);
+    mock_on_next_irq_disable(release_irq, &pin, false);
+    CHECK_EQ(n64_read_poll(c, &state), N64_XFER_DONE);
+    CHECK(c->connected);
+
+    // Never raised: ERROR, and the held flag does not leak into the next frame
+    s_pad[0].hold_next = 1;
+    CHECK(n64_read_start(c));
+    CHECK_EQ(wait_read(c, &state), N64_XFER_ERROR);
+    CHECK(!mock_joybus_release_irq(pin));
+    CHECK(n64_read_start(c));
+    CHECK_EQ(wait_read(c, &state), N64_XFER_DONE);
+    CHECK(n64_read_start(c));
+    CHECK_EQ(wait_read(c, &state), N64_XFER_DONE);
+    CHECK_EQ(state.n64.buttons0, N64_MASK_A);
+}
+
+static void test_batched_release(void) {
+    n64_device_state_t state;
+    mock_device_plug(PIN_B, &s_pad[1]);
+    mock_device_set_n64(&s_pad[1], N64_MASK_B, 0, 0, 0);
+    CHECK(n64_read_start(&s_ctrl[1]));
+    CHECK_EQ(wait_read(&s_ctrl[1], &state), N64_XFER_DONE);
+    CHECK(s_ctrl[1].connected);
+
+    // Prepared reads stay on hold, with no timeout, until released
+    mock_joybus_stats_t before, after;
+    mock_joybus_get_stats(&before);
+    CHECK(n64_read_prepare(&s_ctrl[0]));
+    CHECK(n64_read_prepare(&s_ctrl[1]));
+    mock_advance_us(STATUS_TIMEOUT_US * 2);
+    CHECK_EQ(n64_read_poll(&s_ctrl[0], &state), N64_XFER_BUSY);
+    CHECK_EQ(n64_read_poll(&s_ctrl[1], &state), N64_XFER_BUSY);
+    mock_joybus_get_stats(&after);
+    CHECK_EQ(after.frames, before.frames);
+
+    // Both frames start in the same cycle
+    n64_transfer_release(s_ctrl, 2);
+    CHECK_EQ(wait_read(&s_ctrl[0], &state), N64_XFER_DONE);
+    CHECK_EQ(state.n64.buttons0, N64_MASK_A);
+    CHECK_EQ(wait_read(&s_ctrl[1], &state), N64_XFER_DONE);
+    CHECK_EQ(state.n64.buttons0, N64_MASK_B);
+    CHECK_EQ(mock_joybus_last_frame_ns(PIN_A), mock_joybus_last_frame_ns(PIN_B));
+}
+
+static void test_pak_commands(void) {
+    n64_controller_t *c = &s_ctrl[0];
+    mock_device_set_accessory(&s_pad[0], MOCK_ACCESSORY_CPAK);
+    uint16_t address = mock_pak_address_crc(0x0120);
+
+    // Write: 35 command bytes, the TX FIFO fed by DMA while the frame runs
+    uint8_t cmd[N64_CMD_MAX_LEN];
+    uint8_t response[33];
+    cmd[0] = N64_CMD_WRITE;
+    cmd[1] = (uint8_t)(address >> 8);
+    cmd[2] = (uint8_t)address;
+    for (uint i = 0; i < 32; i++) {
+        cmd[3 + i] = (uint8_t)(i * 9 + 1);
+    }
+    mock_joybus_stats_t before, after;
+    mock_joybus_get_stats(&before);
+    CHECK(n64_command_async(c, cmd, sizeof(cmd), response, 1));
+    CHECK_EQ(n64_transfer_poll(c), N64_XFER_BUSY);
+    CHECK_EQ(wait_transfer(c), N64_XFER_DONE);
+    CHECK_EQ(response[0], mock_pak_data_crc(&cmd[3]));
+    CHECK(memcmp(&s_pad[0].pak[0x0120], &cmd[3], 32) == 0);
+    mock_joybus_get_stats(&after);
+    CHECK_EQ(after.tx_stalls, before.tx_stalls);
+    CHECK_EQ(s_pad[0].address_crc_errors, 0);
+
+    // Read: 33 response bytes drained one per DMA transfer
+    cmd[0] = N64_CMD_READ;
+    memset(response, 0, sizeof(response));
+    CHECK(n64_command_async(c, cmd, 3, response, sizeof(response)));
+    CHECK_EQ(wait_transfer(c), N64_XFER_DONE);
+    CHECK(memcmp(response, &cmd[3], 32) == 0);
+    CHECK_EQ(response[32], mock_pak_data_crc(&cmd[3]));
+
+    // Invalid lengths are refused without touching the line, reported as ERROR once
+    mock_joybus_get_stats(&before);
+    CHECK(!n64_command_async(c, cmd, N64_CMD_MAX_LEN + 1, response, 1));
+    CHECK(!n64_command_async(c, cmd, 3, response, 0));
+    mock_joybus_get_stats(&after);
+    CHECK_EQ(after.frames, before.frames);
+    CHECK_EQ(n64_transfer_poll(c), N64_XFER_ERROR);
+    CHECK_EQ(n64_transfer_poll(c), N64_XFER_IDLE);
+}
+
+int main(void) {
+    rig_reset();
+    mock_device_init(&s_pad[0], MOCK_DEVICE_N64);
+    mock_device_init(&s_pad[1], MOCK_DEVICE_N64);
+    mock_device_plug(PIN_A, &s_pad[0]);
+
+    test_init();
+    test_done();
+    test_absent();
+    test_short_frame();
+    test_late_irq();
+    test_batched_release();
+    test_pak_commands();
+    return test_result("test_transfer");
+}
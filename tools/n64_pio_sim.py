@@ -0,0 +1,751 @@
+#!/usr/bin/env python3
+"""
+N64 PIO timing simulator
+
+Cycle-level emulator for src/n64/n64_controller.pio running against a
+simulated open-drain Joybus line and a scripted controller model.
+
+For each scenario and clk_sys value it reports:
+  - host bit timing: low/high widths of every command and stop bit (ns)
+  - receive sample points: distance from each `in pins` sample to the
+    rising edge of a '1' bit and of a '0' bit (margin, ns)
+  - decoded response bytes and end-of-frame IRQ time
+
+FIFO packing mirrors n64_controller.c: a TX header word (response length
+- 1 in bits 31-24, command bits - 1 in bits 23-8, first command byte in
+bits 7-0) followed by the rest of the command, inverted, 4 bytes per word;
+for responses of up to 4 bytes, one RX word (autopush at 8 * length bits).
+
+The pak scenarios run Controller Pak block reads and writes (3- and
+35-byte commands) against a simulated pak that checks the address CRC and
+answers with the data CRC, as n64_pak.c expects.
+
+The exit code is non-zero when a check fails (wrong bytes, missing IRQ,
+bit widths outside tolerance, sample margin too small), so the script can
+gate changes to the PIO program or its clock divider.
+
+Model (RP2040 datasheet, chapter 3):
+  - fractional clock divider (8-bit fraction), one instruction per tick
+  - side-set applied on the first cycle of an instruction, even if stalled
+  - delay cycles counted after the instruction completes
+  - PULL IFEMPTY when the shift count reached the threshold (no autopull),
+    autopush on IN, TX FIFO fed and RX FIFO drained immediately (DMA)
+  - 2 clk_sys cycles of input synchroniser latency
+  - line low if the state machine drives it (pindir = output, value 0) or
+    the controller drives it; optional pull-up rise time
+
+Usage:
+  tools/n64_pio_sim.py [--clk-sys 125e6,133e6] [--scenario status,absent]
+                       [--verbose]
+"""
+
+import argparse
+import bisect
+import os
+import re
+import sys
+
+DEFAULT_PIO = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                           '..', 'src', 'n64', 'n64_controller.pio')
+
+NOMINAL_BIT_NS = 4000
+NOMINAL_SHORT_NS = 1000
+NOMINAL_LONG_NS = 3000
+CONTROLLER_STOP_LOW_NS = 2000
+RX_WORD_MAX = 4                 # N64_RX_WORD_MAX: responses packed in one RX word
+
+# ---------------------------------------------------------------------
+# Assembler (subset of pioasm used by the N64 program)
+# ---------------------------------------------------------------------
+
+class Instr:
+    def __init__(self, op, args, side, delay, line):
+        self.op = op
+        self.args = args
+        self.side = side
+        self.delay = delay
+        self.line = line
+
+    def __repr__(self):
+        return '%s %s' % (self.op, ', '.join(self.args))
+
+
+class Program:
+    def __init__(self):
+        self.name = None
+        self.instrs = []
+        self.labels = {}
+        self.defines = {}
+        self.wrap_target = 0
+        self.wrap = None
+        self.side_set_opt = False
+        self.side_set_pindirs = False
+
+
+def eval_expr(expr, defines):
+    expr = expr.strip()
+    if not expr:
+        return 0
+    names = dict(defines)
+    if not re.fullmatch(r'[\w\s+\-*/()]+', expr):
+        raise ValueError('unsupported expression: %s' % expr)
+    return int(eval(expr, {'__builtins__': {}}, names))
+
+
+def assemble(path):
+    prog = Program()
+    pending = []  # (Instr, raw delay expr, raw side expr)
+
+    with open(path) as f:
+        text = f.read()
+    text = re.sub(r'% c-sdk \{.*?%\}', '', text, flags=re.S)
+
+    for lineno, raw in enumerate(text.splitlines(), 1):
+        line = raw.split(';', 1)[0].strip()
+        if not line:
+            continue
+
+        m = re.match(r'\.program\s+(\w+)', line)
+        if m:
+            prog.name = m.group(1)
+            continue
+        m = re.match(r'\.define\s+(?:public\s+)?(\w+)\s+(.+)', line)
+        if m:
+            prog.defines[m.group(1)] = eval_expr(m.group(2), prog.defines)
+            continue
+        m = re.match(r'\.side_set\s+(\d+)(.*)', line)
+        if m:
+            opts = m.group(2).split()
+            prog.side_set_opt = 'opt' in opts
+            prog.side_set_pindirs = 'pindirs' in opts
+            continue
+        if line == '.wrap_target':
+            prog.wrap_target = len(pending)
+            continue
+        if line == '.wrap':
+            prog.wrap = len(pending) - 1
+            continue
+        if line.startswith('.'):
+            continue
+
+        m = re.match(r'(?:public\s+)?(\w+):\s*(.*)', line)
+        if m:
+            prog.labels[m.group(1)] = len(pending)
+            line = m.group(2).strip()
+            if not line:
+                continue
+
+        delay_expr = ''
+        m = re.search(r'\[([^\]]*)\]\s*$', line)
+        if m:
+            delay_expr = m.group(1)
+            line = line[:m.start()].strip()
+
+        side_expr = None
+        m = re.search(r'\bside\s+(\S+)\s*$', line)
+        if m:
+            side_expr = m.group(1)
+            line = line[:m.start()].strip()
+
+        parts = line.split(None, 1)
+        op = parts[0].lower()
+        args = re.split(r'[,\s]+', parts[1].strip()) if len(parts) > 1 else []
+        pending.append((Instr(op, args, None, 0, lineno), delay_expr, side_expr))
+
+    for instr, delay_expr, side_expr in pending:
+        instr.delay = eval_expr(delay_expr, prog.defines)
+        instr.side = eval_expr(side_expr, prog.defines) if side_expr is not None else None
+        prog.instrs.append(instr)
+
+    if prog.wrap is None:
+        prog.wrap = len(prog.instrs) - 1
+    if len(prog.instrs) > 32:
+        raise ValueError('program has %d instructions (max 32)' % len(prog.instrs))
+    return prog
+
+
+# ---------------------------------------------------------------------
+# Line and controller model
+# ---------------------------------------------------------------------
+
+class Controller:
+    """Scripted controller: decodes the host command, answers after a delay"""
+
+    def __init__(self, cmd_len, response, delay_ns, bit_scale, present=True):
+        self.cmd_len = cmd_len
+        self.response = list(response)
+        self.delay_ns = delay_ns
+        self.bit_scale = bit_scale
+        self.present = present
+        self.host_pulses = []       # (fall_ns, rise_ns)
+        self.low_intervals = []     # controller-driven (start, end)
+        self.bits = []              # (fall_ns, low1_end, low0_end, next_fall, value)
+        self.stop_end_ns = None
+
+    def on_host_pulse(self, fall, rise):
+        self.host_pulses.append((fall, rise))
+        if not self.present or len(self.host_pulses) != self.cmd_len * 8 + 1:
+            return
+        self.respond(self.command_bytes())
+        if not self.present:
+            return
+
+        # Host stop bit complete: schedule the response
+        period = NOMINAL_BIT_NS * self.bit_scale
+        short = NOMINAL_SHORT_NS * self.bit_scale
+        long_ = NOMINAL_LONG_NS * self.bit_scale
+        t = rise + self.delay_ns
+        for byte in self.response:
+            for bit in range(7, -1, -1):
+                value = (byte >> bit) & 1
+                low = short if value else long_
+                self.low_intervals.append((t, t + low))
+                self.bits.append((t, t + short, t + long_, t + period, value))
+                t += period
+        stop = CONTROLLER_STOP_LOW_NS * self.bit_scale
+        self.low_intervals.append((t, t + stop))
+        self.stop_end_ns = t + stop
+
+    def command_bytes(self):
+        """Command as decoded from the host pulse widths (stop bit excluded)"""
+        data = []
+        for i in range(self.cmd_len):
+            byte = 0
+            for fall, rise in self.host_pulses[8 * i:8 * i + 8]:
+                byte = (byte << 1) | (1 if rise - fall < 2000 else 0)
+            data.append(byte)
+        return data
+
+    def respond(self, command):
+        """Hook for models whose answer depends on the command"""
+        pass
+
+    def drives_low(self, t):
+        # Intervals are sorted: only the last one starting before t matters
+        i = bisect.bisect_right(self.low_intervals, (t, float('inf'))) - 1
+        return i >= 0 and t < self.low_intervals[i][1]
+
+    def last_release_before(self, t):
+        last = None
+        for start, end in self.low_intervals:
+            if end <= t:
+                last = end
+        return last
+
+    def bit_at(self, t):
+        for bit in self.bits:
+            if bit[0] <= t < bit[3]:
+                return bit
+        return None
+
+
+class Pak(Controller):
+    """Controller with a Controller Pak: block reads and writes"""
+
+    def __init__(self, cmd_len, delay_ns, bit_scale):
+        Controller.__init__(self, cmd_len, [], delay_ns, bit_scale)
+        self.memory = bytearray((i * 7 + 3) & 0xFF for i in range(PAK_SIZE))
+        self.errors = []
+
+    def respond(self, command):
+        address = (command[1] << 8) | command[2]
+        if address & 0x1F != pak_address_crc(address):
+            self.errors.append('pak address CRC mismatch')
+            self.present = False        # A pak ignores the command
+            return
+        address &= ~0x1F
+        if command[0] == N64_CMD_READ:
+            data = list(self.memory[address:address + 32])
+            self.response = data + [pak_data_crc(data)]
+        else:
+            data = command[3:35]
+            self.memory[address:address + 32] = bytes(data)
+            self.response = [pak_data_crc(data)]
+
+
+# ---------------------------------------------------------------------
+# Controller Pak CRCs (same as n64_pak.c)
+# ---------------------------------------------------------------------
+
+N64_CMD_READ = 0x02
+N64_CMD_WRITE = 0x03
+PAK_SIZE = 0x8000
+
+
+def pak_address_crc(address):
+    table = [0x15, 0x1F, 0x0B, 0x16, 0x19, 0x07, 0x0E, 0x1C, 0x0D, 0x1A, 0x01]
+    crc = 0
+    for bit in range(5, 16):
+        if address & (1 << bit):
+            crc ^= table[bit - 5]
+    return crc
+
+
+def pak_data_crc(data):
+    crc = 0
+    for byte in list(data) + [0]:
+        for bit in range(7, -1, -1):
+            top = crc & 0x80
+            crc = ((crc << 1) | ((byte >> bit) & 1)) & 0xFF
+            if top:
+                crc ^= 0x85
+    return crc
+
+
+def pak_read_command(address):
+    address &= ~0x1F
+    address |= pak_address_crc(address)
+    return [N64_CMD_READ, address >> 8, address & 0xFF]
+
+
+def pak_write_command(address, data):
+    return [N64_CMD_WRITE] + pak_read_command(address)[1:] + list(data)
+
+
+class HostPin:
+    """State machine output: history of pindir changes (True = driving low)"""
+
+    def __init__(self):
+        self.history = [(-1e18, False)]
+        self.fall = None
+
+    def set(self, t, driving, controller):
+        if driving == self.history[-1][1]:
+            return
+        self.history.append((t, driving))
+        if driving:
+            self.fall = t
+        elif self.fall is not None:
+            controller.on_host_pulse(self.fall, t)
+            self.fall = None
+
+    def driving_at(self, t):
+        # Queries follow the simulation time: search from the newest change
+        for when, driving in reversed(self.history):
+            if when <= t:
+                return driving
+        return False
+
+    def last_release_before(self, t):
+        last = None
+        for when, driving in self.history:
+            if when > t:
+                break
+            if not driving:
+                last = when
+        return last
+
+
+class Line:
+    def __init__(self, host, controller, rise_ns):
+        self.host = host
+        self.controller = controller
+        self.rise_ns = rise_ns
+
+    def level(self, t):
+        if self.host.driving_at(t) or self.controller.drives_low(t):
+            return 0
+        if self.rise_ns > 0:
+            for release in (self.host.last_release_before(t),
+                            self.controller.last_release_before(t)):
+                if release is not None and t - release < self.rise_ns:
+                    return 0
+        return 1
+
+
+# ---------------------------------------------------------------------
+# State machine
+# ---------------------------------------------------------------------
+
+class StateMachine:
+    def __init__(self, prog, out_thresh=32, in_thresh=8, autopull=False):
+        self.prog = prog
+        self.pc = prog.wrap_target
+        self.x = 0
+        self.y = 0
+        self.osr = 0
+        self.osr_count = 32         # Empty
+        self.isr = 0
+        self.isr_count = 0
+        self.out_thresh = out_thresh
+        self.autopull = autopull
+        self.in_thresh = in_thresh
+        self.tx_fifo = []
+        self.rx_fifo = []
+        self.pindir = 0             # 0 = input (released), 1 = output (low)
+        self.delay = 0
+        self.irq_times = []
+        self.samples = []           # (tick time, sample time, value)
+
+    def osre(self):
+        return self.osr_count >= self.out_thresh
+
+    def step(self, t, pin):
+        """Execute one PIO tick. pin = synchronised input level"""
+        if self.delay > 0:
+            self.delay -= 1
+            return
+
+        instr = self.prog.instrs[self.pc]
+        if instr.side is not None:
+            self.pindir = instr.side
+
+        result = self.execute(instr, t, pin)
+        if result == 'stall':
+            return
+
+        if result is not None:
+            self.pc = result
+        elif self.pc == self.prog.wrap:
+            self.pc = self.prog.wrap_target
+        else:
+            self.pc += 1
+        self.delay = instr.delay
+
+    def target(self, name):
+        if name in self.prog.labels:
+            return self.prog.labels[name]
+        return eval_expr(name, self.prog.defines)
+
+    def execute(self, instr, t, pin):
+        op, a = instr.op, instr.args
+
+        if op == 'nop':
+            return None
+
+        if op == 'jmp':
+            if len(a) == 1:
+                return self.target(a[0])
+            cond, dest = a[0].lower(), a[1]
+            if cond == '!x':
+                taken = self.x == 0
+            elif cond == 'x--':
+                taken = self.x != 0
+                self.x = (self.x - 1) & 0xFFFFFFFF
+            elif cond == '!y':
+                taken = self.y == 0
+            elif cond == 'y--':
+                taken = self.y != 0
+                self.y = (self.y - 1) & 0xFFFFFFFF
+            elif cond == 'x!=y':
+                taken = self.x != self.y
+            elif cond == 'pin':
+                taken = pin == 1
+            elif cond == '!osre':
+                taken = not self.osre()
+            else:
+                raise ValueError('unsupported jmp condition %s' % cond)
+            return self.target(dest) if taken else None
+
+        if op == 'out':
+            count = eval_expr(a[1], self.prog.defines) or 32
+            if self.autopull and self.osre():
+                if not self.tx_fifo:
+                    return 'stall'
+                self.osr = self.tx_fifo.pop(0)
+                self.osr_count = 0
+            value = (self.osr >> (32 - count)) & ((1 << count) - 1)
+            self.osr = (self.osr << count) & 0xFFFFFFFF
+            self.osr_count += count
+            self.write_dest(a[0].lower(), value)
+            return None
+
+        if op == 'pull':
+            flags = [x.lower() for x in a]
+            if 'ifempty' in flags and not self.osre():
+                return None
+            if not self.tx_fifo:
+                if 'noblock' in flags:
+                    self.osr = self.x
+                    self.osr_count = 0
+                    return None
+                return 'stall'
+            self.osr = self.tx_fifo.pop(0)
+            self.osr_count = 0
+            return None
+
+        if op == 'in':
+            count = eval_expr(a[1], self.prog.defines) or 32
+            src = a[0].lower()
+            if src != 'pins':
+                raise ValueError('unsupported in source %s' % src)
+            self.samples.append((t, pin))
+            self.isr = ((self.isr << count) | (pin & ((1 << count) - 1))) & 0xFFFFFFFF
+            self.isr_count += count
+            if self.isr_count >= self.in_thresh:
+                self.rx_fifo.append(self.isr)
+                self.isr = 0
+                self.isr_count = 0
+            return None
+
+        if op == 'push':
+            self.rx_fifo.append(self.isr)
+            self.isr = 0
+            self.isr_count = 0
+            return None
+
+        if op == 'set':
+            self.write_dest(a[0].lower(), eval_expr(a[1], self.prog.defines))
+            return None
+
+        if op == 'mov':
+            src = a[1].lower()
+            value = {'x': self.x, 'y': self.y, 'isr': self.isr,
+                     'osr': self.osr, 'null': 0, 'pins': pin}[src]
+            self.write_dest(a[0].lower(), value)
+            return None
+
+        if op == 'wait':
+            polarity = int(a[0])
+            source = a[1].lower()
+            if source != 'pin':
+                raise ValueError('unsupported wait source %s' % source)
+            return None if pin == polarity else 'stall'
+
+        if op == 'irq':
+            self.irq_times.append(t)
+            return None
+
+        raise ValueError('unsupported instruction %s (line %d)' % (op, instr.line))
+
+    def write_dest(self, dest, value):
+        if dest == 'x':
+            self.x = value & 0xFFFFFFFF
+        elif dest == 'y':
+            self.y = value & 0xFFFFFFFF
+        elif dest == 'isr':
+            self.isr = value & 0xFFFFFFFF
+            self.isr_count = 0
+        elif dest == 'osr':
+            self.osr = value & 0xFFFFFFFF
+            self.osr_count = 0
+        elif dest == 'pindirs':
+            self.pindir = value & 1
+        elif dest in ('null', 'pins'):
+            pass
+        else:
+            raise ValueError('unsupported destination %s' % dest)
+
+
+# ---------------------------------------------------------------------
+# Scenarios
+# ---------------------------------------------------------------------
+
+SCENARIOS = {
+    # name: (command bytes, response length, response (None = pak model),
+    #        delay_us, bit scale, controller present, response expected)
+    'status':      ([0x01], 4, [0x80, 0x20, 0x7F, 0x81], 2.0, 1.00, True, True),
+    'info':        ([0x00], 3, [0x05, 0x00, 0x02], 2.0, 1.00, True, True),
+    'slow-bits':   ([0x01], 4, [0xA5, 0x5A, 0x00, 0xFF], 2.0, 1.10, True, True),
+    'fast-bits':   ([0x01], 4, [0xA5, 0x5A, 0x00, 0xFF], 2.0, 0.90, True, True),
+    'late-reply':  ([0x01], 4, [0x00, 0x00, 0x01, 0xFF], 12.0, 1.00, True, True),
+    'too-late':    ([0x01], 4, [0x00, 0x00, 0x01, 0xFF], 24.0, 1.00, True, False),
+    'absent':      ([0x01], 4, [], 0.0, 1.00, False, False),
+    'pak-read':    (pak_read_command(0x1240), 33, None, 2.0, 1.00, True, True),
+    'pak-read-slow': (pak_read_command(0x7FE0), 33, None, 2.0, 1.10, True, True),
+    'pak-write':   (pak_write_command(0x0400, range(0xC0, 0xE0)), 1, None, 2.0, 1.00,
+                    True, True),
+}
+
+
+def tx_words(cmd, resp_len):
+    """TX FIFO words, as built by begin_transfer() in n64_controller.c"""
+    bits = 8 * len(cmd)
+    words = [((resp_len - 1) & 0xFF) << 24 | ((bits - 1) & 0xFFFF) << 8 |
+             (~cmd[0] & 0xFF)]
+    rest = [~b & 0xFF for b in cmd[1:]]
+    for i in range(0, len(rest), 4):
+        chunk = rest[i:i + 4]
+        word = 0
+        for b in chunk:
+            word = (word << 8) | b
+        words.append(word << (8 * (4 - len(chunk))))
+    return words
+
+
+def clkdiv_fixed(prog, clk_sys):
+    """Mirror of n64_controller_program_init(): 8-bit fractional divider"""
+    cycles_per_bit = (prog.defines['T1'] + prog.defines['T2']) // 4
+    div = clk_sys / (cycles_per_bit * 1000000.0)
+    return max(256, int(div * 256))     # 16.8 fixed point, as the SDK truncates
+
+
+def run(prog, clk_sys, name, args):
+    cmd, resp_len, response, delay_us, scale, present, expected = SCENARIOS[name]
+    div = clkdiv_fixed(prog, clk_sys)
+    sys_ns = 1e9 / clk_sys
+    sync_ns = 2 * sys_ns
+
+    if response is None:
+        controller = Pak(len(cmd), delay_us * 1000, scale)
+    else:
+        controller = Controller(len(cmd), response, delay_us * 1000, scale, present)
+    host = HostPin()
+    line = Line(host, controller, args.rise_ns)
+    # Same FIFO packing as begin_transfer() in n64_controller.c
+    in_thresh = 8 * resp_len if resp_len <= RX_WORD_MAX else 8
+    sm = StateMachine(prog, in_thresh=in_thresh)
+    sm.tx_fifo = tx_words(cmd, resp_len)
+
+    end_ns = None
+    tick = 0
+    limit_ns = 4000000
+    while True:
+        t = (tick * div // 256) * sys_ns
+        if t > limit_ns:
+            break
+        pin = line.level(t - sync_ns)
+        sm.step(t, pin)
+        host.set(t, sm.pindir == 1, controller)
+        if sm.irq_times and end_ns is None:
+            end_ns = t + 5000           # Let the line settle, then stop
+        if end_ns is not None and t > end_ns:
+            break
+        tick += 1
+
+    return analyse(name, clk_sys, div, sm, controller, cmd,
+                   controller.response if expected else [], args)
+
+
+def unpack_rx(words, in_thresh):
+    """RX FIFO words -> response bytes, first byte in the top bits"""
+    data = []
+    for word in words:
+        for i in reversed(range(in_thresh // 8)):
+            data.append((word >> (8 * i)) & 0xFF)
+    return data
+
+
+def analyse(name, clk_sys, div, sm, controller, cmd, expected, args):
+    failures = []
+    lines = []
+    tol = args.tolerance / 100.0
+
+    lines.append('%-11s clk_sys %6.2f MHz, clkdiv %d + %d/256, PIO tick %.1f ns' %
+                 (name, clk_sys / 1e6, div >> 8, div & 0xFF, div / 256 * 1e9 / clk_sys))
+
+    # Host command bits (8 per byte + stop)
+    pulses = controller.host_pulses
+    bits = 8 * len(cmd)
+    if len(pulses) < bits + 1:
+        failures.append('host sent %d pulses, expected %d' % (len(pulses), bits + 1))
+    else:
+        if controller.command_bytes() != list(cmd):
+            failures.append('controller decoded command %s' %
+                            ' '.join('%02X' % b for b in controller.command_bytes()))
+        widths = {'1': [], '0': [], 'period': []}
+        for i in range(bits):
+            fall, rise = pulses[i]
+            low = rise - fall
+            bit = '1' if low < 2000 else '0'
+            widths[bit].append(low)
+            widths['period'].append(pulses[i + 1][0] - fall)
+        stop_low = pulses[bits][1] - pulses[bits][0]
+
+        checks = [('1 low', widths['1'], NOMINAL_SHORT_NS),
+                  ('0 low', widths['0'], NOMINAL_LONG_NS),
+                  ('period', widths['period'], NOMINAL_BIT_NS),
+                  ('stop low', [stop_low], NOMINAL_SHORT_NS)]
+        for label, values, nominal in checks:
+            if not values:
+                continue
+            lo, hi = min(values), max(values)
+            status = 'ok'
+            if lo < nominal * (1 - tol) or hi > nominal * (1 + tol):
+                status = 'DRIFT'
+                failures.append('host %s %.0f-%.0f ns, nominal %d +/-%.1f%%' %
+                                (label, lo, hi, nominal, args.tolerance))
+            lines.append('  host %-8s %7.0f .. %7.0f ns (nominal %d) %s' %
+                         (label, lo, hi, nominal, status))
+
+    # Receive sample points
+    if expected:
+        margin_1 = []   # sample - '1' rise
+        margin_0 = []   # '0' rise - sample
+        for t, _ in sm.samples:
+            sample_t = t - 2e9 / clk_sys
+            bit = controller.bit_at(sample_t)
+            if bit is None:
+                failures.append('sample at %.0f ns outside any response bit' % sample_t)
+                continue
+            # Edges as seen by the input: released line needs the rise time
+            margin_1.append(sample_t - (bit[1] + args.rise_ns))
+            margin_0.append(bit[2] + args.rise_ns - sample_t)
+        if margin_1:
+            worst = min(min(margin_1), min(margin_0))
+            status = 'ok' if worst >= args.min_margin_ns else 'LOW'
+            lines.append('  sample   after 1-rise %5.0f .. %5.0f ns, before 0-rise %5.0f .. %5.0f ns %s' %
+                         (min(margin_1), max(margin_1), min(margin_0), max(margin_0), status))
+            if worst < args.min_margin_ns:
+                failures.append('sample margin %.0f ns < %d ns' % (worst, args.min_margin_ns))
+
+    for error in getattr(controller, 'errors', []):
+        failures.append(error)
+
+    # Decoded data and end of frame
+    received = unpack_rx(sm.rx_fifo, sm.in_thresh)
+    if received != expected:
+        failures.append('received %s, expected %s' %
+                        (' '.join('%02X' % b for b in received) or '(none)',
+                         ' '.join('%02X' % b for b in expected) or '(none)'))
+    shown = ' '.join('%02X' % b for b in received[:8]) or '(none)'
+    if len(received) > 8:
+        shown += ' .. %02X (%d bytes)' % (received[-1], len(received))
+    lines.append('  data     %s (%d FIFO word%s)' %
+                 (shown, len(sm.rx_fifo), '' if len(sm.rx_fifo) == 1 else 's'))
+
+    if not sm.irq_times:
+        failures.append('end-of-frame IRQ never raised')
+    else:
+        irq = sm.irq_times[0]
+        if expected:
+            lines.append('  irq      %.0f ns after the controller stop bit' %
+                         (irq - controller.stop_end_ns))
+        else:
+            lines.append('  irq      %.0f ns after command start (no response)' % irq)
+
+    if args.verbose:
+        for fall, rise in pulses:
+            lines.append('    host pulse %9.0f .. %9.0f (%4.0f ns low)' % (fall, rise, rise - fall))
+
+    for f in failures:
+        lines.append('  FAIL     %s' % f)
+    return failures, lines
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--pio', default=DEFAULT_PIO, help='PIO source file')
+    parser.add_argument('--clk-sys', default='125e6,133e6,48e6,200e6',
+                        help='comma-separated clk_sys values in Hz')
+    parser.add_argument('--scenario', default=','.join(SCENARIOS),
+                        help='comma-separated scenarios: ' + ', '.join(SCENARIOS))
+    parser.add_argument('--tolerance', type=float, default=2.0,
+                        help='allowed host bit width error in percent (default 2)')
+    parser.add_argument('--min-margin-ns', type=int, default=200,
+                        help='minimum sample distance to a bit edge (default 200)')
+    parser.add_argument('--rise-ns', type=float, default=0.0,
+                        help='pull-up rise time of the line (default 0)')
+    parser.add_argument('--verbose', action='store_true')
+    args = parser.parse_args()
+
+    prog = assemble(args.pio)
+    print('%s: %d instructions, wrap %d..%d, T1=%d T2=%d' %
+          (prog.name, len(prog.instrs), prog.wrap_target, prog.wrap,
+           prog.defines.get('T1', 0), prog.defines.get('T2', 0)))
+
+    failed = 0
+    for clk in [float(c) for c in args.clk_sys.split(',')]:
+        for name in args.scenario.split(','):
+            if name not in SCENARIOS:
+                parser.error('unknown scenario %s' % name)
+            failures, lines = run(prog, clk, name, args)
+            print('\n'.join(lines))
+            failed += 1 if failures else 0
+
+    print('%d scenario run(s) failed' % failed if failed else 'all scenario runs passed')
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
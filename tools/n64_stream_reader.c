@@ -0,0 +1,243 @@
+/*
+ * N64 raw Joybus stream reader (Linux, hidraw)
+ *
+ * Reads the vendor HID interface enabled by PICO_N64_RAW_STREAM, decodes
+ * the raw controller frames, detects sequence gaps (frames dropped by the
+ * adapter or lost on the way) and prints the sustained frame rate.
+ *
+ * Build (from the repository root):
+ *   cc -O2 -Wall -Iinclude -o n64_stream_reader tools/n64_stream_reader.c
+ *
+ * Usage:
+ *   ./n64_stream_reader [-v] [/dev/hidrawN]
+ *   Without a device path the first hidraw node of the adapter exposing the
+ *   vendor usage page is used. -v prints every frame.
+ *   Reading /dev/hidraw* usually needs root or a udev rule.
+ */
+
+#define _GNU_SOURCE     // strcasestr
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "usb_descriptors.h"
+#include "usb_raw_stream.h"
+
+//--------------------------------------------------------------------
+// Configuration
+//--------------------------------------------------------------------
+#define REPORT_PERIOD_MS    1000        // Rate summary period
+#define MAX_PORTS           8
+
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+typedef struct {
+    uint64_t frames;
+    uint64_t reports;
+    uint64_t dropped;                   // Sum of sequence gaps
+    uint64_t port_frames[MAX_PORTS];
+} counters_t;
+
+static volatile sig_atomic_t s_stop = 0;
+
+//--------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------
+
+static void on_signal(int sig) {
+    (void)sig;
+    s_stop = 1;
+}
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static int read_file(const char *path, uint8_t *buf, size_t size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t len = read(fd, buf, size);
+    close(fd);
+    return (int)len;
+}
+
+// hidraw node of the adapter whose report descriptor is the vendor stream
+static int find_stream_device(char *path, size_t size) {
+    DIR *dir = opendir("/sys/class/hidraw");
+    if (dir == NULL) {
+        return -1;
+    }
+
+    char id[32];
+    snprintf(id, sizeof(id), "%08X:%08X", USB_VID, USB_PID);
+
+    struct dirent *entry;
+    int found = -1;
+    while (found < 0 && (entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "hidraw", 6) != 0) {
+            continue;
+        }
+
+        char file[512];
+        uint8_t buf[1024];
+        snprintf(file, sizeof(file), "/sys/class/hidraw/%s/device/uevent", entry->d_name);
+        int len = read_file(file, buf, sizeof(buf) - 1);
+        if (len <= 0) {
+            continue;
+        }
+        buf[len] = '\0';
+        if (strcasestr((char *)buf, id) == NULL) {
+            continue;
+        }
+
+        // Usage Page (Vendor Defined 0xFF00) first: the raw stream interface
+        snprintf(file, sizeof(file), "/sys/class/hidraw/%s/device/report_descriptor",
+                 entry->d_name);
+        len = read_file(file, buf, sizeof(buf));
+        if (len >= 3 && buf[0] == 0x06 && buf[1] == 0x00 && buf[2] == 0xFF) {
+            snprintf(path, size, "/dev/%s", entry->d_name);
+            found = 0;
+        }
+    }
+
+    closedir(dir);
+    return found;
+}
+
+static void print_frame(const raw_stream_frame_t *frame) {
+    static const char *const devices[] = {"--", "n64", "mouse", "gc"};
+    uint8_t device = (frame->flags & RAW_FRAME_DEVICE_MASK) >> RAW_FRAME_DEVICE_SHIFT;
+
+    printf("t=%10u seq=%5u P%u %s %-5s b0=%02X b1=%02X x=%4d y=%4d\n",
+           frame->timestamp_us, frame->seq, frame->port + 1,
+           (frame->flags & RAW_FRAME_RESPONDING) ? "ok  " : "none", devices[device],
+           frame->state.buttons0, frame->state.buttons1,
+           frame->state.stick_x, frame->state.stick_y);
+}
+
+static void print_rates(const counters_t *c, const counters_t *last, uint64_t elapsed_ms) {
+    printf("%6.0f frames/s, %5.0f reports/s, %llu dropped",
+           (double)(c->frames - last->frames) * 1000.0 / (double)elapsed_ms,
+           (double)(c->reports - last->reports) * 1000.0 / (double)elapsed_ms,
+           (unsigned long long)(c->dropped - last->dropped));
+    for (int i = 0; i < MAX_PORTS; i++) {
+        uint64_t n = c->port_frames[i] - last->port_frames[i];
+        if (n > 0) {
+            printf(" | P%d %.0f/s", i + 1, (double)n * 1000.0 / (double)elapsed_ms);
+        }
+    }
+    printf("\n");
+}
+
+//--------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------
+int main(int argc, char **argv) {
+    bool verbose = false;
+    char path[288] = "";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [-v] [/dev/hidrawN]\n", argv[0]);
+            return 2;
+        } else {
+            snprintf(path, sizeof(path), "%s", argv[i]);
+        }
+    }
+
+    if (path[0] == '\0' && find_stream_device(path, sizeof(path)) < 0) {
+        fprintf(stderr, "No raw stream interface found (adapter built with PICO_N64_RAW_STREAM?)\n");
+        return 1;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    printf("Reading %s\n", path);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    counters_t total = {0};
+    counters_t last = {0};
+    bool have_seq = false;
+    uint16_t next_seq = 0;
+    uint64_t start = now_ms();
+    uint64_t last_print = start;
+
+    while (!s_stop) {
+        raw_stream_report_t report;
+        ssize_t len = read(fd, &report, sizeof(report));
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "read: %s\n", strerror(errno));
+            break;
+        }
+        if (len == 0) {
+            break;      // Device unplugged (or end of a recorded file)
+        }
+        if (len != (ssize_t)sizeof(report) || report.magic != RAW_STREAM_MAGIC ||
+            report.count > RAW_STREAM_FRAMES_PER_REPORT) {
+            fprintf(stderr, "Malformed report (%zd bytes)\n", len);
+            continue;
+        }
+
+        total.reports++;
+        for (int i = 0; i < report.count; i++) {
+            const raw_stream_frame_t *frame = &report.frames[i];
+
+            // Sequence numbers are consumed even for frames the adapter dropped
+            if (have_seq && frame->seq != next_seq) {
+                total.dropped += (uint16_t)(frame->seq - next_seq);
+            }
+            next_seq = (uint16_t)(frame->seq + 1);
+            have_seq = true;
+
+            total.frames++;
+            if (frame->port < MAX_PORTS) {
+                total.port_frames[frame->port]++;
+            }
+            if (verbose) {
+                print_frame(frame);
+            }
+        }
+
+        uint64_t now = now_ms();
+        if (now - last_print >= REPORT_PERIOD_MS) {
+            print_rates(&total, &last, now - last_print);
+            last = total;
+            last_print = now;
+        }
+    }
+
+    close(fd);
+
+    uint64_t elapsed = now_ms() - start;
+    printf("Total: %llu frames in %llu reports over %.1f s, %llu dropped\n",
+           (unsigned long long)total.frames, (unsigned long long)total.reports,
+           (double)elapsed / 1000.0, (unsigned long long)total.dropped);
+    if (elapsed > 0) {
+        counters_t zero = {0};
+        printf("Sustained: ");
+        print_rates(&total, &zero, elapsed);
+    }
+    return 0;
+}
@@ -0,0 +1,350 @@
+/*
+ * N64 Transfer Pak cartridge dumper (Linux, usbfs)
+ *
+ * Asks the adapter (built with PICO_N64_TPAK) to dump the Game Boy
+ * cartridge in a Transfer Pak, saves the ROM or the SRAM to a file, checks
+ * the cartridge header checksum (and the global checksum of a ROM dump)
+ * and prints the transfer rate seen by the host and measured by the
+ * adapter.
+ *
+ * Build (from the repository root):
+ *   cc -O2 -Wall -Iinclude -o n64_tpak_dump tools/n64_tpak_dump.c
+ *
+ * Usage:
+ *   ./n64_tpak_dump [-p port] [-s | -i] [file]
+ *   -p  controller port, 1 = P1 (default)
+ *   -s  dump the SRAM (save) instead of the ROM
+ *   -i  identify the cartridge only
+ *   Without a file name the dump goes to <title>.gb (or <title>.sav).
+ *   Opening the /dev/bus/usb device nodes usually needs root or a udev rule.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/usbdevice_fs.h>
+
+#include "usb_descriptors.h"
+#include "usb_tpak_stream.h"
+
+//--------------------------------------------------------------------
+// Configuration
+//--------------------------------------------------------------------
+#define TIMEOUT_MS          5000        // Per bulk transfer (header read included)
+#define READ_SIZE           4096        // Bytes per data transfer
+#define PROGRESS_MS         1000
+
+//--------------------------------------------------------------------
+// Private Variables
+//--------------------------------------------------------------------
+typedef struct {
+    int fd;
+    unsigned interface;
+    unsigned ep_out;
+    unsigned ep_in;
+} device_t;
+
+// n64_tpak_error_t order
+static const char *const s_status_names[] = {
+    "ok", "no controller", "accessory slot empty", "not a Transfer Pak", "no cartridge",
+    "unsupported cartridge", "no SRAM", "block I/O error", "aborted"
+};
+
+//--------------------------------------------------------------------
+// Private Functions - USB
+//--------------------------------------------------------------------
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static const char *status_name(uint8_t status) {
+    if (status == TPAK_STATUS_BUSY) {
+        return "adapter busy with another dump";
+    }
+    if (status == TPAK_STATUS_BAD_REQUEST) {
+        return "request rejected (port or version)";
+    }
+    return status < sizeof(s_status_names) / sizeof(s_status_names[0]) ? s_status_names[status] : "?";
+}
+
+// Vendor interface and its bulk endpoints, from the descriptors usbfs returns
+static bool parse_descriptors(const uint8_t *buf, size_t len, device_t *dev) {
+    if (len < 18 || buf[1] != 1 || (buf[8] | buf[9] << 8) != USB_VID ||
+        (buf[10] | buf[11] << 8) != USB_PID) {
+        return false;
+    }
+
+    bool in_vendor = false;
+    dev->ep_in = 0;
+    dev->ep_out = 0;
+    for (size_t pos = 18; pos + 2 <= len && buf[pos] >= 2; pos += buf[pos]) {
+        const uint8_t *d = &buf[pos];
+        if (d[1] == 4 && pos + 9 <= len) {              // Interface
+            in_vendor = (d[5] == 0xFF);
+            if (in_vendor) {
+                dev->interface = d[2];
+            }
+        } else if (d[1] == 5 && in_vendor && pos + 7 <= len && (d[3] & 0x03) == 2) {
+            if (d[2] & 0x80) {                          // Bulk endpoint
+                dev->ep_in = d[2];
+            } else {
+                dev->ep_out = d[2];
+            }
+        }
+    }
+    return dev->ep_in != 0 && dev->ep_out != 0;
+}
+
+static int open_device(device_t *dev) {
+    DIR *bus_dir = opendir("/dev/bus/usb");
+    if (bus_dir == NULL) {
+        return -1;
+    }
+
+    struct dirent *bus;
+    int found = -1;
+    while (found < 0 && (bus = readdir(bus_dir)) != NULL) {
+        if (bus->d_name[0] == '.') {
+            continue;
+        }
+        char path[300];
+        snprintf(path, sizeof(path), "/dev/bus/usb/%s", bus->d_name);
+        DIR *dev_dir = opendir(path);
+        if (dev_dir == NULL) {
+            continue;
+        }
+
+        struct dirent *entry;
+        while (found < 0 && (entry = readdir(dev_dir)) != NULL) {
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            char file[600];
+            snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+            int fd = open(file, O_RDWR);
+            if (fd < 0) {
+                continue;
+            }
+            uint8_t buf[1024];
+            ssize_t len = read(fd, buf, sizeof(buf));
+            if (len > 0 && parse_descriptors(buf, (size_t)len, dev)) {
+                dev->fd = fd;
+                found = 0;
+            } else {
+                close(fd);
+            }
+        }
+        closedir(dev_dir);
+    }
+
+    closedir(bus_dir);
+    return found;
+}
+
+static int bulk(device_t *dev, unsigned ep, void *data, unsigned len) {
+    struct usbdevfs_bulktransfer transfer = {
+        .ep = ep,
+        .len = len,
+        .timeout = TIMEOUT_MS,
+        .data = data,
+    };
+    return ioctl(dev->fd, USBDEVFS_BULK, &transfer);
+}
+
+//--------------------------------------------------------------------
+// Private Functions - Cartridge
+//--------------------------------------------------------------------
+
+// Header fields: response.gb_header[i] is Game Boy address 0x0134 + i
+#define GB(a)   ((a) - TPAK_GB_HEADER_START)
+
+static bool header_checksum_ok(const uint8_t *h) {
+    uint8_t sum = 0;
+    for (unsigned a = 0x0134; a < 0x014D; a++) {
+        sum = (uint8_t)(sum - h[GB(a)] - 1);
+    }
+    return sum == h[GB(0x014D)];
+}
+
+static void cart_title(const uint8_t *h, char *title) {
+    unsigned n = 0;
+    for (unsigned i = 0; i < 16 && h[i] != '\0'; i++) {
+        char c = (char)h[i];
+        title[n++] = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ? c : '_';
+    }
+    if (n == 0) {
+        strcpy(title, "cartridge");
+        n = 9;
+    }
+    title[n] = '\0';
+}
+
+//--------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------
+int main(int argc, char **argv) {
+    unsigned port = 1;
+    uint8_t command = TPAK_CMD_ROM;
+    const char *out_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            port = (unsigned)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-s") == 0) {
+            command = TPAK_CMD_SRAM;
+        } else if (strcmp(argv[i], "-i") == 0) {
+            command = TPAK_CMD_HEADER;
+        } else if (argv[i][0] == '-' || out_path != NULL) {
+            fprintf(stderr, "usage: %s [-p port] [-s | -i] [file]\n", argv[0]);
+            return 2;
+        } else {
+            out_path = argv[i];
+        }
+    }
+    if (port < 1 || port > 8) {
+        fprintf(stderr, "Port must be 1 to 8\n");
+        return 2;
+    }
+
+    device_t dev;
+    if (open_device(&dev) < 0) {
+        fprintf(stderr, "No Transfer Pak interface found (adapter built with PICO_N64_TPAK?)\n");
+        return 1;
+    }
+    if (ioctl(dev.fd, USBDEVFS_CLAIMINTERFACE, &dev.interface) < 0) {
+        fprintf(stderr, "claim interface %u: %s\n", dev.interface, strerror(errno));
+        return 1;
+    }
+
+    tpak_request_t request = {
+        .magic = {TPAK_REQUEST_MAGIC[0], TPAK_REQUEST_MAGIC[1]},
+        .version = TPAK_STREAM_VERSION,
+        .command = command,
+        .port = (uint8_t)(port - 1),
+    };
+    tpak_response_t response;
+    uint64_t start = now_ms();
+    if (bulk(&dev, dev.ep_out, &request, sizeof(request)) != (int)sizeof(request) ||
+        bulk(&dev, dev.ep_in, &response, sizeof(response)) != (int)sizeof(response) ||
+        memcmp(response.magic, TPAK_RESPONSE_MAGIC, 2) != 0) {
+        fprintf(stderr, "No response from the adapter: %s\n", strerror(errno));
+        return 1;
+    }
+
+    // Cartridge
+    char title[17] = "cartridge";
+    const uint8_t *h = response.gb_header;
+    bool header_ok = header_checksum_ok(h);
+    if (response.status == 0) {
+        cart_title(h, title);
+        printf("P%u: \"%s\", type 0x%02X, ROM %u KiB, SRAM %u bytes, header checksum %s\n",
+               port, title, h[GB(0x0147)], response.rom_size / 1024, response.ram_size,
+               header_ok ? "ok" : "BAD");
+    }
+
+    // Data, written as it arrives
+    FILE *out = NULL;
+    char name[32];
+    if (response.length != 0) {
+        if (out_path == NULL) {
+            snprintf(name, sizeof(name), "%s.%s", title, command == TPAK_CMD_SRAM ? "sav" : "gb");
+            out_path = name;
+        }
+        out = fopen(out_path, "wb");
+        if (out == NULL) {
+            fprintf(stderr, "%s: %s\n", out_path, strerror(errno));
+            return 1;
+        }
+    }
+
+    static uint8_t data[8 << 20];       // Largest ROM (MBC5, 8 MiB)
+    uint32_t length = response.length;
+    if (length > sizeof(data)) {
+        fprintf(stderr, "Unexpected dump length %u\n", length);
+        return 1;
+    }
+    uint32_t received = 0;
+    uint64_t data_start = now_ms();
+    uint64_t last_print = data_start;
+    while (received < length) {
+        uint32_t n = length - received;
+        if (n > READ_SIZE) {
+            n = READ_SIZE;
+        }
+        int len = bulk(&dev, dev.ep_in, &data[received], n);
+        if (len <= 0) {
+            fprintf(stderr, "\nRead failed after %u bytes: %s\n", received, strerror(errno));
+            return 1;
+        }
+        received += (uint32_t)len;
+
+        uint64_t now = now_ms();
+        if (now - last_print >= PROGRESS_MS) {
+            printf("\r%u / %u bytes, %.1f KB/s", received, length,
+                   (double)received / (double)(now - data_start));
+            fflush(stdout);
+            last_print = now;
+        }
+    }
+    uint64_t data_ms = now_ms() - data_start;
+    if (last_print != data_start) {
+        printf("\n");
+    }
+
+    tpak_trailer_t trailer;
+    if (bulk(&dev, dev.ep_in, &trailer, sizeof(trailer)) != (int)sizeof(trailer) ||
+        memcmp(trailer.magic, TPAK_TRAILER_MAGIC, 2) != 0) {
+        fprintf(stderr, "No trailer from the adapter\n");
+        return 1;
+    }
+    ioctl(dev.fd, USBDEVFS_RELEASEINTERFACE, &dev.interface);
+    close(dev.fd);
+
+    if (out != NULL) {
+        fwrite(data, 1, received, out);
+        fclose(out);
+    }
+    if (trailer.status != 0) {
+        fprintf(stderr, "Dump failed: %s (%u of %u bytes valid%s%s)\n", status_name(trailer.status),
+                trailer.bytes, length, out != NULL ? ", saved to " : "", out != NULL ? out_path : "");
+        return 1;
+    }
+    if (command == TPAK_CMD_HEADER) {
+        return header_ok ? 0 : 1;
+    }
+
+    // ROM: checksums over the file itself (header as dumped, global sum)
+    bool ok = header_ok;
+    if (command == TPAK_CMD_ROM && received >= 0x150) {
+        bool file_header_ok = header_checksum_ok(&data[TPAK_GB_HEADER_START]);
+        uint16_t global = 0;
+        for (uint32_t i = 0; i < received; i++) {
+            if (i != 0x014E && i != 0x014F) {
+                global = (uint16_t)(global + data[i]);
+            }
+        }
+        uint16_t expected = (uint16_t)(data[0x014E] << 8 | data[0x014F]);
+        printf("ROM header checksum %s, global checksum %04X (%s)\n",
+               file_header_ok ? "ok" : "BAD", global, global == expected ? "ok" : "mismatch");
+        ok = file_header_ok && memcmp(&data[TPAK_GB_HEADER_START], h, TPAK_GB_HEADER_LEN) == 0;
+    }
+
+    uint64_t total_ms = now_ms() - start;
+    printf("Saved %u bytes to %s in %.1f s\n", received, out_path, (double)total_ms / 1000.0);
+    printf("Host: %.1f KB/s over the data | adapter: %.1f KB/s sustained, Joybus busy %u%%, "
+           "%u retries, %u reads waited for USB\n",
+           data_ms ? (double)received / (double)data_ms : 0.0, trailer.bytes_per_s / 1000.0,
+           trailer.elapsed_us ? (unsigned)((uint64_t)trailer.wire_us * 100 / trailer.elapsed_us) : 0,
+           trailer.retries, trailer.stalls);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""
+N64 adapter trace decoder
+
+Turns the binary trace records sent on the debug UART (include/trace.h,
+one '~' + 24 hex digits line per record) back into readable text. Every
+other line of the log ([STATS], [LAT], boot messages) is passed through
+unchanged, so the decoder can sit directly behind the serial port.
+
+Event names and argument labels are read from the trace_event_t enum of
+include/trace.h, so new events need no change here.
+
+Record layout (little-endian, 12 bytes):
+  u32 timestamp_us, u8 event, u8 port (bit 7 = core1), u16 arg0, u32 arg1
+
+Usage:
+  tools/n64_trace_decode.py [--trace-only] [--relative] [log ...]
+  stty -F /dev/ttyUSB0 115200 raw && tools/n64_trace_decode.py /dev/ttyUSB0
+  Without a file the log is read from stdin.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+RECORD = struct.Struct('<IBBHI')
+PORT_CORE1 = 0x80
+PORT_NONE = 0x7F
+
+HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                      '..', 'include', 'trace.h')
+LINE_RE = re.compile(r'~([0-9a-fA-F]{%d})\s*$' % (2 * RECORD.size))
+ENUM_RE = re.compile(r'^\s*TRACE_EV_(\w+)\s*(?:=\s*(\d+))?\s*,\s*(?://\s*(.*))?$')
+ARG_RE = re.compile(r'(arg[01])\s*=\s*([^,)]+)')
+
+
+def load_events(path):
+    """Event id -> (name, {arg: label}) from the trace_event_t enum."""
+    events = {}
+    value = 0
+    in_enum = False
+    with open(path) as f:
+        for line in f:
+            if 'typedef enum' in line:
+                in_enum = True
+                value = 0
+                continue
+            if not in_enum:
+                continue
+            if line.strip().startswith('}'):
+                if 'trace_event_t' in line:
+                    break
+                in_enum = False
+                continue
+            m = ENUM_RE.match(line)
+            if not m:
+                continue
+            if m.group(2) is not None:
+                value = int(m.group(2))
+            labels = dict((a, l.strip()) for a, l in ARG_RE.findall(m.group(3) or ''))
+            events[value] = (m.group(1), labels)
+            value += 1
+    return events
+
+
+class Decoder:
+    def __init__(self, events, relative):
+        self.events = events
+        self.relative = relative
+        self.last_raw = None
+        self.time_us = 0
+        self.origin = None
+        self.records = 0
+        self.malformed = 0
+
+    def timestamp(self, raw):
+        # Unwrap the 32-bit device clock (records arrive in time order)
+        if self.last_raw is None:
+            self.time_us = raw
+        else:
+            delta = (raw - self.last_raw) & 0xFFFFFFFF
+            if delta >= 0x80000000:
+                delta -= 0x100000000    # Slightly out of order across cores
+            self.time_us += delta
+        self.last_raw = raw
+        if self.origin is None:
+            self.origin = self.time_us
+        return self.time_us - self.origin if self.relative else self.time_us
+
+    def format(self, payload):
+        ts, event, port, arg0, arg1 = RECORD.unpack(payload)
+        self.records += 1
+
+        name, labels = self.events.get(event, ('EVENT_%d' % event, {}))
+        core = 1 if port & PORT_CORE1 else 0
+        port &= ~PORT_CORE1
+        where = '--' if port == PORT_NONE else 'P%d' % (port + 1)
+
+        args = []
+        for key, value in (('arg0', arg0), ('arg1', arg1)):
+            label = labels.get(key)
+            if label is None:
+                continue
+            text = '0x%x' % value if 'mask' in label else str(value)
+            args.append('%s=%s' % (label.replace(' ', '_'), text))
+
+        return '[%12.6f] c%d %s %-15s %s' % (self.timestamp(ts) / 1e6, core, where, name,
+                                             ' '.join(args))
+
+    def line(self, text):
+        if not text.startswith('~'):
+            return None
+        m = LINE_RE.match(text)
+        if not m:
+            self.malformed += 1
+            return '# malformed trace line: %s' % text.strip()
+        return self.format(bytes.fromhex(m.group(1)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[1])
+    parser.add_argument('logs', nargs='*', help='UART logs or serial devices (default: stdin)')
+    parser.add_argument('--trace-only', action='store_true',
+                        help='drop the non-trace lines')
+    parser.add_argument('--relative', action='store_true',
+                        help='timestamps relative to the first record')
+    parser.add_argument('--header', default=HEADER, help='path to include/trace.h')
+    args = parser.parse_args()
+
+    decoder = Decoder(load_events(args.header), args.relative)
+    sources = args.logs or ['-']
+
+    try:
+        for source in sources:
+            stream = sys.stdin if source == '-' else open(source, errors='replace')
+            for text in stream:
+                text = text.rstrip('\r\n')
+                decoded = decoder.line(text)
+                if decoded is not None:
+                    print(decoded, flush=True)
+                elif not args.trace_only:
+                    print(text, flush=True)
+            if stream is not sys.stdin:
+                stream.close()
+    except KeyboardInterrupt:
+        pass
+
+    print('%d trace records, %d malformed lines' % (decoder.records, decoder.malformed),
+          file=sys.stderr)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())